@@ -225,8 +225,17 @@ struct spdk_bdev_ext_io_opts {
 	 * request is submitted.
 	 */
 	struct spdk_accel_sequence *accel_sequence;
+	/**
+	 * Data placement hint for write requests.  Writes carrying the same hint are expected
+	 * to have a similar lifetime, so bdevs that support data placement (e.g. NVMe namespaces
+	 * with Flexible Data Placement enabled) keep them together on the media.  Bdevs without
+	 * such support ignore it.  0 means no hint.
+	 */
+	uint16_t placement_hint;
+	/* Hole at bytes 42-47. */
+	uint8_t reserved42[6];
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_ext_io_opts) == 40, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_ext_io_opts) == 48, "Incorrect size");
 
 /**
  * Get the options for the bdev module.
@@ -103,6 +103,30 @@ bool spdk_bit_pool_is_allocated(const struct spdk_bit_pool *pool, uint32_t bit_i
  */
 uint32_t spdk_bit_pool_allocate_bit(struct spdk_bit_pool *pool);
 
+/**
+ * Allocate a given bit from the bit pool.
+ *
+ * \param pool Bit pool to allocate the bit from
+ * \param bit_index The index of the bit to allocate.
+ *
+ * \return 0 on success, -EINVAL if bit_index is out of range, -EBUSY if the bit
+ * has already been allocated.
+ */
+int spdk_bit_pool_allocate_bit_at(struct spdk_bit_pool *pool, uint32_t bit_index);
+
+/**
+ * Find a range of consecutive free bits in the bit pool.
+ *
+ * \param pool Bit pool to search.
+ * \param start_bit_index The index of the first bit to consider.
+ * \param num_bits Number of consecutive free bits to find.
+ *
+ * \return index of the first bit of the lowest range of num_bits free bits starting at
+ * or after start_bit_index, UINT32_MAX if there is no such range.
+ */
+uint32_t spdk_bit_pool_find_free_range(const struct spdk_bit_pool *pool, uint32_t start_bit_index,
+				       uint32_t num_bits);
+
 /**
  * Free a bit back to the bit pool.
  *
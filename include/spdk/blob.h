@@ -58,6 +58,14 @@ enum bs_clear_method {
 	BS_CLEAR_WITH_NONE,
 };
 
+enum bs_cluster_allocator {
+	/* Claim the lowest free cluster */
+	BS_CLUSTER_ALLOCATOR_FIRST_FIT,
+	/* Keep the clusters of each blob together, handing out extents of free
+	 * clusters to growing blobs */
+	BS_CLUSTER_ALLOCATOR_EXTENT,
+};
+
 struct spdk_blob_store;
 struct spdk_bs_dev;
 struct spdk_io_channel;
@@ -150,6 +158,36 @@ typedef int (*spdk_bs_esnap_dev_create)(void *bs_ctx, void *blob_ctx, struct spd
 					const void *esnap_id, uint32_t id_size,
 					struct spdk_bs_dev **bs_dev);
 
+/**
+ * Progress of the metadata replay done when loading a blobstore that was not shut down
+ * cleanly.
+ */
+struct spdk_bs_recovery_progress {
+	/** Number of pages in the metadata region. */
+	uint64_t md_pages_total;
+
+	/** Number of metadata pages read and checked so far. */
+	uint64_t md_pages_scanned;
+
+	/** Number of metadata pages found to be in use by blobs. */
+	uint64_t md_pages_used;
+
+	/** Number of metadata pages in use that were parsed so far. */
+	uint64_t md_pages_parsed;
+
+	/** Number of blobs found. */
+	uint64_t num_blobs;
+};
+
+/**
+ * Blobstore recovery progress callback.
+ *
+ * \param cb_arg Context passed via recovery_progress_arg of struct spdk_bs_opts.
+ * \param progress Current progress of the recovery. Only valid during the callback.
+ */
+typedef void (*spdk_bs_recovery_progress_cb)(void *cb_arg,
+		const struct spdk_bs_recovery_progress *progress);
+
 struct spdk_bs_dev_cb_args {
 	spdk_bs_dev_cpl		cb_fn;
 	struct spdk_io_channel	*channel;
@@ -302,8 +340,43 @@ struct spdk_bs_opts {
 	 * Context to pass with esnap_bs_dev_create.
 	 */
 	void *esnap_ctx;
+
+	/**
+	 * Cluster allocator. Only affects where new clusters are placed, not the on-disk format.
+	 * It is recorded in the super block along with cluster_extent_sz, and the recorded values
+	 * take precedence over these when the blobstore is loaded.
+	 */
+	enum bs_cluster_allocator cluster_allocator;
+
+	/**
+	 * Number of clusters in the extents handed out to growing blobs by
+	 * BS_CLUSTER_ALLOCATOR_EXTENT.
+	 */
+	uint32_t cluster_extent_sz;
+
+	/**
+	 * Called repeatedly while the metadata of a blobstore that was not shut down cleanly
+	 * is replayed during load, to report the progress of the recovery.
+	 */
+	spdk_bs_recovery_progress_cb recovery_progress_fn;
+
+	/**
+	 * Argument passed to recovery_progress_fn.
+	 */
+	void *recovery_progress_arg;
+
+	/**
+	 * Rate, in clusters per second, at which the clusters of deleted blobs are released
+	 * and cleared in the background. Deleting a blob then completes as soon as it is
+	 * marked for removal in its metadata, which survives a crash. 0 (the default) releases
+	 * and clears the clusters as part of the delete.
+	 *
+	 * The rate is recorded in the super block. When loading, 0 keeps the recorded rate and
+	 * any other value replaces it.
+	 */
+	uint32_t background_free_rate;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 88, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 116, "Incorrect size");
 
 /**
  * Initialize a spdk_bs_opts structure to the default blobstore option values.
@@ -559,8 +632,19 @@ struct spdk_blob_opts {
 	 * The size of data referenced by esnap_id, in bytes.
 	 */
 	uint64_t esnap_id_len;
+
+	/**
+	 * Track copy-on-write at page rather than cluster granularity. The first write to a
+	 * cluster shared with a snapshot then allocates the cluster without copying it, and
+	 * only the pages not written yet are read from the snapshot. Snapshots and clones of
+	 * the blob inherit this option. Requires use_extent_table and a blobstore with a 4 KiB
+	 * io unit size. Clusters whose extent page has no room left for the bitmap of their
+	 * written pages are still copied whole. Blobs created with it cannot be opened by older
+	 * versions of the blobstore.
+	 */
+	bool subcluster_cow;
 };
-SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 80, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 88, "Incorrect size");
 
 /**
  * Initialize a spdk_blob_opts structure to the default blob option values.
@@ -761,6 +845,107 @@ void spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *ch
 void spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
 				  spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
 
+struct spdk_bs_inflate_opts {
+	/**
+	 * The size of spdk_bs_inflate_opts according to the caller of this library is used for ABI
+	 * compatibility. The library uses this field to know how many fields in this
+	 * structure are valid. And the library will populate any remaining fields with default values.
+	 * New added fields should be put at the end of the struct.
+	 */
+	size_t opts_size;
+
+	/** Number of clusters copied at the same time. Default is 8. */
+	uint32_t queue_depth;
+
+	/** Maximum number of clusters copied per second, 0 for no limit. Default is 0. */
+	uint32_t rate_limit;
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_inflate_opts) == 16, "Incorrect size");
+
+/**
+ * Initialize a spdk_bs_inflate_opts structure to the default option values.
+ *
+ * \param opts spdk_bs_inflate_opts structure to initialize.
+ * \param opts_size It must be the size of struct spdk_bs_inflate_opts.
+ */
+void spdk_bs_inflate_opts_init(struct spdk_bs_inflate_opts *opts, size_t opts_size);
+
+/**
+ * Allocate all unallocated clusters in this blob and copy data from backing blob,
+ * with options.
+ *
+ * Same as spdk_bs_inflate_blob(), the clusters are copied with up to
+ * opts->queue_depth of them in flight, and no faster than opts->rate_limit clusters
+ * per second.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to inflate blob.
+ * \param blobid The id of the blob to inflate.
+ * \param opts Inflate options, NULL for the default ones.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_inflate_blob_ext(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			      spdk_blob_id blobid, const struct spdk_bs_inflate_opts *opts,
+			      spdk_blob_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Remove dependency on parent blob, with options.
+ *
+ * Same as spdk_bs_blob_decouple_parent(), the clusters are copied with up to
+ * opts->queue_depth of them in flight, and no faster than opts->rate_limit clusters
+ * per second.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to inflate blob.
+ * \param blobid The id of the blob.
+ * \param opts Inflate options, NULL for the default ones.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_decouple_parent_ext(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+				      spdk_blob_id blobid, const struct spdk_bs_inflate_opts *opts,
+				      spdk_blob_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Cancel the inflate or decouple in progress on a blob.
+ *
+ * No more clusters are copied, and the operation completes with -ECANCELED once the
+ * copies in flight are done. The blob keeps the clusters copied so far and stays a
+ * clone of its parent.
+ *
+ * \param bs blobstore.
+ * \param blobid The id of the blob.
+ *
+ * \return 0 on success, -ENOENT if no inflate or decouple is in progress on the blob.
+ */
+int spdk_bs_inflate_blob_cancel(struct spdk_blob_store *bs, spdk_blob_id blobid);
+
+/**
+ * Deduplicate the data of a blob against a snapshot.
+ *
+ * Each allocated cluster of the blob is compared with the data the snapshot holds
+ * at the same offset. Clusters with identical contents are released and from then
+ * on read from the snapshot, a later write allocates them again. A blob without a
+ * parent becomes a clone of the snapshot first. I/O to the blob is frozen while
+ * each cluster is compared.
+ *
+ * If the blob is read-only, is a clone of another blob or an external snapshot,
+ * or if the snapshot is not read-only, -EINVAL error is reported.
+ * It is also reported for a thin provisioned blob without a parent, if the snapshot
+ * holds data where the blob is not allocated.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to read the clusters.
+ * \param blobid The id of the blob to deduplicate.
+ * \param snapshotid The id of the snapshot to deduplicate against.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			spdk_blob_id blobid, spdk_blob_id snapshotid,
+			spdk_blob_op_complete cb_fn, void *cb_arg);
+
 struct spdk_blob_open_opts {
 	enum blob_clear_method  clear_method;
 
@@ -69,8 +69,36 @@ struct spdk_lvs_opts {
 	 * is being loaded, the lvolstore will not support external snapshots.
 	 */
 	spdk_bs_esnap_dev_create esnap_bs_dev_create;
+
+	/**
+	 * A function to be called to report the progress of the recovery of a lvolstore that
+	 * was not shut down cleanly while it is being loaded.
+	 */
+	spdk_bs_recovery_progress_cb recovery_progress_fn;
+
+	/** Argument passed to recovery_progress_fn. */
+	void *recovery_progress_arg;
+
+	/**
+	 * Cluster allocator of the blobstore. It is recorded in the blobstore when the
+	 * lvolstore is created, so it is ignored when the lvolstore is loaded.
+	 */
+	enum bs_cluster_allocator cluster_allocator;
+
+	/**
+	 * Number of clusters in the extents handed out to growing lvols by
+	 * BS_CLUSTER_ALLOCATOR_EXTENT. 0 selects the blobstore default.
+	 */
+	uint32_t cluster_extent_sz;
+
+	/**
+	 * Rate, in clusters per second, at which the clusters of deleted lvols are released in the
+	 * background. It is recorded in the blobstore. When loading, 0 keeps the recorded rate and
+	 * any other value replaces it.
+	 */
+	uint32_t background_free_rate;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_lvs_opts) == 88, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_lvs_opts) == 116, "Incorrect size");
 
 /**
  * Initialize an spdk_lvs_opts structure to the defaults.
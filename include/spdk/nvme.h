@@ -1113,7 +1113,7 @@ void spdk_nvme_ctrlr_set_remove_cb(struct spdk_nvme_ctrlr *ctrlr,
  * are actively using the NVMe device.
  *
  * Any pointers returned from spdk_nvme_ctrlr_get_ns(), spdk_nvme_ns_get_data(),
- * spdk_nvme_zns_ns_get_data(), and spdk_nvme_zns_ctrlr_get_data()
+ * spdk_nvme_ns_get_fdp_cfg(), spdk_nvme_zns_ns_get_data(), and spdk_nvme_zns_ctrlr_get_data()
  * may be invalidated by calling this function. The number of namespaces as returned
  * by spdk_nvme_ctrlr_get_num_ns() may also change.
  *
@@ -1163,7 +1163,7 @@ int spdk_nvme_ctrlr_reconnect_poll_async(struct spdk_nvme_ctrlr *ctrlr);
  * hot add event.
  *
  * Any pointers returned from spdk_nvme_ctrlr_get_ns(), spdk_nvme_ns_get_data(),
- * spdk_nvme_zns_ns_get_data(), and spdk_nvme_zns_ctrlr_get_data()
+ * spdk_nvme_ns_get_fdp_cfg(), spdk_nvme_zns_ns_get_data(), and spdk_nvme_zns_ctrlr_get_data()
  * may be invalidated by calling this function. The number of namespaces as returned
  * by spdk_nvme_ctrlr_get_num_ns() may also change.
  *
@@ -2203,6 +2203,38 @@ int spdk_nvme_ctrlr_cmd_set_feature_ns(struct spdk_nvme_ctrlr *ctrlr, uint8_t fe
 				       uint32_t payload_size, spdk_nvme_cmd_cb cb_fn,
 				       void *cb_arg, uint32_t ns_id);
 
+/**
+ * Set the controller-wide interrupt coalescing parameters (Interrupt Coalescing feature).
+ *
+ * The aggregation threshold and time are controller-wide: they apply to every I/O
+ * completion queue created with interrupts enabled, and have no effect on the admin
+ * queue. The SPDK PCIe transport polls its I/O completion queues and creates them
+ * with interrupts disabled, so there is no per-qpair setting. Coalescing only applies
+ * to controllers that signal completions with interrupts, so this is not supported
+ * for fabrics controllers.
+ *
+ * This function is thread safe and can be called at any point while the controller
+ * is attached to the SPDK NVMe driver.
+ *
+ * Call \ref spdk_nvme_ctrlr_process_admin_completions() to poll for completion
+ * of commands submitted through this function.
+ *
+ * \param ctrlr NVMe controller to manipulate.
+ * \param threshold Aggregation threshold: minimum number of completion queue entries
+ * to aggregate per interrupt vector before signaling an interrupt (0's based).
+ * \param time Aggregation time: maximum time in 100 microsecond increments that the
+ * controller may delay an interrupt due to coalescing. 0 means no delay.
+ * \param cb_fn Callback function to invoke when the feature has been set.
+ * \param cb_arg Argument to pass to the callback function.
+ *
+ * \return 0 if successfully submitted, -ENOTSUP if the controller is a fabrics controller,
+ * -ENOMEM if resources could not be allocated for this request, -ENXIO if the admin qpair
+ * is failed at the transport layer.
+ */
+int spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(struct spdk_nvme_ctrlr *ctrlr,
+		uint8_t threshold, uint8_t time,
+		spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+
 /**
  * Receive security protocol data from controller.
  *
@@ -2779,6 +2811,25 @@ void spdk_nvme_poll_group_free_stats(struct spdk_nvme_poll_group *group,
  */
 const struct spdk_nvme_ns_data *spdk_nvme_ns_get_data(struct spdk_nvme_ns *ns);
 
+/**
+ * Get the Flexible Data Placement configuration used by the namespace.
+ *
+ * The configuration is the FDP configuration descriptor, as defined by the NVMe
+ * specification, selected by the FDP feature of the namespace's Endurance Group.
+ * Writes are directed to a placement identifier by setting
+ * SPDK_NVME_IO_FLAGS_DATA_PLACEMENT_DIRECTIVE in the I/O flags and the placement
+ * identifier in the upper 16 bits of cdw13 (see \ref spdk_nvme_ns_cmd_ext_io_opts).
+ *
+ * This function is thread safe and can be called at any point while the controller
+ * is attached to the SPDK NVMe driver.
+ *
+ * \param ns Namespace.
+ *
+ * \return a pointer to the FDP configuration descriptor, or NULL if FDP is not
+ * enabled for the namespace's Endurance Group.
+ */
+const struct spdk_nvme_fdp_cfg_descriptor *spdk_nvme_ns_get_fdp_cfg(const struct spdk_nvme_ns *ns);
+
 /**
  * Get the namespace id (index number) from the given namespace handle.
  *
@@ -392,6 +392,119 @@ int spdk_nvme_zns_ext_report_zones(struct spdk_nvme_ns *ns, struct spdk_nvme_qpa
 				   enum spdk_nvme_zns_zra_report_opts report_opts, bool partial_report,
 				   spdk_nvme_cmd_cb cb_fn, void *cb_arg);
 
+/**
+ * Zone append write stream.
+ *
+ * A stream owns a range of empty zones of a namespace and spreads the writes submitted
+ * to it across several of them using zone append. Zones are opened implicitly by the
+ * first append, and finished once they cannot accept the next write. The LBA written
+ * by each append is reported in its completion callback.
+ */
+struct spdk_nvme_zns_stream;
+
+struct spdk_nvme_zns_stream_opts {
+	/** Zone start LBA of the first zone owned by the stream. */
+	uint64_t first_zone_slba;
+
+	/**
+	 * Number of consecutive zones owned by the stream, starting at first_zone_slba.
+	 * 0 means all the zones up to the end of the namespace.
+	 */
+	uint64_t num_zones;
+
+	/**
+	 * Number of zones written concurrently.
+	 * Defaults to 4, limited by the maximum number of open zones of the namespace.
+	 */
+	uint32_t max_open_zones;
+
+	/** Maximum number of outstanding zone appends per zone. */
+	uint32_t max_qd_per_zone;
+
+	/**
+	 * Writable capacity of each zone, in sectors. 0 means the zone size.
+	 * Must be set when the zone capacity of the namespace is smaller than its zone size.
+	 */
+	uint64_t zone_capacity;
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_zns_stream_opts) == 32, "Incorrect size");
+
+/**
+ * Completion callback of a write submitted to a zone append write stream.
+ *
+ * \param cb_arg Argument passed to spdk_nvme_zns_stream_write().
+ * \param lba First LBA written by the zone append. Only valid on success.
+ * \param cpl Completion queue entry of the zone append.
+ */
+typedef void (*spdk_nvme_zns_stream_cb)(void *cb_arg, uint64_t lba,
+					const struct spdk_nvme_cpl *cpl);
+
+/**
+ * Get the default options for a zone append write stream.
+ *
+ * \param ns Namespace the stream will be created on.
+ * \param opts Options structure to fill.
+ * \param opts_size Must be set to sizeof(struct spdk_nvme_zns_stream_opts).
+ */
+void spdk_nvme_zns_stream_get_default_opts(struct spdk_nvme_ns *ns,
+		struct spdk_nvme_zns_stream_opts *opts,
+		size_t opts_size);
+
+/**
+ * Create a zone append write stream.
+ *
+ * The zones owned by the stream must be empty and must not be written by anything
+ * else while the stream exists. The stream submits commands to the given qpair only,
+ * so it has the same threading rules as the qpair.
+ *
+ * \param ns Zoned namespace to write.
+ * \param qpair I/O queue pair used for zone append and zone management commands.
+ * \param opts Stream options, NULL to use the defaults.
+ * \param opts_size Must be set to sizeof(struct spdk_nvme_zns_stream_opts).
+ *
+ * \return the stream on success, NULL if the namespace is not zoned, the options are
+ * invalid or memory could not be allocated.
+ */
+struct spdk_nvme_zns_stream *spdk_nvme_zns_stream_create(struct spdk_nvme_ns *ns,
+		struct spdk_nvme_qpair *qpair,
+		const struct spdk_nvme_zns_stream_opts *opts,
+		size_t opts_size);
+
+/**
+ * Submit a write to a zone append write stream.
+ *
+ * The write is issued as a zone append to one of the zones currently written by the
+ * stream, in round-robin order. If all of them are at their maximum queue depth, the
+ * write is queued and submitted when an append completes.
+ *
+ * \param stream Stream to write.
+ * \param buffer Virtual address pointer to the data payload buffer.
+ * \param metadata Virtual address pointer to the metadata payload, or NULL.
+ * \param lba_count Length (in sectors) of the write. Must fit in a single zone append.
+ * \param cb_fn Callback function to invoke when the write is completed.
+ * \param cb_arg Argument to pass to the callback function.
+ * \param io_flags Set flags, defined by the SPDK_NVME_IO_FLAGS_* entries in spdk/nvme_spec.h.
+ *
+ * \return 0 if successfully submitted or queued, -EINVAL if the write does not fit in a
+ * zone, -ENOSPC if all the zones of the stream are full, -ENOMEM if the stream has no
+ * free request left, or another negated errno from the zone append or zone finish
+ * submission.
+ */
+int spdk_nvme_zns_stream_write(struct spdk_nvme_zns_stream *stream, void *buffer,
+			       void *metadata, uint32_t lba_count,
+			       spdk_nvme_zns_stream_cb cb_fn, void *cb_arg,
+			       uint32_t io_flags);
+
+/**
+ * Free a zone append write stream.
+ *
+ * \param stream Stream to free.
+ *
+ * \return 0 on success, -EBUSY if the stream still has outstanding writes or zone
+ * management commands, or another negated errno if a zone finish could not be submitted.
+ */
+int spdk_nvme_zns_stream_free(struct spdk_nvme_zns_stream *stream);
+
 #ifdef __cplusplus
 }
 #endif
@@ -445,9 +445,12 @@ int spdk_nvmf_subsystem_stop(struct spdk_nvmf_subsystem *subsystem,
 /**
  * Transition an NVMe-oF subsystem from Active to Paused state.
  *
- * In a paused state, all admin queues are frozen across the whole subsystem. If
- * a namespace ID is provided, all commands to that namespace are quiesced and incoming
- * commands for that namespace are queued until the subsystem is resumed.
+ * If no namespace ID is provided, all admin queues are frozen across the whole subsystem.
+ * If a namespace ID is provided, only the commands to that namespace are quiesced and
+ * incoming commands for that namespace are queued until the subsystem is resumed. Admin
+ * commands and the other namespaces keep being processed, so listeners cannot be added
+ * or removed while paused that way. SPDK_NVME_GLOBAL_NS_TAG freezes the admin queues
+ * and quiesces all namespaces.
  *
  * \param subsystem The NVMe-oF subsystem.
  * \param nsid The namespace to pause. If 0, pause no namespaces.
@@ -455,7 +458,8 @@ int spdk_nvmf_subsystem_stop(struct spdk_nvmf_subsystem *subsystem,
  * \param cb_arg Argument passed to cb_fn.
  *
  * \return 0 on success, or negated errno on failure. The callback provided will only
- * be called on success.
+ * be called on success. If the subsystem is already paused for a different namespace, the
+ * callback is called with -EBUSY.
  */
 int spdk_nvmf_subsystem_pause(struct spdk_nvmf_subsystem *subsystem,
 			      uint32_t nsid,
@@ -103,6 +103,9 @@ struct spdk_nvmf_request {
 	struct spdk_bdev_io		*zcopy_bdev_io; /* Contains the bdev_io when using ZCOPY */
 	enum spdk_nvmf_zcopy_phase	zcopy_phase;
 
+	/* Tick at which an I/O command started executing, for the per-namespace statistics */
+	uint64_t			exec_tsc;
+
 	TAILQ_ENTRY(spdk_nvmf_request)	link;
 };
 
@@ -135,6 +138,10 @@ struct spdk_nvmf_qpair {
 		struct spdk_nvmf_request	*connect_req;
 	};
 
+	/* I/O statistics of this qpair's host, indexed by nsid - 1 and allocated on first use */
+	struct spdk_nvmf_ns_io_stat		**ns_io_stats;
+	uint32_t				num_ns_io_stats;
+
 	TAILQ_HEAD(, spdk_nvmf_request)		outstanding;
 	TAILQ_ENTRY(spdk_nvmf_qpair)		link;
 };
@@ -92,6 +92,8 @@ DECLARE_WRAPPER(pthread_mutex_init, int,
 DECLARE_WRAPPER(pthread_mutexattr_init, int,
 		(pthread_mutexattr_t *attr));
 
+DECLARE_WRAPPER(readv, ssize_t, (int fd, const struct iovec *iov, int iovcnt));
+
 DECLARE_WRAPPER(recvmsg, ssize_t, (int sockfd, struct msghdr *msg, int flags));
 
 DECLARE_WRAPPER(sendmsg, ssize_t, (int sockfd, const struct msghdr *msg, int flags));
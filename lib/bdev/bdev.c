@@ -404,7 +404,7 @@ static int bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_i
 				      struct iovec *iov, int iovcnt, void *md_buf,
 				      uint64_t offset_blocks, uint64_t num_blocks,
 				      struct spdk_memory_domain *domain, void *domain_ctx,
-				      struct spdk_accel_sequence *seq,
+				      struct spdk_accel_sequence *seq, uint16_t placement_hint,
 				      spdk_bdev_io_completion_cb cb, void *cb_arg);
 
 static int bdev_lock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *_ch,
@@ -2910,6 +2910,7 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 						iov, iovcnt, md_buf, current_offset,
 						num_blocks, bdev_io->internal.memory_domain,
 						bdev_io->internal.memory_domain_ctx, NULL,
+						bdev_io->u.bdev.placement_hint,
 						bdev_io_split_done, bdev_io);
 		break;
 	case SPDK_BDEV_IO_TYPE_UNMAP:
@@ -5354,6 +5355,7 @@ bdev_write_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *c
 	bdev_io->u.bdev.memory_domain = NULL;
 	bdev_io->u.bdev.memory_domain_ctx = NULL;
 	bdev_io->u.bdev.accel_sequence = NULL;
+	bdev_io->u.bdev.placement_hint = 0;
 	bdev_io_init(bdev_io, bdev, cb_arg, cb);
 
 	bdev_io_submit(bdev_io);
@@ -5410,7 +5412,7 @@ bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *
 			   struct iovec *iov, int iovcnt, void *md_buf,
 			   uint64_t offset_blocks, uint64_t num_blocks,
 			   struct spdk_memory_domain *domain, void *domain_ctx,
-			   struct spdk_accel_sequence *seq,
+			   struct spdk_accel_sequence *seq, uint16_t placement_hint,
 			   spdk_bdev_io_completion_cb cb, void *cb_arg)
 {
 	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
@@ -5446,6 +5448,7 @@ bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *
 	bdev_io->u.bdev.memory_domain = domain;
 	bdev_io->u.bdev.memory_domain_ctx = domain_ctx;
 	bdev_io->u.bdev.accel_sequence = seq;
+	bdev_io->u.bdev.placement_hint = placement_hint;
 
 	_bdev_io_submit_ext(desc, bdev_io);
 
@@ -5475,7 +5478,7 @@ spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 			spdk_bdev_io_completion_cb cb, void *cb_arg)
 {
 	return bdev_writev_blocks_with_md(desc, ch, iov, iovcnt, NULL, offset_blocks,
-					  num_blocks, NULL, NULL, NULL, cb, cb_arg);
+					  num_blocks, NULL, NULL, NULL, 0, cb, cb_arg);
 }
 
 int
@@ -5493,7 +5496,7 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	}
 
 	return bdev_writev_blocks_with_md(desc, ch, iov, iovcnt, md_buf, offset_blocks,
-					  num_blocks, NULL, NULL, NULL, cb, cb_arg);
+					  num_blocks, NULL, NULL, NULL, 0, cb, cb_arg);
 }
 
 int
@@ -5524,6 +5527,7 @@ spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel
 					  bdev_get_ext_io_opt(opts, memory_domain, NULL),
 					  bdev_get_ext_io_opt(opts, memory_domain_ctx, NULL),
 					  bdev_get_ext_io_opt(opts, accel_sequence, NULL),
+					  bdev_get_ext_io_opt(opts, placement_hint, 0),
 					  cb, cb_arg);
 }
 
@@ -144,6 +144,10 @@ blob_bs_translate_lba(struct spdk_bs_dev *dev, uint64_t lba, uint64_t *base_lba)
 
 	assert(base_lba != NULL);
 	if (bs_io_unit_is_allocated(blob, lba)) {
+		if (bs_io_unit_to_partial_cluster(blob, lba) != NULL) {
+			/* Part of the cluster is still in the parent */
+			return false;
+		}
 		*base_lba = bs_blob_io_unit_to_lba(blob, lba);
 		return true;
 	}
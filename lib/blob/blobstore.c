@@ -7,6 +7,7 @@
 #include "spdk/stdinc.h"
 
 #include "spdk/blob.h"
+#include "spdk/barrier.h"
 #include "spdk/crc32.h"
 #include "spdk/env.h"
 #include "spdk/queue.h"
@@ -28,8 +29,11 @@ static int bs_register_md_thread(struct spdk_blob_store *bs);
 static int bs_unregister_md_thread(struct spdk_blob_store *bs);
 static void blob_close_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
 static void blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
-		uint64_t cluster, uint32_t extent, struct spdk_blob_md_page *page,
+		uint64_t cluster, uint32_t extent, struct spdk_blob_md_page *page, bool partial,
 		spdk_blob_op_complete cb_fn, void *cb_arg);
+static void blob_insert_cluster_msg(void *arg);
+static void blob_fill_partial_clusters(struct spdk_blob *blob, spdk_blob_op_complete cb_fn,
+				       void *cb_arg);
 
 static int blob_set_xattr(struct spdk_blob *blob, const char *name, const void *value,
 			  uint16_t value_len, bool internal);
@@ -40,6 +44,10 @@ static int blob_remove_xattr(struct spdk_blob *blob, const char *name, bool inte
 static void blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
 				   struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg);
 
+static int bs_pending_free_add(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			       struct spdk_blob *blob);
+static bool bs_blob_is_pending_free(struct spdk_blob_store *bs, spdk_blob_id blobid);
+
 /*
  * External snapshots require a channel per thread per esnap bdev.  The tree
  * is populated lazily as blob IOs are handled by the back_bs_dev. When this
@@ -134,6 +142,86 @@ bs_claim_cluster(struct spdk_blob_store *bs)
 	return cluster_num;
 }
 
+/*
+ * Claims a cluster for the blob with BS_CLUSTER_ALLOCATOR_EXTENT. Each growing blob
+ * gets an extent of free clusters, which it fills in order before getting the next
+ * one. New extents continue the previous one of the blob when possible, or else are
+ * taken after the last extent handed out, so that blobs growing at the same time do
+ * not interleave their clusters. Falls back to the lowest free cluster when free
+ * space is too fragmented, and keeps doing so without looking for free runs until
+ * enough clusters are released for one to possibly exist again.
+ */
+static uint32_t
+bs_claim_blob_cluster(struct spdk_blob *blob)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint32_t cluster_num = UINT32_MAX;
+	uint64_t i;
+
+	assert(spdk_spin_held(&bs->used_lock));
+
+	if (bs->cluster_allocator == BS_CLUSTER_ALLOCATOR_FIRST_FIT) {
+		return bs_claim_cluster(bs);
+	}
+
+	if (blob->next_cluster == 0) {
+		/* Try to continue after the last cluster of the blob, e.g. after it was reopened */
+		for (i = blob->active.num_clusters; i > 0; i--) {
+			if (bs_blob_cluster_lba(blob, i - 1) != 0) {
+				blob->next_cluster = bs_lba_to_cluster(bs, bs_blob_cluster_lba(blob, i - 1)) + 1;
+				break;
+			}
+		}
+	}
+
+	if (blob->next_cluster < blob->cluster_extent_end &&
+	    spdk_bit_pool_allocate_bit_at(bs->used_clusters, blob->next_cluster) == 0) {
+		cluster_num = blob->next_cluster;
+		goto out;
+	}
+
+	/* Don't scan for free runs again until enough clusters were released since the last
+	 * scans found none.
+	 */
+	if (!bs->clusters_fragmented) {
+		if (blob->next_cluster != 0 &&
+		    spdk_bit_pool_find_free_range(bs->used_clusters, blob->next_cluster,
+						  bs->cluster_extent_sz) == blob->next_cluster) {
+			cluster_num = blob->next_cluster;
+		} else {
+			cluster_num = spdk_bit_pool_find_free_range(bs->used_clusters, bs->next_cluster_extent,
+					bs->cluster_extent_sz);
+			if (cluster_num == UINT32_MAX) {
+				cluster_num = spdk_bit_pool_find_free_range(bs->used_clusters, 0,
+						bs->cluster_extent_sz);
+			}
+			if (cluster_num == UINT32_MAX) {
+				bs->clusters_fragmented = true;
+				bs->clusters_released = 0;
+			}
+		}
+	}
+
+	if (cluster_num != UINT32_MAX) {
+		spdk_bit_pool_allocate_bit_at(bs->used_clusters, cluster_num);
+		blob->cluster_extent_end = cluster_num + bs->cluster_extent_sz;
+		bs->next_cluster_extent = blob->cluster_extent_end;
+	} else {
+		cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+		if (cluster_num == UINT32_MAX) {
+			return UINT32_MAX;
+		}
+		blob->cluster_extent_end = 0;
+	}
+
+out:
+	SPDK_DEBUGLOG(blob, "Claiming cluster %u\n", cluster_num);
+	bs->num_free_clusters--;
+	blob->next_cluster = cluster_num + 1;
+
+	return cluster_num;
+}
+
 static void
 bs_release_cluster(struct spdk_blob_store *bs, uint32_t cluster_num)
 {
@@ -146,21 +234,265 @@ bs_release_cluster(struct spdk_blob_store *bs, uint32_t cluster_num)
 
 	spdk_bit_pool_free_bit(bs->used_clusters, cluster_num);
 	bs->num_free_clusters++;
+
+	if (bs->clusters_fragmented && ++bs->clusters_released >= bs->cluster_extent_sz) {
+		bs->clusters_fragmented = false;
+	}
+}
+
+/* Thin provisioned blobs larger than a chunk of clusters use a sparse cluster map. Its chunks
+ * are only allocated once one of their clusters is, so the memory used by the map follows
+ * the number of allocated clusters instead of the size of the blob.
+ */
+static bool
+blob_use_cluster_chunks(struct spdk_blob *blob, uint64_t num_clusters)
+{
+	return spdk_blob_is_thin_provisioned(blob) && num_clusters > SPDK_BLOB_CLUSTER_CHUNK_SZ;
+}
+
+static void
+blob_cluster_map_free(struct spdk_blob *blob)
+{
+	uint64_t num_chunks, i;
+
+	if (blob->active.cluster_chunks != NULL) {
+		num_chunks = spdk_divide_round_up(blob->active.cluster_array_size,
+						  SPDK_BLOB_CLUSTER_CHUNK_SZ);
+		for (i = 0; i < num_chunks; i++) {
+			free(blob->active.cluster_chunks[i]);
+		}
+		free(blob->active.cluster_chunks);
+		blob->active.cluster_chunks = NULL;
+	}
+
+	free(blob->active.clusters);
+	blob->active.clusters = NULL;
+	blob->active.cluster_array_size = 0;
 }
 
+/* Moves the flat cluster map of the blob to chunks */
 static int
-blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
+blob_cluster_map_to_chunks(struct spdk_blob *blob)
+{
+	uint64_t **chunks;
+	uint64_t num_chunks, count, i;
+
+	assert(blob->active.cluster_chunks == NULL);
+
+	num_chunks = spdk_divide_round_up(blob->active.cluster_array_size, SPDK_BLOB_CLUSTER_CHUNK_SZ);
+	chunks = calloc(spdk_max(num_chunks, 1), sizeof(*chunks));
+	if (chunks == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_chunks; i++) {
+		count = spdk_min(SPDK_BLOB_CLUSTER_CHUNK_SZ,
+				 blob->active.cluster_array_size - i * SPDK_BLOB_CLUSTER_CHUNK_SZ);
+		if (spdk_mem_all_zero(&blob->active.clusters[i * SPDK_BLOB_CLUSTER_CHUNK_SZ],
+				      count * sizeof(*blob->active.clusters))) {
+			continue;
+		}
+
+		chunks[i] = calloc(SPDK_BLOB_CLUSTER_CHUNK_SZ, sizeof(*chunks[i]));
+		if (chunks[i] == NULL) {
+			while (i > 0) {
+				free(chunks[--i]);
+			}
+			free(chunks);
+			return -ENOMEM;
+		}
+		memcpy(chunks[i], &blob->active.clusters[i * SPDK_BLOB_CLUSTER_CHUNK_SZ],
+		       count * sizeof(*chunks[i]));
+	}
+
+	free(blob->active.clusters);
+	blob->active.clusters = NULL;
+	blob->active.cluster_chunks = chunks;
+
+	return 0;
+}
+
+static int
+blob_cluster_chunks_resize(struct spdk_blob *blob, uint64_t sz)
+{
+	uint64_t **chunks = blob->active.cluster_chunks;
+	uint64_t num_chunks, new_num_chunks, i;
+
+	num_chunks = spdk_divide_round_up(blob->active.cluster_array_size, SPDK_BLOB_CLUSTER_CHUNK_SZ);
+	new_num_chunks = spdk_divide_round_up(sz, SPDK_BLOB_CLUSTER_CHUNK_SZ);
+
+	if (sz < blob->active.cluster_array_size) {
+		for (i = new_num_chunks; i < num_chunks; i++) {
+			free(chunks[i]);
+			chunks[i] = NULL;
+		}
+		/* Clusters past the end must be unallocated when the map grows again */
+		if (sz % SPDK_BLOB_CLUSTER_CHUNK_SZ != 0 && chunks[new_num_chunks - 1] != NULL) {
+			memset(&chunks[new_num_chunks - 1][sz % SPDK_BLOB_CLUSTER_CHUNK_SZ], 0,
+			       sizeof(*chunks[0]) * (SPDK_BLOB_CLUSTER_CHUNK_SZ - sz % SPDK_BLOB_CLUSTER_CHUNK_SZ));
+		}
+	}
+
+	if (new_num_chunks > num_chunks) {
+		chunks = realloc(chunks, sizeof(*chunks) * new_num_chunks);
+		if (chunks == NULL) {
+			return -ENOMEM;
+		}
+		memset(&chunks[num_chunks], 0, sizeof(*chunks) * (new_num_chunks - num_chunks));
+		blob->active.cluster_chunks = chunks;
+	}
+	blob->active.cluster_array_size = sz;
+
+	if (spdk_blob_is_thin_provisioned(blob) == false) {
+		/* All clusters get allocated right away, inserting them must not fail */
+		for (i = 0; i < new_num_chunks; i++) {
+			if (chunks[i] == NULL) {
+				chunks[i] = calloc(SPDK_BLOB_CLUSTER_CHUNK_SZ, sizeof(*chunks[i]));
+				if (chunks[i] == NULL) {
+					return -ENOMEM;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Changes the number of clusters in the cluster map of the blob. Clusters added to
+ * the map are unallocated. Shrinking the map does not fail.
+ */
+static int
+blob_cluster_map_resize(struct spdk_blob *blob, uint64_t sz)
+{
+	uint64_t *tmp;
+	int rc;
+
+	if (sz == 0) {
+		blob_cluster_map_free(blob);
+		return 0;
+	}
+
+	if (blob->active.cluster_chunks == NULL && sz > blob->active.cluster_array_size &&
+	    blob_use_cluster_chunks(blob, sz)) {
+		rc = blob_cluster_map_to_chunks(blob);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	if (blob->active.cluster_chunks != NULL) {
+		return blob_cluster_chunks_resize(blob, sz);
+	}
+
+	tmp = realloc(blob->active.clusters, sizeof(*blob->active.clusters) * sz);
+	if (tmp == NULL) {
+		if (sz > blob->active.cluster_array_size) {
+			return -ENOMEM;
+		}
+		/* Shrinking never fails, the larger array is kept instead */
+		tmp = blob->active.clusters;
+	} else if (sz > blob->active.cluster_array_size) {
+		memset(tmp + blob->active.cluster_array_size, 0,
+		       sizeof(*blob->active.clusters) * (sz - blob->active.cluster_array_size));
+	}
+	blob->active.clusters = tmp;
+	blob->active.cluster_array_size = sz;
+
+	return 0;
+}
+
+/* Sets the LBA of a cluster of the blob, allocating the chunk holding it if needed */
+static int
+blob_cluster_map_set(struct spdk_blob *blob, uint64_t cluster_num, uint64_t lba)
+{
+	uint64_t **chunk;
+	uint64_t *new_chunk;
+
+	assert(cluster_num < blob->active.cluster_array_size);
+
+	if (spdk_likely(blob->active.cluster_chunks == NULL)) {
+		blob->active.clusters[cluster_num] = lba;
+		return 0;
+	}
+
+	chunk = &blob->active.cluster_chunks[cluster_num >> SPDK_BLOB_CLUSTER_CHUNK_SHIFT];
+	if (*chunk != NULL) {
+		(*chunk)[cluster_num & (SPDK_BLOB_CLUSTER_CHUNK_SZ - 1)] = lba;
+		return 0;
+	}
+
+	if (lba == 0) {
+		return 0;
+	}
+
+	new_chunk = calloc(SPDK_BLOB_CLUSTER_CHUNK_SZ, sizeof(*new_chunk));
+	if (new_chunk == NULL) {
+		return -ENOMEM;
+	}
+	new_chunk[cluster_num & (SPDK_BLOB_CLUSTER_CHUNK_SZ - 1)] = lba;
+
+	/* I/O threads look up the chunk without taking any lock */
+	spdk_smp_wmb();
+	*chunk = new_chunk;
+
+	return 0;
+}
+
+#ifdef DEBUG
+static bool
+blob_cluster_map_is_empty(struct spdk_blob *blob)
+{
+	uint64_t i;
+
+	for (i = 0; i < blob->active.num_clusters; i++) {
+		if (bs_blob_cluster_lba(blob, i) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif
+
+/* Invalidates what the I/O threads resolved about the backing chains of the blobs */
+static void
+bs_backing_chain_changed(struct spdk_blob_store *bs)
 {
-	uint64_t *cluster_lba = &blob->active.clusters[cluster_num];
+	uint32_t gen = bs->backing_chain_gen + 1;
+
+	/* Generation 0 is never used, so that a zeroed entry is always stale */
+	if (spdk_unlikely(gen == 0)) {
+		gen = 1;
+	}
+	__atomic_store_n(&bs->backing_chain_gen, gen, __ATOMIC_RELEASE);
+}
+
+static void
+blob_resolve_cache_free(struct spdk_blob *blob)
+{
+	uint64_t i;
+
+	if (blob->resolve_cache == NULL) {
+		return;
+	}
+
+	for (i = 0; i < blob->resolve_cache->num_chunks; i++) {
+		free(blob->resolve_cache->chunks[i]);
+	}
+	free(blob->resolve_cache);
+	blob->resolve_cache = NULL;
+}
 
+static int
+blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
+{
 	blob_verify_md_op(blob);
 
-	if (*cluster_lba != 0) {
+	if (bs_blob_cluster_lba(blob, cluster_num) != 0) {
 		return -EEXIST;
 	}
 
-	*cluster_lba = bs_cluster_to_lba(blob->bs, cluster);
-	return 0;
+	return blob_cluster_map_set(blob, cluster_num, bs_cluster_to_lba(blob->bs, cluster));
 }
 
 static int
@@ -171,7 +503,7 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 
 	assert(spdk_spin_held(&blob->bs->used_lock));
 
-	*cluster = bs_claim_cluster(blob->bs);
+	*cluster = bs_claim_blob_cluster(blob);
 	if (*cluster == UINT32_MAX) {
 		/* No more free clusters. Cannot satisfy the request */
 		return -ENOSPC;
@@ -251,6 +583,7 @@ spdk_blob_opts_init(struct spdk_blob_opts *opts, size_t opts_size)
 	}
 
 	SET_FIELD(use_extent_table, true);
+	SET_FIELD(subcluster_cow, false);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -317,6 +650,10 @@ blob_alloc(struct spdk_blob_store *bs, spdk_blob_id id)
 	TAILQ_INIT(&blob->xattrs_internal);
 	TAILQ_INIT(&blob->pending_persists);
 	TAILQ_INIT(&blob->persists_to_complete);
+	TAILQ_INIT(&blob->pending_inserts);
+	TAILQ_INIT(&blob->inserts_to_complete);
+	TAILQ_INIT(&blob->retired_partial_clusters);
+	TAILQ_INIT(&blob->retired_partial_tables);
 
 	return blob;
 }
@@ -335,91 +672,388 @@ xattrs_free(struct spdk_xattr_tailq *xattrs)
 }
 
 static void
-blob_free(struct spdk_blob *blob)
+partial_cluster_free(struct spdk_blob_partial_cluster *partial)
 {
-	assert(blob != NULL);
-	assert(TAILQ_EMPTY(&blob->pending_persists));
-	assert(TAILQ_EMPTY(&blob->persists_to_complete));
+	spdk_bit_array_free(&partial->written);
+	free(partial);
+}
 
-	free(blob->active.extent_pages);
-	free(blob->clean.extent_pages);
-	free(blob->active.clusters);
-	free(blob->clean.clusters);
-	free(blob->active.pages);
-	free(blob->clean.pages);
+static void
+blob_partial_table_free(struct spdk_blob_partial_table *table)
+{
+	struct spdk_blob_partial_chunk *chunk;
+	uint64_t i, j;
 
-	xattrs_free(&blob->xattrs);
-	xattrs_free(&blob->xattrs_internal);
+	for (i = 0; i < table->num_chunks; i++) {
+		chunk = table->chunks[i];
+		if (chunk == NULL) {
+			continue;
+		}
+		for (j = 0; j < SPDK_EXTENTS_PER_EP; j++) {
+			if (chunk->clusters[j] != NULL) {
+				partial_cluster_free(chunk->clusters[j]);
+			}
+		}
+		free(chunk);
+	}
+	free(table);
+}
 
-	if (blob->back_bs_dev) {
-		blob->back_bs_dev->destroy(blob->back_bs_dev);
+static void
+blob_partial_clusters_free(struct spdk_blob *blob)
+{
+	struct spdk_blob_partial_cluster *partial, *tmp;
+	struct spdk_blob_partial_table *table, *table_tmp;
+
+	/* The retired tables share their chunks with the current one */
+	TAILQ_FOREACH_SAFE(table, &blob->retired_partial_tables, link, table_tmp) {
+		TAILQ_REMOVE(&blob->retired_partial_tables, table, link);
+		free(table);
 	}
+	if (blob->partial_table != NULL) {
+		blob_partial_table_free(blob->partial_table);
+		blob->partial_table = NULL;
+	}
+	blob->num_partial_clusters = 0;
 
-	free(blob);
+	TAILQ_FOREACH_SAFE(partial, &blob->retired_partial_clusters, link, tmp) {
+		TAILQ_REMOVE(&blob->retired_partial_clusters, partial, link);
+		partial_cluster_free(partial);
+	}
 }
 
-static void
-blob_back_bs_destroy_esnap_done(void *ctx, struct spdk_blob *blob, int bserrno)
+/* Grows the table of partial clusters so that it covers num_clusters clusters. The table
+ * is never shrunk nor reallocated in place, as the I/O threads may look up entries past
+ * the current size of the blob while it is being resized.
+ */
+static int
+blob_partial_table_resize(struct spdk_blob *blob, uint64_t num_clusters)
 {
-	struct spdk_bs_dev	*bs_dev = ctx;
+	struct spdk_blob_partial_table *table, *old = blob->partial_table;
+	uint64_t num_chunks = spdk_divide_round_up(num_clusters, SPDK_EXTENTS_PER_EP);
 
-	if (bserrno != 0) {
-		/*
-		 * This is probably due to a memory allocation failure when creating the
-		 * blob_esnap_destroy_ctx before iterating threads.
-		 */
-		SPDK_ERRLOG("blob 0x%" PRIx64 ": Unable to destroy bs dev channels: error %d\n",
-			    blob->id, bserrno);
-		assert(false);
+	if (old != NULL) {
+		if (num_chunks <= old->num_chunks) {
+			return 0;
+		}
+		num_chunks = spdk_max(num_chunks, old->num_chunks * 2);
 	}
 
-	if (bs_dev == NULL) {
-		/*
-		 * This check exists to make scanbuild happy.
-		 *
-		 * blob->back_bs_dev for an esnap is NULL during the first iteration of blobs while
-		 * the blobstore is being loaded. It could also be NULL if there was an error
-		 * opening the esnap device. In each of these cases, no channels could have been
-		 * created because back_bs_dev->create_channel() would have led to a NULL pointer
-		 * deref.
-		 */
-		assert(false);
-		return;
+	table = calloc(1, sizeof(*table) + num_chunks * sizeof(table->chunks[0]));
+	if (table == NULL) {
+		return -ENOMEM;
 	}
+	table->num_chunks = num_chunks;
 
-	SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": calling destroy on back_bs_dev\n", blob->id);
-	bs_dev->destroy(bs_dev);
+	if (old != NULL) {
+		memcpy(table->chunks, old->chunks, old->num_chunks * sizeof(table->chunks[0]));
+		TAILQ_INSERT_TAIL(&blob->retired_partial_tables, old, link);
+	}
+	/* The I/O threads must see the chunks before the table */
+	spdk_smp_wmb();
+	blob->partial_table = table;
+
+	return 0;
 }
 
-static void
-blob_back_bs_destroy(struct spdk_blob *blob)
+static struct spdk_blob_partial_chunk *
+blob_partial_chunk(const struct spdk_blob *blob, uint64_t cluster_num)
 {
-	SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": preparing to destroy back_bs_dev\n",
-		      blob->id);
+	struct spdk_blob_partial_table *table = blob->partial_table;
+	uint64_t extent_table_id = bs_cluster_to_extent_table_id(cluster_num);
 
-	blob_esnap_destroy_bs_dev_channels(blob, false, blob_back_bs_destroy_esnap_done,
-					   blob->back_bs_dev);
-	blob->back_bs_dev = NULL;
+	if (table == NULL || extent_table_id >= table->num_chunks) {
+		return NULL;
+	}
+
+	return table->chunks[extent_table_id];
 }
 
-struct freeze_io_ctx {
-	struct spdk_bs_cpl cpl;
-	struct spdk_blob *blob;
-};
+static struct spdk_blob_partial_cluster *
+blob_partial_cluster_get(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob_partial_chunk *chunk = blob_partial_chunk(blob, cluster_num);
 
-static void
-blob_io_sync(struct spdk_io_channel_iter *i)
+	return chunk != NULL ? chunk->clusters[cluster_num % SPDK_EXTENTS_PER_EP] : NULL;
+}
+
+/* Number of partial clusters whose PARTIAL_CLUSTER descriptor fits in an extent page */
+static uint32_t
+bs_partial_clusters_per_extent_page(struct spdk_blob_store *bs)
 {
-	spdk_for_each_channel_continue(i, 0);
+	return SPDK_EXTENT_PAGE_PARTIAL_SIZE /
+	       (sizeof(struct spdk_blob_md_descriptor_partial_cluster) +
+		spdk_divide_round_up(bs->pages_per_cluster, 8));
 }
 
-static void
-blob_execute_queued_io(struct spdk_io_channel_iter *i)
+/* Returns true if the extent page covering the cluster has no room for another bitmap */
+static bool
+blob_partial_extent_page_full(struct spdk_blob *blob, uint64_t cluster_num)
 {
-	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
-	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
-	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
-	struct spdk_bs_request_set	*set;
+	struct spdk_blob_partial_chunk *chunk = blob_partial_chunk(blob, cluster_num);
+
+	return chunk != NULL &&
+	       chunk->num_partial >= bs_partial_clusters_per_extent_page(blob->bs);
+}
+
+static struct spdk_blob_partial_cluster *
+blob_partial_cluster_alloc(struct spdk_blob *blob, uint32_t cluster_num)
+{
+	struct spdk_blob_partial_cluster *partial;
+
+	partial = calloc(1, sizeof(*partial));
+	if (partial == NULL) {
+		return NULL;
+	}
+
+	partial->written = spdk_bit_array_create(blob->bs->pages_per_cluster);
+	if (partial->written == NULL) {
+		free(partial);
+		return NULL;
+	}
+	partial->cluster_num = cluster_num;
+
+	return partial;
+}
+
+/* Starts tracking a cluster as partial, the table must already cover the cluster */
+static int
+blob_partial_cluster_set(struct spdk_blob *blob, struct spdk_blob_partial_cluster *partial)
+{
+	struct spdk_blob_partial_table *table = blob->partial_table;
+	uint64_t extent_table_id = bs_cluster_to_extent_table_id(partial->cluster_num);
+	struct spdk_blob_partial_chunk *chunk;
+
+	assert(table != NULL && extent_table_id < table->num_chunks);
+
+	chunk = table->chunks[extent_table_id];
+	if (chunk == NULL) {
+		chunk = calloc(1, sizeof(*chunk) +
+			       SPDK_EXTENTS_PER_EP * sizeof(chunk->clusters[0]));
+		if (chunk == NULL) {
+			return -ENOMEM;
+		}
+		table->chunks[extent_table_id] = chunk;
+	}
+
+	assert(chunk->clusters[partial->cluster_num % SPDK_EXTENTS_PER_EP] == NULL);
+	chunk->clusters[partial->cluster_num % SPDK_EXTENTS_PER_EP] = partial;
+	chunk->num_partial++;
+	blob->num_partial_clusters++;
+
+	return 0;
+}
+
+/* Stops tracking a cluster as partial, because it got fully written or it got
+ * released. The entry is only freed with the blob, I/O threads may still hold it.
+ */
+static void
+blob_partial_cluster_retire(struct spdk_blob *blob, uint32_t cluster_num)
+{
+	struct spdk_blob_partial_chunk *chunk = blob_partial_chunk(blob, cluster_num);
+	struct spdk_blob_partial_cluster *partial;
+
+	assert(chunk != NULL);
+	partial = chunk->clusters[cluster_num % SPDK_EXTENTS_PER_EP];
+	assert(partial != NULL);
+	assert(chunk->num_partial > 0);
+	assert(blob->num_partial_clusters > 0);
+
+	chunk->clusters[cluster_num % SPDK_EXTENTS_PER_EP] = NULL;
+	chunk->num_partial--;
+	blob->num_partial_clusters--;
+	TAILQ_INSERT_TAIL(&blob->retired_partial_clusters, partial, link);
+}
+
+static void
+blob_free(struct spdk_blob *blob)
+{
+	assert(blob != NULL);
+	assert(TAILQ_EMPTY(&blob->pending_persists));
+	assert(TAILQ_EMPTY(&blob->persists_to_complete));
+	assert(TAILQ_EMPTY(&blob->pending_inserts));
+	assert(TAILQ_EMPTY(&blob->inserts_to_complete));
+
+	free(blob->active.extent_pages);
+	free(blob->clean.extent_pages);
+	blob_cluster_map_free(blob);
+	blob_resolve_cache_free(blob);
+	free(blob->active.pages);
+	free(blob->clean.pages);
+
+	blob_partial_clusters_free(blob);
+
+	xattrs_free(&blob->xattrs);
+	xattrs_free(&blob->xattrs_internal);
+
+	if (blob->back_bs_dev) {
+		blob->back_bs_dev->destroy(blob->back_bs_dev);
+	}
+
+	free(blob);
+}
+
+static void
+blob_back_bs_destroy_esnap_done(void *ctx, struct spdk_blob *blob, int bserrno)
+{
+	struct spdk_bs_dev	*bs_dev = ctx;
+
+	if (bserrno != 0) {
+		/*
+		 * This is probably due to a memory allocation failure when creating the
+		 * blob_esnap_destroy_ctx before iterating threads.
+		 */
+		SPDK_ERRLOG("blob 0x%" PRIx64 ": Unable to destroy bs dev channels: error %d\n",
+			    blob->id, bserrno);
+		assert(false);
+	}
+
+	if (bs_dev == NULL) {
+		/*
+		 * This check exists to make scanbuild happy.
+		 *
+		 * blob->back_bs_dev for an esnap is NULL during the first iteration of blobs while
+		 * the blobstore is being loaded. It could also be NULL if there was an error
+		 * opening the esnap device. In each of these cases, no channels could have been
+		 * created because back_bs_dev->create_channel() would have led to a NULL pointer
+		 * deref.
+		 */
+		assert(false);
+		return;
+	}
+
+	SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": calling destroy on back_bs_dev\n", blob->id);
+	bs_dev->destroy(bs_dev);
+}
+
+struct blob_back_bs_release_ctx {
+	struct spdk_blob_store	*bs;
+	struct spdk_bs_dev	*bs_dev;
+};
+
+static void
+blob_back_bs_release_channel(struct spdk_io_channel_iter *i)
+{
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+blob_back_bs_release_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct blob_back_bs_release_ctx	*ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob_store		*bs = ctx->bs;
+
+	ctx->bs_dev->destroy(ctx->bs_dev);
+	free(ctx);
+
+	bs->back_bs_devs_releasing--;
+	if (bs->back_bs_devs_releasing == 0 && bs->esnap_channels_unloading == 0 &&
+	    bs->esnap_unload_cb_fn != NULL) {
+		spdk_bs_unload(bs, bs->esnap_unload_cb_fn, bs->esnap_unload_cb_arg);
+	}
+}
+
+/*
+ * Reads of a clone resolve unallocated clusters by walking the chain of snapshots on the I/O
+ * thread (see blob_resolve_backing_cluster()), not only through the clone's own back_bs_dev.
+ * Destroying a blob_bs_dev closes the parent snapshot, which may free it while such a walk,
+ * started from any descendant, still references it. Only destroy the device once every thread
+ * with a blobstore channel has been visited, as none of them can reach it after that.
+ */
+static void
+blob_back_bs_release(struct spdk_blob *blob, struct spdk_bs_dev *bs_dev)
+{
+	struct blob_back_bs_release_ctx	*ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 ": Unable to defer back_bs_dev destruction\n",
+			    blob->id);
+		assert(false);
+		bs_dev->destroy(bs_dev);
+		return;
+	}
+	ctx->bs = blob->bs;
+	ctx->bs_dev = bs_dev;
+
+	blob->bs->back_bs_devs_releasing++;
+	spdk_for_each_channel(blob->bs, blob_back_bs_release_channel, ctx,
+			      blob_back_bs_release_done);
+}
+
+static void
+blob_back_bs_destroy(struct spdk_blob *blob)
+{
+	SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": preparing to destroy back_bs_dev\n",
+		      blob->id);
+
+	if (blob->back_bs_dev != NULL && !blob_is_esnap_clone(blob)) {
+		/* Destroying the channels of an esnap clone already visits every channel */
+		blob_back_bs_release(blob, blob->back_bs_dev);
+	} else {
+		blob_esnap_destroy_bs_dev_channels(blob, false, blob_back_bs_destroy_esnap_done,
+						   blob->back_bs_dev);
+	}
+	blob->back_bs_dev = NULL;
+	bs_backing_chain_changed(blob->bs);
+}
+
+struct spdk_blob_insert_cluster_ctx {
+	struct spdk_thread	*thread;
+	struct spdk_blob	*blob;
+	uint32_t		cluster_num;	/* cluster index in blob */
+	uint32_t		cluster;	/* cluster on disk */
+	uint32_t		extent_page;	/* extent page on disk */
+	struct spdk_blob_md_page *page; /* preallocated extent page */
+	bool			partial;	/* cluster not copied from the parent */
+	/* Pages written to a partial cluster, when num_pages is not 0 */
+	uint32_t		first_page;
+	uint32_t		num_pages;
+	bool			write_extent_page; /* extent page is written by the batch */
+	spdk_bs_sequence_t	*seq;
+	struct spdk_bs_channel	*channel;
+	TAILQ_ENTRY(spdk_blob_insert_cluster_ctx) ch_link;
+	int			rc;
+	spdk_blob_op_complete	cb_fn;
+	void			*cb_arg;
+	TAILQ_ENTRY(spdk_blob_insert_cluster_ctx) link;
+};
+
+struct freeze_io_ctx {
+	struct spdk_bs_cpl cpl;
+	struct spdk_blob *blob;
+	struct spdk_io_channel_iter *iter;
+	TAILQ_ENTRY(freeze_io_ctx) link;
+};
+
+static void
+blob_io_sync(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob_insert_cluster_ctx *written;
+
+	/* Writes to partial clusters are done only once their pages are marked as
+	 * written, wait for them. */
+	TAILQ_FOREACH(written, &ch->partial_writes, ch_link) {
+		if (written->blob == ctx->blob) {
+			ctx->iter = i;
+			TAILQ_INSERT_TAIL(&ch->partial_write_drains, ctx, link);
+			return;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+blob_execute_queued_io(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_bs_request_set	*set;
 	struct spdk_bs_user_op_args	*args;
 	spdk_bs_user_op_t *op, *tmp;
 
@@ -499,7 +1133,6 @@ static int
 blob_mark_clean(struct spdk_blob *blob)
 {
 	uint32_t *extent_pages = NULL;
-	uint64_t *clusters = NULL;
 	uint32_t *pages = NULL;
 
 	assert(blob != NULL);
@@ -514,40 +1147,29 @@ blob_mark_clean(struct spdk_blob *blob)
 		       blob->active.num_extent_pages * sizeof(*extent_pages));
 	}
 
-	if (blob->active.num_clusters) {
-		assert(blob->active.clusters);
-		clusters = calloc(blob->active.num_clusters, sizeof(*blob->active.clusters));
-		if (!clusters) {
-			free(extent_pages);
-			return -ENOMEM;
-		}
-		memcpy(clusters, blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
-	}
-
 	if (blob->active.num_pages) {
 		assert(blob->active.pages);
 		pages = calloc(blob->active.num_pages, sizeof(*blob->active.pages));
 		if (!pages) {
 			free(extent_pages);
-			free(clusters);
 			return -ENOMEM;
 		}
 		memcpy(pages, blob->active.pages, blob->active.num_pages * sizeof(*blob->active.pages));
 	}
 
 	free(blob->clean.extent_pages);
-	free(blob->clean.clusters);
 	free(blob->clean.pages);
 
 	blob->clean.num_extent_pages = blob->active.num_extent_pages;
 	blob->clean.extent_pages = blob->active.extent_pages;
+	/* Only the number of clusters is ever looked at in the clean state,
+	 * there is no need to keep a second copy of the cluster map.
+	 */
 	blob->clean.num_clusters = blob->active.num_clusters;
-	blob->clean.clusters = blob->active.clusters;
 	blob->clean.num_pages = blob->active.num_pages;
 	blob->clean.pages = blob->active.pages;
 
 	blob->active.extent_pages = extent_pages;
-	blob->active.clusters = clusters;
 	blob->active.pages = pages;
 
 	/* If the metadata was dirtied again while the metadata was being written to disk,
@@ -609,6 +1231,7 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 	struct spdk_blob_md_descriptor *desc;
 	size_t	cur_desc = 0;
 	void *tmp;
+	int rc;
 
 	desc = (struct spdk_blob_md_descriptor *)page->descriptors;
 	while (cur_desc < sizeof(page->descriptors)) {
@@ -671,12 +1294,15 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 			}
 
 			for (i = 0; i < desc_extent_rle->length / sizeof(desc_extent_rle->extents[0]); i++) {
+				if (desc_extent_rle->extents[i].cluster_idx == 0) {
+					/* Runs of unallocated clusters can be huge in thin provisioned blobs */
+					cluster_count += desc_extent_rle->extents[i].length;
+					continue;
+				}
 				for (j = 0; j < desc_extent_rle->extents[i].length; j++) {
-					if (desc_extent_rle->extents[i].cluster_idx != 0) {
-						if (!spdk_bit_pool_is_allocated(blob->bs->used_clusters,
-										desc_extent_rle->extents[i].cluster_idx + j)) {
-							return -EINVAL;
-						}
+					if (!spdk_bit_pool_is_allocated(blob->bs->used_clusters,
+									desc_extent_rle->extents[i].cluster_idx + j)) {
+						return -EINVAL;
 					}
 					cluster_count++;
 				}
@@ -685,23 +1311,26 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 			if (cluster_count == 0) {
 				return -EINVAL;
 			}
-			tmp = realloc(blob->active.clusters, cluster_count * sizeof(*blob->active.clusters));
-			if (tmp == NULL) {
-				return -ENOMEM;
+			rc = blob_cluster_map_resize(blob, cluster_count);
+			if (rc != 0) {
+				return rc;
 			}
-			blob->active.clusters = tmp;
-			blob->active.cluster_array_size = cluster_count;
 
 			for (i = 0; i < desc_extent_rle->length / sizeof(desc_extent_rle->extents[0]); i++) {
-				for (j = 0; j < desc_extent_rle->extents[i].length; j++) {
-					if (desc_extent_rle->extents[i].cluster_idx != 0) {
-						blob->active.clusters[blob->active.num_clusters++] = bs_cluster_to_lba(blob->bs,
-								desc_extent_rle->extents[i].cluster_idx + j);
-					} else if (spdk_blob_is_thin_provisioned(blob)) {
-						blob->active.clusters[blob->active.num_clusters++] = 0;
-					} else {
+				if (desc_extent_rle->extents[i].cluster_idx == 0) {
+					if (!spdk_blob_is_thin_provisioned(blob)) {
 						return -EINVAL;
 					}
+					blob->active.num_clusters += desc_extent_rle->extents[i].length;
+					continue;
+				}
+				for (j = 0; j < desc_extent_rle->extents[i].length; j++) {
+					rc = blob_cluster_map_set(blob, blob->active.num_clusters++,
+								  bs_cluster_to_lba(blob->bs,
+										  desc_extent_rle->extents[i].cluster_idx + j));
+					if (rc != 0) {
+						return rc;
+					}
 				}
 			}
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_EXTENT_TABLE) {
@@ -802,20 +1431,20 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 				return -EINVAL;
 			}
 
-			tmp = realloc(blob->active.clusters,
-				      (cluster_count + blob->active.num_clusters) * sizeof(*blob->active.clusters));
-			if (tmp == NULL) {
-				return -ENOMEM;
+			rc = blob_cluster_map_resize(blob, cluster_count + blob->active.num_clusters);
+			if (rc != 0) {
+				return rc;
 			}
-			blob->active.clusters = tmp;
-			blob->active.cluster_array_size = (cluster_count + blob->active.num_clusters);
 
 			for (i = 0; i < cluster_idx_length / sizeof(desc_extent->cluster_idx[0]); i++) {
 				if (desc_extent->cluster_idx[i] != 0) {
-					blob->active.clusters[blob->active.num_clusters++] = bs_cluster_to_lba(blob->bs,
-							desc_extent->cluster_idx[i]);
+					rc = blob_cluster_map_set(blob, blob->active.num_clusters++,
+								  bs_cluster_to_lba(blob->bs, desc_extent->cluster_idx[i]));
+					if (rc != 0) {
+						return rc;
+					}
 				} else if (spdk_blob_is_thin_provisioned(blob)) {
-					blob->active.clusters[blob->active.num_clusters++] = 0;
+					blob->active.num_clusters++;
 				} else {
 					return -EINVAL;
 				}
@@ -823,6 +1452,41 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 			assert(desc_extent->start_cluster_idx + cluster_count == blob->active.num_clusters);
 			assert(blob->remaining_clusters_in_et >= cluster_count);
 			blob->remaining_clusters_in_et -= cluster_count;
+		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER) {
+			struct spdk_blob_md_descriptor_partial_cluster	*desc_partial;
+			struct spdk_blob_partial_cluster		*partial;
+			int rc;
+
+			desc_partial = (struct spdk_blob_md_descriptor_partial_cluster *)desc;
+
+			if (desc_partial->length < sizeof(*desc_partial) - sizeof(*desc) ||
+			    desc_partial->num_pages != blob->bs->pages_per_cluster ||
+			    desc_partial->length != sizeof(*desc_partial) - sizeof(*desc) +
+			    spdk_divide_round_up(desc_partial->num_pages, 8)) {
+				return -EINVAL;
+			}
+
+			rc = blob_partial_table_resize(blob,
+						       (uint64_t)desc_partial->cluster_idx + 1);
+			if (rc != 0) {
+				return rc;
+			}
+
+			if (blob_partial_cluster_get(blob, desc_partial->cluster_idx) != NULL) {
+				return -EINVAL;
+			}
+
+			partial = blob_partial_cluster_alloc(blob, desc_partial->cluster_idx);
+			if (partial == NULL) {
+				return -ENOMEM;
+			}
+			spdk_bit_array_load_mask(partial->written, desc_partial->written);
+
+			rc = blob_partial_cluster_set(blob, partial);
+			if (rc != 0) {
+				partial_cluster_free(partial);
+				return rc;
+			}
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_XATTR) {
 			int rc;
 
@@ -888,6 +1552,7 @@ blob_parse(const struct spdk_blob_md_page *pages, uint32_t page_count,
 	assert(blob != NULL);
 	assert(blob->state == SPDK_BLOB_STATE_LOADING);
 	assert(blob->active.clusters == NULL);
+	assert(blob->active.cluster_chunks == NULL);
 
 	/* The blobid provided doesn't match what's in the MD, this can
 	 * happen for example if a bogus blobid is passed in through open.
@@ -1112,15 +1777,15 @@ blob_serialize_extent_rle(const struct spdk_blob *blob,
 	/* Assert for scan-build false positive */
 	assert(lba_per_cluster > 0);
 
-	lba = blob->active.clusters[start_cluster];
+	lba = bs_blob_cluster_lba(blob, start_cluster);
 	lba_count = lba_per_cluster;
 	extent_idx = 0;
 	for (i = start_cluster + 1; i < blob->active.num_clusters; i++) {
-		if ((lba + lba_count) == blob->active.clusters[i] && lba != 0) {
+		if ((lba + lba_count) == bs_blob_cluster_lba(blob, i) && lba != 0) {
 			/* Run-length encode sequential non-zero LBA */
 			lba_count += lba_per_cluster;
 			continue;
-		} else if (lba == 0 && blob->active.clusters[i] == 0) {
+		} else if (lba == 0 && bs_blob_cluster_lba(blob, i) == 0) {
 			/* Run-length encode unallocated clusters */
 			lba_count += lba_per_cluster;
 			continue;
@@ -1137,7 +1802,7 @@ blob_serialize_extent_rle(const struct spdk_blob *blob,
 			break;
 		}
 
-		lba = blob->active.clusters[i];
+		lba = bs_blob_cluster_lba(blob, i);
 		lba_count = lba_per_cluster;
 	}
 
@@ -1184,6 +1849,51 @@ blob_serialize_extents_rle(const struct spdk_blob *blob,
 	return 0;
 }
 
+/*
+ * Serializes the bitmaps of the partial clusters among num_clusters clusters starting at
+ * start_cluster_idx, after the EXTENT_PAGE descriptor of the extent page covering them.
+ */
+static void
+blob_serialize_partial_clusters(const struct spdk_blob *blob, uint64_t start_cluster_idx,
+				uint64_t num_clusters, uint8_t *buf)
+{
+	struct spdk_blob_md_descriptor_partial_cluster *desc;
+	struct spdk_blob_partial_cluster *partial;
+	struct spdk_blob_partial_chunk *chunk;
+	size_t required_sz, remaining_sz = SPDK_EXTENT_PAGE_PARTIAL_SIZE;
+	uint64_t i;
+
+	chunk = blob_partial_chunk(blob, start_cluster_idx);
+	if (chunk == NULL || chunk->num_partial == 0) {
+		return;
+	}
+
+	required_sz = sizeof(*desc) + spdk_divide_round_up(blob->bs->pages_per_cluster, 8);
+
+	for (i = 0; i < num_clusters; i++) {
+		partial = chunk->clusters[i];
+		if (partial == NULL) {
+			continue;
+		}
+
+		/* New partial clusters are only allocated while the extent page has room */
+		assert(remaining_sz >= required_sz);
+		if (remaining_sz < required_sz) {
+			break;
+		}
+
+		desc = (struct spdk_blob_md_descriptor_partial_cluster *)buf;
+		desc->type = SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER;
+		desc->length = required_sz - sizeof(struct spdk_blob_md_descriptor);
+		desc->cluster_idx = start_cluster_idx + i;
+		desc->num_pages = blob->bs->pages_per_cluster;
+		spdk_bit_array_store_mask(partial->written, desc->written);
+
+		remaining_sz -= required_sz;
+		buf += required_sz;
+	}
+}
+
 static void
 blob_serialize_extent_page(const struct spdk_blob *blob,
 			   uint64_t cluster, struct spdk_blob_md_page *page)
@@ -1192,6 +1902,7 @@ blob_serialize_extent_page(const struct spdk_blob *blob,
 	uint64_t i, extent_idx;
 	uint64_t lba, lba_per_cluster;
 	uint64_t start_cluster_idx = (cluster / SPDK_EXTENTS_PER_EP) * SPDK_EXTENTS_PER_EP;
+	uint8_t *buf;
 
 	desc_extent = (struct spdk_blob_md_descriptor_extent_page *) page->descriptors;
 	desc_extent->type = SPDK_MD_DESCRIPTOR_TYPE_EXTENT_PAGE;
@@ -1201,7 +1912,7 @@ blob_serialize_extent_page(const struct spdk_blob *blob,
 	desc_extent->start_cluster_idx = start_cluster_idx;
 	extent_idx = 0;
 	for (i = start_cluster_idx; i < blob->active.num_clusters; i++) {
-		lba = blob->active.clusters[i];
+		lba = bs_blob_cluster_lba(blob, i);
 		desc_extent->cluster_idx[extent_idx++] = lba / lba_per_cluster;
 		if (extent_idx >= SPDK_EXTENTS_PER_EP) {
 			break;
@@ -1209,6 +1920,10 @@ blob_serialize_extent_page(const struct spdk_blob *blob,
 	}
 	desc_extent->length = sizeof(desc_extent->start_cluster_idx) +
 			      sizeof(desc_extent->cluster_idx[0]) * extent_idx;
+
+	buf = (uint8_t *)page->descriptors + sizeof(struct spdk_blob_md_descriptor) +
+	      desc_extent->length;
+	blob_serialize_partial_clusters(blob, start_cluster_idx, extent_idx, buf);
 }
 
 static void
@@ -1456,6 +2171,35 @@ blob_load_esnap(struct spdk_blob *blob, void *blob_ctx)
 	return 0;
 }
 
+/*
+ * Drops the bitmaps of the clusters that are not allocated in the blob, left over in the
+ * last extent page of a blob that got shrunk.
+ */
+static int
+blob_load_partial_clusters(struct spdk_blob *blob)
+{
+	struct spdk_blob_partial_cluster *partial;
+	uint64_t i;
+
+	if (!(blob->invalid_flags & SPDK_BLOB_SUBCLUSTER_COW)) {
+		blob_partial_clusters_free(blob);
+		return 0;
+	}
+
+	if (blob->partial_table != NULL) {
+		for (i = 0; i < blob->partial_table->num_chunks * SPDK_EXTENTS_PER_EP; i++) {
+			partial = blob_partial_cluster_get(blob, i);
+			if (partial != NULL &&
+			    (i >= blob->active.num_clusters || bs_blob_cluster_lba(blob, i) == 0)) {
+				blob_partial_cluster_retire(blob, i);
+			}
+		}
+	}
+
+	/* The table is allocated even for an empty blob, it enables partial clusters */
+	return blob_partial_table_resize(blob, spdk_max(blob->active.num_clusters, 1));
+}
+
 static void
 blob_load_backing_dev(spdk_bs_sequence_t *seq, void *cb_arg)
 {
@@ -1465,6 +2209,12 @@ blob_load_backing_dev(spdk_bs_sequence_t *seq, void *cb_arg)
 	size_t				len;
 	int				rc;
 
+	rc = blob_load_partial_clusters(blob);
+	if (rc != 0) {
+		blob_load_final(ctx, rc);
+		return;
+	}
+
 	if (blob_is_esnap_clone(blob)) {
 		rc = blob_load_esnap(blob, seq->cpl.u.blob_handle.esnap_ctx);
 		blob_load_final(ctx, rc);
@@ -1503,8 +2253,8 @@ blob_load_cpl_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	uint64_t			i;
 	uint32_t			crc;
 	uint64_t			lba;
-	void				*tmp;
 	uint64_t			sz;
+	int				rc;
 
 	if (bserrno) {
 		SPDK_ERRLOG("Extent page read failed: %d\n", bserrno);
@@ -1563,15 +2313,11 @@ blob_load_cpl_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 			assert(spdk_blob_is_thin_provisioned(blob));
 			assert(i + 1 < blob->active.num_extent_pages || blob->remaining_clusters_in_et == 0);
 
-			tmp = realloc(blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
-			if (tmp == NULL) {
-				blob_load_final(ctx, -ENOMEM);
+			rc = blob_cluster_map_resize(blob, blob->active.num_clusters);
+			if (rc != 0) {
+				blob_load_final(ctx, rc);
 				return;
 			}
-			memset(tmp + sizeof(*blob->active.clusters) * blob->active.cluster_array_size, 0,
-			       sizeof(*blob->active.clusters) * (blob->active.num_clusters - blob->active.cluster_array_size));
-			blob->active.clusters = tmp;
-			blob->active.cluster_array_size = blob->active.num_clusters;
 		}
 	}
 
@@ -1716,6 +2462,10 @@ struct spdk_blob_persist_ctx {
 	uint32_t			next_extent_page;
 	struct spdk_blob_md_page	*extent_page;
 
+	/* Writes of the md pages other than the root one, in flight */
+	uint32_t			md_writes_outstanding;
+	int				md_writes_rc;
+
 	spdk_bs_sequence_t		*seq;
 	spdk_bs_sequence_cpl		cb_fn;
 	void				*cb_arg;
@@ -1743,8 +2493,151 @@ bs_batch_clear_dev(struct spdk_blob_persist_ctx *ctx, spdk_bs_batch_t *batch, ui
 static void bs_mark_dirty(spdk_bs_sequence_t *seq, struct spdk_blob_store *bs,
 			  spdk_bs_sequence_cpl cb_fn, void *cb_arg);
 
-static void
-blob_persist_complete_cb(void *arg)
+/* Maximum number of md pages merged into a single write */
+#define BS_MD_WRITE_MAX_IOVS	32
+
+struct spdk_bs_md_write {
+	void				*payload;
+	uint64_t			lba;
+	uint32_t			lba_count;
+
+	spdk_bs_sequence_t		*seq;
+	spdk_bs_sequence_cpl		cb_fn;
+	void				*cb_arg;
+	TAILQ_ENTRY(spdk_bs_md_write)	link;
+};
+
+/* Writes of md pages at contiguous LBAs, submitted as a single vectored write */
+struct spdk_bs_md_write_run {
+	struct spdk_bs_dev_cb_args	cb_args;
+	struct spdk_bs_md_writes	writes;
+	struct iovec			iovs[];
+};
+
+static void
+bs_md_write_run_complete(struct spdk_bs_md_write_run *run, int bserrno)
+{
+	struct spdk_bs_md_write *write;
+
+	while ((write = TAILQ_FIRST(&run->writes)) != NULL) {
+		TAILQ_REMOVE(&run->writes, write, link);
+		if (bserrno != 0) {
+			/* Fail the sequence, as an I/O submitted through it would */
+			write->seq->bserrno = bserrno;
+		}
+		write->cb_fn(write->seq, write->cb_arg, bserrno);
+		free(write);
+	}
+	free(run);
+}
+
+static void
+bs_md_write_run_cpl(struct spdk_io_channel *channel, void *cb_arg, int bserrno)
+{
+	bs_md_write_run_complete(cb_arg, bserrno);
+}
+
+static void
+bs_md_writes_flush(void *arg)
+{
+	struct spdk_blob_store		*bs = arg;
+	struct spdk_bs_channel		*channel = spdk_io_channel_get_ctx(bs->md_channel);
+	struct spdk_bs_md_write		*first, *write, *next;
+	struct spdk_bs_md_write_run	*run;
+	uint64_t			lba_count;
+	int				iovcnt;
+
+	bs->md_writes_flush_scheduled = false;
+
+	while ((first = TAILQ_FIRST(&bs->md_writes)) != NULL) {
+		/* Find the longest run of writes to contiguous LBAs */
+		lba_count = first->lba_count;
+		iovcnt = 1;
+		next = TAILQ_NEXT(first, link);
+		while (next != NULL && next->lba == first->lba + lba_count &&
+		       iovcnt < BS_MD_WRITE_MAX_IOVS) {
+			lba_count += next->lba_count;
+			iovcnt++;
+			next = TAILQ_NEXT(next, link);
+		}
+
+		run = calloc(1, sizeof(*run) + iovcnt * sizeof(struct iovec));
+		if (run == NULL) {
+			while ((write = TAILQ_FIRST(&bs->md_writes)) != next) {
+				TAILQ_REMOVE(&bs->md_writes, write, link);
+				write->seq->bserrno = -ENOMEM;
+				write->cb_fn(write->seq, write->cb_arg, -ENOMEM);
+				free(write);
+			}
+			continue;
+		}
+
+		TAILQ_INIT(&run->writes);
+		iovcnt = 0;
+		while ((write = TAILQ_FIRST(&bs->md_writes)) != next) {
+			TAILQ_REMOVE(&bs->md_writes, write, link);
+			TAILQ_INSERT_TAIL(&run->writes, write, link);
+			run->iovs[iovcnt].iov_base = write->payload;
+			run->iovs[iovcnt].iov_len = write->lba_count * bs->dev->blocklen;
+			iovcnt++;
+		}
+
+		run->cb_args.cb_fn = bs_md_write_run_cpl;
+		run->cb_args.channel = channel->dev_channel;
+		run->cb_args.cb_arg = run;
+
+		SPDK_DEBUGLOG(blob, "Writing %d md pages to LBA %" PRIu64 "\n", iovcnt, first->lba);
+		channel->dev->writev(channel->dev, channel->dev_channel, run->iovs, iovcnt,
+				     first->lba, lba_count, &run->cb_args);
+	}
+}
+
+/*
+ * Writes an md page as part of seq. The writes issued on the md thread while it
+ * processes a message are not submitted right away, but merged with each other,
+ * so that the md of many blobs synced at once goes out in a few large writes.
+ */
+static void
+bs_md_write(spdk_bs_sequence_t *seq, struct spdk_blob_store *bs, void *payload,
+	    uint64_t lba, uint32_t lba_count, spdk_bs_sequence_cpl cb_fn, void *cb_arg)
+{
+	struct spdk_bs_md_write *write, *prev;
+
+	assert(spdk_get_thread() == bs->md_thread);
+
+	write = calloc(1, sizeof(*write));
+	if (write == NULL) {
+		seq->bserrno = -ENOMEM;
+		cb_fn(seq, cb_arg, -ENOMEM);
+		return;
+	}
+	write->payload = payload;
+	write->lba = lba;
+	write->lba_count = lba_count;
+	write->seq = seq;
+	write->cb_fn = cb_fn;
+	write->cb_arg = cb_arg;
+
+	/* Pages are mostly claimed in increasing order, look for the spot from the tail */
+	TAILQ_FOREACH_REVERSE(prev, &bs->md_writes, spdk_bs_md_writes, link) {
+		if (prev->lba <= lba) {
+			break;
+		}
+	}
+	if (prev != NULL) {
+		TAILQ_INSERT_AFTER(&bs->md_writes, prev, write, link);
+	} else {
+		TAILQ_INSERT_HEAD(&bs->md_writes, write, link);
+	}
+
+	if (!bs->md_writes_flush_scheduled) {
+		bs->md_writes_flush_scheduled = true;
+		spdk_thread_send_msg(bs->md_thread, bs_md_writes_flush, bs);
+	}
+}
+
+static void
+blob_persist_complete_cb(void *arg)
 {
 	struct spdk_blob_persist_ctx *ctx = arg;
 
@@ -1870,33 +2763,29 @@ blob_persist_clear_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserr
 		return;
 	}
 
+	if (blob->active.num_clusters < blob->active.cluster_array_size) {
+		/* Clones may have resolved reads to the clusters about to be released */
+		bs_backing_chain_changed(bs);
+	}
+
 	spdk_spin_lock(&bs->used_lock);
 	/* Release all clusters that were truncated */
 	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
-		uint32_t cluster_num = bs_lba_to_cluster(bs, blob->active.clusters[i]);
+		uint64_t lba = bs_blob_cluster_lba(blob, i);
 
 		/* Nothing to release if it was not allocated */
-		if (blob->active.clusters[i] != 0) {
-			bs_release_cluster(bs, cluster_num);
+		if (lba != 0) {
+			bs_release_cluster(bs, bs_lba_to_cluster(bs, lba));
+		}
+
+		if (blob_partial_cluster_get(blob, i) != NULL) {
+			blob_partial_cluster_retire(blob, i);
 		}
 	}
 	spdk_spin_unlock(&bs->used_lock);
 
-	if (blob->active.num_clusters == 0) {
-		free(blob->active.clusters);
-		blob->active.clusters = NULL;
-		blob->active.cluster_array_size = 0;
-	} else if (blob->active.num_clusters != blob->active.cluster_array_size) {
-#ifndef __clang_analyzer__
-		void *tmp;
-
-		/* scan-build really can't figure reallocs, workaround it */
-		tmp = realloc(blob->active.clusters, sizeof(*blob->active.clusters) * blob->active.num_clusters);
-		assert(tmp != NULL);
-		blob->active.clusters = tmp;
-
-#endif
-		blob->active.cluster_array_size = blob->active.num_clusters;
+	if (blob->active.num_clusters != blob->active.cluster_array_size) {
+		blob_cluster_map_resize(blob, blob->active.num_clusters);
 	}
 
 	/* Move on to clearing extent pages */
@@ -1923,7 +2812,7 @@ blob_persist_clear_clusters(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ct
 	lba = 0;
 	lba_count = 0;
 	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
-		uint64_t next_lba = blob->active.clusters[i];
+		uint64_t next_lba = bs_blob_cluster_lba(blob, i);
 		uint64_t next_lba_count = bs_cluster_to_lba(bs, 1);
 
 		if (next_lba > 0 && (lba + lba_count) == next_lba) {
@@ -2065,8 +2954,24 @@ blob_persist_write_page_root(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	/* The first page in the metadata goes where the blobid indicates */
 	lba = bs_md_page_to_lba(bs, bs_blobid_to_page(blob->id));
 
-	bs_sequence_write_dev(seq, page, lba, lba_count,
-			      blob_persist_zero_pages, ctx);
+	bs_md_write(seq, bs, page, lba, lba_count, blob_persist_zero_pages, ctx);
+}
+
+static void
+blob_persist_write_page_chain_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+
+	if (bserrno != 0) {
+		ctx->md_writes_rc = bserrno;
+	}
+
+	assert(ctx->md_writes_outstanding > 0);
+	if (--ctx->md_writes_outstanding > 0) {
+		return;
+	}
+
+	blob_persist_write_page_root(seq, ctx, ctx->md_writes_rc);
 }
 
 static void
@@ -2077,7 +2982,6 @@ blob_persist_write_page_chain(spdk_bs_sequence_t *seq, struct spdk_blob_persist_
 	uint64_t			lba;
 	uint32_t			lba_count;
 	struct spdk_blob_md_page	*page;
-	spdk_bs_batch_t			*batch;
 	size_t				i;
 
 	/* Clusters don't move around in blobs. The list shrinks or grows
@@ -2086,7 +2990,9 @@ blob_persist_write_page_chain(spdk_bs_sequence_t *seq, struct spdk_blob_persist_
 
 	lba_count = bs_byte_to_lba(bs, sizeof(*page));
 
-	batch = bs_sequence_to_batch(seq, blob_persist_write_page_root, ctx);
+	/* Hold a reference until all the writes are issued */
+	ctx->md_writes_outstanding = 1;
+	ctx->md_writes_rc = 0;
 
 	/* This starts at 1. The root page is not written until
 	 * all of the others are finished
@@ -2097,17 +3003,17 @@ blob_persist_write_page_chain(spdk_bs_sequence_t *seq, struct spdk_blob_persist_
 
 		lba = bs_md_page_to_lba(bs, blob->active.pages[i]);
 
-		bs_batch_write_dev(batch, page, lba, lba_count);
+		ctx->md_writes_outstanding++;
+		bs_md_write(seq, bs, page, lba, lba_count, blob_persist_write_page_chain_cpl, ctx);
 	}
 
-	bs_batch_close(batch);
+	blob_persist_write_page_chain_cpl(seq, ctx, 0);
 }
 
 static int
 blob_resize(struct spdk_blob *blob, uint64_t sz)
 {
 	uint64_t	i;
-	uint64_t	*tmp;
 	uint64_t	cluster;
 	uint32_t	lfmd; /*  lowest free md page */
 	uint64_t	num_clusters;
@@ -2169,15 +3075,10 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 		/* Expand the cluster array if necessary.
 		 * We only shrink the array when persisting.
 		 */
-		tmp = realloc(blob->active.clusters, sizeof(*blob->active.clusters) * sz);
-		if (sz > 0 && tmp == NULL) {
-			rc = -ENOMEM;
+		rc = blob_cluster_map_resize(blob, sz);
+		if (rc != 0) {
 			goto out;
 		}
-		memset(tmp + blob->active.cluster_array_size, 0,
-		       sizeof(*blob->active.clusters) * (sz - blob->active.cluster_array_size));
-		blob->active.clusters = tmp;
-		blob->active.cluster_array_size = sz;
 
 		/* Expand the extents table, only if enough clusters were added */
 		if (new_num_ep > current_num_ep && blob->use_extent_table) {
@@ -2191,6 +3092,13 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 			blob->active.extent_pages = ep_tmp;
 			blob->active.extent_pages_array_size = new_num_ep;
 		}
+
+		if (blob->partial_table != NULL) {
+			rc = blob_partial_table_resize(blob, sz);
+			if (rc != 0) {
+				goto out;
+			}
+		}
 	}
 
 	blob->state = SPDK_BLOB_STATE_DIRTY;
@@ -2327,9 +3235,9 @@ blob_persist_write_extent_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserr
 
 		ctx->extent_page->crc = blob_md_page_calc_crc(ctx->extent_page);
 
-		bs_sequence_write_dev(seq, ctx->extent_page, bs_md_page_to_lba(blob->bs, extent_page_id),
-				      bs_byte_to_lba(blob->bs, SPDK_BS_PAGE_SIZE),
-				      blob_persist_write_extent_pages, ctx);
+		bs_md_write(seq, blob->bs, ctx->extent_page, bs_md_page_to_lba(blob->bs, extent_page_id),
+			    bs_byte_to_lba(blob->bs, SPDK_BS_PAGE_SIZE),
+			    blob_persist_write_extent_pages, ctx);
 		return;
 	}
 
@@ -2493,20 +3401,57 @@ struct spdk_blob_copy_cluster_ctx {
 	uint64_t page;
 	uint64_t new_cluster;
 	uint32_t new_extent_page;
+	uint32_t cluster_number;
 	spdk_bs_sequence_t *seq;
 	struct spdk_blob_md_page *new_cluster_page;
+	struct spdk_bs_channel *channel;
+
+	/* User ops waiting for this cluster to be allocated */
+	TAILQ_HEAD(, spdk_bs_request_set) ops;
+	TAILQ_ENTRY(spdk_blob_copy_cluster_ctx) link;
 };
 
+static void bs_allocate_and_copy_cluster(struct spdk_blob *blob, struct spdk_io_channel *_ch,
+		uint64_t io_unit, spdk_bs_user_op_t *op);
+
+static void
+bs_channel_retry_cluster_allocs(struct spdk_bs_channel *ch)
+{
+	TAILQ_HEAD(, spdk_bs_request_set) requests;
+	struct spdk_bs_user_op_args *args;
+	spdk_bs_user_op_t *op;
+
+	TAILQ_INIT(&requests);
+	TAILQ_SWAP(&ch->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+
+	while (!TAILQ_EMPTY(&requests)) {
+		op = TAILQ_FIRST(&requests);
+		TAILQ_REMOVE(&requests, op, link);
+		args = &((struct spdk_bs_request_set *)op)->u.user_op;
+		if (bs_io_unit_is_allocated(args->blob, args->offset)) {
+			bs_user_op_execute(op);
+		} else {
+			bs_allocate_and_copy_cluster(args->blob, spdk_io_channel_from_ctx(ch),
+						     args->offset, op);
+		}
+	}
+}
+
 static void
 blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 {
 	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
-	struct spdk_bs_request_set *set = (struct spdk_bs_request_set *)ctx->seq;
+	struct spdk_bs_channel *ch = ctx->channel;
 	TAILQ_HEAD(, spdk_bs_request_set) requests;
 	spdk_bs_user_op_t *op;
 
 	TAILQ_INIT(&requests);
-	TAILQ_SWAP(&set->channel->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+	TAILQ_SWAP(&ctx->ops, &requests, spdk_bs_request_set, link);
+
+	spdk_free(ctx->buf);
+	ctx->buf = NULL;
+	TAILQ_REMOVE(&ch->cluster_allocs, ctx, link);
+	TAILQ_INSERT_TAIL(&ch->free_cluster_allocs, ctx, link);
 
 	while (!TAILQ_EMPTY(&requests)) {
 		op = TAILQ_FIRST(&requests);
@@ -2518,8 +3463,7 @@ blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 		}
 	}
 
-	spdk_free(ctx->buf);
-	free(ctx);
+	bs_channel_retry_cluster_allocs(ch);
 }
 
 static void
@@ -2528,17 +3472,16 @@ blob_insert_cluster_cpl(void *cb_arg, int bserrno)
 	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
 
 	if (bserrno) {
-		if (bserrno == -EEXIST) {
+		if (bserrno == -EEXIST || bserrno == -EAGAIN) {
 			/* The metadata insert failed because another thread
-			 * allocated the cluster first. Free our cluster
-			 * but continue without error. */
+			 * allocated the cluster first, or the cluster has to be
+			 * fully copied after all. Free our cluster but continue
+			 * without error, the user ops are executed again. */
 			bserrno = 0;
 		}
+		/* The new extent page, if any, was already released on the md thread */
 		spdk_spin_lock(&ctx->blob->bs->used_lock);
 		bs_release_cluster(ctx->blob->bs, ctx->new_cluster);
-		if (ctx->new_extent_page != 0) {
-			bs_release_md_page(ctx->blob->bs, ctx->new_extent_page);
-		}
 		spdk_spin_unlock(&ctx->blob->bs->used_lock);
 	}
 
@@ -2560,7 +3503,8 @@ blob_write_copy_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	cluster_number = bs_page_to_cluster(ctx->blob->bs, ctx->page);
 
 	blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
-					 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
+					 ctx->new_extent_page, ctx->new_cluster_page, false,
+					 blob_insert_cluster_cpl, ctx);
 }
 
 static void
@@ -2603,6 +3547,26 @@ blob_copy(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op, uint64_
 			     blob_write_copy_cpl, ctx);
 }
 
+/*
+ * Clusters written to by the user are allocated without copying them from the parent, when
+ * the blob tracks copy-on-write at page granularity. Clusters touched by inflate and decouple
+ * are still copied whole, and so are the ones whose extent page has no room for their bitmap.
+ */
+static bool
+blob_allocate_partial_cluster(struct spdk_blob *blob, uint32_t cluster_number,
+			      spdk_bs_user_op_t *op, bool is_zeroes)
+{
+	int type = ((struct spdk_bs_request_set *)op)->u.user_op.type;
+
+	if (blob->partial_table == NULL || blob->partial_cow_paused ||
+	    blob->parent_id == SPDK_BLOBID_INVALID || blob_is_esnap_clone(blob) || is_zeroes ||
+	    blob_partial_extent_page_full(blob, cluster_number)) {
+		return false;
+	}
+
+	return type == SPDK_BLOB_WRITE || type == SPDK_BLOB_WRITEV || type == SPDK_BLOB_WRITE_ZEROES;
+}
+
 static void
 bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 			     struct spdk_io_channel *_ch,
@@ -2615,50 +3579,57 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	uint32_t cluster_number;
 	bool is_zeroes;
 	bool can_copy;
+	bool partial;
 	uint64_t copy_src_lba;
 	int rc;
 
 	ch = spdk_io_channel_get_ctx(_ch);
 
-	if (!TAILQ_EMPTY(&ch->need_cluster_alloc)) {
-		/* There are already operations pending. Queue this user op
-		 * and return because it will be re-executed when the outstanding
-		 * cluster allocation completes. */
-		TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
-		return;
-	}
-
-	/* Round the io_unit offset down to the first page in the cluster */
-	cluster_start_page = bs_io_unit_to_cluster_start(blob, io_unit);
-
 	/* Calculate which index in the metadata cluster array the corresponding
 	 * cluster is supposed to be at. */
 	cluster_number = bs_io_unit_to_cluster_number(blob, io_unit);
 
-	ctx = calloc(1, sizeof(*ctx));
-	if (!ctx) {
-		bs_user_op_abort(op, -ENOMEM);
+	TAILQ_FOREACH(ctx, &ch->cluster_allocs, link) {
+		if (ctx->blob == blob && ctx->cluster_number == cluster_number) {
+			/* This cluster is already being allocated. Queue this user op
+			 * and return because it will be re-executed when that
+			 * allocation completes. */
+			TAILQ_INSERT_TAIL(&ctx->ops, op, link);
+			return;
+		}
+	}
+
+	ctx = TAILQ_FIRST(&ch->free_cluster_allocs);
+	if (ctx == NULL || !TAILQ_EMPTY(&ch->need_cluster_alloc)) {
+		/* Too many allocations are outstanding on this channel. Retry once
+		 * one of them completes. */
+		TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
 		return;
 	}
 
+	/* Round the io_unit offset down to the first page in the cluster */
+	cluster_start_page = bs_io_unit_to_cluster_start(blob, io_unit);
+
 	assert(blob->bs->cluster_sz % blob->back_bs_dev->blocklen == 0);
 
 	ctx->blob = blob;
 	ctx->page = cluster_start_page;
-	ctx->new_cluster_page = ch->new_cluster_page;
+	ctx->cluster_number = cluster_number;
+	ctx->new_extent_page = 0;
+	ctx->buf = NULL;
 	memset(ctx->new_cluster_page, 0, SPDK_BS_PAGE_SIZE);
-	can_copy = blob_can_copy(blob, cluster_start_page, &copy_src_lba);
 
 	is_zeroes = blob->back_bs_dev->is_zeroes(blob->back_bs_dev,
 			bs_dev_page_to_lba(blob->back_bs_dev, cluster_start_page),
 			bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz));
-	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes && !can_copy) {
+	partial = blob_allocate_partial_cluster(blob, cluster_number, op, is_zeroes);
+	can_copy = !partial && blob_can_copy(blob, cluster_start_page, &copy_src_lba);
+	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes && !partial && !can_copy) {
 		ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen,
 				       NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
 		if (!ctx->buf) {
 			SPDK_ERRLOG("DMA allocation for cluster of size = %" PRIu32 " failed.\n",
 				    blob->bs->cluster_sz);
-			free(ctx);
 			bs_user_op_abort(op, -ENOMEM);
 			return;
 		}
@@ -2670,7 +3641,7 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	spdk_spin_unlock(&blob->bs->used_lock);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
-		free(ctx);
+		ctx->buf = NULL;
 		bs_user_op_abort(op, rc);
 		return;
 	}
@@ -2683,17 +3654,28 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	if (!ctx->seq) {
 		spdk_spin_lock(&blob->bs->used_lock);
 		bs_release_cluster(blob->bs, ctx->new_cluster);
+		if (ctx->new_extent_page != 0) {
+			bs_release_md_page(blob->bs, ctx->new_extent_page);
+		}
 		spdk_spin_unlock(&blob->bs->used_lock);
 		spdk_free(ctx->buf);
-		free(ctx);
+		ctx->buf = NULL;
 		bs_user_op_abort(op, -ENOMEM);
 		return;
 	}
 
-	/* Queue the user op to block other incoming operations */
-	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+	/* Queue the user op to block other incoming operations to this cluster */
+	TAILQ_REMOVE(&ch->free_cluster_allocs, ctx, link);
+	TAILQ_INSERT_TAIL(&ch->cluster_allocs, ctx, link);
+	TAILQ_INSERT_TAIL(&ctx->ops, op, link);
 
-	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes) {
+	if (partial) {
+		/* The pages are written to the cluster as they come, the other ones are
+		 * still read from the parent */
+		blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
+						 ctx->new_extent_page, ctx->new_cluster_page, true,
+						 blob_insert_cluster_cpl, ctx);
+	} else if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes) {
 		if (can_copy) {
 			blob_copy(ctx, op, copy_src_lba);
 		} else {
@@ -2706,7 +3688,8 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 
 	} else {
 		blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
-						 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
+						 ctx->new_extent_page, ctx->new_cluster_page, false,
+						 blob_insert_cluster_cpl, ctx);
 	}
 }
 
@@ -2727,6 +3710,141 @@ blob_calculate_lba_and_lba_count(struct spdk_blob *blob, uint64_t io_unit, uint6
 	}
 }
 
+/* Walks the snapshots in the backing chain of the blob, looking for the first one that
+ * has a given cluster allocated.
+ */
+static uint32_t
+blob_resolve_backing_cluster(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob *snapshot = blob;
+	uint64_t lba;
+
+	while (snapshot->parent_id != SPDK_BLOBID_INVALID) {
+		if (blob_is_esnap_clone(snapshot)) {
+			/* The data is out of the blobstore */
+			return SPDK_BLOB_RESOLVED_BACKING;
+		}
+
+		snapshot = ((struct spdk_blob_bs_dev *)snapshot->back_bs_dev)->blob;
+		if (cluster_num >= snapshot->active.num_clusters) {
+			/* Clone larger than its snapshot, leave it to the backing device */
+			return SPDK_BLOB_RESOLVED_BACKING;
+		}
+
+		lba = bs_blob_cluster_lba(snapshot, cluster_num);
+		if (lba != 0) {
+			if (bs_io_unit_to_partial_cluster(snapshot,
+							  cluster_num * bs_io_units_per_cluster(snapshot)) != NULL) {
+				/* Part of the cluster is further down the chain */
+				return SPDK_BLOB_RESOLVED_BACKING;
+			}
+			return bs_lba_to_cluster(blob->bs, lba);
+		}
+	}
+
+	return SPDK_BLOB_RESOLVED_ZEROES;
+}
+
+static uint64_t *
+blob_resolve_cache_entry(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob_resolve_cache *cache, *new_cache;
+	uint64_t *chunk, *new_chunk;
+	uint64_t num_chunks, chunk_idx;
+
+	cache = __atomic_load_n(&blob->resolve_cache, __ATOMIC_ACQUIRE);
+	if (spdk_unlikely(cache == NULL)) {
+		num_chunks = spdk_divide_round_up(blob->active.num_clusters, SPDK_BLOB_CLUSTER_CHUNK_SZ);
+		new_cache = calloc(1, sizeof(*new_cache) + num_chunks * sizeof(new_cache->chunks[0]));
+		if (new_cache == NULL) {
+			return NULL;
+		}
+		new_cache->num_chunks = num_chunks;
+
+		/* Another I/O thread might have been faster */
+		if (__atomic_compare_exchange_n(&blob->resolve_cache, &cache, new_cache, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			cache = new_cache;
+		} else {
+			free(new_cache);
+		}
+	}
+
+	chunk_idx = cluster_num >> SPDK_BLOB_CLUSTER_CHUNK_SHIFT;
+	if (chunk_idx >= cache->num_chunks) {
+		/* The blob grew since the cache was allocated */
+		return NULL;
+	}
+
+	chunk = __atomic_load_n(&cache->chunks[chunk_idx], __ATOMIC_ACQUIRE);
+	if (spdk_unlikely(chunk == NULL)) {
+		new_chunk = calloc(SPDK_BLOB_CLUSTER_CHUNK_SZ, sizeof(*new_chunk));
+		if (new_chunk == NULL) {
+			return NULL;
+		}
+
+		if (__atomic_compare_exchange_n(&cache->chunks[chunk_idx], &chunk, new_chunk, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			chunk = new_chunk;
+		} else {
+			free(new_chunk);
+		}
+	}
+
+	return &chunk[cluster_num & (SPDK_BLOB_CLUSTER_CHUNK_SZ - 1)];
+}
+
+/* Resolves where an unallocated range of a blob is read from, without going through
+ * each of the snapshots in its backing chain. Returns true if the data is in a cluster
+ * of one of these snapshots, with *lba updated to point to it on the blobstore device.
+ * Otherwise, *lba and *lba_count are to be read from *dev.
+ */
+static bool
+blob_resolve_backing(struct spdk_blob *blob, uint64_t io_unit, uint64_t length,
+		     struct spdk_bs_dev **dev, uint64_t *lba, uint64_t *lba_count)
+{
+	uint64_t cluster_num, *entry, value;
+	uint32_t gen, cluster;
+
+	*dev = blob->back_bs_dev;
+
+	/* Only clones of snapshots have a backing chain worth resolving */
+	if (blob->parent_id == SPDK_BLOBID_INVALID || blob_is_esnap_clone(blob)) {
+		return false;
+	}
+
+	cluster_num = bs_io_unit_to_cluster_number(blob, io_unit);
+	entry = blob_resolve_cache_entry(blob, cluster_num);
+	if (spdk_unlikely(entry == NULL)) {
+		return false;
+	}
+
+	gen = __atomic_load_n(&blob->bs->backing_chain_gen, __ATOMIC_ACQUIRE);
+	value = __atomic_load_n(entry, __ATOMIC_RELAXED);
+	if (spdk_likely((uint32_t)(value >> 32) == gen)) {
+		cluster = (uint32_t)value;
+	} else {
+		/* Stored with the generation read before the lookup, so that a chain
+		 * changing in the meantime leaves a stale entry. */
+		cluster = blob_resolve_backing_cluster(blob, cluster_num);
+		__atomic_store_n(entry, ((uint64_t)gen << 32) | cluster, __ATOMIC_RELAXED);
+	}
+
+	switch (cluster) {
+	case SPDK_BLOB_RESOLVED_BACKING:
+		return false;
+	case SPDK_BLOB_RESOLVED_ZEROES:
+		*dev = bs_create_zeroes_dev();
+		*lba = 0;
+		*lba_count = bs_dev_byte_to_lba(*dev, length * blob->bs->io_unit_size);
+		return false;
+	default:
+		*lba = bs_cluster_to_lba(blob->bs, cluster) + io_unit % bs_io_units_per_cluster(blob);
+		*lba_count = length;
+		return true;
+	}
+}
+
 struct op_split_ctx {
 	struct spdk_blob *blob;
 	struct spdk_io_channel *channel;
@@ -2884,42 +4002,303 @@ blob_request_submit_op_split(struct spdk_io_channel *ch, struct spdk_blob *blob,
 	blob_request_submit_op_split_next(ctx, 0);
 }
 
-static void
-blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blob,
-			      void *payload, uint64_t offset, uint64_t length,
-			      spdk_blob_op_complete cb_fn, void *cb_arg, enum spdk_blob_op_type op_type)
+/*
+ * Fills iov with the part of orig_iov that starts byte_offset bytes into it and is
+ * byte_count bytes long. Returns the number of entries used in iov.
+ */
+static int
+blob_iov_slice(struct iovec *iov, int max_iovcnt, struct iovec *orig_iov, uint64_t byte_offset,
+	       uint64_t byte_count)
 {
-	struct spdk_bs_cpl cpl;
-	uint64_t lba;
-	uint64_t lba_count;
-	bool is_allocated;
+	size_t orig_iovoff = 0;
+	int iovcnt = 0;
 
-	assert(blob != NULL);
+	while (byte_offset > 0) {
+		if (byte_offset >= orig_iov->iov_len) {
+			byte_offset -= orig_iov->iov_len;
+			orig_iov++;
+		} else {
+			orig_iovoff = byte_offset;
+			byte_offset = 0;
+		}
+	}
 
-	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-	cpl.u.blob_basic.cb_fn = cb_fn;
-	cpl.u.blob_basic.cb_arg = cb_arg;
+	while (byte_count > 0) {
+		assert(iovcnt < max_iovcnt);
+		iov->iov_len = spdk_min(byte_count, orig_iov->iov_len - orig_iovoff);
+		iov->iov_base = orig_iov->iov_base + orig_iovoff;
+		byte_count -= iov->iov_len;
+		orig_iovoff = 0;
+		orig_iov++;
+		iov++;
+		iovcnt++;
+	}
 
-	if (blob->frozen_refcnt) {
-		/* This blob I/O is frozen */
-		spdk_bs_user_op_t *op;
-		struct spdk_bs_channel *bs_channel = spdk_io_channel_get_ctx(_ch);
+	return iovcnt;
+}
 
-		op = bs_user_op_alloc(_ch, &cpl, op_type, blob, payload, 0, offset, length);
-		if (!op) {
-			cb_fn(cb_arg, -ENOMEM);
-			return;
-		}
+/*
+ * Returns the partial cluster an I/O, which does not cross a cluster boundary, has to be
+ * split for, or NULL if all of its pages were already written.
+ */
+static inline struct spdk_blob_partial_cluster *
+blob_io_partial_cluster(struct spdk_blob *blob, uint64_t io_unit, uint64_t length)
+{
+	struct spdk_blob_partial_cluster *partial;
+	uint32_t first;
 
-		TAILQ_INSERT_TAIL(&bs_channel->queued_io, op, link);
+	partial = bs_io_unit_to_partial_cluster(blob, io_unit);
+	if (spdk_likely(partial == NULL)) {
+		return NULL;
+	}
 
-		return;
+	/* Partial clusters require io units of a page */
+	first = io_unit % blob->bs->pages_per_cluster;
+	if (spdk_bit_array_find_first_clear(partial->written, first) >= first + length) {
+		return NULL;
 	}
 
-	is_allocated = blob_calculate_lba_and_lba_count(blob, offset, length, &lba, &lba_count);
+	return partial;
+}
+
+struct blob_partial_io_ctx {
+	struct spdk_blob			*blob;
+	struct spdk_blob_partial_cluster	*partial;
+	struct spdk_blob_insert_cluster_ctx	*written;
+	uint64_t				offset;
+	uint64_t				lba;
+	uint32_t				first_page;
+	uint32_t				num_pages;
+	uint32_t				pages_done;
+	struct iovec				payload_iov;
+	struct iovec				*orig_iov;
+	int					iovcnt;
+	struct iovec				iov[0];
+};
+
+
+static void
+blob_partial_readv_next(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct blob_partial_io_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint32_t page, end, run_end;
+	bool written;
+	int iovcnt;
+
+	if (bserrno != 0 || ctx->pages_done == ctx->num_pages) {
+		free(ctx);
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	/* Read the next run of pages, either all written to the cluster or all still in the parent */
+	page = ctx->first_page + ctx->pages_done;
+	end = ctx->first_page + ctx->num_pages;
+	written = spdk_bit_array_get(ctx->partial->written, page);
+	if (written) {
+		run_end = spdk_bit_array_find_first_clear(ctx->partial->written, page);
+	} else {
+		run_end = spdk_bit_array_find_first_set(ctx->partial->written, page);
+	}
+	run_end = spdk_min(run_end, end);
+
+	iovcnt = blob_iov_slice(ctx->iov, ctx->iovcnt, ctx->orig_iov,
+				(uint64_t)ctx->pages_done * SPDK_BS_PAGE_SIZE,
+				(uint64_t)(run_end - page) * SPDK_BS_PAGE_SIZE);
+	if (written) {
+		bs_sequence_readv_dev(seq, ctx->iov, iovcnt, ctx->lba + ctx->pages_done,
+				      run_end - page, blob_partial_readv_next, ctx);
+	} else {
+		bs_sequence_readv_bs_dev(seq, blob->back_bs_dev, ctx->iov, iovcnt,
+					 bs_io_unit_to_back_dev_lba(blob, ctx->offset + ctx->pages_done),
+					 bs_io_unit_to_back_dev_lba(blob, run_end - page),
+					 blob_partial_readv_next, ctx);
+	}
+	ctx->pages_done = run_end - ctx->first_page;
+}
+
+static void
+blob_partial_write_marked(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_insert_cluster_ctx *written = cb_arg;
+	struct spdk_bs_channel *ch = written->channel;
+	struct spdk_blob_insert_cluster_ctx *tmp;
+	struct freeze_io_ctx *drain, *drain_tmp;
+
+	TAILQ_REMOVE(&ch->partial_writes, written, ch_link);
+
+	/* Let the freezes of the blob, waiting on this channel, go on */
+	TAILQ_FOREACH_SAFE(drain, &ch->partial_write_drains, link, drain_tmp) {
+		TAILQ_FOREACH(tmp, &ch->partial_writes, ch_link) {
+			if (tmp->blob == drain->blob) {
+				break;
+			}
+		}
+		if (tmp == NULL) {
+			TAILQ_REMOVE(&ch->partial_write_drains, drain, link);
+			spdk_for_each_channel_continue(drain->iter, 0);
+		}
+	}
+
+	bs_sequence_finish(written->seq, bserrno);
+}
+
+static void
+blob_partial_write_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct blob_partial_io_ctx *ctx = cb_arg;
+	struct spdk_blob_insert_cluster_ctx *written = ctx->written;
+
+	free(ctx);
+
+	if (bserrno != 0) {
+		blob_partial_write_marked(written, bserrno);
+		free(written);
+		return;
+	}
+
+	/* The data is on disk, the pages can now be persisted as written */
+	spdk_thread_send_msg(written->blob->bs->md_thread, blob_insert_cluster_msg, written);
+}
+
+/*
+ * Submits an I/O to a partial cluster. Reads are split into runs of pages read either
+ * from the cluster or from the parent. Writes are completed only once the pages they
+ * wrote are persisted as written in the metadata.
+ */
+static void
+blob_partial_cluster_submit(struct spdk_io_channel *_ch, struct spdk_blob *blob,
+			    struct spdk_blob_partial_cluster *partial, enum spdk_blob_op_type op_type,
+			    struct iovec *iov, int iovcnt, uint64_t offset, uint64_t length, uint64_t lba,
+			    struct spdk_bs_cpl *cpl, struct spdk_blob_ext_io_opts *ext_io_opts)
+{
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct blob_partial_io_ctx *ctx;
+	spdk_bs_sequence_t *seq;
+
+	assert(blob->bs->io_unit_size == SPDK_BS_PAGE_SIZE);
+
+	ctx = calloc(1, sizeof(*ctx) + iovcnt * sizeof(struct iovec));
+	if (ctx == NULL) {
+		bs_call_cpl(cpl, -ENOMEM);
+		return;
+	}
+
+	ctx->blob = blob;
+	ctx->partial = partial;
+	ctx->offset = offset;
+	ctx->lba = lba;
+	ctx->first_page = offset % blob->bs->pages_per_cluster;
+	ctx->num_pages = length;
+	ctx->iovcnt = iovcnt;
+	if (op_type == SPDK_BLOB_READ || op_type == SPDK_BLOB_WRITE) {
+		/* Payload, the caller passed it in a single iov */
+		ctx->payload_iov = *iov;
+		ctx->orig_iov = &ctx->payload_iov;
+	} else {
+		ctx->orig_iov = iov;
+	}
+
+	if (op_type != SPDK_BLOB_READ && op_type != SPDK_BLOB_READV) {
+		ctx->written = calloc(1, sizeof(*ctx->written));
+		if (ctx->written == NULL) {
+			free(ctx);
+			bs_call_cpl(cpl, -ENOMEM);
+			return;
+		}
+	}
+
+	seq = bs_sequence_start_blob(_ch, cpl, blob);
+	if (!seq) {
+		free(ctx->written);
+		free(ctx);
+		bs_call_cpl(cpl, -ENOMEM);
+		return;
+	}
+	seq->ext_io_opts = ext_io_opts;
+
+	switch (op_type) {
+	case SPDK_BLOB_READ:
+	case SPDK_BLOB_READV:
+		blob_partial_readv_next(seq, ctx, 0);
+		return;
+	default:
+		break;
+	}
+
+	ctx->written->thread = spdk_get_thread();
+	ctx->written->blob = blob;
+	ctx->written->cluster_num = bs_io_unit_to_cluster_number(blob, offset);
+	ctx->written->first_page = ctx->first_page;
+	ctx->written->num_pages = length;
+	ctx->written->seq = seq;
+	ctx->written->channel = ch;
+	ctx->written->cb_fn = blob_partial_write_marked;
+	ctx->written->cb_arg = ctx->written;
+	/* Blob freezes wait for the write, until its pages are marked as written */
+	TAILQ_INSERT_TAIL(&ch->partial_writes, ctx->written, ch_link);
+
+	if (op_type == SPDK_BLOB_WRITE_ZEROES) {
+		bs_sequence_write_zeroes_dev(seq, lba, length, blob_partial_write_cpl, ctx);
+	} else {
+		bs_sequence_writev_dev(seq, ctx->orig_iov, iovcnt, lba, length,
+				       blob_partial_write_cpl, ctx);
+	}
+}
+
+static void
+blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blob,
+			      void *payload, uint64_t offset, uint64_t length,
+			      spdk_blob_op_complete cb_fn, void *cb_arg, enum spdk_blob_op_type op_type)
+{
+	struct spdk_bs_cpl cpl;
+	struct spdk_blob_partial_cluster *partial;
+	uint64_t lba;
+	uint64_t lba_count;
+	bool is_allocated;
+
+	assert(blob != NULL);
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = cb_fn;
+	cpl.u.blob_basic.cb_arg = cb_arg;
+
+	if (blob->frozen_refcnt) {
+		/* This blob I/O is frozen */
+		spdk_bs_user_op_t *op;
+		struct spdk_bs_channel *bs_channel = spdk_io_channel_get_ctx(_ch);
+
+		op = bs_user_op_alloc(_ch, &cpl, op_type, blob, payload, 0, offset, length);
+		if (!op) {
+			cb_fn(cb_arg, -ENOMEM);
+			return;
+		}
+
+		TAILQ_INSERT_TAIL(&bs_channel->queued_io, op, link);
+
+		return;
+	}
+
+	is_allocated = blob_calculate_lba_and_lba_count(blob, offset, length, &lba, &lba_count);
+
+	if (is_allocated && op_type != SPDK_BLOB_UNMAP) {
+		partial = blob_io_partial_cluster(blob, offset, length);
+		if (spdk_unlikely(partial != NULL)) {
+			struct iovec iov = {
+				.iov_base = payload,
+				.iov_len = length * blob->bs->io_unit_size,
+			};
+
+			blob_partial_cluster_submit(_ch, blob, partial, op_type, &iov, 1, offset, length,
+						    lba, &cpl, NULL);
+			return;
+		}
+	}
 
 	switch (op_type) {
 	case SPDK_BLOB_READ: {
+		struct spdk_bs_dev *back_bs_dev;
 		spdk_bs_batch_t *batch;
 
 		batch = bs_batch_open(_ch, &cpl, blob);
@@ -2931,9 +4310,12 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 		if (is_allocated) {
 			/* Read from the blob */
 			bs_batch_read_dev(batch, payload, lba, lba_count);
+		} else if (blob_resolve_backing(blob, offset, length, &back_bs_dev, &lba, &lba_count)) {
+			/* Read from the snapshot owning the cluster */
+			bs_batch_read_dev(batch, payload, lba, lba_count);
 		} else {
 			/* Read from the backing block device */
-			bs_batch_read_bs_dev(batch, blob->back_bs_dev, payload, lba, lba_count);
+			bs_batch_read_bs_dev(batch, back_bs_dev, payload, lba, lba_count);
 		}
 
 		bs_batch_close(batch);
@@ -3058,11 +4440,9 @@ rw_iov_split_next(void *cb_arg, int bserrno)
 {
 	struct rw_iov_ctx *ctx = cb_arg;
 	struct spdk_blob *blob = ctx->blob;
-	struct iovec *iov, *orig_iov;
+	struct iovec *iov;
 	int iovcnt;
-	size_t orig_iovoff;
 	uint64_t io_units_count, io_units_to_boundary, io_unit_offset;
-	uint64_t byte_count;
 
 	if (bserrno != 0 || ctx->io_units_remaining == 0) {
 		ctx->cb_fn(ctx->cb_arg, bserrno);
@@ -3073,41 +4453,11 @@ rw_iov_split_next(void *cb_arg, int bserrno)
 	io_unit_offset = ctx->io_unit_offset;
 	io_units_to_boundary = bs_num_io_units_to_cluster_boundary(blob, io_unit_offset);
 	io_units_count = spdk_min(ctx->io_units_remaining, io_units_to_boundary);
-	/*
-	 * Get index and offset into the original iov array for our current position in the I/O sequence.
-	 *  byte_count will keep track of how many bytes remaining until orig_iov and orig_iovoff will
-	 *  point to the current position in the I/O sequence.
-	 */
-	byte_count = ctx->io_units_done * blob->bs->io_unit_size;
-	orig_iov = &ctx->orig_iov[0];
-	orig_iovoff = 0;
-	while (byte_count > 0) {
-		if (byte_count >= orig_iov->iov_len) {
-			byte_count -= orig_iov->iov_len;
-			orig_iov++;
-		} else {
-			orig_iovoff = byte_count;
-			byte_count = 0;
-		}
-	}
-
-	/*
-	 * Build an iov array for the next I/O in the sequence.  byte_count will keep track of how many
-	 *  bytes of this next I/O remain to be accounted for in the new iov array.
-	 */
-	byte_count = io_units_count * blob->bs->io_unit_size;
-	iov = &ctx->iov[0];
-	iovcnt = 0;
-	while (byte_count > 0) {
-		assert(iovcnt < ctx->iovcnt);
-		iov->iov_len = spdk_min(byte_count, orig_iov->iov_len - orig_iovoff);
-		iov->iov_base = orig_iov->iov_base + orig_iovoff;
-		byte_count -= iov->iov_len;
-		orig_iovoff = 0;
-		orig_iov++;
-		iov++;
-		iovcnt++;
-	}
+	/* Build an iov array for the next I/O in the sequence, from our current position in the
+	 *  original iov array. */
+	iovcnt = blob_iov_slice(&ctx->iov[0], ctx->iovcnt, &ctx->orig_iov[0],
+				ctx->io_units_done * blob->bs->io_unit_size,
+				io_units_count * blob->bs->io_unit_size);
 
 	ctx->io_unit_offset += io_units_count;
 	ctx->io_units_remaining -= io_units_count;
@@ -3163,6 +4513,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 	 *  when the batch was completed, to allow for freeing the memory for the iov arrays.
 	 */
 	if (spdk_likely(length <= bs_num_io_units_to_cluster_boundary(blob, offset))) {
+		struct spdk_blob_partial_cluster *partial;
 		uint64_t lba_count;
 		uint64_t lba;
 		bool is_allocated;
@@ -3191,7 +4542,16 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 
 		is_allocated = blob_calculate_lba_and_lba_count(blob, offset, length, &lba, &lba_count);
 
+		partial = is_allocated ? blob_io_partial_cluster(blob, offset, length) : NULL;
+		if (spdk_unlikely(partial != NULL)) {
+			blob_partial_cluster_submit(_channel, blob, partial,
+						    read ? SPDK_BLOB_READV : SPDK_BLOB_WRITEV, iov, iovcnt,
+						    offset, length, lba, &cpl, ext_io_opts);
+			return;
+		}
+
 		if (read) {
+			struct spdk_bs_dev *back_bs_dev;
 			spdk_bs_sequence_t *seq;
 
 			seq = bs_sequence_start_blob(_channel, &cpl, blob);
@@ -3202,10 +4562,11 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 
 			seq->ext_io_opts = ext_io_opts;
 
-			if (is_allocated) {
+			if (is_allocated ||
+			    blob_resolve_backing(blob, offset, length, &back_bs_dev, &lba, &lba_count)) {
 				bs_sequence_readv_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
-				bs_sequence_readv_bs_dev(seq, blob->back_bs_dev, iov, iovcnt, lba, lba_count,
+				bs_sequence_readv_bs_dev(seq, back_bs_dev, iov, iovcnt, lba, lba_count,
 							 rw_iov_done, NULL);
 			}
 		} else {
@@ -3336,17 +4697,32 @@ bs_channel_create(void *io_device, void *ctx_buf)
 		return -1;
 	}
 
-	channel->new_cluster_page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
-				    SPDK_MALLOC_DMA);
-	if (!channel->new_cluster_page) {
-		SPDK_ERRLOG("Failed to allocate new cluster page\n");
+	channel->new_cluster_pages = spdk_zmalloc(SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS * SPDK_BS_PAGE_SIZE,
+				     0, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	channel->cluster_alloc_mem = calloc(SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS,
+					    sizeof(*channel->cluster_alloc_mem));
+	if (!channel->new_cluster_pages || !channel->cluster_alloc_mem) {
+		SPDK_ERRLOG("Failed to allocate new cluster pages\n");
+		spdk_free(channel->new_cluster_pages);
+		free(channel->cluster_alloc_mem);
 		free(channel->req_mem);
 		channel->dev->destroy_channel(channel->dev, channel->dev_channel);
 		return -1;
 	}
 
+	TAILQ_INIT(&channel->free_cluster_allocs);
+	TAILQ_INIT(&channel->cluster_allocs);
+	for (i = 0; i < SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS; i++) {
+		channel->cluster_alloc_mem[i].channel = channel;
+		channel->cluster_alloc_mem[i].new_cluster_page = &channel->new_cluster_pages[i];
+		TAILQ_INIT(&channel->cluster_alloc_mem[i].ops);
+		TAILQ_INSERT_TAIL(&channel->free_cluster_allocs, &channel->cluster_alloc_mem[i], link);
+	}
+
 	TAILQ_INIT(&channel->need_cluster_alloc);
 	TAILQ_INIT(&channel->queued_io);
+	TAILQ_INIT(&channel->partial_writes);
+	TAILQ_INIT(&channel->partial_write_drains);
 	RB_INIT(&channel->esnap_channels);
 
 	return 0;
@@ -3356,8 +4732,17 @@ static void
 bs_channel_destroy(void *io_device, void *ctx_buf)
 {
 	struct spdk_bs_channel *channel = ctx_buf;
+	struct spdk_blob_copy_cluster_ctx *ctx;
 	spdk_bs_user_op_t *op;
 
+	TAILQ_FOREACH(ctx, &channel->cluster_allocs, link) {
+		while (!TAILQ_EMPTY(&ctx->ops)) {
+			op = TAILQ_FIRST(&ctx->ops);
+			TAILQ_REMOVE(&ctx->ops, op, link);
+			bs_user_op_abort(op, -EIO);
+		}
+	}
+
 	while (!TAILQ_EMPTY(&channel->need_cluster_alloc)) {
 		op = TAILQ_FIRST(&channel->need_cluster_alloc);
 		TAILQ_REMOVE(&channel->need_cluster_alloc, op, link);
@@ -3373,7 +4758,8 @@ bs_channel_destroy(void *io_device, void *ctx_buf)
 	blob_esnap_destroy_bs_channel(channel);
 
 	free(channel->req_mem);
-	spdk_free(channel->new_cluster_page);
+	free(channel->cluster_alloc_mem);
+	spdk_free(channel->new_cluster_pages);
 	channel->dev->destroy_channel(channel->dev, channel->dev_channel);
 }
 
@@ -3496,6 +4882,20 @@ bs_blob_list_free(struct spdk_blob_store *bs)
 static void
 bs_free(struct spdk_blob_store *bs)
 {
+	struct spdk_bs_pending_free *pending;
+
+	assert(TAILQ_EMPTY(&bs->md_writes));
+	assert(!bs->background_free_busy);
+
+	spdk_poller_unregister(&bs->background_free_poller);
+	while ((pending = TAILQ_FIRST(&bs->pending_frees)) != NULL) {
+		TAILQ_REMOVE(&bs->pending_frees, pending, link);
+		if (pending->blob != NULL) {
+			blob_free(pending->blob);
+		}
+		free(pending);
+	}
+
 	bs_blob_list_free(bs);
 
 	bs_unregister_md_thread(bs);
@@ -3542,6 +4942,11 @@ spdk_bs_opts_init(struct spdk_bs_opts *opts, size_t opts_size)
 	SET_FIELD(force_recover, false);
 	SET_FIELD(esnap_bs_dev_create, NULL);
 	SET_FIELD(esnap_ctx, NULL);
+	SET_FIELD(cluster_allocator, BS_CLUSTER_ALLOCATOR_FIRST_FIT);
+	SET_FIELD(cluster_extent_sz, SPDK_BLOB_OPTS_CLUSTER_EXTENT_SZ);
+	SET_FIELD(recovery_progress_fn, NULL);
+	SET_FIELD(recovery_progress_arg, NULL);
+	SET_FIELD(background_free_rate, 0);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -3556,11 +4961,24 @@ bs_opts_verify(struct spdk_bs_opts *opts)
 		return -1;
 	}
 
+	if (opts->cluster_allocator != BS_CLUSTER_ALLOCATOR_FIRST_FIT &&
+	    (opts->cluster_allocator != BS_CLUSTER_ALLOCATOR_EXTENT || opts->cluster_extent_sz == 0)) {
+		SPDK_ERRLOG("Invalid cluster allocator %d with extent size %" PRIu32 "\n",
+			    opts->cluster_allocator, opts->cluster_extent_sz);
+		return -1;
+	}
+
 	return 0;
 }
 
 /* START spdk_bs_load */
 
+enum bs_replay_pass {
+	BS_REPLAY_SCAN,
+	BS_REPLAY_PARSE,
+	BS_REPLAY_PARSE_EXTENTS,
+};
+
 /* spdk_bs_load_ctx is used for init, load, unload and dump code paths. */
 
 struct spdk_bs_load_ctx {
@@ -3568,16 +4986,26 @@ struct spdk_bs_load_ctx {
 	struct spdk_bs_super_block	*super;
 
 	struct spdk_bs_md_mask		*mask;
-	bool				in_page_chain;
 	uint32_t			page_index;
 	uint32_t			cur_page;
 	struct spdk_blob_md_page	*page;
 
 	uint64_t			num_extent_pages;
 	uint32_t			*extent_page_num;
-	struct spdk_blob_md_page	*extent_pages;
 	struct spdk_bit_array		*used_clusters;
 
+	/* These fields are used to replay the metadata during recovery. */
+	enum bs_replay_pass		replay_pass;
+	struct spdk_blob_md_page	*replay_buf;
+	uint32_t			*replay_next;
+	struct spdk_bit_array		*replay_valid;
+	struct spdk_bit_array		*replay_heads;
+	struct spdk_bit_array		*replay_extents;
+	struct spdk_bit_array		*replay_filter;
+	struct spdk_bs_recovery_progress	recovery_progress;
+	spdk_bs_recovery_progress_cb		recovery_progress_fn;
+	void					*recovery_progress_arg;
+
 	spdk_bs_sequence_t			*seq;
 	spdk_blob_op_with_handle_complete	iter_cb_fn;
 	void					*iter_cb_arg;
@@ -3630,6 +5058,8 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	ctx->iter_cb_fn = opts->iter_cb_fn;
 	ctx->iter_cb_arg = opts->iter_cb_arg;
 	ctx->force_recover = opts->force_recover;
+	ctx->recovery_progress_fn = opts->recovery_progress_fn;
+	ctx->recovery_progress_arg = opts->recovery_progress_arg;
 
 	ctx->super = spdk_zmalloc(sizeof(*ctx->super), 0x1000, NULL,
 				  SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
@@ -3641,6 +5071,8 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 
 	RB_INIT(&bs->open_blobs);
 	TAILQ_INIT(&bs->snapshots);
+	TAILQ_INIT(&bs->md_writes);
+	TAILQ_INIT(&bs->pending_frees);
 	bs->dev = dev;
 	bs->md_thread = spdk_get_thread();
 	assert(bs->md_thread != NULL);
@@ -3671,6 +5103,10 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	memcpy(&bs->bstype, &opts->bstype, sizeof(opts->bstype));
 	bs->esnap_bs_dev_create = opts->esnap_bs_dev_create;
 	bs->esnap_ctx = opts->esnap_ctx;
+	bs->cluster_allocator = opts->cluster_allocator;
+	bs->cluster_extent_sz = opts->cluster_extent_sz;
+	bs->background_free_rate = opts->background_free_rate;
+	bs->backing_chain_gen = 1;
 
 	/* The metadata is assumed to be at least 1 page */
 	bs->used_md_pages = spdk_bit_array_create(1);
@@ -3720,6 +5156,9 @@ bs_write_super(spdk_bs_sequence_t *seq, struct spdk_blob_store *bs,
 	/* Update the values in the super block */
 	super->super_blob = bs->super_blob;
 	memcpy(&super->bstype, &bs->bstype, sizeof(bs->bstype));
+	super->cluster_allocator = bs->cluster_allocator;
+	super->cluster_extent_sz = bs->cluster_extent_sz;
+	super->background_free_rate = bs->background_free_rate;
 	super->crc = blob_md_page_calc_crc(super);
 	bs_sequence_write_dev(seq, super, bs_page_to_lba(bs, 0),
 			      bs_byte_to_lba(bs, sizeof(*super)),
@@ -3889,7 +5328,7 @@ bs_delete_corrupted_blob(void *cb_arg, int bserrno)
 	 * so that it won't be cleared for clone later when we remove snapshot.
 	 * Also set thin provision to pass data corruption check */
 	for (i = 0; i < ctx->blob->active.num_clusters; i++) {
-		ctx->blob->active.clusters[i] = 0;
+		blob_cluster_map_set(ctx->blob, i, 0);
 	}
 	for (i = 0; i < ctx->blob->active.num_extent_pages; i++) {
 		ctx->blob->active.extent_pages[i] = 0;
@@ -3959,6 +5398,16 @@ bs_load_iter(void *arg, struct spdk_blob *blob, int bserrno)
 	int rc = 0;
 
 	if (bserrno == 0) {
+		if (blob_get_xattr_value(blob, BLOB_PENDING_FREE, &value, &len, true) == 0) {
+			/* Deleted before all its clusters were released, resume releasing them */
+			rc = bs_pending_free_add(ctx->bs, blob->id, NULL);
+			if (rc != 0) {
+				SPDK_ERRLOG("Failed to resume freeing blob 0x%" PRIx64 ": %d\n", blob->id, rc);
+			}
+			spdk_bs_iter_next(ctx->bs, blob, bs_load_iter, ctx);
+			return;
+		}
+
 		/* Examine blob if it is corrupted after power failure. Fix
 		 * the ones that can be fixed and remove any other corrupted
 		 * ones. If it is not corrupted just process it */
@@ -4198,7 +5647,7 @@ bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_p
 					 * in the used cluster map.
 					 */
 					if (cluster_idx != 0) {
-						SPDK_NOTICELOG("Recover: cluster %" PRIu32 "\n", cluster_idx + j);
+						SPDK_DEBUGLOG(blob, "Recover: cluster %" PRIu32 "\n", cluster_idx + j);
 						spdk_bit_array_set(ctx->used_clusters, cluster_idx + j);
 						if (bs->num_free_clusters == 0) {
 							return -ENOSPC;
@@ -4255,6 +5704,8 @@ bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_p
 			/* Skip this item */
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_FLAGS) {
 			/* Skip this item */
+		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER) {
+			/* Skip this item, the cluster is claimed through the extents */
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_EXTENT_TABLE) {
 			struct spdk_blob_md_descriptor_extent_table *desc_extent_table;
 			uint32_t num_extent_pages = ctx->num_extent_pages;
@@ -4316,6 +5767,7 @@ bs_load_cur_extent_page_valid(struct spdk_blob_md_page *page)
 	uint32_t crc;
 	struct spdk_blob_md_descriptor *desc = (struct spdk_blob_md_descriptor *)page->descriptors;
 	size_t desc_len;
+	uint32_t start_cluster_idx, cluster_idx;
 
 	crc = blob_md_page_calc_crc(page);
 	if (crc != page->crc) {
@@ -4338,10 +5790,25 @@ bs_load_cur_extent_page_valid(struct spdk_blob_md_page *page)
 		return false;
 	}
 
-	/* It has to be the only descriptor in the page. */
-	if (desc_len + sizeof(*desc) <= sizeof(page->descriptors)) {
+	start_cluster_idx = ((struct spdk_blob_md_descriptor_extent_page *)desc)->start_cluster_idx;
+
+	/* It can only be followed by the bitmaps of its partial clusters. */
+	while (desc_len + sizeof(*desc) <= sizeof(page->descriptors)) {
 		desc = (struct spdk_blob_md_descriptor *)((uintptr_t)page->descriptors + desc_len);
-		if (desc->length != 0) {
+		if (desc->length == 0) {
+			break;
+		}
+		if (desc->type != SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER || desc->length <
+		    sizeof(struct spdk_blob_md_descriptor_partial_cluster) - sizeof(*desc)) {
+			return false;
+		}
+		desc_len += sizeof(*desc) + desc->length;
+		if (desc_len > sizeof(page->descriptors)) {
+			return false;
+		}
+		cluster_idx = ((struct spdk_blob_md_descriptor_partial_cluster *)desc)->cluster_idx;
+		if (cluster_idx < start_cluster_idx ||
+		    cluster_idx - start_cluster_idx >= SPDK_EXTENTS_PER_EP) {
 			return false;
 		}
 	}
@@ -4349,29 +5816,6 @@ bs_load_cur_extent_page_valid(struct spdk_blob_md_page *page)
 	return true;
 }
 
-static bool
-bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
-{
-	uint32_t crc;
-	struct spdk_blob_md_page *page = ctx->page;
-
-	crc = blob_md_page_calc_crc(page);
-	if (crc != page->crc) {
-		return false;
-	}
-
-	/* First page of a sequence should match the blobid. */
-	if (page->sequence_num == 0 &&
-	    bs_page_to_blobid(ctx->cur_page) != page->id) {
-		return false;
-	}
-	assert(bs_load_cur_extent_page_valid(page) == false);
-
-	return true;
-}
-
-static void bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx);
-
 static void
 bs_load_write_used_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
@@ -4423,167 +5867,287 @@ bs_load_write_used_md(struct spdk_bs_load_ctx *ctx)
 	bs_write_used_md(ctx->seq, ctx, bs_load_write_used_pages_cpl);
 }
 
+/*
+ * Metadata replay
+ *
+ * The metadata region is replayed in three passes, each reading it in windows of
+ * SPDK_BS_RECOVER_READ_DEPTH reads of SPDK_BS_RECOVER_READ_PAGES pages issued at once:
+ *  - SCAN reads every page and records which ones are valid metadata pages, first pages of
+ *    blobs or extent pages, along with the next page of each chain. The chains are then
+ *    followed in memory to claim the pages and blobids in use.
+ *  - PARSE reads back only the windows holding claimed pages and parses them to claim the
+ *    clusters of the blobs and collect their extent pages.
+ *  - PARSE_EXTENTS does the same for the extent pages.
+ */
+
+static void bs_load_replay_md_read_window(struct spdk_bs_load_ctx *ctx);
+
 static void
-bs_load_replay_md_chain_cpl(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_md_free(struct spdk_bs_load_ctx *ctx)
 {
-	uint64_t num_md_clusters;
-	uint64_t i;
-
-	ctx->in_page_chain = false;
+	spdk_free(ctx->replay_buf);
+	ctx->replay_buf = NULL;
+	free(ctx->replay_next);
+	ctx->replay_next = NULL;
+	spdk_bit_array_free(&ctx->replay_valid);
+	spdk_bit_array_free(&ctx->replay_heads);
+	spdk_bit_array_free(&ctx->replay_extents);
+	free(ctx->extent_page_num);
+	ctx->extent_page_num = NULL;
+	ctx->num_extent_pages = 0;
+}
 
-	do {
-		ctx->page_index++;
-	} while (spdk_bit_array_get(ctx->bs->used_md_pages, ctx->page_index) == true);
+static void
+bs_load_replay_md_fail(struct spdk_bs_load_ctx *ctx, int bserrno)
+{
+	bs_load_replay_md_free(ctx);
+	bs_load_ctx_fail(ctx, bserrno);
+}
 
-	if (ctx->page_index < ctx->super->md_len) {
-		ctx->cur_page = ctx->page_index;
-		bs_load_replay_cur_md_page(ctx);
-	} else {
-		/* Claim all of the clusters used by the metadata */
-		num_md_clusters = spdk_divide_round_up(
-					  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
-		for (i = 0; i < num_md_clusters; i++) {
-			spdk_bit_array_set(ctx->used_clusters, i);
-		}
-		ctx->bs->num_free_clusters -= num_md_clusters;
-		spdk_free(ctx->page);
-		bs_load_write_used_md(ctx);
+static void
+bs_load_replay_md_report_progress(struct spdk_bs_load_ctx *ctx)
+{
+	if (ctx->recovery_progress_fn != NULL) {
+		ctx->recovery_progress_fn(ctx->recovery_progress_arg, &ctx->recovery_progress);
 	}
 }
 
 static void
-bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+bs_load_replay_md_scan_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_page *page,
+			    uint32_t page_num)
 {
-	struct spdk_bs_load_ctx *ctx = cb_arg;
-	uint32_t page_num;
-	uint64_t i;
-
-	if (bserrno != 0) {
-		spdk_free(ctx->extent_pages);
-		bs_load_ctx_fail(ctx, bserrno);
+	/* First page of a sequence should match the blobid, otherwise it can only be an extent page */
+	if (page->sequence_num == 0 && bs_page_to_blobid(page_num) != page->id) {
+		if (bs_load_cur_extent_page_valid(page)) {
+			spdk_bit_array_set(ctx->replay_extents, page_num);
+		}
 		return;
 	}
 
-	for (i = 0; i < ctx->num_extent_pages; i++) {
-		/* Extent pages are only read when present within in chain md.
-		 * Integrity of md is not right if that page was not a valid extent page. */
-		if (bs_load_cur_extent_page_valid(&ctx->extent_pages[i]) != true) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
-			return;
-		}
-
-		page_num = ctx->extent_page_num[i];
-		spdk_bit_array_set(ctx->bs->used_md_pages, page_num);
-		if (bs_load_replay_md_parse_page(ctx, &ctx->extent_pages[i])) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
-			return;
-		}
+	if (blob_md_page_calc_crc(page) != page->crc) {
+		return;
 	}
+	assert(bs_load_cur_extent_page_valid(page) == false);
 
-	spdk_free(ctx->extent_pages);
-	free(ctx->extent_page_num);
-	ctx->extent_page_num = NULL;
-	ctx->num_extent_pages = 0;
-
-	bs_load_replay_md_chain_cpl(ctx);
+	spdk_bit_array_set(ctx->replay_valid, page_num);
+	if (page->sequence_num == 0) {
+		spdk_bit_array_set(ctx->replay_heads, page_num);
+	}
+	ctx->replay_next[page_num] = page->next;
 }
 
 static void
-bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_md_claim_chains(struct spdk_bs_load_ctx *ctx)
 {
-	spdk_bs_batch_t *batch;
-	uint32_t page;
-	uint64_t lba;
-	uint64_t i;
+	struct spdk_blob_store *bs = ctx->bs;
+	uint32_t md_len = ctx->super->md_len;
+	uint32_t head, page_num;
 
-	ctx->extent_pages = spdk_zmalloc(SPDK_BS_PAGE_SIZE * ctx->num_extent_pages, 0,
-					 NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (!ctx->extent_pages) {
-		bs_load_ctx_fail(ctx, -ENOMEM);
-		return;
+	spdk_spin_lock(&bs->used_lock);
+	for (head = spdk_bit_array_find_first_set(ctx->replay_heads, 0);
+	     head != UINT32_MAX;
+	     head = spdk_bit_array_find_first_set(ctx->replay_heads, head + 1)) {
+		page_num = head;
+		/* Pages already claimed are part of a chain seen earlier. */
+		while (page_num < md_len && spdk_bit_array_get(ctx->replay_valid, page_num) &&
+		       !spdk_bit_array_get(bs->used_md_pages, page_num)) {
+			bs_claim_md_page(bs, page_num);
+			ctx->recovery_progress.md_pages_used++;
+			if (spdk_bit_array_get(ctx->replay_heads, page_num)) {
+				SPDK_DEBUGLOG(blob, "Recover: blob 0x%" PRIx32 "\n", page_num);
+				spdk_bit_array_set(bs->used_blobids, page_num);
+				ctx->recovery_progress.num_blobs++;
+			}
+			page_num = ctx->replay_next[page_num];
+		}
 	}
+	spdk_spin_unlock(&bs->used_lock);
+}
 
-	batch = bs_sequence_to_batch(ctx->seq, bs_load_replay_extent_page_cpl, ctx);
+static int
+bs_load_replay_md_claim_extent_pages(struct spdk_bs_load_ctx *ctx)
+{
+	uint32_t page_num;
+	uint64_t i;
 
+	/* The valid page mask is not needed anymore, reuse it for the extent pages to parse. */
+	spdk_bit_array_clear_mask(ctx->replay_valid);
 	for (i = 0; i < ctx->num_extent_pages; i++) {
-		page = ctx->extent_page_num[i];
-		assert(page < ctx->super->md_len);
-		lba = bs_md_page_to_lba(ctx->bs, page);
-		bs_batch_read_dev(batch, &ctx->extent_pages[i], lba,
-				  bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE));
+		page_num = ctx->extent_page_num[i];
+		/* Integrity of md is not right if that page was not a valid extent page. */
+		if (page_num >= ctx->super->md_len ||
+		    !spdk_bit_array_get(ctx->replay_extents, page_num)) {
+			return -EILSEQ;
+		}
+		if (!spdk_bit_array_get(ctx->replay_valid, page_num)) {
+			spdk_bit_array_set(ctx->replay_valid, page_num);
+			spdk_bit_array_set(ctx->bs->used_md_pages, page_num);
+			ctx->recovery_progress.md_pages_used++;
+		}
 	}
 
-	bs_batch_close(batch);
+	return 0;
 }
 
 static void
-bs_load_replay_md_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+bs_load_replay_md_done(struct spdk_bs_load_ctx *ctx)
 {
-	struct spdk_bs_load_ctx *ctx = cb_arg;
-	uint32_t page_num;
+	uint64_t num_md_clusters;
+	uint64_t i;
+
+	/* Claim all of the clusters used by the metadata */
+	num_md_clusters = spdk_divide_round_up(
+				  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
+	for (i = 0; i < num_md_clusters; i++) {
+		spdk_bit_array_set(ctx->used_clusters, i);
+	}
+	ctx->bs->num_free_clusters -= num_md_clusters;
+
+	SPDK_NOTICELOG("Recovered %" PRIu64 " blobs from %" PRIu64 " metadata pages\n",
+		       ctx->recovery_progress.num_blobs, ctx->recovery_progress.md_pages_used);
+	bs_load_replay_md_free(ctx);
+	bs_load_write_used_md(ctx);
+}
+
+static void
+bs_load_replay_md_pass_done(struct spdk_bs_load_ctx *ctx)
+{
+	int rc;
+
+	switch (ctx->replay_pass) {
+	case BS_REPLAY_SCAN:
+		bs_load_replay_md_claim_chains(ctx);
+		ctx->replay_pass = BS_REPLAY_PARSE;
+		ctx->replay_filter = ctx->bs->used_md_pages;
+		break;
+	case BS_REPLAY_PARSE:
+		rc = bs_load_replay_md_claim_extent_pages(ctx);
+		if (rc != 0) {
+			bs_load_replay_md_fail(ctx, rc);
+			return;
+		}
+		ctx->replay_pass = BS_REPLAY_PARSE_EXTENTS;
+		ctx->replay_filter = ctx->replay_valid;
+		break;
+	case BS_REPLAY_PARSE_EXTENTS:
+		bs_load_replay_md_done(ctx);
+		return;
+	}
+
+	ctx->page_index = 0;
+	bs_load_replay_md_report_progress(ctx);
+	bs_load_replay_md_read_window(ctx);
+}
+
+static uint32_t
+bs_load_replay_md_window_end(struct spdk_bs_load_ctx *ctx)
+{
+	return spdk_min(ctx->page_index + SPDK_BS_RECOVER_READ_PAGES * SPDK_BS_RECOVER_READ_DEPTH,
+			ctx->super->md_len);
+}
+
+static bool
+bs_load_replay_md_page_needed(struct spdk_bs_load_ctx *ctx, uint32_t page_num)
+{
+	return ctx->replay_filter == NULL || spdk_bit_array_get(ctx->replay_filter, page_num);
+}
+
+static void
+bs_load_replay_md_window_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_load_ctx *ctx = cb_arg;
 	struct spdk_blob_md_page *page;
+	uint32_t page_num, end;
 
 	if (bserrno != 0) {
-		bs_load_ctx_fail(ctx, bserrno);
+		bs_load_replay_md_fail(ctx, bserrno);
 		return;
 	}
 
-	page_num = ctx->cur_page;
-	page = ctx->page;
-	if (bs_load_cur_md_page_valid(ctx) == true) {
-		if (page->sequence_num == 0 || ctx->in_page_chain == true) {
-			spdk_spin_lock(&ctx->bs->used_lock);
-			bs_claim_md_page(ctx->bs, page_num);
-			spdk_spin_unlock(&ctx->bs->used_lock);
-			if (page->sequence_num == 0) {
-				SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
-				spdk_bit_array_set(ctx->bs->used_blobids, page_num);
-			}
+	end = bs_load_replay_md_window_end(ctx);
+	for (page_num = ctx->page_index; page_num < end; page_num++) {
+		if (!bs_load_replay_md_page_needed(ctx, page_num)) {
+			continue;
+		}
+
+		page = &ctx->replay_buf[page_num - ctx->page_index];
+		if (ctx->replay_pass == BS_REPLAY_SCAN) {
+			bs_load_replay_md_scan_page(ctx, page, page_num);
+			ctx->recovery_progress.md_pages_scanned++;
+		} else {
 			if (bs_load_replay_md_parse_page(ctx, page)) {
-				bs_load_ctx_fail(ctx, -EILSEQ);
-				return;
-			}
-			if (page->next != SPDK_INVALID_MD_PAGE) {
-				ctx->in_page_chain = true;
-				ctx->cur_page = page->next;
-				bs_load_replay_cur_md_page(ctx);
-				return;
-			}
-			if (ctx->num_extent_pages != 0) {
-				bs_load_replay_extent_pages(ctx);
+				bs_load_replay_md_fail(ctx, -EILSEQ);
 				return;
 			}
+			ctx->recovery_progress.md_pages_parsed++;
 		}
 	}
-	bs_load_replay_md_chain_cpl(ctx);
+
+	ctx->page_index = end;
+	bs_load_replay_md_report_progress(ctx);
+	bs_load_replay_md_read_window(ctx);
 }
 
 static void
-bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_md_read_window(struct spdk_bs_load_ctx *ctx)
 {
-	uint64_t lba;
+	spdk_bs_batch_t *batch;
+	uint32_t start, end, chunk_start, chunk_end;
+	uint64_t lba_count;
 
-	assert(ctx->cur_page < ctx->super->md_len);
-	lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
-	bs_sequence_read_dev(ctx->seq, ctx->page, lba,
-			     bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
-			     bs_load_replay_md_cpl, ctx);
+	if (ctx->replay_filter != NULL) {
+		/* Skip straight to the next page needed in this pass. */
+		start = spdk_bit_array_find_first_set(ctx->replay_filter, ctx->page_index);
+		ctx->page_index = start;
+	}
+	if (ctx->page_index >= ctx->super->md_len) {
+		bs_load_replay_md_pass_done(ctx);
+		return;
+	}
+
+	start = ctx->page_index;
+	end = bs_load_replay_md_window_end(ctx);
+	batch = bs_sequence_to_batch(ctx->seq, bs_load_replay_md_window_cpl, ctx);
+
+	for (chunk_start = start; chunk_start < end; chunk_start = chunk_end) {
+		chunk_end = spdk_min(chunk_start + SPDK_BS_RECOVER_READ_PAGES, end);
+		if (ctx->replay_filter != NULL &&
+		    spdk_bit_array_find_first_set(ctx->replay_filter, chunk_start) >= chunk_end) {
+			continue;
+		}
+		lba_count = bs_byte_to_lba(ctx->bs, (chunk_end - chunk_start) * SPDK_BS_PAGE_SIZE);
+		bs_batch_read_dev(batch, &ctx->replay_buf[chunk_start - start],
+				  bs_md_page_to_lba(ctx->bs, chunk_start), lba_count);
+	}
+
+	bs_batch_close(batch);
 }
 
 static void
 bs_load_replay_md(struct spdk_bs_load_ctx *ctx)
 {
-	ctx->page_index = 0;
-	ctx->cur_page = 0;
-	ctx->page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0,
-				 NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (!ctx->page) {
-		bs_load_ctx_fail(ctx, -ENOMEM);
+	uint32_t md_len = ctx->super->md_len;
+	uint32_t buf_pages;
+
+	buf_pages = spdk_min(md_len, SPDK_BS_RECOVER_READ_PAGES * SPDK_BS_RECOVER_READ_DEPTH);
+	ctx->replay_buf = spdk_zmalloc(buf_pages * SPDK_BS_PAGE_SIZE, 0,
+				       NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->replay_next = calloc(md_len, sizeof(*ctx->replay_next));
+	ctx->replay_valid = spdk_bit_array_create(md_len);
+	ctx->replay_heads = spdk_bit_array_create(md_len);
+	ctx->replay_extents = spdk_bit_array_create(md_len);
+	if (!ctx->replay_buf || !ctx->replay_next || !ctx->replay_valid ||
+	    !ctx->replay_heads || !ctx->replay_extents) {
+		bs_load_replay_md_fail(ctx, -ENOMEM);
 		return;
 	}
-	bs_load_replay_cur_md_page(ctx);
+
+	ctx->replay_pass = BS_REPLAY_SCAN;
+	ctx->replay_filter = NULL;
+	ctx->page_index = 0;
+	ctx->recovery_progress.md_pages_total = md_len;
+	bs_load_replay_md_report_progress(ctx);
+	bs_load_replay_md_read_window(ctx);
 }
 
 static void
@@ -4620,6 +6184,30 @@ bs_recover(struct spdk_bs_load_ctx *ctx)
 	bs_load_replay_md(ctx);
 }
 
+/*
+ * The allocator recorded in the super block takes precedence over the one given when loading.
+ * Blobstores created before it was recorded keep the one given, which is recorded with the next
+ * update of the super block.
+ */
+static void
+bs_parse_super_cluster_allocator(struct spdk_blob_store *bs,
+				 const struct spdk_bs_super_block *super)
+{
+	if (super->cluster_extent_sz == 0) {
+		return;
+	}
+
+	if (super->cluster_allocator != BS_CLUSTER_ALLOCATOR_FIRST_FIT &&
+	    super->cluster_allocator != BS_CLUSTER_ALLOCATOR_EXTENT) {
+		SPDK_WARNLOG("Unknown cluster allocator %u in super block, using %d\n",
+			     super->cluster_allocator, bs->cluster_allocator);
+		return;
+	}
+
+	bs->cluster_allocator = super->cluster_allocator;
+	bs->cluster_extent_sz = super->cluster_extent_sz;
+}
+
 static int
 bs_parse_super(struct spdk_bs_load_ctx *ctx)
 {
@@ -4641,6 +6229,10 @@ bs_parse_super(struct spdk_bs_load_ctx *ctx)
 		ctx->bs->pages_per_cluster_shift = spdk_u32log2(ctx->bs->pages_per_cluster);
 	}
 	ctx->bs->io_unit_size = ctx->super->io_unit_size;
+	bs_parse_super_cluster_allocator(ctx->bs, ctx->super);
+	if (ctx->bs->background_free_rate == 0) {
+		ctx->bs->background_free_rate = ctx->super->background_free_rate;
+	}
 	rc = spdk_bit_array_resize(&ctx->used_clusters, ctx->bs->total_clusters);
 	if (rc < 0) {
 		return -ENOMEM;
@@ -4749,12 +6341,17 @@ bs_opts_copy(struct spdk_bs_opts *src, struct spdk_bs_opts *dst)
 	SET_FIELD(force_recover);
 	SET_FIELD(esnap_bs_dev_create);
 	SET_FIELD(esnap_ctx);
+	SET_FIELD(cluster_allocator);
+	SET_FIELD(cluster_extent_sz);
+	SET_FIELD(recovery_progress_fn);
+	SET_FIELD(recovery_progress_arg);
+	SET_FIELD(background_free_rate);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 88, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 116, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -4887,6 +6484,25 @@ bs_dump_print_xattr(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_descriptor
 	}
 }
 
+static void
+bs_dump_print_partial_cluster(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_descriptor *desc)
+{
+	struct spdk_blob_md_descriptor_partial_cluster *desc_partial;
+	uint32_t i, num_pages, written = 0;
+
+	desc_partial = (struct spdk_blob_md_descriptor_partial_cluster *)desc;
+	num_pages = spdk_min(desc_partial->num_pages, (desc_partial->length -
+				     (sizeof(*desc_partial) - sizeof(*desc))) * 8);
+
+	for (i = 0; i < num_pages; i++) {
+		if (desc_partial->written[i / 8] & (1U << (i % 8))) {
+			written++;
+		}
+	}
+	fprintf(ctx->fp, "Partial Cluster: %" PRIu32 " - Written Pages: %" PRIu32 "/%" PRIu32 "\n",
+		desc_partial->cluster_idx, written, desc_partial->num_pages);
+}
+
 struct type_flag_desc {
 	uint64_t mask;
 	uint64_t val;
@@ -4927,6 +6543,8 @@ bs_dump_print_type_flags(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_descr
 		ADD_FLAG(SPDK_BLOB_THIN_PROV),
 		ADD_FLAG(SPDK_BLOB_INTERNAL_XATTR),
 		ADD_FLAG(SPDK_BLOB_EXTENT_TABLE),
+		ADD_FLAG(SPDK_BLOB_SUBCLUSTER_COW),
+		ADD_FLAG(SPDK_BLOB_PENDING_FREE),
 	};
 	static struct type_flag_desc data_ro[] = {
 		ADD_FLAG(SPDK_BLOB_READ_ONLY),
@@ -5054,6 +6672,8 @@ bs_dump_print_md_page(struct spdk_bs_load_ctx *ctx)
 			bs_dump_print_type_flags(ctx, desc);
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_EXTENT_TABLE) {
 			bs_dump_print_extent_table(ctx, desc);
+		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER) {
+			bs_dump_print_partial_cluster(ctx, desc);
 		} else {
 			/* Error */
 			fprintf(ctx->fp, "Unknown descriptor type %" PRIu8 "\n", desc->type);
@@ -5124,6 +6744,11 @@ bs_dump_super_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 		(ctx->super->crc == blob_md_page_calc_crc(ctx->super)) ? "OK" : "Mismatch");
 	fprintf(ctx->fp, "Blobstore Type: %.*s\n", SPDK_BLOBSTORE_TYPE_LENGTH, ctx->super->bstype.bstype);
 	fprintf(ctx->fp, "Cluster Size: %" PRIu32 "\n", ctx->super->cluster_size);
+	if (ctx->super->cluster_extent_sz != 0) {
+		fprintf(ctx->fp, "Cluster Allocator: %" PRIu8 " (Extent Size: %" PRIu32 ")\n",
+			ctx->super->cluster_allocator, ctx->super->cluster_extent_sz);
+	}
+	fprintf(ctx->fp, "Background Free Rate: %" PRIu32 "\n", ctx->super->background_free_rate);
 	fprintf(ctx->fp, "Super Blob ID: ");
 	if (ctx->super->super_blob == SPDK_BLOBID_INVALID) {
 		fprintf(ctx->fp, "(None)\n");
@@ -5322,6 +6947,9 @@ spdk_bs_init(struct spdk_bs_dev *dev, struct spdk_bs_opts *o,
 	ctx->super->clean = 0;
 	ctx->super->cluster_size = bs->cluster_sz;
 	ctx->super->io_unit_size = bs->io_unit_size;
+	ctx->super->cluster_allocator = bs->cluster_allocator;
+	ctx->super->cluster_extent_sz = bs->cluster_extent_sz;
+	ctx->super->background_free_rate = bs->background_free_rate;
 	memcpy(&ctx->super->bstype, &bs->bstype, sizeof(bs->bstype));
 
 	/* Calculate how many pages the metadata consumes at the front
@@ -5470,7 +7098,7 @@ spdk_bs_destroy(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn,
 
 	SPDK_DEBUGLOG(blob, "Destroying blobstore\n");
 
-	if (!RB_EMPTY(&bs->open_blobs)) {
+	if (!RB_EMPTY(&bs->open_blobs) || bs->background_free_busy) {
 		SPDK_ERRLOG("Blobstore still has open blobs\n");
 		cb_fn(cb_arg, -EBUSY);
 		return;
@@ -5609,14 +7237,15 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 	 * If external snapshot channels are being destroyed while the blobstore is unloaded, the
 	 * unload is deferred until after the channel destruction completes.
 	 */
-	if (bs->esnap_channels_unloading != 0) {
+	if (bs->esnap_channels_unloading != 0 || bs->back_bs_devs_releasing != 0) {
 		if (bs->esnap_unload_cb_fn != NULL) {
 			SPDK_ERRLOG("Blobstore unload in progress\n");
 			cb_fn(cb_arg, -EBUSY);
 			return;
 		}
 		SPDK_DEBUGLOG(blob_esnap, "Blobstore unload deferred: %" PRIu32
-			      " esnap clones are unloading\n", bs->esnap_channels_unloading);
+			      " esnap clones are unloading, %" PRIu32 " back_bs_devs are released\n",
+			      bs->esnap_channels_unloading, bs->back_bs_devs_releasing);
 		bs->esnap_unload_cb_fn = cb_fn;
 		bs->esnap_unload_cb_arg = cb_arg;
 		return;
@@ -5629,6 +7258,24 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 		bs->esnap_unload_cb_arg = NULL;
 	}
 
+	/* The unload is also deferred while clusters of a deleted blob are being released */
+	if (bs->background_free_busy) {
+		if (bs->background_free_unload_cb_fn != NULL) {
+			SPDK_ERRLOG("Blobstore unload in progress\n");
+			cb_fn(cb_arg, -EBUSY);
+			return;
+		}
+		bs->background_free_unload_cb_fn = cb_fn;
+		bs->background_free_unload_cb_arg = cb_arg;
+		return;
+	}
+	if (bs->background_free_unload_cb_fn != NULL) {
+		assert(bs->background_free_unload_cb_fn == cb_fn);
+		assert(bs->background_free_unload_cb_arg == cb_arg);
+		bs->background_free_unload_cb_fn = NULL;
+		bs->background_free_unload_cb_arg = NULL;
+	}
+
 	if (!RB_EMPTY(&bs->open_blobs)) {
 		SPDK_ERRLOG("Blobstore still has open blobs\n");
 		cb_fn(cb_arg, -EBUSY);
@@ -5945,12 +7592,13 @@ blob_opts_copy(const struct spdk_blob_opts *src, struct spdk_blob_opts *dst)
 	SET_FIELD(use_extent_table);
 	SET_FIELD(esnap_id);
 	SET_FIELD(esnap_id_len);
+	SET_FIELD(subcluster_cow);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 80, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 88, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -6042,6 +7690,21 @@ bs_create_blob(struct spdk_blob_store *bs,
 		}
 	}
 
+	if (opts_local.subcluster_cow) {
+		if (!blob->use_extent_table || bs->io_unit_size != SPDK_BS_PAGE_SIZE ||
+		    bs_partial_clusters_per_extent_page(bs) == 0) {
+			SPDK_ERRLOG("Sub-cluster copy-on-write requires an extent table, an io "
+				    "unit of a page and a cluster bitmap fitting in an extent page\n");
+			rc = -EINVAL;
+			goto error;
+		}
+		blob->invalid_flags |= SPDK_BLOB_SUBCLUSTER_COW;
+		rc = blob_partial_table_resize(blob, spdk_max(opts_local.num_clusters, 1));
+		if (rc != 0) {
+			goto error;
+		}
+	}
+
 	rc = blob_resize(blob, opts_local.num_clusters);
 	if (rc < 0) {
 		goto error;
@@ -6101,6 +7764,17 @@ struct spdk_clone_snapshot_ctx {
 	/* Current cluster for inflate operation */
 	uint64_t cluster;
 
+	/* Clusters being copied by inflate, and the limits on them */
+	uint32_t outstanding;
+	uint32_t queue_depth;
+	uint32_t rate_limit;
+	/* Microseconds worth of copies at rate_limit, one copy costs a second */
+	uint64_t credit;
+	struct spdk_poller *poller;
+	bool submitting;
+	bool cancelled;
+	int inflate_rc;
+
 	/* For inflation force allocation of all unallocated clusters and remove
 	 * thin-provisioning. Otherwise only decouple parent and keep clone thin. */
 	bool allocate_all;
@@ -6165,6 +7839,7 @@ bs_snapshot_unfreeze_cpl(void *cb_arg, int bserrno)
 
 	ctx->original.id = origblob->id;
 	origblob->locked_operation_in_progress = false;
+	origblob->partial_cow_paused = false;
 
 	/* Revert md_ro to original state */
 	origblob->md_ro = ctx->original.md_ro;
@@ -6220,15 +7895,32 @@ static void
 bs_snapshot_swap_cluster_maps(struct spdk_blob *blob1, struct spdk_blob *blob2)
 {
 	uint64_t *cluster_temp;
+	uint64_t **chunks_temp;
 	uint32_t *extent_page_temp;
+	struct spdk_blob_partial_table *partial_temp;
+	uint64_t size_temp;
 
 	cluster_temp = blob1->active.clusters;
 	blob1->active.clusters = blob2->active.clusters;
 	blob2->active.clusters = cluster_temp;
 
+	chunks_temp = blob1->active.cluster_chunks;
+	blob1->active.cluster_chunks = blob2->active.cluster_chunks;
+	blob2->active.cluster_chunks = chunks_temp;
+
 	extent_page_temp = blob1->active.extent_pages;
 	blob1->active.extent_pages = blob2->active.extent_pages;
 	blob2->active.extent_pages = extent_page_temp;
+
+	partial_temp = blob1->partial_table;
+	blob1->partial_table = blob2->partial_table;
+	blob2->partial_table = partial_temp;
+
+	size_temp = blob1->num_partial_clusters;
+	blob1->num_partial_clusters = blob2->num_partial_clusters;
+	blob2->num_partial_clusters = size_temp;
+
+	bs_backing_chain_changed(blob1->bs);
 }
 
 /* Copies an internal xattr */
@@ -6301,8 +7993,7 @@ bs_snapshot_newblob_sync_cpl(void *cb_arg, int bserrno)
 		 * Since I/O is frozen on origblob, not changes to zeroed out cluster map should have occurred.
 		 * Newblob needs to be reverted to thin_provisioned state at creation to properly close. */
 		blob_set_thin_provision(newblob);
-		assert(spdk_mem_all_zero(newblob->active.clusters,
-					 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
+		assert(blob_cluster_map_is_empty(newblob));
 		assert(spdk_mem_all_zero(newblob->active.extent_pages,
 					 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
 
@@ -6435,8 +8126,7 @@ bs_snapshot_newblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 
 	ctx->new.blob = newblob;
 	assert(spdk_blob_is_thin_provisioned(newblob));
-	assert(spdk_mem_all_zero(newblob->active.clusters,
-				 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
+	assert(blob_cluster_map_is_empty(newblob));
 	assert(spdk_mem_all_zero(newblob->active.extent_pages,
 				 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
 
@@ -6512,6 +8202,7 @@ bs_snapshot_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno
 	opts.thin_provision = true;
 	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
 	opts.use_extent_table = _blob->use_extent_table;
+	opts.subcluster_cow = !!(_blob->invalid_flags & SPDK_BLOB_SUBCLUSTER_COW);
 
 	/* If there are any xattrs specified for snapshot, set them now */
 	if (ctx->xattrs) {
@@ -6623,6 +8314,7 @@ bs_clone_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 	opts.thin_provision = true;
 	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
 	opts.use_extent_table = _blob->use_extent_table;
+	opts.subcluster_cow = !!(_blob->invalid_flags & SPDK_BLOB_SUBCLUSTER_COW);
 	if (ctx->xattrs) {
 		memcpy(&opts.xattrs, ctx->xattrs, sizeof(*ctx->xattrs));
 	}
@@ -6686,11 +8378,11 @@ bs_inflate_blob_set_parent_cpl(void *cb_arg, struct spdk_blob *_parent, int bser
 
 	assert(_parent != NULL);
 
+	/* Publish the new back_bs_dev before the parent_id, which readers walking the chain check first */
 	bs_blob_list_remove(_blob);
-	_blob->parent_id = _parent->id;
-
 	blob_back_bs_destroy(_blob);
 	_blob->back_bs_dev = bs_create_blob_bs_dev(_parent);
+	_blob->parent_id = _parent->id;
 	bs_blob_list_add(_blob);
 
 	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
@@ -6748,7 +8440,7 @@ bs_cluster_needs_allocation(struct spdk_blob *blob, uint64_t cluster, bool alloc
 
 	assert(blob != NULL);
 
-	if (blob->active.clusters[cluster] != 0) {
+	if (bs_blob_cluster_lba(blob, cluster) != 0) {
 		/* Cluster is already allocated */
 		return false;
 	}
@@ -6763,59 +8455,171 @@ bs_cluster_needs_allocation(struct spdk_blob *blob, uint64_t cluster, bool alloc
 	}
 
 	b = (struct spdk_blob_bs_dev *)blob->back_bs_dev;
-	return (allocate_all || b->blob->active.clusters[cluster] != 0);
+	return (allocate_all || bs_blob_cluster_lba(b->blob, cluster) != 0);
 }
 
+static void bs_inflate_blob_submit(struct spdk_clone_snapshot_ctx *ctx);
+
 static void
-bs_inflate_blob_touch_next(void *cb_arg, int bserrno)
+bs_inflate_blob_touch_cpl(void *cb_arg, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
+	assert(ctx->outstanding > 0);
+	ctx->outstanding--;
+	if (bserrno != 0 && ctx->inflate_rc == 0) {
+		ctx->inflate_rc = bserrno;
+	}
+
+	bs_inflate_blob_submit(ctx);
+}
+
+static void
+bs_inflate_blob_touch(struct spdk_clone_snapshot_ctx *ctx, uint64_t cluster)
+{
 	struct spdk_blob *_blob = ctx->original.blob;
 	struct spdk_bs_cpl cpl;
 	spdk_bs_user_op_t *op;
 	uint64_t offset;
 
-	if (bserrno != 0) {
-		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+	offset = bs_cluster_to_lba(_blob->bs, cluster);
+
+	/* Use a dummy 0B read as a context for cluster copy */
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_inflate_blob_touch_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	op = bs_user_op_alloc(ctx->channel, &cpl, SPDK_BLOB_READ, _blob,
+			      NULL, 0, offset, 0);
+	if (!op) {
+		bs_inflate_blob_touch_cpl(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_allocate_and_copy_cluster(_blob, ctx->channel, offset, op);
+}
+
+static uint64_t
+bs_inflate_blob_max_credit(struct spdk_clone_snapshot_ctx *ctx)
+{
+	/* Enough for the copies of one period, and at least one copy at low rates */
+	return spdk_max((uint64_t)ctx->rate_limit * SPDK_BS_INFLATE_PERIOD_US, SPDK_SEC_TO_USEC);
+}
+
+static void
+bs_inflate_blob_finish(struct spdk_clone_snapshot_ctx *ctx)
+{
+	spdk_poller_unregister(&ctx->poller);
+	ctx->original.blob->inflate_ctx = NULL;
+
+	if (ctx->inflate_rc != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, ctx->inflate_rc);
+	} else if (ctx->cancelled) {
+		SPDK_DEBUGLOG(blob, "Inflate of blob 0x%" PRIx64 " cancelled\n", ctx->original.id);
+		bs_clone_snapshot_origblob_cleanup(ctx, -ECANCELED);
+	} else {
+		bs_inflate_blob_done(ctx);
+	}
+}
+
+/*
+ * Copies the next clusters needing allocation, keeping up to queue_depth of them in flight
+ * within the rate limit. Completions of copies and the rate limit poller call it again.
+ */
+static void
+bs_inflate_blob_submit(struct spdk_clone_snapshot_ctx *ctx)
+{
+	struct spdk_blob *_blob = ctx->original.blob;
+
+	/* Copies may complete right away, let the outer call carry on */
+	if (ctx->submitting) {
 		return;
 	}
+	ctx->submitting = true;
+
+	while (ctx->inflate_rc == 0 && !ctx->cancelled && ctx->outstanding < ctx->queue_depth) {
+		for (; ctx->cluster < _blob->active.num_clusters; ctx->cluster++) {
+			if (bs_cluster_needs_allocation(_blob, ctx->cluster, ctx->allocate_all)) {
+				break;
+			}
+		}
 
-	for (; ctx->cluster < _blob->active.num_clusters; ctx->cluster++) {
-		if (bs_cluster_needs_allocation(_blob, ctx->cluster, ctx->allocate_all)) {
+		if (ctx->cluster == _blob->active.num_clusters) {
 			break;
 		}
-	}
 
-	if (ctx->cluster < _blob->active.num_clusters) {
-		offset = bs_cluster_to_lba(_blob->bs, ctx->cluster);
+		if (ctx->rate_limit != 0) {
+			if (ctx->credit < SPDK_SEC_TO_USEC) {
+				break;
+			}
+			ctx->credit -= SPDK_SEC_TO_USEC;
+		}
 
 		/* We may safely increment a cluster before copying */
-		ctx->cluster++;
+		ctx->outstanding++;
+		bs_inflate_blob_touch(ctx, ctx->cluster++);
+	}
 
-		/* Use a dummy 0B read as a context for cluster copy */
-		cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-		cpl.u.blob_basic.cb_fn = bs_inflate_blob_touch_next;
-		cpl.u.blob_basic.cb_arg = ctx;
+	ctx->submitting = false;
 
-		op = bs_user_op_alloc(ctx->channel, &cpl, SPDK_BLOB_READ, _blob,
-				      NULL, 0, offset, 0);
-		if (!op) {
-			bs_clone_snapshot_origblob_cleanup(ctx, -ENOMEM);
-			return;
-		}
+	if (ctx->outstanding > 0) {
+		return;
+	}
 
-		bs_allocate_and_copy_cluster(_blob, ctx->channel, offset, op);
-	} else {
-		bs_inflate_blob_done(ctx);
+	if (ctx->inflate_rc == 0 && !ctx->cancelled && ctx->cluster < _blob->active.num_clusters) {
+		/* Waiting for the rate limit poller */
+		return;
+	}
+
+	bs_inflate_blob_finish(ctx);
+}
+
+static int
+bs_inflate_blob_poll(void *arg)
+{
+	struct spdk_clone_snapshot_ctx *ctx = arg;
+
+	ctx->credit = spdk_min(ctx->credit + (uint64_t)ctx->rate_limit * SPDK_BS_INFLATE_PERIOD_US,
+			       bs_inflate_blob_max_credit(ctx));
+	bs_inflate_blob_submit(ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void bs_inflate_blob_start(void *cb_arg, int bserrno);
+
+static void
+bs_inflate_blob_fill_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
+	ctx->frozen = false;
+	blob_unfreeze_io(ctx->original.blob, bs_inflate_blob_start, ctx);
+}
+
+static void
+bs_inflate_blob_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
+
+	ctx->frozen = true;
+	blob_fill_partial_clusters(ctx->original.blob, bs_inflate_blob_fill_cpl, ctx);
 }
 
 static void
 bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	uint64_t clusters_needed;
-	uint64_t i;
 
 	if (bserrno != 0) {
 		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
@@ -6862,6 +8666,31 @@ bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 		return;
 	}
 
+	if (_blob->partial_table != NULL) {
+		/* Clusters get fully copied from now on, and the partial ones are filled */
+		_blob->partial_cow_paused = true;
+		if (_blob->num_partial_clusters > 0) {
+			blob_freeze_io(_blob, bs_inflate_blob_freeze_cpl, ctx);
+			return;
+		}
+	}
+
+	bs_inflate_blob_start(ctx, 0);
+}
+
+static void
+bs_inflate_blob_start(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *_blob = ctx->original.blob;
+	uint64_t clusters_needed;
+	uint64_t i;
+
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
+	}
+
 	/* Do two passes - one to verify that we can obtain enough clusters
 	 * and another to actually claim them.
 	 */
@@ -6879,44 +8708,558 @@ bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 	}
 
 	ctx->cluster = 0;
-	bs_inflate_blob_touch_next(ctx, 0);
+	if (ctx->rate_limit != 0) {
+		ctx->credit = bs_inflate_blob_max_credit(ctx);
+		ctx->poller = SPDK_POLLER_REGISTER(bs_inflate_blob_poll, ctx, SPDK_BS_INFLATE_PERIOD_US);
+		if (ctx->poller == NULL) {
+			bs_clone_snapshot_origblob_cleanup(ctx, -ENOMEM);
+			return;
+		}
+	}
+
+	_blob->inflate_ctx = ctx;
+	bs_inflate_blob_submit(ctx);
 }
 
-static void
-bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
-		spdk_blob_id blobid, bool allocate_all, spdk_blob_op_complete cb_fn, void *cb_arg)
+void
+spdk_bs_inflate_opts_init(struct spdk_bs_inflate_opts *opts, size_t opts_size)
 {
-	struct spdk_clone_snapshot_ctx *ctx = calloc(1, sizeof(*ctx));
+	if (!opts) {
+		SPDK_ERRLOG("opts should not be NULL\n");
+		return;
+	}
 
-	if (!ctx) {
-		cb_fn(cb_arg, -ENOMEM);
+	if (!opts_size) {
+		SPDK_ERRLOG("opts_size should not be zero value\n");
 		return;
 	}
-	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-	ctx->cpl.u.bs_basic.cb_fn = cb_fn;
-	ctx->cpl.u.bs_basic.cb_arg = cb_arg;
-	ctx->bserrno = 0;
-	ctx->original.id = blobid;
-	ctx->channel = channel;
-	ctx->allocate_all = allocate_all;
 
-	spdk_bs_open_blob(bs, ctx->original.id, bs_inflate_blob_open_cpl, ctx);
-}
+	memset(opts, 0, opts_size);
+	opts->opts_size = opts_size;
+
+#define FIELD_OK(field) \
+        offsetof(struct spdk_bs_inflate_opts, field) + sizeof(opts->field) <= opts_size
+
+#define SET_FIELD(field, value) \
+        if (FIELD_OK(field)) { \
+                opts->field = value; \
+        } \
+
+	SET_FIELD(queue_depth, SPDK_BS_INFLATE_QUEUE_DEPTH);
+	SET_FIELD(rate_limit, 0);
+
+#undef FIELD_OK
+#undef SET_FIELD
+}
+
+static void
+bs_inflate_opts_copy(const struct spdk_bs_inflate_opts *src, struct spdk_bs_inflate_opts *dst)
+{
+#define FIELD_OK(field) \
+        offsetof(struct spdk_bs_inflate_opts, field) + sizeof(src->field) <= src->opts_size
+
+#define SET_FIELD(field) \
+        if (FIELD_OK(field)) { \
+                dst->field = src->field; \
+        } \
+
+	SET_FIELD(queue_depth);
+	SET_FIELD(rate_limit);
+
+	dst->opts_size = src->opts_size;
+
+	/* You should not remove this statement, but need to update the assert statement
+	 * if you add a new field, and also add a corresponding SET_FIELD statement */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_inflate_opts) == 16, "Incorrect size");
+
+#undef FIELD_OK
+#undef SET_FIELD
+}
+
+static void
+bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		spdk_blob_id blobid, bool allocate_all, const struct spdk_bs_inflate_opts *opts,
+		spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_clone_snapshot_ctx *ctx;
+	struct spdk_bs_inflate_opts opts_local;
+
+	spdk_bs_inflate_opts_init(&opts_local, sizeof(opts_local));
+	if (opts) {
+		bs_inflate_opts_copy(opts, &opts_local);
+	}
+
+	if (opts_local.queue_depth == 0) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	ctx->cpl.u.bs_basic.cb_fn = cb_fn;
+	ctx->cpl.u.bs_basic.cb_arg = cb_arg;
+	ctx->bserrno = 0;
+	ctx->original.id = blobid;
+	ctx->channel = channel;
+	ctx->allocate_all = allocate_all;
+	ctx->queue_depth = opts_local.queue_depth;
+	ctx->rate_limit = opts_local.rate_limit;
+
+	spdk_bs_open_blob(bs, ctx->original.id, bs_inflate_blob_open_cpl, ctx);
+}
 
 void
 spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
 		     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	bs_inflate_blob(bs, channel, blobid, true, cb_fn, cb_arg);
+	bs_inflate_blob(bs, channel, blobid, true, NULL, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_inflate_blob_ext(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			 spdk_blob_id blobid, const struct spdk_bs_inflate_opts *opts,
+			 spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	bs_inflate_blob(bs, channel, blobid, true, opts, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	bs_inflate_blob(bs, channel, blobid, false, NULL, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_blob_decouple_parent_ext(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+				 spdk_blob_id blobid, const struct spdk_bs_inflate_opts *opts,
+				 spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	bs_inflate_blob(bs, channel, blobid, false, opts, cb_fn, cb_arg);
+}
+
+int
+spdk_bs_inflate_blob_cancel(struct spdk_blob_store *bs, spdk_blob_id blobid)
+{
+	struct spdk_blob *blob;
+
+	assert(spdk_get_thread() == bs->md_thread);
+
+	blob = blob_lookup(bs, blobid);
+	if (blob == NULL || blob->inflate_ctx == NULL) {
+		return -ENOENT;
+	}
+
+	SPDK_DEBUGLOG(blob, "Cancelling inflate of blob 0x%" PRIx64 "\n", blobid);
+	blob->inflate_ctx->cancelled = true;
+
+	return 0;
 }
+/* END spdk_bs_inflate_blob */
+
+/* START spdk_bs_blob_dedup */
+
+struct spdk_bs_dedup_ctx {
+	struct spdk_blob_store		*bs;
+	struct spdk_io_channel		*channel;
+	spdk_blob_id			blobid;
+	spdk_blob_id			snapshotid;
+	struct spdk_blob		*blob;
+	/* Snapshot opened to become the parent of the blob */
+	struct spdk_blob		*snapshot;
+	bool				locked;
+
+	uint64_t			cluster;
+	uint64_t			num_clusters;
+	uint64_t			lba;
+	uint64_t			num_released;
+	void				*buf;
+	void				*parent_buf;
+	struct spdk_blob_md_page	*extent_page;
+
+	spdk_blob_op_complete		cb_fn;
+	void				*cb_arg;
+	int				bserrno;
+};
+
+static void
+bs_dedup_close_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob;
+
+	if (ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	if (ctx->snapshot != NULL) {
+		blob = ctx->snapshot;
+		ctx->snapshot = NULL;
+		spdk_blob_close(blob, bs_dedup_close_cpl, ctx);
+		return;
+	}
+
+	if (ctx->blob != NULL) {
+		blob = ctx->blob;
+		ctx->blob = NULL;
+		spdk_blob_close(blob, bs_dedup_close_cpl, ctx);
+		return;
+	}
+
+	SPDK_DEBUGLOG(blob, "Released %" PRIu64 " clusters of blob 0x%" PRIx64 ", rc=%d\n",
+		      ctx->num_released, ctx->blobid, ctx->bserrno);
+
+	ctx->cb_fn(ctx->cb_arg, ctx->bserrno);
+	spdk_free(ctx->buf);
+	spdk_free(ctx->parent_buf);
+	spdk_free(ctx->extent_page);
+	free(ctx);
+}
+
+static void
+bs_dedup_finish(struct spdk_bs_dedup_ctx *ctx, int bserrno)
+{
+	if (ctx->locked) {
+		ctx->blob->locked_operation_in_progress = false;
+	}
+
+	bs_dedup_close_cpl(ctx, bserrno);
+}
+
+static void bs_dedup_next(struct spdk_bs_dedup_ctx *ctx);
+
+static void
+bs_dedup_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+
+	if (ctx->bserrno != 0 || bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	ctx->cluster++;
+	bs_dedup_next(ctx);
+}
+
+static void
+bs_dedup_release_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob_store *bs = ctx->bs;
+
+	if (bserrno != 0) {
+		/* The cluster still belongs to the blob */
+		blob_cluster_map_set(ctx->blob, ctx->cluster, ctx->lba);
+		ctx->bserrno = bserrno;
+	} else {
+		spdk_spin_lock(&bs->used_lock);
+		bs_release_cluster(bs, bs_lba_to_cluster(bs, ctx->lba));
+		spdk_spin_unlock(&bs->used_lock);
+		ctx->num_released++;
+	}
+
+	blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+}
+
+static void
+bs_dedup_compare(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint32_t extent_page;
+
+	if (bserrno != 0 || memcmp(ctx->buf, ctx->parent_buf, ctx->bs->cluster_sz) != 0) {
+		ctx->bserrno = bserrno;
+		blob_unfreeze_io(blob, bs_dedup_unfreeze_cpl, ctx);
+		return;
+	}
+
+	/* The parent holds the same data. Drop the cluster from the map and release it
+	 * once the md no longer references it. */
+	blob_cluster_map_set(blob, ctx->cluster, 0);
+	if (blob->use_extent_table) {
+		extent_page = *bs_cluster_to_extent_page(blob, ctx->cluster);
+		memset(ctx->extent_page, 0, SPDK_BS_PAGE_SIZE);
+		blob_write_extent_page(blob, extent_page, ctx->cluster, ctx->extent_page,
+				       bs_dedup_release_cpl, ctx);
+	} else {
+		blob->state = SPDK_BLOB_STATE_DIRTY;
+		spdk_blob_sync_md(blob, bs_dedup_release_cpl, ctx);
+	}
+}
+
+static void
+bs_dedup_read_parent_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	bs_sequence_finish(seq, bserrno);
+}
+
+static void
+bs_dedup_read_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_bs_dev *back_bs_dev = ctx->blob->back_bs_dev;
+	uint64_t page = bs_cluster_to_page(ctx->bs, ctx->cluster);
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	bs_sequence_read_bs_dev(seq, back_bs_dev, ctx->parent_buf,
+				bs_dev_page_to_lba(back_bs_dev, page),
+				bs_dev_byte_to_lba(back_bs_dev, ctx->bs->cluster_sz),
+				bs_dedup_read_parent_cpl, ctx);
+}
+
+static bool
+bs_dedup_cluster_is_candidate(struct spdk_blob *blob, uint64_t cluster)
+{
+	/* Partial clusters hold only some pages, the others are read from the parent */
+	if (blob_partial_cluster_get(blob, cluster) != NULL) {
+		return false;
+	}
+
+	return bs_blob_cluster_lba(blob, cluster) != 0;
+}
+
+static void
+bs_dedup_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	/* A partial cluster may have been filled in the meantime */
+	if (!bs_dedup_cluster_is_candidate(ctx->blob, ctx->cluster)) {
+		blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+		return;
+	}
+	ctx->lba = bs_blob_cluster_lba(ctx->blob, ctx->cluster);
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_dedup_compare;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	seq = bs_sequence_start_bs(ctx->channel, &cpl);
+	if (!seq) {
+		bs_dedup_compare(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_sequence_read_dev(seq, ctx->buf, ctx->lba, bs_cluster_to_lba(ctx->bs, 1),
+			     bs_dedup_read_cpl, ctx);
+}
+
+static void
+bs_dedup_next(struct spdk_bs_dedup_ctx *ctx)
+{
+	for (; ctx->cluster < ctx->num_clusters; ctx->cluster++) {
+		if (bs_dedup_cluster_is_candidate(ctx->blob, ctx->cluster)) {
+			break;
+		}
+	}
+
+	if (ctx->cluster == ctx->num_clusters) {
+		bs_dedup_finish(ctx, 0);
+		return;
+	}
+
+	/* Writes to the cluster must not land between the compare and the release */
+	blob_freeze_io(ctx->blob, bs_dedup_freeze_cpl, ctx);
+}
+
+static void
+bs_dedup_start(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob *parent;
+
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	/* Clusters past the end of the parent are not compared */
+	parent = ((struct spdk_blob_bs_dev *)blob->back_bs_dev)->blob;
+	ctx->num_clusters = spdk_min(blob->active.num_clusters, parent->active.num_clusters);
+
+	ctx->buf = spdk_malloc(ctx->bs->cluster_sz, blob->back_bs_dev->blocklen, NULL,
+			       SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->parent_buf = spdk_malloc(ctx->bs->cluster_sz, blob->back_bs_dev->blocklen, NULL,
+				      SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (blob->use_extent_table) {
+		ctx->extent_page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+						SPDK_MALLOC_DMA);
+	}
+	if (!ctx->buf || !ctx->parent_buf || (blob->use_extent_table && !ctx->extent_page)) {
+		bs_dedup_finish(ctx, -ENOMEM);
+		return;
+	}
+
+	ctx->cluster = 0;
+	bs_dedup_next(ctx);
+}
+
+/* Checks that the clusters the blob does not hold read as zeroes from the snapshot too */
+static bool
+bs_dedup_unallocated_are_zeroes(struct spdk_blob *blob, struct spdk_blob *snapshot)
+{
+	struct spdk_bs_dev *back_bs_dev = snapshot->back_bs_dev;
+	uint64_t i, page;
+
+	for (i = 0; i < blob->active.num_clusters; i++) {
+		if (bs_blob_cluster_lba(blob, i) != 0) {
+			continue;
+		}
+
+		if (i >= snapshot->active.num_clusters || bs_blob_cluster_lba(snapshot, i) != 0) {
+			return false;
+		}
+
+		page = bs_cluster_to_page(blob->bs, i);
+		if (back_bs_dev != NULL &&
+		    !back_bs_dev->is_zeroes(back_bs_dev, bs_dev_page_to_lba(back_bs_dev, page),
+					    bs_dev_byte_to_lba(back_bs_dev, blob->bs->cluster_sz))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+bs_dedup_snapshot_open_cpl(void *cb_arg, struct spdk_blob *snapshot, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_bs_dev *back_bs_dev;
+
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	ctx->snapshot = snapshot;
+
+	if (!snapshot->data_ro) {
+		SPDK_ERRLOG("Cannot deduplicate against blob 0x%" PRIx64 ", it is not read-only\n",
+			    snapshot->id);
+		bs_dedup_finish(ctx, -EINVAL);
+		return;
+	}
+
+	/* Unallocated clusters of a thin blob read as zeroes, they would read the data of the
+	 * snapshot once the blob is its clone. */
+	if (!bs_dedup_unallocated_are_zeroes(blob, snapshot)) {
+		SPDK_ERRLOG("Cannot deduplicate blob 0x%" PRIx64 ", the snapshot holds data where "
+			    "the blob is not allocated\n", blob->id);
+		bs_dedup_finish(ctx, -EINVAL);
+		return;
+	}
+
+	back_bs_dev = bs_create_blob_bs_dev(snapshot);
+	if (back_bs_dev == NULL) {
+		bs_dedup_finish(ctx, -ENOMEM);
+		return;
+	}
+
+	bserrno = blob_set_xattr(blob, BLOB_SNAPSHOT, &snapshot->id, sizeof(spdk_blob_id), true);
+	if (bserrno != 0) {
+		/* Destroying the back_bs_dev closes the snapshot */
+		ctx->snapshot = NULL;
+		back_bs_dev->destroy(back_bs_dev);
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	/* The blob becomes a clone of the snapshot, the reference taken on the snapshot
+	 * by opening it now belongs to the back_bs_dev. */
+	if (blob->back_bs_dev != NULL) {
+		blob_back_bs_destroy(blob);
+	}
+	blob->back_bs_dev = back_bs_dev;
+	blob->parent_id = snapshot->id;
+	ctx->snapshot = NULL;
+	bs_blob_list_add(blob);
+	blob_set_thin_provision(blob);
+
+	spdk_blob_sync_md(blob, bs_dedup_start, ctx);
+}
+
+static void
+bs_dedup_open_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct spdk_bs_dedup_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
+	}
+
+	ctx->blob = blob;
+
+	if (blob->locked_operation_in_progress) {
+		SPDK_DEBUGLOG(blob, "Cannot deduplicate blob - another operation in progress\n");
+		bs_dedup_finish(ctx, -EBUSY);
+		return;
+	}
+
+	if (spdk_blob_is_read_only(blob) || blob_is_esnap_clone(blob) || blob->id == ctx->snapshotid ||
+	    (blob->parent_id != SPDK_BLOBID_INVALID && blob->parent_id != ctx->snapshotid)) {
+		SPDK_ERRLOG("Cannot deduplicate blob 0x%" PRIx64 " against blob 0x%" PRIx64 "\n",
+			    blob->id, ctx->snapshotid);
+		bs_dedup_finish(ctx, -EINVAL);
+		return;
+	}
+
+	blob->locked_operation_in_progress = true;
+	ctx->locked = true;
+
+	if (blob->parent_id == ctx->snapshotid) {
+		bs_dedup_start(ctx, 0);
+		return;
+	}
+
+	spdk_bs_open_blob(ctx->bs, ctx->snapshotid, bs_dedup_snapshot_open_cpl, ctx);
+}
+
+void
+spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		   spdk_blob_id blobid, spdk_blob_id snapshotid,
+		   spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_dedup_ctx *ctx;
+
+	SPDK_DEBUGLOG(blob, "Deduplicating blob 0x%" PRIx64 " against 0x%" PRIx64 "\n",
+		      blobid, snapshotid);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->bs = bs;
+	ctx->channel = channel;
+	ctx->blobid = blobid;
+	ctx->snapshotid = snapshotid;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
 
-void
-spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
-			     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
-{
-	bs_inflate_blob(bs, channel, blobid, false, cb_fn, cb_arg);
+	spdk_bs_open_blob(bs, blobid, bs_dedup_open_cpl, ctx);
 }
-/* END spdk_bs_inflate_blob */
+/* END spdk_bs_blob_dedup */
 
 /* START spdk_blob_resize */
 struct spdk_bs_resize_ctx {
@@ -7102,6 +9445,7 @@ delete_snapshot_cleanup_clone(void *cb_arg, int bserrno)
 	struct delete_snapshot_ctx *ctx = cb_arg;
 
 	ctx->clone->locked_operation_in_progress = false;
+	ctx->clone->partial_cow_paused = false;
 	ctx->clone->md_ro = ctx->clone_md_ro;
 
 	spdk_blob_close(ctx->clone, delete_snapshot_cleanup_snapshot, ctx);
@@ -7119,6 +9463,7 @@ delete_snapshot_unfreeze_cpl(void *cb_arg, int bserrno)
 	}
 
 	ctx->clone->locked_operation_in_progress = false;
+	ctx->clone->partial_cow_paused = false;
 	spdk_blob_close(ctx->clone, delete_blob_cleanup_finish, ctx);
 }
 
@@ -7204,8 +9549,8 @@ delete_snapshot_sync_clone_cpl(void *cb_arg, int bserrno)
 
 	/* Clear cluster map entries for snapshot */
 	for (i = 0; i < ctx->snapshot->active.num_clusters && i < ctx->clone->active.num_clusters; i++) {
-		if (ctx->clone->active.clusters[i] == ctx->snapshot->active.clusters[i]) {
-			ctx->snapshot->active.clusters[i] = 0;
+		if (bs_blob_cluster_lba(ctx->clone, i) == bs_blob_cluster_lba(ctx->snapshot, i)) {
+			blob_cluster_map_set(ctx->snapshot, i, 0);
 		}
 	}
 	for (i = 0; i < ctx->snapshot->active.num_extent_pages &&
@@ -7324,8 +9669,31 @@ delete_snapshot_sync_snapshot_xattr_cpl(void *cb_arg, int bserrno)
 
 	/* Copy snapshot map to clone map (only unallocated clusters in clone) */
 	for (i = 0; i < ctx->snapshot->active.num_clusters && i < ctx->clone->active.num_clusters; i++) {
-		if (ctx->clone->active.clusters[i] == 0) {
-			ctx->clone->active.clusters[i] = ctx->snapshot->active.clusters[i];
+		if (bs_blob_cluster_lba(ctx->clone, i) != 0) {
+			continue;
+		}
+		bserrno = blob_cluster_map_set(ctx->clone, i, bs_blob_cluster_lba(ctx->snapshot, i));
+		if (bserrno != 0) {
+			SPDK_ERRLOG("Failed to copy cluster map of snapshot to clone\n");
+			ctx->bserrno = bserrno;
+
+			/* Clusters of the clone and of the snapshot differ unless copied above */
+			while (i > 0) {
+				i--;
+				if (bs_blob_cluster_lba(ctx->clone, i) == bs_blob_cluster_lba(ctx->snapshot, i)) {
+					blob_cluster_map_set(ctx->clone, i, 0);
+				}
+			}
+
+			/* Restore snapshot to previous state */
+			bserrno = blob_remove_xattr(ctx->snapshot, SNAPSHOT_PENDING_REMOVAL, true);
+			if (bserrno != 0) {
+				delete_snapshot_cleanup_clone(ctx, bserrno);
+				return;
+			}
+
+			spdk_blob_sync_md(ctx->snapshot, delete_snapshot_cleanup_clone, ctx);
+			return;
 		}
 	}
 	ctx->next_extent_page = 0;
@@ -7347,21 +9715,17 @@ delete_snapshot_esnap_channels_destroyed_cb(void *cb_arg, struct spdk_blob *blob
 }
 
 static void
-delete_snapshot_freeze_io_cb(void *cb_arg, int bserrno)
+delete_snapshot_fill_clone_cpl(void *cb_arg, int bserrno)
 {
 	struct delete_snapshot_ctx *ctx = cb_arg;
 
 	if (bserrno) {
-		SPDK_ERRLOG("Failed to freeze I/O on clone\n");
+		SPDK_ERRLOG("Failed to fill partial clusters of clone\n");
 		ctx->bserrno = bserrno;
 		delete_snapshot_cleanup_clone(ctx, 0);
 		return;
 	}
 
-	/* Temporarily override md_ro flag for snapshot for MD modification */
-	ctx->snapshot_md_ro = ctx->snapshot->md_ro;
-	ctx->snapshot->md_ro = false;
-
 	/* Mark blob as pending for removal for power failure safety, use clone id for recovery */
 	ctx->bserrno = blob_set_xattr(ctx->snapshot, SNAPSHOT_PENDING_REMOVAL, &ctx->clone->id,
 				      sizeof(spdk_blob_id), true);
@@ -7380,6 +9744,43 @@ delete_snapshot_freeze_io_cb(void *cb_arg, int bserrno)
 	spdk_blob_sync_md(ctx->snapshot, delete_snapshot_sync_snapshot_xattr_cpl, ctx);
 }
 
+static void
+delete_snapshot_fill_snapshot_cpl(void *cb_arg, int bserrno)
+{
+	struct delete_snapshot_ctx *ctx = cb_arg;
+
+	if (bserrno) {
+		SPDK_ERRLOG("Failed to fill partial clusters of snapshot\n");
+		ctx->bserrno = bserrno;
+		delete_snapshot_cleanup_clone(ctx, 0);
+		return;
+	}
+
+	/* The parent of the clone changes, it must not depend on the snapshot anymore */
+	blob_fill_partial_clusters(ctx->clone, delete_snapshot_fill_clone_cpl, ctx);
+}
+
+static void
+delete_snapshot_freeze_io_cb(void *cb_arg, int bserrno)
+{
+	struct delete_snapshot_ctx *ctx = cb_arg;
+
+	if (bserrno) {
+		SPDK_ERRLOG("Failed to freeze I/O on clone\n");
+		ctx->bserrno = bserrno;
+		delete_snapshot_cleanup_clone(ctx, 0);
+		return;
+	}
+
+	/* Temporarily override md_ro flag for snapshot for MD modification */
+	ctx->snapshot_md_ro = ctx->snapshot->md_ro;
+	ctx->snapshot->md_ro = false;
+
+	/* Clusters merged into the clone must not be partial, as they would then be read
+	 * from the parent of the snapshot */
+	blob_fill_partial_clusters(ctx->snapshot, delete_snapshot_fill_snapshot_cpl, ctx);
+}
+
 static void
 delete_snapshot_open_clone_cb(void *cb_arg, struct spdk_blob *clone, int bserrno)
 {
@@ -7402,6 +9803,8 @@ delete_snapshot_open_clone_cb(void *cb_arg, struct spdk_blob *clone, int bserrno
 	}
 
 	clone->locked_operation_in_progress = true;
+	/* Clusters of the clone get fully copied until the snapshot is removed */
+	clone->partial_cow_paused = true;
 
 	blob_freeze_io(clone, delete_snapshot_freeze_io_cb, ctx);
 }
@@ -7431,12 +9834,265 @@ update_clone_on_snapshot_deletion(struct spdk_blob *snapshot, struct delete_snap
 	spdk_bs_open_blob(snapshot->bs, clone_entry->id, delete_snapshot_open_clone_cb, ctx);
 }
 
+/* Deletes the md of the blob and releases all its clusters */
+static void
+blob_delete_md(spdk_bs_sequence_t *seq, struct spdk_blob *blob, spdk_bs_sequence_cpl cb_fn,
+	       void *cb_arg)
+{
+	spdk_bit_array_clear(blob->bs->used_blobids, bs_blobid_to_page(blob->id));
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	blob->active.num_pages = 0;
+	blob_resize(blob, 0);
+
+	blob_persist(seq, blob, cb_fn, cb_arg);
+}
+
+static bool
+blob_has_allocated_clusters(struct spdk_blob *blob)
+{
+	uint64_t i;
+
+	for (i = 0; i < blob->active.num_clusters; i++) {
+		if (bs_blob_cluster_lba(blob, i) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool
+bs_blob_is_pending_free(struct spdk_blob_store *bs, spdk_blob_id blobid)
+{
+	struct spdk_bs_pending_free *pending;
+
+	TAILQ_FOREACH(pending, &bs->pending_frees, link) {
+		if (pending->blobid == blobid) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void bs_background_free_step(struct spdk_bs_pending_free *pending);
+static void bs_open_blob(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			 struct spdk_blob_open_opts *opts, spdk_blob_op_with_handle_complete cb_fn,
+			 void *cb_arg);
+
+static void
+bs_background_free_step_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_store *bs = cb_arg;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to release clusters of a deleted blob: %d\n", bserrno);
+	}
+
+	bs->background_free_busy = false;
+	if (bs->background_free_unload_cb_fn != NULL) {
+		spdk_bs_unload(bs, bs->background_free_unload_cb_fn, bs->background_free_unload_cb_arg);
+	}
+}
+
+static void
+bs_background_free_persist_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	bs_sequence_finish(seq, bserrno);
+}
+
+static void
+bs_background_free_step(struct spdk_bs_pending_free *pending)
+{
+	struct spdk_blob	*blob = pending->blob;
+	struct spdk_blob_store	*bs = blob->bs;
+	struct spdk_bs_cpl	cpl;
+	spdk_bs_sequence_t	*seq;
+	uint64_t		num_clusters = blob->active.num_clusters;
+	uint64_t		budget = UINT64_MAX;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BS_BASIC;
+	cpl.u.bs_basic.cb_fn = bs_background_free_step_cpl;
+	cpl.u.bs_basic.cb_arg = bs;
+
+	seq = bs_sequence_start_bs(bs->md_channel, &cpl);
+	if (!seq) {
+		bs_background_free_step_cpl(bs, -ENOMEM);
+		return;
+	}
+
+	/* Without a rate, the blobs found pending after a load are released at once */
+	if (bs->background_free_rate != 0) {
+		budget = spdk_max(1, (uint64_t)bs->background_free_rate *
+				  SPDK_BS_BACKGROUND_FREE_PERIOD_US / SPDK_SEC_TO_USEC);
+	}
+
+	/* Shrink the blob by up to budget allocated clusters. Its md is persisted before
+	 * the clusters are cleared and released, so it never references a released cluster. */
+	while (num_clusters > 0 && budget > 0) {
+		num_clusters--;
+		if (bs_blob_cluster_lba(blob, num_clusters) != 0) {
+			budget--;
+		}
+	}
+
+	if (num_clusters > 0) {
+		SPDK_DEBUGLOG(blob, "Releasing clusters %" PRIu64 "-%" PRIu64 " of deleted blob 0x%"
+			      PRIx64 "\n", num_clusters, blob->active.num_clusters - 1, blob->id);
+		blob_resize(blob, num_clusters);
+		blob_persist(seq, blob, bs_background_free_persist_cpl, blob);
+		return;
+	}
+
+	/* All the clusters are released, finish the delete */
+	SPDK_DEBUGLOG(blob, "Deleting blob 0x%" PRIx64 " pending free\n", blob->id);
+	TAILQ_REMOVE(&bs->pending_frees, pending, link);
+	free(pending);
+	blob_delete_md(seq, blob, bs_delete_persist_cpl, blob);
+}
+
+static void
+bs_background_free_open_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct spdk_bs_pending_free *pending = cb_arg;
+	struct spdk_blob_store *bs = pending->bs;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to open blob 0x%" PRIx64 " pending free: %d\n",
+			    pending->blobid, bserrno);
+		TAILQ_REMOVE(&bs->pending_frees, pending, link);
+		free(pending);
+		bs_background_free_step_cpl(bs, bserrno);
+		return;
+	}
+
+	/* Like a blob being deleted, it can no longer be looked up */
+	spdk_bit_array_clear(bs->open_blobids, blob->id);
+	RB_REMOVE(spdk_blob_tree, &bs->open_blobs, blob);
+	blob->locked_operation_in_progress = true;
+	blob->md_ro = false;
+	pending->blob = blob;
+
+	bs_background_free_step(pending);
+}
+
+static int
+bs_background_free_poll(void *arg)
+{
+	struct spdk_blob_store *bs = arg;
+	struct spdk_bs_pending_free *pending;
+
+	if (bs->background_free_busy || bs->background_free_unload_cb_fn != NULL) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Blobs found pending during a load may still be open by the load */
+	TAILQ_FOREACH(pending, &bs->pending_frees, link) {
+		if (pending->blob != NULL || blob_lookup(bs, pending->blobid) == NULL) {
+			break;
+		}
+	}
+	if (pending == NULL) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	bs->background_free_busy = true;
+	if (pending->blob == NULL) {
+		bs_open_blob(bs, pending->blobid, NULL, bs_background_free_open_cpl, pending);
+	} else {
+		bs_background_free_step(pending);
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
+static int
+bs_pending_free_add(struct spdk_blob_store *bs, spdk_blob_id blobid, struct spdk_blob *blob)
+{
+	struct spdk_bs_pending_free *pending;
+
+	if (bs->background_free_poller == NULL) {
+		bs->background_free_poller = SPDK_POLLER_REGISTER(bs_background_free_poll, bs,
+					     SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+		if (bs->background_free_poller == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	pending = calloc(1, sizeof(*pending));
+	if (pending == NULL) {
+		return -ENOMEM;
+	}
+	pending->bs = bs;
+	pending->blobid = blobid;
+	pending->blob = blob;
+	TAILQ_INSERT_TAIL(&bs->pending_frees, pending, link);
+
+	return 0;
+}
+
+static void
+bs_delete_deferred_persist_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob *blob = cb_arg;
+
+	if (bserrno != 0) {
+		blob_free(blob);
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	if (bs_pending_free_add(blob->bs, blob->id, blob) != 0) {
+		/* The blob is marked deleted on disk already, so the delete succeeded.
+		 * The next load resumes releasing its clusters. */
+		SPDK_ERRLOG("Failed to queue blob 0x%" PRIx64 " for release, its clusters are "
+			    "released on the next load\n", blob->id);
+		blob_free(blob);
+	}
+
+	bs_sequence_finish(seq, 0);
+}
+
+/*
+ * Marks the blob pending free in its md and completes the delete, its clusters are then
+ * released in the background. Returns an error if the blob has to be deleted right away.
+ */
+static int
+bs_delete_blob_deferred(spdk_bs_sequence_t *seq, struct spdk_blob *blob)
+{
+	const void *value;
+	size_t len;
+	int rc;
+
+	blob->md_ro = false;
+	rc = blob_set_xattr(blob, BLOB_PENDING_FREE, &blob->id, sizeof(blob->id), true);
+	if (rc != 0) {
+		return rc;
+	}
+	/* Versions unaware of deferred frees must not bring the blob back */
+	blob->invalid_flags |= SPDK_BLOB_PENDING_FREE;
+
+	/* The data is never read again. Let go of the snapshot, so that it can be deleted
+	 * before all the clusters of this blob are released. The blob was already taken off
+	 * the clone list of the snapshot, which reset its parent_id. */
+	if (!blob_is_esnap_clone(blob) &&
+	    blob_get_xattr_value(blob, BLOB_SNAPSHOT, &value, &len, true) == 0) {
+		blob_remove_xattr(blob, BLOB_SNAPSHOT, true);
+		blob_back_bs_destroy(blob);
+		blob->back_bs_dev = bs_create_zeroes_dev();
+	}
+
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	blob_persist(seq, blob, bs_delete_deferred_persist_cpl, blob);
+
+	return 0;
+}
+
 static void
 bs_delete_blob_finish(void *cb_arg, struct spdk_blob *blob, int bserrno)
 {
 	spdk_bs_sequence_t *seq = cb_arg;
 	struct spdk_blob_list *snapshot_entry = NULL;
-	uint32_t page_num;
 
 	if (bserrno) {
 		SPDK_ERRLOG("Failed to remove blob\n");
@@ -7451,13 +10107,12 @@ bs_delete_blob_finish(void *cb_arg, struct spdk_blob *blob, int bserrno)
 		free(snapshot_entry);
 	}
 
-	page_num = bs_blobid_to_page(blob->id);
-	spdk_bit_array_clear(blob->bs->used_blobids, page_num);
-	blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob->active.num_pages = 0;
-	blob_resize(blob, 0);
+	if (blob->bs->background_free_rate != 0 && blob_has_allocated_clusters(blob) &&
+	    bs_delete_blob_deferred(seq, blob) == 0) {
+		return;
+	}
 
-	blob_persist(seq, blob, bs_delete_persist_cpl, blob);
+	blob_delete_md(seq, blob, bs_delete_persist_cpl, blob);
 }
 
 static int
@@ -7725,6 +10380,12 @@ void
 spdk_bs_open_blob(struct spdk_blob_store *bs, spdk_blob_id blobid,
 		  spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
 {
+	if (bs_blob_is_pending_free(bs, blobid)) {
+		/* The blob was deleted */
+		cb_fn(cb_arg, NULL, -ENOENT);
+		return;
+	}
+
 	bs_open_blob(bs, blobid, NULL, cb_fn, cb_arg);
 }
 
@@ -7732,6 +10393,12 @@ void
 spdk_bs_open_blob_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
 		      struct spdk_blob_open_opts *opts, spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
 {
+	if (bs_blob_is_pending_free(bs, blobid)) {
+		/* The blob was deleted */
+		cb_fn(cb_arg, NULL, -ENOENT);
+		return;
+	}
+
 	bs_open_blob(bs, blobid, opts, cb_fn, cb_arg);
 }
 
@@ -7785,63 +10452,30 @@ blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 }
 
 void
-spdk_blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
-{
-	blob_verify_md_op(blob);
-
-	SPDK_DEBUGLOG(blob, "Syncing blob 0x%" PRIx64 "\n", blob->id);
-
-	if (blob->md_ro) {
-		assert(blob->state == SPDK_BLOB_STATE_CLEAN);
-		cb_fn(cb_arg, 0);
-		return;
-	}
-
-	blob_sync_md(blob, cb_fn, cb_arg);
-}
-
-/* END spdk_blob_sync_md */
-
-struct spdk_blob_insert_cluster_ctx {
-	struct spdk_thread	*thread;
-	struct spdk_blob	*blob;
-	uint32_t		cluster_num;	/* cluster index in blob */
-	uint32_t		cluster;	/* cluster on disk */
-	uint32_t		extent_page;	/* extent page on disk */
-	struct spdk_blob_md_page *page; /* preallocated extent page */
-	int			rc;
-	spdk_blob_op_complete	cb_fn;
-	void			*cb_arg;
-};
-
-static void
-blob_insert_cluster_msg_cpl(void *arg)
-{
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-
-	ctx->cb_fn(ctx->cb_arg, ctx->rc);
-	free(ctx);
-}
-
-static void
-blob_insert_cluster_msg_cb(void *arg, int bserrno)
+spdk_blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	blob_verify_md_op(blob);
+
+	SPDK_DEBUGLOG(blob, "Syncing blob 0x%" PRIx64 "\n", blob->id);
+
+	if (blob->md_ro) {
+		assert(blob->state == SPDK_BLOB_STATE_CLEAN);
+		cb_fn(cb_arg, 0);
+		return;
+	}
 
-	ctx->rc = bserrno;
-	spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+	blob_sync_md(blob, cb_fn, cb_arg);
 }
 
+/* END spdk_blob_sync_md */
+
 static void
-blob_insert_new_ep_cb(void *arg, int bserrno)
+blob_insert_cluster_msg_cpl(void *arg)
 {
 	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-	uint32_t *extent_page;
 
-	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
-	*extent_page = ctx->extent_page;
-	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob_sync_md(ctx->blob, blob_insert_cluster_msg_cb, ctx);
+	ctx->cb_fn(ctx->cb_arg, ctx->rc);
+	free(ctx);
 }
 
 struct spdk_blob_write_extent_page_ctx {
@@ -7869,9 +10503,9 @@ blob_write_extent_page_ready(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 		blob_persist_extent_page_cpl(seq, ctx, bserrno);
 		return;
 	}
-	bs_sequence_write_dev(seq, ctx->page, bs_md_page_to_lba(ctx->bs, ctx->extent),
-			      bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
-			      blob_persist_extent_page_cpl, ctx);
+	bs_md_write(seq, ctx->bs, ctx->page, bs_md_page_to_lba(ctx->bs, ctx->extent),
+		    bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
+		    blob_persist_extent_page_cpl, ctx);
 }
 
 static void
@@ -7916,60 +10550,327 @@ blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster
 	bs_mark_dirty(seq, blob->bs, blob_write_extent_page_ready, ctx);
 }
 
+static void blob_insert_cluster_batch_start(void *arg);
+
 static void
-blob_insert_cluster_msg(void *arg)
+blob_insert_cluster_batch_done(struct spdk_blob *blob, int bserrno)
 {
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-	uint32_t *extent_page;
+	struct spdk_blob_insert_cluster_ctx *ctx, *tmp;
+	uint32_t extent_page;
+
+	TAILQ_FOREACH_SAFE(ctx, &blob->inserts_to_complete, link, tmp) {
+		TAILQ_REMOVE(&blob->inserts_to_complete, ctx, link);
+
+		if (ctx->rc == 0 && bserrno != 0 && ctx->num_pages != 0) {
+			/* The pages stay marked as written, they were written before */
+			ctx->rc = bserrno;
+		} else if (ctx->rc == 0 && bserrno != 0) {
+			/* Undo the insertion, the caller releases the cluster */
+			ctx->rc = bserrno;
+			blob_cluster_map_set(blob, ctx->cluster_num, 0);
+			if (ctx->partial) {
+				blob_partial_cluster_retire(blob, ctx->cluster_num);
+			}
+
+			extent_page = blob->use_extent_table ?
+				      *bs_cluster_to_extent_page(blob, ctx->cluster_num) : 0;
+			if (ctx->extent_page != 0 && ctx->extent_page != extent_page) {
+				spdk_spin_lock(&blob->bs->used_lock);
+				bs_release_md_page(blob->bs, ctx->extent_page);
+				spdk_spin_unlock(&blob->bs->used_lock);
+			}
+		}
 
-	ctx->rc = blob_insert_cluster(ctx->blob, ctx->cluster_num, ctx->cluster);
-	if (ctx->rc != 0) {
 		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+	}
+
+	if (!TAILQ_EMPTY(&blob->pending_inserts)) {
+		blob_insert_cluster_batch_start(blob);
+	}
+}
+
+static void
+blob_insert_cluster_sync_cpl(void *arg, int bserrno)
+{
+	blob_insert_cluster_batch_done(arg, bserrno);
+}
+
+static void
+blob_insert_cluster_write_cpl(void *arg, int bserrno)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	if (ctx->num_pages != 0) {
+		/* The page was allocated for the bitmap update */
+		spdk_free(ctx->page);
+		ctx->page = NULL;
+	}
+
+	if (bserrno != 0) {
+		blob->insert_rc = bserrno;
+	} else if (ctx->extent_page != 0) {
+		/* The new extent page is on disk, it can be referenced from the extent table */
+		*bs_cluster_to_extent_page(blob, ctx->cluster_num) = ctx->extent_page;
+		blob->insert_needs_sync = true;
+	}
+
+	assert(blob->insert_writes_outstanding > 0);
+	if (--blob->insert_writes_outstanding > 0) {
 		return;
 	}
 
-	if (ctx->blob->use_extent_table == false) {
-		/* Extent table is not used, proceed with sync of md that will only use extents_rle. */
-		ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-		blob_sync_md(ctx->blob, blob_insert_cluster_msg_cb, ctx);
+	if (blob->insert_rc == 0 && blob->insert_needs_sync) {
+		blob->state = SPDK_BLOB_STATE_DIRTY;
+		blob_sync_md(blob, blob_insert_cluster_sync_cpl, blob);
 		return;
 	}
 
-	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
-	if (*extent_page == 0) {
-		/* Extent page requires allocation.
-		 * It was already claimed in the used_md_pages map and placed in ctx. */
-		assert(ctx->extent_page != 0);
-		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-		blob_write_extent_page(ctx->blob, ctx->extent_page, ctx->cluster_num, ctx->page,
-				       blob_insert_new_ep_cb, ctx);
-	} else {
-		/* It is possible for original thread to allocate extent page for
-		 * different cluster in the same extent page. In such case proceed with
-		 * updating the existing extent page, but release the additional one. */
-		if (ctx->extent_page != 0) {
-			spdk_spin_lock(&ctx->blob->bs->used_lock);
-			assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-			bs_release_md_page(ctx->blob->bs, ctx->extent_page);
-			spdk_spin_unlock(&ctx->blob->bs->used_lock);
+	blob_insert_cluster_batch_done(blob, blob->insert_rc);
+}
+
+/*
+ * Returns the insertion or bitmap update, earlier in the batch, that already writes the
+ * extent page of ctx, or NULL if there is none.
+ */
+static struct spdk_blob_insert_cluster_ctx *
+blob_insert_cluster_find_extent_page(struct spdk_blob_insert_cluster_ctx *ctx)
+{
+	struct spdk_blob_insert_cluster_ctx *prev;
+	uint64_t extent_table_id = bs_cluster_to_extent_table_id(ctx->cluster_num);
+
+	TAILQ_FOREACH(prev, &ctx->blob->inserts_to_complete, link) {
+		if (prev == ctx) {
+			break;
+		}
+		if (prev->write_extent_page &&
+		    bs_cluster_to_extent_table_id(prev->cluster_num) == extent_table_id) {
+			return prev;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+blob_insert_partial_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
+{
+	struct spdk_blob_partial_cluster *partial;
+	int rc;
+
+	if (bs_blob_cluster_lba(blob, cluster_num) != 0) {
+		return -EEXIST;
+	}
+
+	if (blob->partial_cow_paused) {
+		/* The cluster has to be copied from the parent */
+		return -EAGAIN;
+	}
+
+	if (blob_partial_extent_page_full(blob, cluster_num)) {
+		/* No room for the bitmap in the extent page, the cluster has to be copied */
+		return -EAGAIN;
+	}
+
+	partial = blob_partial_cluster_alloc(blob, cluster_num);
+	if (partial == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The I/O threads must find the partial cluster as soon as the cluster is allocated */
+	rc = blob_partial_cluster_set(blob, partial);
+	if (rc != 0) {
+		partial_cluster_free(partial);
+		return rc;
+	}
+	spdk_smp_wmb();
+
+	rc = blob_insert_cluster(blob, cluster_num, cluster);
+	if (rc != 0) {
+		blob_partial_cluster_retire(blob, cluster_num);
+	}
+
+	return rc;
+}
+
+/* Marks pages of a partial cluster as written, returns true if any was not yet */
+static bool
+blob_partial_cluster_set_written(struct spdk_blob *blob, uint32_t cluster_num,
+				 uint32_t first_page, uint32_t num_pages)
+{
+	struct spdk_blob_partial_cluster *partial;
+	uint32_t page;
+	bool changed = false;
+
+	partial = blob_partial_cluster_get(blob, cluster_num);
+	if (partial == NULL) {
+		/* The cluster was fully written or filled from the parent meanwhile */
+		return false;
+	}
+
+	for (page = first_page; page < first_page + num_pages; page++) {
+		if (!spdk_bit_array_get(partial->written, page)) {
+			spdk_bit_array_set(partial->written, page);
+			changed = true;
+		}
+	}
+
+	if (spdk_bit_array_count_clear(partial->written) == 0) {
+		blob_partial_cluster_retire(blob, cluster_num);
+	}
+
+	return changed;
+}
+
+static void
+blob_insert_cluster_batch_write(struct spdk_blob *blob)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx;
+	uint32_t *extent_page;
+	uint32_t writes;
+
+	/* Every extent page touched by the batch is written once, with all of its new clusters
+	 * and bitmaps. The batch may complete as soon as the last write is issued, so stop
+	 * right there. */
+	writes = blob->insert_writes_outstanding;
+	TAILQ_FOREACH(ctx, &blob->inserts_to_complete, link) {
+		if (!ctx->write_extent_page || blob_insert_cluster_find_extent_page(ctx) != NULL) {
+			continue;
+		}
+		extent_page = bs_cluster_to_extent_page(blob, ctx->cluster_num);
+		writes--;
+		if (ctx->num_pages != 0) {
+			/* Bitmap updates do not come with a preallocated extent page */
+			assert(ctx->page == NULL);
+			ctx->page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+						 SPDK_MALLOC_DMA);
+		}
+		if (ctx->page != NULL) {
+			blob_write_extent_page(blob,
+					       ctx->extent_page != 0 ? ctx->extent_page : *extent_page,
+					       ctx->cluster_num, ctx->page,
+					       blob_insert_cluster_write_cpl, ctx);
+		} else {
+			blob_insert_cluster_write_cpl(ctx, -ENOMEM);
+		}
+		if (writes == 0) {
+			break;
+		}
+	}
+}
+
+static void
+blob_insert_cluster_batch_start(void *arg)
+{
+	struct spdk_blob *blob = arg;
+	struct spdk_blob_insert_cluster_ctx *ctx, *writer;
+	uint32_t *extent_page;
+
+	assert(TAILQ_EMPTY(&blob->inserts_to_complete));
+	TAILQ_SWAP(&blob->inserts_to_complete, &blob->pending_inserts, spdk_blob_insert_cluster_ctx, link);
+	blob->insert_rc = 0;
+	blob->insert_needs_sync = false;
+	blob->insert_writes_outstanding = 0;
+
+	/* Insert all the clusters first, so that each extent page is written only once */
+	TAILQ_FOREACH(ctx, &blob->inserts_to_complete, link) {
+		if (ctx->num_pages != 0) {
+			/* Pages written to a partial cluster, persisted in the extent page of the
+			 * cluster along with its bitmap */
+			ctx->rc = 0;
+			if (blob_partial_cluster_set_written(blob, ctx->cluster_num, ctx->first_page,
+							     ctx->num_pages)) {
+				assert(*bs_cluster_to_extent_page(blob, ctx->cluster_num) != 0);
+				ctx->write_extent_page = true;
+				if (blob_insert_cluster_find_extent_page(ctx) == NULL) {
+					blob->insert_writes_outstanding++;
+				}
+			}
+			continue;
+		}
+
+		if (ctx->partial) {
+			/* The bitmap of the cluster is written with its extent page */
+			ctx->rc = blob_insert_partial_cluster(blob, ctx->cluster_num, ctx->cluster);
+		} else {
+			ctx->rc = blob_insert_cluster(blob, ctx->cluster_num, ctx->cluster);
+		}
+		if (ctx->rc == 0 && blob->use_extent_table == false) {
+			/* Extent table is not used, a single sync of md persists all the clusters. */
+			blob->insert_needs_sync = true;
+		}
+		if (ctx->rc != 0 || blob->use_extent_table == false) {
+			if (ctx->extent_page != 0) {
+				spdk_spin_lock(&blob->bs->used_lock);
+				bs_release_md_page(blob->bs, ctx->extent_page);
+				spdk_spin_unlock(&blob->bs->used_lock);
+				ctx->extent_page = 0;
+			}
+			continue;
+		}
+
+		/* It is possible for the I/O threads to allocate a new extent page for
+		 * several clusters in the same extent page. Keep only the first one and
+		 * release the others. */
+		extent_page = bs_cluster_to_extent_page(blob, ctx->cluster_num);
+		writer = blob_insert_cluster_find_extent_page(ctx);
+		if (ctx->extent_page != 0 && (*extent_page != 0 || writer != NULL)) {
+			spdk_spin_lock(&blob->bs->used_lock);
+			assert(spdk_bit_array_get(blob->bs->used_md_pages, ctx->extent_page) == true);
+			bs_release_md_page(blob->bs, ctx->extent_page);
+			spdk_spin_unlock(&blob->bs->used_lock);
 			ctx->extent_page = 0;
 		}
-		/* Extent page already allocated.
-		 * Every cluster allocation, requires just an update of single extent page. */
-		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num, ctx->page,
-				       blob_insert_cluster_msg_cb, ctx);
+		ctx->write_extent_page = true;
+		if (writer == NULL) {
+			/* Extent page requires allocation, it was already claimed in
+			 * the used_md_pages map and placed in ctx. */
+			assert(*extent_page != 0 || ctx->extent_page != 0);
+			blob->insert_writes_outstanding++;
+		}
+	}
+
+	if (blob->insert_writes_outstanding == 0) {
+		if (blob->insert_needs_sync) {
+			blob->state = SPDK_BLOB_STATE_DIRTY;
+			blob_sync_md(blob, blob_insert_cluster_sync_cpl, blob);
+		} else {
+			blob_insert_cluster_batch_done(blob, 0);
+		}
+		return;
+	}
+
+	blob_insert_cluster_batch_write(blob);
+}
+
+static void
+blob_insert_cluster_msg(void *arg)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	if (TAILQ_EMPTY(&blob->pending_inserts) && TAILQ_EMPTY(&blob->inserts_to_complete)) {
+		/* Start the batch after the insertions already queued on this thread,
+		 * so that they are persisted together. */
+		spdk_thread_send_msg(spdk_get_thread(), blob_insert_cluster_batch_start, blob);
 	}
+	TAILQ_INSERT_TAIL(&blob->pending_inserts, ctx, link);
 }
 
 static void
 blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
 				 uint64_t cluster, uint32_t extent_page, struct spdk_blob_md_page *page,
-				 spdk_blob_op_complete cb_fn, void *cb_arg)
+				 bool partial, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_blob_insert_cluster_ctx *ctx;
 
 	ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
+		if (extent_page != 0) {
+			spdk_spin_lock(&blob->bs->used_lock);
+			bs_release_md_page(blob->bs, extent_page);
+			spdk_spin_unlock(&blob->bs->used_lock);
+		}
 		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
@@ -7980,12 +10881,179 @@ blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
 	ctx->cluster = cluster;
 	ctx->extent_page = extent_page;
 	ctx->page = page;
+	ctx->partial = partial;
 	ctx->cb_fn = cb_fn;
 	ctx->cb_arg = cb_arg;
 
 	spdk_thread_send_msg(blob->bs->md_thread, blob_insert_cluster_msg, ctx);
 }
 
+struct blob_fill_partial_ctx {
+	struct spdk_blob	*blob;
+	void			*buf;
+	struct spdk_blob_md_page *extent_page;
+	spdk_bs_sequence_t	*seq;
+	uint64_t		cluster;
+	uint32_t		page;
+	uint32_t		num_pages;
+	spdk_blob_op_complete	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+blob_fill_partial_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_fill_partial_ctx *ctx = cb_arg;
+
+	ctx->cb_fn(ctx->cb_arg, bserrno);
+	spdk_free(ctx->extent_page);
+	spdk_free(ctx->buf);
+	free(ctx);
+}
+
+static void blob_fill_partial_next(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
+
+static void
+blob_fill_partial_extent_page_cpl(void *cb_arg, int bserrno)
+{
+	struct blob_fill_partial_ctx *ctx = cb_arg;
+
+	blob_fill_partial_next(ctx->seq, ctx, bserrno);
+}
+
+/* Persists the extent page of a cluster that got filled, without its bitmap */
+static void
+blob_fill_partial_write_extent_page(struct blob_fill_partial_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+
+	memset(ctx->extent_page, 0, SPDK_BS_PAGE_SIZE);
+	blob_write_extent_page(blob, *bs_cluster_to_extent_page(blob, ctx->cluster), ctx->cluster,
+			       ctx->extent_page, blob_fill_partial_extent_page_cpl, ctx);
+}
+
+static void
+blob_fill_partial_write(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct blob_fill_partial_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	bs_sequence_write_dev(seq, ctx->buf, bs_blob_cluster_lba(blob, ctx->cluster) + ctx->page,
+			      ctx->num_pages, blob_fill_partial_next, ctx);
+}
+
+static void
+blob_fill_partial_next(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct blob_fill_partial_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_partial_cluster *partial;
+	uint32_t pages_per_cluster = blob->bs->pages_per_cluster;
+	uint32_t end;
+
+	if (bserrno != 0) {
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	if (ctx->num_pages != 0) {
+		/* The run was copied from the parent */
+		blob_partial_cluster_set_written(blob, ctx->cluster, ctx->page, ctx->num_pages);
+		ctx->num_pages = 0;
+		if (blob_partial_cluster_get(blob, ctx->cluster) == NULL) {
+			blob_fill_partial_write_extent_page(ctx);
+			return;
+		}
+	}
+
+	for (; ctx->cluster < blob->active.num_clusters; ctx->cluster++) {
+		partial = blob_partial_cluster_get(blob, ctx->cluster);
+		if (partial == NULL) {
+			continue;
+		}
+
+		ctx->page = spdk_bit_array_find_first_clear(partial->written, 0);
+		if (ctx->page >= pages_per_cluster) {
+			blob_partial_cluster_retire(blob, ctx->cluster);
+			blob_fill_partial_write_extent_page(ctx);
+			return;
+		}
+		end = spdk_min(spdk_bit_array_find_first_set(partial->written, ctx->page),
+			       pages_per_cluster);
+		ctx->num_pages = end - ctx->page;
+
+		bs_sequence_read_bs_dev(seq, blob->back_bs_dev, ctx->buf,
+					bs_io_unit_to_back_dev_lba(blob,
+							bs_cluster_to_page(blob->bs, ctx->cluster) + ctx->page),
+					bs_io_unit_to_back_dev_lba(blob, ctx->num_pages),
+					blob_fill_partial_write, ctx);
+		return;
+	}
+
+	bs_sequence_finish(seq, 0);
+}
+
+/*
+ * Copies the pages of the partial clusters that were not written yet from the parent, so that
+ * the blob no longer depends on the parent for them. The I/O to the blob must be frozen.
+ */
+static void
+blob_fill_partial_clusters(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	struct blob_fill_partial_ctx *ctx;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+
+	blob_verify_md_op(blob);
+
+	if (blob->num_partial_clusters == 0) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen, NULL,
+			       SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->extent_page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+					SPDK_MALLOC_DMA);
+	if (ctx->buf == NULL || ctx->extent_page == NULL) {
+		spdk_free(ctx->extent_page);
+		spdk_free(ctx->buf);
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->blob = blob;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_fill_partial_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	seq = bs_sequence_start_blob(blob->bs->md_channel, &cpl, blob);
+	if (!seq) {
+		spdk_free(ctx->extent_page);
+		spdk_free(ctx->buf);
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->seq = seq;
+
+	blob_fill_partial_next(seq, ctx, 0);
+}
+
 /* START spdk_blob_close */
 
 static void
@@ -8586,6 +11654,10 @@ bs_load_grow_continue(struct spdk_bs_load_ctx *ctx)
 		ctx->bs->pages_per_cluster_shift = spdk_u32log2(ctx->bs->pages_per_cluster);
 	}
 	ctx->bs->io_unit_size = ctx->super->io_unit_size;
+	bs_parse_super_cluster_allocator(ctx->bs, ctx->super);
+	if (ctx->bs->background_free_rate == 0) {
+		ctx->bs->background_free_rate = ctx->super->background_free_rate;
+	}
 	rc = spdk_bit_array_resize(&ctx->used_clusters, ctx->bs->total_clusters);
 	if (rc < 0) {
 		bs_load_ctx_fail(ctx, -ENOMEM);
@@ -8904,7 +11976,8 @@ blob_esnap_destroy_channels_done(struct spdk_io_channel_iter *i, int status)
 	free(ctx);
 
 	bs->esnap_channels_unloading--;
-	if (bs->esnap_channels_unloading == 0 && bs->esnap_unload_cb_fn != NULL) {
+	if (bs->esnap_channels_unloading == 0 && bs->back_bs_devs_releasing == 0 &&
+	    bs->esnap_unload_cb_fn != NULL) {
 		spdk_bs_unload(bs, bs->esnap_unload_cb_fn, bs->esnap_unload_cb_arg);
 	}
 }
@@ -9052,6 +12125,7 @@ blob_frozen_set_back_bs_dev(void *_ctx, struct spdk_blob *blob, int bserrno)
 
 	SPDK_NOTICELOG("blob 0x%" PRIx64 ": hotplugged back_bs_dev\n", blob->id);
 	blob->back_bs_dev = ctx->back_bs_dev;
+	bs_backing_chain_changed(blob->bs);
 	ctx->bserrno = 0;
 
 	blob_unfreeze_io(blob, blob_set_back_bs_dev_done, ctx);
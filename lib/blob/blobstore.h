@@ -25,6 +25,20 @@
 #define SPDK_BLOB_OPTS_NUM_MD_PAGES UINT32_MAX
 #define SPDK_BLOB_OPTS_MAX_MD_OPS 32
 #define SPDK_BLOB_OPTS_DEFAULT_CHANNEL_OPS 512
+#define SPDK_BLOB_OPTS_CLUSTER_EXTENT_SZ 32
+/* Period of the poller releasing the clusters of deleted blobs in the background */
+#define SPDK_BS_BACKGROUND_FREE_PERIOD_US (100 * 1000)
+#define SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS 8
+/* Default number of clusters copied at the same time by inflate and decouple */
+#define SPDK_BS_INFLATE_QUEUE_DEPTH SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS
+/* Period at which rate limited inflate and decouple get more clusters to copy */
+#define SPDK_BS_INFLATE_PERIOD_US (100 * 1000)
+/* Number of clusters in each chunk of a sparse cluster map, as a power of 2 */
+#define SPDK_BLOB_CLUSTER_CHUNK_SHIFT 9
+#define SPDK_BLOB_CLUSTER_CHUNK_SZ (1ULL << SPDK_BLOB_CLUSTER_CHUNK_SHIFT)
+/* Metadata pages read by each I/O during recovery, and number of such I/O issued at once */
+#define SPDK_BS_RECOVER_READ_PAGES 128
+#define SPDK_BS_RECOVER_READ_DEPTH 8
 #define SPDK_BLOB_BLOBID_HIGH_BIT (1ULL << 32)
 
 struct spdk_xattr {
@@ -47,6 +61,14 @@ struct spdk_blob_mut_data {
 	 */
 	uint64_t	*clusters;
 
+	/* Sparse cluster map, used instead of 'clusters' by large thin
+	 * provisioned blobs. Each entry points to an array of the LBAs of
+	 * SPDK_BLOB_CLUSTER_CHUNK_SZ clusters, or is NULL if none of these
+	 * clusters is allocated. Use bs_blob_cluster_lba() to look up a
+	 * cluster in either of the maps.
+	 */
+	uint64_t	**cluster_chunks;
+
 	/* The size of the clusters array. This is greater than or
 	 * equal to 'num_clusters'.
 	 */
@@ -91,6 +113,32 @@ enum spdk_blob_state {
 
 TAILQ_HEAD(spdk_xattr_tailq, spdk_xattr);
 
+/* A cluster allocated by sub-cluster copy-on-write. Only the pages set in 'written'
+ * were written to the cluster, the other ones are still read from the parent.
+ */
+struct spdk_blob_partial_cluster {
+	uint32_t		cluster_num;
+	struct spdk_bit_array	*written;
+	TAILQ_ENTRY(spdk_blob_partial_cluster) link;
+};
+
+/* Partial clusters of the SPDK_EXTENTS_PER_EP clusters covered by an extent page,
+ * which holds their bitmaps. Allocated on first use, indexed by cluster within the page.
+ */
+struct spdk_blob_partial_chunk {
+	uint32_t				num_partial;
+	struct spdk_blob_partial_cluster	*clusters[0];
+};
+
+/* Table of partial cluster chunks, indexed by extent page. It is replaced rather than
+ * reallocated when the blob grows, as the I/O threads look it up without locking.
+ */
+struct spdk_blob_partial_table {
+	uint64_t				num_chunks;
+	TAILQ_ENTRY(spdk_blob_partial_table)	link;
+	struct spdk_blob_partial_chunk		*chunks[0];
+};
+
 struct spdk_blob_list {
 	spdk_blob_id id;
 	size_t clone_count;
@@ -136,6 +184,8 @@ struct spdk_blob {
 
 	uint32_t frozen_refcnt;
 	bool locked_operation_in_progress;
+	/* Inflate or decouple in progress, to cancel it */
+	struct spdk_clone_snapshot_ctx *inflate_ctx;
 	enum blob_clear_method clear_method;
 	bool extent_rle_found;
 	bool extent_table_found;
@@ -145,9 +195,59 @@ struct spdk_blob {
 	TAILQ_HEAD(, spdk_blob_persist_ctx) pending_persists;
 	TAILQ_HEAD(, spdk_blob_persist_ctx) persists_to_complete;
 
+	/* Clusters allocated by the I/O path, waiting to be inserted on the md thread.
+	 * All insertions pending when a batch starts are persisted together. */
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx) pending_inserts;
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx) inserts_to_complete;
+	uint32_t	insert_writes_outstanding;
+	int		insert_rc;
+	bool		insert_needs_sync;
+
 	/* Number of data clusters retrieved from extent table,
 	 * that many have to be read from extent pages. */
 	uint64_t	remaining_clusters_in_et;
+
+	/* Extent of clusters handed out to this blob by BS_CLUSTER_ALLOCATOR_EXTENT: the
+	 * next cluster to allocate and the end of the extent, 0 if not known yet.
+	 * Protected by bs->used_lock. */
+	uint32_t	next_cluster;
+	uint32_t	cluster_extent_end;
+
+	/* Partial clusters of a blob with SPDK_BLOB_SUBCLUSTER_COW. Once fully written or
+	 * filled from the parent they are retired rather than freed, and so are the tables
+	 * replaced on resize, as the I/O threads may still be looking at them. */
+	struct spdk_blob_partial_table *partial_table;
+	uint64_t	num_partial_clusters;
+	TAILQ_HEAD(, spdk_blob_partial_cluster) retired_partial_clusters;
+	TAILQ_HEAD(, spdk_blob_partial_table) retired_partial_tables;
+	/* Set while the partial clusters are filled, new clusters get fully copied */
+	bool		partial_cow_paused;
+
+	/* Where the unallocated clusters of a clone of a snapshot are read from, filled
+	 * by the I/O threads on first read. Allocated on first use and never resized. */
+	struct spdk_blob_resolve_cache *resolve_cache;
+};
+
+/* Each entry of the cache holds the backing chain generation it was resolved at in
+ * its upper 32 bits, and the blobstore cluster holding the data in its lower 32 bits,
+ * or one of the markers below. Entries of older generations are stale.
+ */
+#define SPDK_BLOB_RESOLVED_ZEROES	UINT32_MAX
+#define SPDK_BLOB_RESOLVED_BACKING	(UINT32_MAX - 1)
+
+struct spdk_blob_resolve_cache {
+	uint64_t	num_chunks;
+	/* Chunks of SPDK_BLOB_CLUSTER_CHUNK_SZ entries, NULL until first used */
+	uint64_t	*chunks[];
+};
+
+/* A deleted blob whose clusters are released in the background */
+struct spdk_bs_pending_free {
+	struct spdk_blob_store		*bs;
+	spdk_blob_id			blobid;
+	/* Handle of the blob, NULL until the background free gets to it after a load */
+	struct spdk_blob		*blob;
+	TAILQ_ENTRY(spdk_bs_pending_free) link;
 };
 
 struct spdk_blob_store {
@@ -172,6 +272,16 @@ struct spdk_blob_store {
 	uint64_t			total_clusters;
 	uint64_t			total_data_clusters;
 	uint64_t			num_free_clusters;	/* Protected by used_lock */
+	enum bs_cluster_allocator	cluster_allocator;
+	uint32_t			cluster_extent_sz;
+	uint32_t			next_cluster_extent;	/* Protected by used_lock */
+	/* Set when no free run of cluster_extent_sz clusters was found, until at least that many
+	 * clusters are released again.  Protected by used_lock. */
+	bool				clusters_fragmented;
+	uint32_t			clusters_released;
+	/* Bumped on the md thread whenever the data of clusters read by clones through
+	 * their backing chains may move, invalidating the resolve caches of the blobs. */
+	uint32_t			backing_chain_gen;
 	uint64_t			pages_per_cluster;
 	uint8_t				pages_per_cluster_shift;
 	uint32_t			io_unit_size;
@@ -185,6 +295,22 @@ struct spdk_blob_store {
 	RB_HEAD(spdk_blob_tree, spdk_blob) open_blobs;
 	TAILQ_HEAD(, spdk_blob_list)	snapshots;
 
+	/* Writes of md pages issued on the md thread, sorted by LBA. They are merged
+	 * and submitted together once the md thread is done with the current message. */
+	TAILQ_HEAD(spdk_bs_md_writes, spdk_bs_md_write) md_writes;
+	bool				md_writes_flush_scheduled;
+
+	/* Deleted blobs marked with BLOB_PENDING_FREE, released by background_free_poller
+	 * at background_free_rate clusters per second. They keep their blobid until then,
+	 * but can no longer be opened. */
+	TAILQ_HEAD(, spdk_bs_pending_free) pending_frees;
+	uint32_t			background_free_rate;
+	struct spdk_poller		*background_free_poller;
+	bool				background_free_busy;
+	/* Unload deferred until the release in progress completes */
+	spdk_bs_op_complete		background_free_unload_cb_fn;
+	void				*background_free_unload_cb_arg;
+
 	bool				clean;
 
 	spdk_bs_esnap_dev_create	esnap_bs_dev_create;
@@ -195,6 +321,10 @@ struct spdk_blob_store {
 	 * after the channel destruction completes.
 	 */
 	uint32_t			esnap_channels_unloading;
+	/* Backing devices of clones waiting for a pass over all channels
+	 * before being destroyed. The unload is deferred for those as well.
+	 */
+	uint32_t			back_bs_devs_releasing;
 	spdk_bs_op_complete		esnap_unload_cb_fn;
 	void				*esnap_unload_cb_arg;
 };
@@ -208,12 +338,22 @@ struct spdk_bs_channel {
 	struct spdk_bs_dev		*dev;
 	struct spdk_io_channel		*dev_channel;
 
-	/* This page is only used during insert of a new cluster. */
-	struct spdk_blob_md_page	*new_cluster_page;
+	/* Contexts for the cluster allocations in flight on this channel, each with
+	 * its own page used during insert of the new cluster. */
+	struct spdk_blob_copy_cluster_ctx	*cluster_alloc_mem;
+	struct spdk_blob_md_page	*new_cluster_pages;
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) free_cluster_allocs;
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) cluster_allocs;
 
+	/* User ops waiting for a free cluster allocation context */
 	TAILQ_HEAD(, spdk_bs_request_set) need_cluster_alloc;
 	TAILQ_HEAD(, spdk_bs_request_set) queued_io;
 
+	/* Writes to partial clusters until their pages are persisted as written, and
+	 * the blob freezes waiting for them. */
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx) partial_writes;
+	TAILQ_HEAD(, freeze_io_ctx) partial_write_drains;
+
 	RB_HEAD(blob_esnap_channel_tree, blob_esnap_channel) esnap_channels;
 };
 
@@ -233,6 +373,7 @@ enum spdk_blob_op_type {
 #define SNAPSHOT_IN_PROGRESS "SNAPTMP"
 #define SNAPSHOT_PENDING_REMOVAL "SNAPRM"
 #define BLOB_EXTERNAL_SNAPSHOT_ID "EXTSNAP"
+#define BLOB_PENDING_FREE "FREERM"
 
 struct spdk_blob_bs_dev {
 	struct spdk_bs_dev bs_dev;
@@ -282,6 +423,11 @@ struct spdk_bs_md_mask {
  * with 0's being unallocated clusters. It is NOT part of
  * serialized metadata chain for a blob. */
 #define SPDK_MD_DESCRIPTOR_TYPE_EXTENT_PAGE 6
+/* PARTIAL_CLUSTER descriptor holds the bitmap of pages written to a cluster
+ * allocated by sub-cluster copy-on-write, the other pages of the cluster are
+ * read from the parent. It follows the EXTENT_PAGE descriptor of the extent page
+ * covering the cluster, and is NOT part of serialized metadata chain for a blob. */
+#define SPDK_MD_DESCRIPTOR_TYPE_PARTIAL_CLUSTER 7
 
 struct spdk_blob_md_descriptor_xattr {
 	uint8_t		type;
@@ -327,12 +473,28 @@ struct spdk_blob_md_descriptor_extent_page {
 	uint32_t	cluster_idx[0];
 };
 
+struct spdk_blob_md_descriptor_partial_cluster {
+	uint8_t		type;
+	uint32_t	length;
+
+	/* Cluster index in the blob */
+	uint32_t	cluster_idx;
+	/* Number of bits in the written mask */
+	uint32_t	num_pages;
+
+	uint8_t		written[0];
+};
+
 #define SPDK_BLOB_THIN_PROV		(1ULL << 0)
 #define SPDK_BLOB_INTERNAL_XATTR	(1ULL << 1)
 #define SPDK_BLOB_EXTENT_TABLE		(1ULL << 2)
 #define SPDK_BLOB_EXTERNAL_SNAPSHOT	(1ULL << 3)
+#define SPDK_BLOB_SUBCLUSTER_COW	(1ULL << 4)
+/* Deleted blob whose clusters are being released, see BLOB_PENDING_FREE */
+#define SPDK_BLOB_PENDING_FREE		(1ULL << 5)
 #define SPDK_BLOB_INVALID_FLAGS_MASK	(SPDK_BLOB_THIN_PROV | SPDK_BLOB_INTERNAL_XATTR | \
-					 SPDK_BLOB_EXTENT_TABLE | SPDK_BLOB_EXTERNAL_SNAPSHOT)
+					 SPDK_BLOB_EXTENT_TABLE | SPDK_BLOB_EXTERNAL_SNAPSHOT | \
+					 SPDK_BLOB_SUBCLUSTER_COW | SPDK_BLOB_PENDING_FREE)
 
 #define SPDK_BLOB_READ_ONLY (1ULL << 0)
 #define SPDK_BLOB_DATA_RO_FLAGS_MASK	SPDK_BLOB_READ_ONLY
@@ -393,6 +555,11 @@ SPDK_STATIC_ASSERT(SPDK_BS_PAGE_SIZE == sizeof(struct spdk_blob_md_page), "Inval
 #define SPDK_EXTENTS_PER_EP_MAX ((SPDK_BS_MAX_DESC_SIZE - sizeof(struct spdk_blob_md_descriptor_extent_page)) / sizeof(uint32_t))
 #define SPDK_EXTENTS_PER_EP (spdk_align64pow2(SPDK_EXTENTS_PER_EP_MAX + 1) >> 1u)
 
+/* Room left in an Extent Page, after a full EXTENT_PAGE descriptor, for the PARTIAL_CLUSTER
+ * descriptors of its clusters. */
+#define SPDK_EXTENT_PAGE_PARTIAL_SIZE (SPDK_BS_MAX_DESC_SIZE - \
+	sizeof(struct spdk_blob_md_descriptor_extent_page) - SPDK_EXTENTS_PER_EP * sizeof(uint32_t))
+
 #define SPDK_BS_SUPER_BLOCK_SIG "SPDKBLOB"
 
 struct spdk_bs_super_block {
@@ -421,7 +588,13 @@ struct spdk_bs_super_block {
 	uint64_t	size; /* size of blobstore in bytes */
 	uint32_t	io_unit_size; /* Size of io unit in bytes */
 
-	uint8_t		reserved[4000];
+	/* Cluster allocator, only valid if cluster_extent_sz is not 0 */
+	uint8_t		cluster_allocator;
+	uint8_t		reserved0[3];
+	uint32_t	cluster_extent_sz;
+	uint32_t	background_free_rate; /* In clusters per second, 0 to free synchronously */
+
+	uint8_t		reserved[3988];
 	uint32_t	crc;
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_super_block) == 0x1000, "Invalid super block size");
@@ -586,6 +759,26 @@ bs_page_to_blobid(uint64_t page_idx)
 	return SPDK_BLOB_BLOBID_HIGH_BIT | page_idx;
 }
 
+/* Look up the LBA of the start of a cluster of the blob, 0 if the cluster is not allocated. */
+static inline uint64_t
+bs_blob_cluster_lba(const struct spdk_blob *blob, uint64_t cluster_num)
+{
+	const uint64_t *chunk;
+
+	assert(cluster_num < blob->active.cluster_array_size);
+
+	if (spdk_likely(blob->active.cluster_chunks == NULL)) {
+		return blob->active.clusters[cluster_num];
+	}
+
+	chunk = blob->active.cluster_chunks[cluster_num >> SPDK_BLOB_CLUSTER_CHUNK_SHIFT];
+	if (chunk == NULL) {
+		return 0;
+	}
+
+	return chunk[cluster_num & (SPDK_BLOB_CLUSTER_CHUNK_SZ - 1)];
+}
+
 /* Given an io unit offset into a blob, look up the LBA for the
  * start of that io unit.
  */
@@ -609,10 +802,10 @@ bs_blob_io_unit_to_lba(struct spdk_blob *blob, uint64_t io_unit)
 
 	if (shift != 0) {
 		io_units_per_cluster = io_units_per_page << shift;
-		lba = blob->active.clusters[page >> shift];
+		lba = bs_blob_cluster_lba(blob, page >> shift);
 	} else {
 		io_units_per_cluster = io_units_per_page * pages_per_cluster;
-		lba = blob->active.clusters[page / pages_per_cluster];
+		lba = bs_blob_cluster_lba(blob, page / pages_per_cluster);
 	}
 	lba += io_unit % io_units_per_cluster;
 	return lba;
@@ -676,9 +869,9 @@ bs_io_unit_is_allocated(struct spdk_blob *blob, uint64_t io_unit)
 	assert(page < blob->active.num_clusters * pages_per_cluster);
 
 	if (shift != 0) {
-		lba = blob->active.clusters[page >> shift];
+		lba = bs_blob_cluster_lba(blob, page >> shift);
 	} else {
-		lba = blob->active.clusters[page / pages_per_cluster];
+		lba = bs_blob_cluster_lba(blob, page / pages_per_cluster);
 	}
 
 	if (lba == 0) {
@@ -689,4 +882,30 @@ bs_io_unit_is_allocated(struct spdk_blob *blob, uint64_t io_unit)
 	}
 }
 
+/* Given an io unit offset into a blob, look up the partial cluster it is in,
+ * NULL if its cluster is fully written. The cluster must be allocated.
+ */
+static inline struct spdk_blob_partial_cluster *
+bs_io_unit_to_partial_cluster(struct spdk_blob *blob, uint64_t io_unit)
+{
+	struct spdk_blob_partial_table *table = blob->partial_table;
+	struct spdk_blob_partial_chunk *chunk;
+	uint64_t cluster_num;
+
+	if (spdk_likely(table == NULL)) {
+		return NULL;
+	}
+
+	cluster_num = bs_io_unit_to_cluster_number(blob, io_unit);
+	if (bs_cluster_to_extent_table_id(cluster_num) >= table->num_chunks) {
+		return NULL;
+	}
+	chunk = table->chunks[bs_cluster_to_extent_table_id(cluster_num)];
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	return chunk->clusters[cluster_num % SPDK_EXTENTS_PER_EP];
+}
+
 #endif
@@ -470,6 +470,9 @@ lvs_load(struct spdk_bs_dev *bs_dev, const struct spdk_lvs_opts *_lvs_opts,
 		bs_opts.esnap_bs_dev_create = lvs_esnap_bs_dev_create;
 		bs_opts.esnap_ctx = req->lvol_store;
 	}
+	bs_opts.recovery_progress_fn = lvs_opts.recovery_progress_fn;
+	bs_opts.recovery_progress_arg = lvs_opts.recovery_progress_arg;
+	bs_opts.background_free_rate = lvs_opts.background_free_rate;
 
 	spdk_bs_load(bs_dev, &bs_opts, lvs_load_cb, req);
 }
@@ -647,12 +650,17 @@ lvs_opts_copy(const struct spdk_lvs_opts *src, struct spdk_lvs_opts *dst)
 	SET_FIELD(num_md_pages_per_cluster_ratio);
 	SET_FIELD(opts_size);
 	SET_FIELD(esnap_bs_dev_create);
+	SET_FIELD(recovery_progress_fn);
+	SET_FIELD(recovery_progress_arg);
+	SET_FIELD(cluster_allocator);
+	SET_FIELD(cluster_extent_sz);
+	SET_FIELD(background_free_rate);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_lvs_opts) == 88, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_lvs_opts) == 116, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -671,6 +679,11 @@ setup_lvs_opts(struct spdk_bs_opts *bs_opts, struct spdk_lvs_opts *o, uint32_t t
 	bs_opts->num_md_pages = (o->num_md_pages_per_cluster_ratio * total_clusters) / 100;
 	bs_opts->esnap_bs_dev_create = o->esnap_bs_dev_create;
 	bs_opts->esnap_ctx = esnap_ctx;
+	bs_opts->cluster_allocator = o->cluster_allocator;
+	if (o->cluster_extent_sz != 0) {
+		bs_opts->cluster_extent_sz = o->cluster_extent_sz;
+	}
+	bs_opts->background_free_rate = o->background_free_rate;
 	snprintf(bs_opts->bstype.bstype, sizeof(bs_opts->bstype.bstype), "LVOLSTORE");
 }
 
@@ -21,6 +21,7 @@ static void nvme_ctrlr_identify_active_ns_async(struct nvme_active_ns_ctx *ctx);
 static int nvme_ctrlr_identify_ns_async(struct spdk_nvme_ns *ns);
 static int nvme_ctrlr_identify_ns_iocs_specific_async(struct spdk_nvme_ns *ns);
 static int nvme_ctrlr_identify_id_desc_async(struct spdk_nvme_ns *ns);
+static int nvme_ctrlr_identify_ns_fdp_async(struct spdk_nvme_ns *ns);
 static void nvme_ctrlr_init_cap(struct spdk_nvme_ctrlr *ctrlr);
 static void nvme_ctrlr_set_state(struct spdk_nvme_ctrlr *ctrlr, enum nvme_ctrlr_state state,
 				 uint64_t timeout_in_ms);
@@ -1404,6 +1405,10 @@ nvme_ctrlr_state_string(enum nvme_ctrlr_state state)
 		return "identify ns iocs specific";
 	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_IOCS_SPECIFIC:
 		return "wait for identify ns iocs specific";
+	case NVME_CTRLR_STATE_IDENTIFY_NS_FDP:
+		return "identify ns fdp";
+	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_FDP:
+		return "wait for identify ns fdp";
 	case NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES:
 		return "set supported log pages";
 	case NVME_CTRLR_STATE_SET_SUPPORTED_INTEL_LOG_PAGES:
@@ -2471,48 +2476,122 @@ nvme_ctrlr_identify_active_ns(struct spdk_nvme_ctrlr *ctrlr)
 	return 0;
 }
 
-static void
-nvme_ctrlr_identify_ns_async_done(void *arg, const struct spdk_nvme_cpl *cpl)
+/*
+ * Issue the per-namespace command of the current identify step for as many active
+ *  namespaces as the admin queue allows, rather than one namespace at a time.
+ *  Completions call back into this function to refill the window, and the controller
+ *  moves on to next_state once every active namespace has been processed.
+ */
+static int
+nvme_ctrlr_ns_identify_submit(struct spdk_nvme_ctrlr *ctrlr,
+			      int (*submit_fn)(struct spdk_nvme_ns *ns),
+			      enum nvme_ctrlr_state wait_state,
+			      enum nvme_ctrlr_state next_state)
 {
-	struct spdk_nvme_ns *ns = (struct spdk_nvme_ns *)arg;
-	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
-	uint32_t nsid;
-	int rc;
+	struct spdk_nvme_ns *ns;
+	int rc = 0;
 
-	if (spdk_nvme_cpl_is_error(cpl)) {
+	ctrlr->ns_identify.submitting = true;
+	while (ctrlr->ns_identify.next_nsid != 0 &&
+	       ctrlr->ns_identify.outstanding < NVME_MAX_OUTSTANDING_NS_IDENTIFY &&
+	       ctrlr->state != NVME_CTRLR_STATE_ERROR) {
+		ns = spdk_nvme_ctrlr_get_ns(ctrlr, ctrlr->ns_identify.next_nsid);
+		assert(ns != NULL);
+		ns->ctrlr = ctrlr;
+		ns->id = ctrlr->ns_identify.next_nsid;
+
+		ctrlr->ns_identify.next_nsid = spdk_nvme_ctrlr_get_next_active_ns(ctrlr, ns->id);
+		ctrlr->ns_identify.outstanding++;
+		/* Each submission restarts the admin timeout for this step. */
+		nvme_ctrlr_set_state_quiet(ctrlr, wait_state, ctrlr->opts.admin_timeout_ms);
+
+		rc = submit_fn(ns);
+		if (rc == 0) {
+			continue;
+		}
+
+		ctrlr->ns_identify.outstanding--;
+		if (rc == -ENOMEM && ctrlr->ns_identify.outstanding > 0) {
+			/* Out of admin requests, retry once an outstanding command completes. */
+			ctrlr->ns_identify.next_nsid = ns->id;
+			rc = 0;
+			break;
+		}
+
+		ctrlr->ns_identify.next_nsid = 0;
 		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
-		return;
+		break;
 	}
+	ctrlr->ns_identify.submitting = false;
 
-	nvme_ns_set_identify_data(ns);
+	if (ctrlr->ns_identify.next_nsid == 0 && ctrlr->ns_identify.outstanding == 0 &&
+	    ctrlr->state != NVME_CTRLR_STATE_ERROR) {
+		nvme_ctrlr_set_state(ctrlr, next_state, ctrlr->opts.admin_timeout_ms);
+	}
 
-	/* move on to the next active NS */
-	nsid = spdk_nvme_ctrlr_get_next_active_ns(ctrlr, ns->id);
-	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
-	if (ns == NULL) {
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_ID_DESCS,
-				     ctrlr->opts.admin_timeout_ms);
+	return rc;
+}
+
+static int
+nvme_ctrlr_ns_identify_start(struct spdk_nvme_ctrlr *ctrlr,
+			     int (*submit_fn)(struct spdk_nvme_ns *ns),
+			     enum nvme_ctrlr_state wait_state,
+			     enum nvme_ctrlr_state next_state)
+{
+	assert(ctrlr->ns_identify.outstanding == 0);
+
+	ctrlr->ns_identify.next_nsid = spdk_nvme_ctrlr_get_first_active_ns(ctrlr);
+	if (ctrlr->ns_identify.next_nsid != 0) {
+		nvme_ctrlr_set_state(ctrlr, wait_state, ctrlr->opts.admin_timeout_ms);
+	}
+
+	return nvme_ctrlr_ns_identify_submit(ctrlr, submit_fn, wait_state, next_state);
+}
+
+static void
+nvme_ctrlr_ns_identify_complete(struct spdk_nvme_ctrlr *ctrlr,
+				int (*submit_fn)(struct spdk_nvme_ns *ns),
+				enum nvme_ctrlr_state wait_state,
+				enum nvme_ctrlr_state next_state)
+{
+	assert(ctrlr->ns_identify.outstanding > 0);
+	ctrlr->ns_identify.outstanding--;
+
+	if (ctrlr->state == NVME_CTRLR_STATE_ERROR) {
 		return;
 	}
-	ns->ctrlr = ctrlr;
-	ns->id = nsid;
 
-	rc = nvme_ctrlr_identify_ns_async(ns);
-	if (rc) {
+	/* A submission loop further up the stack will refill the window itself. */
+	if (!ctrlr->ns_identify.submitting) {
+		nvme_ctrlr_ns_identify_submit(ctrlr, submit_fn, wait_state, next_state);
+	}
+}
+
+static void
+nvme_ctrlr_identify_ns_async_done(void *arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct spdk_nvme_ns *ns = (struct spdk_nvme_ns *)arg;
+	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		ctrlr->ns_identify.next_nsid = 0;
 		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
+	} else {
+		nvme_ns_set_identify_data(ns);
 	}
+
+	nvme_ctrlr_ns_identify_complete(ctrlr, nvme_ctrlr_identify_ns_async,
+					NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS,
+					NVME_CTRLR_STATE_IDENTIFY_ID_DESCS);
 }
 
 static int
 nvme_ctrlr_identify_ns_async(struct spdk_nvme_ns *ns)
 {
-	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
 	struct spdk_nvme_ns_data *nsdata;
 
 	nsdata = &ns->nsdata;
 
-	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS,
-			     ctrlr->opts.admin_timeout_ms);
 	return nvme_ctrlr_cmd_identify(ns->ctrlr, SPDK_NVME_IDENTIFY_NS, 0, ns->id, 0,
 				       nsdata, sizeof(*nsdata),
 				       nvme_ctrlr_identify_ns_async_done, ns);
@@ -2521,28 +2600,9 @@ nvme_ctrlr_identify_ns_async(struct spdk_nvme_ns *ns)
 static int
 nvme_ctrlr_identify_namespaces(struct spdk_nvme_ctrlr *ctrlr)
 {
-	uint32_t nsid;
-	struct spdk_nvme_ns *ns;
-	int rc;
-
-	nsid = spdk_nvme_ctrlr_get_first_active_ns(ctrlr);
-	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
-	if (ns == NULL) {
-		/* No active NS, move on to the next state */
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_ID_DESCS,
-				     ctrlr->opts.admin_timeout_ms);
-		return 0;
-	}
-
-	ns->ctrlr = ctrlr;
-	ns->id = nsid;
-
-	rc = nvme_ctrlr_identify_ns_async(ns);
-	if (rc) {
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
-	}
-
-	return rc;
+	return nvme_ctrlr_ns_identify_start(ctrlr, nvme_ctrlr_identify_ns_async,
+					    NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS,
+					    NVME_CTRLR_STATE_IDENTIFY_ID_DESCS);
 }
 
 static int
@@ -2562,7 +2622,7 @@ nvme_ctrlr_identify_namespaces_iocs_specific_next(struct spdk_nvme_ctrlr *ctrlr,
 	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
 	if (ns == NULL) {
 		/* No first/next active NS, move on to the next state */
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_FDP,
 				     ctrlr->opts.admin_timeout_ms);
 		return 0;
 	}
@@ -2573,7 +2633,7 @@ nvme_ctrlr_identify_namespaces_iocs_specific_next(struct spdk_nvme_ctrlr *ctrlr,
 		ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
 		if (ns == NULL) {
 			/* no namespace with (supported) iocs specific data found */
-			nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+			nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_FDP,
 					     ctrlr->opts.admin_timeout_ms);
 			return 0;
 		}
@@ -2644,7 +2704,7 @@ nvme_ctrlr_identify_namespaces_iocs_specific(struct spdk_nvme_ctrlr *ctrlr)
 {
 	if (!nvme_ctrlr_multi_iocs_enabled(ctrlr)) {
 		/* Multi IOCS not supported/enabled, move on to the next state */
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_FDP,
 				     ctrlr->opts.admin_timeout_ms);
 		return 0;
 	}
@@ -2652,20 +2712,293 @@ nvme_ctrlr_identify_namespaces_iocs_specific(struct spdk_nvme_ctrlr *ctrlr)
 	return nvme_ctrlr_identify_namespaces_iocs_specific_next(ctrlr, 0);
 }
 
+struct nvme_ctrlr_fdp_ctx {
+	struct spdk_nvme_ns			*ns;
+	struct nvme_fdp_endurance_group		*endgrp;
+	union spdk_nvme_feat_fdp_cdw12		fdp;
+	struct spdk_nvme_fdp_cfg_log_page	*log;
+};
+
+static void
+nvme_ctrlr_fdp_ctx_free(struct nvme_ctrlr_fdp_ctx *ctx)
+{
+	free(ctx->log);
+	free(ctx);
+}
+
+static struct nvme_fdp_endurance_group *
+nvme_ctrlr_get_fdp_endgrp(struct spdk_nvme_ctrlr *ctrlr, uint16_t endgid)
+{
+	struct nvme_fdp_endurance_group *endgrp;
+
+	TAILQ_FOREACH(endgrp, &ctrlr->fdp_endgrps, tailq) {
+		if (endgrp->endgid == endgid) {
+			return endgrp;
+		}
+	}
+
+	return NULL;
+}
+
+const struct spdk_nvme_fdp_cfg_descriptor *
+nvme_ctrlr_get_fdp_cfg(struct spdk_nvme_ctrlr *ctrlr, uint16_t endgid)
+{
+	struct nvme_fdp_endurance_group *endgrp;
+
+	endgrp = nvme_ctrlr_get_fdp_endgrp(ctrlr, endgid);
+
+	return endgrp != NULL ? endgrp->cfg : NULL;
+}
+
+static void
+nvme_ctrlr_free_fdp_data(struct spdk_nvme_ctrlr *ctrlr)
+{
+	struct nvme_fdp_endurance_group *endgrp;
+	struct spdk_nvme_ns *ns;
+
+	RB_FOREACH(ns, nvme_ns_tree, &ctrlr->ns) {
+		ns->fdp_cfg = NULL;
+	}
+
+	while ((endgrp = TAILQ_FIRST(&ctrlr->fdp_endgrps)) != NULL) {
+		TAILQ_REMOVE(&ctrlr->fdp_endgrps, endgrp, tailq);
+		free(endgrp->cfg);
+		free(endgrp);
+	}
+}
+
+/* Copy the FDP configuration selected by fdpci out of the FDP configurations log page */
+static int
+nvme_ctrlr_set_fdp_cfg(struct spdk_nvme_ctrlr *ctrlr, struct nvme_fdp_endurance_group *endgrp,
+		       const struct spdk_nvme_fdp_cfg_log_page *log, uint32_t log_size,
+		       uint8_t fdpci)
+{
+	const struct spdk_nvme_fdp_cfg_descriptor *desc;
+	uint32_t offset = sizeof(*log);
+	uint32_t i;
+
+	assert(endgrp->cfg == NULL);
+
+	log_size = spdk_min(log_size, log->size);
+
+	/* NCFG is a 0's based value */
+	for (i = 0; i <= log->ncfg; i++) {
+		desc = (const struct spdk_nvme_fdp_cfg_descriptor *)((const uint8_t *)log + offset);
+		if (offset + sizeof(*desc) > log_size || desc->ds < sizeof(*desc) ||
+		    offset + desc->ds > log_size) {
+			break;
+		}
+
+		if (i == fdpci) {
+			if (!desc->fdpa.bits.fdpcv) {
+				NVME_CTRLR_WARNLOG(ctrlr, "FDP configuration %u used by Endurance Group %u "
+						   "is not valid\n", fdpci, endgrp->endgid);
+				return -EINVAL;
+			}
+
+			endgrp->cfg = calloc(1, desc->ds);
+			if (endgrp->cfg == NULL) {
+				return -ENOMEM;
+			}
+			memcpy(endgrp->cfg, desc, desc->ds);
+
+			NVME_CTRLR_DEBUGLOG(ctrlr, "Endurance Group %u FDP configuration %u: "
+					    "%u reclaim groups, %u reclaim unit handles\n",
+					    endgrp->endgid, fdpci, desc->nrg, desc->nruh);
+			return 0;
+		}
+
+		offset += desc->ds;
+	}
+
+	NVME_CTRLR_WARNLOG(ctrlr, "FDP configuration %u used by Endurance Group %u not found\n",
+			   fdpci, endgrp->endgid);
+	return -ENOENT;
+}
+
+static int
+nvme_ctrlr_identify_namespaces_fdp_next(struct spdk_nvme_ctrlr *ctrlr, uint32_t prev_nsid)
+{
+	struct nvme_fdp_endurance_group *endgrp;
+	uint32_t nsid;
+	struct spdk_nvme_ns *ns;
+	int rc;
+
+	if (!prev_nsid) {
+		nsid = spdk_nvme_ctrlr_get_first_active_ns(ctrlr);
+	} else {
+		/* move on to the next active NS */
+		nsid = spdk_nvme_ctrlr_get_next_active_ns(ctrlr, prev_nsid);
+	}
+
+	/* loop until we find a ns which belongs to an Endurance Group not seen yet */
+	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
+	while (ns != NULL) {
+		if (nvme_ns_fdp_supported(ns)) {
+			endgrp = nvme_ctrlr_get_fdp_endgrp(ctrlr, ns->nsdata.endgid);
+			if (endgrp == NULL) {
+				break;
+			}
+			ns->fdp_cfg = endgrp->cfg;
+		}
+		nsid = spdk_nvme_ctrlr_get_next_active_ns(ctrlr, ns->id);
+		ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
+	}
+
+	if (ns == NULL) {
+		/* No first/next NS to check, move on to the next state */
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+				     ctrlr->opts.admin_timeout_ms);
+		return 0;
+	}
+
+	rc = nvme_ctrlr_identify_ns_fdp_async(ns);
+	if (rc) {
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
+	}
+
+	return rc;
+}
+
+static void
+nvme_ctrlr_identify_ns_fdp_log_done(void *arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_ctrlr_fdp_ctx *ctx = arg;
+	struct spdk_nvme_ns *ns = ctx->ns;
+	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
+	int rc;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		/* FDP is optional for the namespace users, do not fail the initialization. */
+		NVME_CTRLR_WARNLOG(ctrlr, "Failed to get FDP configurations log page for "
+				   "Endurance Group %u\n", ctx->endgrp->endgid);
+	} else {
+		rc = nvme_ctrlr_set_fdp_cfg(ctrlr, ctx->endgrp, ctx->log, NVME_FDP_CFG_LOG_PAGE_SIZE,
+					    ctx->fdp.bits.fdpci);
+		if (rc == -ENOMEM) {
+			nvme_ctrlr_fdp_ctx_free(ctx);
+			nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
+			return;
+		}
+	}
+
+	/* The remaining namespaces of the Endurance Group pick the configuration up
+	 * from the cache. */
+	ns->fdp_cfg = ctx->endgrp->cfg;
+	nvme_ctrlr_fdp_ctx_free(ctx);
+	nvme_ctrlr_identify_namespaces_fdp_next(ctrlr, ns->id);
+}
+
+static void
+nvme_ctrlr_identify_ns_fdp_feat_done(void *arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_ctrlr_fdp_ctx *ctx = arg;
+	struct spdk_nvme_ns *ns = ctx->ns;
+	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
+	int rc;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		NVME_CTRLR_WARNLOG(ctrlr, "Failed to get FDP feature for Endurance Group %u\n",
+				   ctx->endgrp->endgid);
+		goto next;
+	}
+
+	ctx->fdp.raw = cpl->cdw0;
+	if (!ctx->fdp.bits.fdpe) {
+		goto next;
+	}
+
+	ctx->log = calloc(1, NVME_FDP_CFG_LOG_PAGE_SIZE);
+	if (ctx->log == NULL) {
+		goto error;
+	}
+
+	rc = spdk_nvme_ctrlr_cmd_get_log_page_ext(ctrlr, SPDK_NVME_LOG_FDP_CONFIGURATIONS, 0,
+			ctx->log, NVME_FDP_CFG_LOG_PAGE_SIZE, 0, 0,
+			(uint32_t)ctx->endgrp->endgid << 16, 0,
+			nvme_ctrlr_identify_ns_fdp_log_done, ctx);
+	if (rc) {
+		goto error;
+	}
+
+	return;
+
+next:
+	nvme_ctrlr_fdp_ctx_free(ctx);
+	nvme_ctrlr_identify_namespaces_fdp_next(ctrlr, ns->id);
+	return;
+
+error:
+	nvme_ctrlr_fdp_ctx_free(ctx);
+	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
+}
+
+static int
+nvme_ctrlr_identify_ns_fdp_async(struct spdk_nvme_ns *ns)
+{
+	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
+	struct nvme_ctrlr_fdp_ctx *ctx;
+	union spdk_nvme_feat_fdp_cdw11 cdw11 = {};
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+	ctx->ns = ns;
+
+	/* The Endurance Group is cached even if FDP turns out to be disabled or its
+	 * configuration can't be retrieved, so that it is queried only once. */
+	ctx->endgrp = calloc(1, sizeof(*ctx->endgrp));
+	if (ctx->endgrp == NULL) {
+		free(ctx);
+		return -ENOMEM;
+	}
+	ctx->endgrp->endgid = ns->nsdata.endgid;
+	TAILQ_INSERT_TAIL(&ctrlr->fdp_endgrps, ctx->endgrp, tailq);
+
+	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_FDP,
+			     ctrlr->opts.admin_timeout_ms);
+
+	cdw11.bits.endgid = ctx->endgrp->endgid;
+	rc = spdk_nvme_ctrlr_cmd_get_feature(ctrlr, SPDK_NVME_FEAT_FDP, cdw11.raw, NULL, 0,
+					     nvme_ctrlr_identify_ns_fdp_feat_done, ctx);
+	if (rc) {
+		nvme_ctrlr_fdp_ctx_free(ctx);
+	}
+
+	return rc;
+}
+
+static int
+nvme_ctrlr_identify_namespaces_fdp(struct spdk_nvme_ctrlr *ctrlr)
+{
+	/* Drop the configurations retrieved by a previous initialization */
+	nvme_ctrlr_free_fdp_data(ctrlr);
+
+	if (!ctrlr->cdata.ctratt.fdps) {
+		/* FDP not supported, move on to the next state */
+		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES,
+				     ctrlr->opts.admin_timeout_ms);
+		return 0;
+	}
+
+	return nvme_ctrlr_identify_namespaces_fdp_next(ctrlr, 0);
+}
+
 static void
 nvme_ctrlr_identify_id_desc_async_done(void *arg, const struct spdk_nvme_cpl *cpl)
 {
 	struct spdk_nvme_ns *ns = (struct spdk_nvme_ns *)arg;
 	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
-	uint32_t nsid;
-	int rc;
 
 	if (spdk_nvme_cpl_is_error(cpl)) {
 		/*
 		 * Many controllers claim to be compatible with NVMe 1.3, however,
 		 * they do not implement NS ID Desc List. Therefore, instead of setting
 		 * the state to NVME_CTRLR_STATE_ERROR, silently ignore the completion
-		 * error and move on to the next state.
+		 * error, stop issuing further requests and move on to the next state
+		 * once the outstanding ones have completed.
 		 *
 		 * The proper way is to create a new quirk for controllers that violate
 		 * the NVMe 1.3 spec by not supporting NS ID Desc List.
@@ -2673,37 +3006,21 @@ nvme_ctrlr_identify_id_desc_async_done(void *arg, const struct spdk_nvme_cpl *cp
 		 * it is too generic and was added in order to handle controllers that
 		 * violate the NVMe 1.1 spec by not supporting ACTIVE LIST).
 		 */
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC,
-				     ctrlr->opts.admin_timeout_ms);
-		return;
-	}
-
-	nvme_ns_set_id_desc_list_data(ns);
-
-	/* move on to the next active NS */
-	nsid = spdk_nvme_ctrlr_get_next_active_ns(ctrlr, ns->id);
-	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
-	if (ns == NULL) {
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC,
-				     ctrlr->opts.admin_timeout_ms);
-		return;
+		ctrlr->ns_identify.next_nsid = 0;
+	} else {
+		nvme_ns_set_id_desc_list_data(ns);
 	}
 
-	rc = nvme_ctrlr_identify_id_desc_async(ns);
-	if (rc) {
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
-	}
+	nvme_ctrlr_ns_identify_complete(ctrlr, nvme_ctrlr_identify_id_desc_async,
+					NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS,
+					NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC);
 }
 
 static int
 nvme_ctrlr_identify_id_desc_async(struct spdk_nvme_ns *ns)
 {
-	struct spdk_nvme_ctrlr *ctrlr = ns->ctrlr;
-
 	memset(ns->id_desc_list, 0, sizeof(ns->id_desc_list));
 
-	nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS,
-			     ctrlr->opts.admin_timeout_ms);
 	return nvme_ctrlr_cmd_identify(ns->ctrlr, SPDK_NVME_IDENTIFY_NS_ID_DESCRIPTOR_LIST,
 				       0, ns->id, 0, ns->id_desc_list, sizeof(ns->id_desc_list),
 				       nvme_ctrlr_identify_id_desc_async_done, ns);
@@ -2712,10 +3029,6 @@ nvme_ctrlr_identify_id_desc_async(struct spdk_nvme_ns *ns)
 static int
 nvme_ctrlr_identify_id_desc_namespaces(struct spdk_nvme_ctrlr *ctrlr)
 {
-	uint32_t nsid;
-	struct spdk_nvme_ns *ns;
-	int rc;
-
 	if ((ctrlr->vs.raw < SPDK_NVME_VERSION(1, 3, 0) &&
 	     !(ctrlr->cap.bits.css & SPDK_NVME_CAP_CSS_IOCS)) ||
 	    (ctrlr->quirks & NVME_QUIRK_IDENTIFY_CNS)) {
@@ -2726,21 +3039,9 @@ nvme_ctrlr_identify_id_desc_namespaces(struct spdk_nvme_ctrlr *ctrlr)
 		return 0;
 	}
 
-	nsid = spdk_nvme_ctrlr_get_first_active_ns(ctrlr);
-	ns = spdk_nvme_ctrlr_get_ns(ctrlr, nsid);
-	if (ns == NULL) {
-		/* No active NS, move on to the next state */
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC,
-				     ctrlr->opts.admin_timeout_ms);
-		return 0;
-	}
-
-	rc = nvme_ctrlr_identify_id_desc_async(ns);
-	if (rc) {
-		nvme_ctrlr_set_state(ctrlr, NVME_CTRLR_STATE_ERROR, NVME_TIMEOUT_INFINITE);
-	}
-
-	return rc;
+	return nvme_ctrlr_ns_identify_start(ctrlr, nvme_ctrlr_identify_id_desc_async,
+					    NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS,
+					    NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC);
 }
 
 static void
@@ -3963,6 +4264,10 @@ nvme_ctrlr_process_init(struct spdk_nvme_ctrlr *ctrlr)
 		rc = nvme_ctrlr_identify_namespaces_iocs_specific(ctrlr);
 		break;
 
+	case NVME_CTRLR_STATE_IDENTIFY_NS_FDP:
+		rc = nvme_ctrlr_identify_namespaces_fdp(ctrlr);
+		break;
+
 	case NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES:
 		rc = nvme_ctrlr_set_supported_log_pages(ctrlr);
 		break;
@@ -4021,6 +4326,7 @@ nvme_ctrlr_process_init(struct spdk_nvme_ctrlr *ctrlr)
 	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS:
 	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS:
 	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_IOCS_SPECIFIC:
+	case NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_FDP:
 	case NVME_CTRLR_STATE_WAIT_FOR_SUPPORTED_INTEL_LOG_PAGES:
 	case NVME_CTRLR_STATE_WAIT_FOR_DB_BUF_CFG:
 	case NVME_CTRLR_STATE_WAIT_FOR_HOST_ID:
@@ -4135,6 +4441,7 @@ nvme_ctrlr_construct(struct spdk_nvme_ctrlr *ctrlr)
 	STAILQ_INIT(&ctrlr->register_operations);
 
 	RB_INIT(&ctrlr->ns);
+	TAILQ_INIT(&ctrlr->fdp_endgrps);
 
 	return rc;
 }
@@ -4236,6 +4543,8 @@ nvme_ctrlr_destruct_poll_async(struct spdk_nvme_ctrlr *ctrlr,
 	ctrlr->copied_ana_desc = NULL;
 	ctrlr->ana_log_page_size = 0;
 
+	nvme_ctrlr_free_fdp_data(ctrlr);
+
 	nvme_transport_ctrlr_destruct(ctrlr);
 
 	return rc;
@@ -411,6 +411,25 @@ spdk_nvme_ctrlr_cmd_set_feature_ns(struct spdk_nvme_ctrlr *ctrlr, uint8_t featur
 	return rc;
 }
 
+int
+spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(struct spdk_nvme_ctrlr *ctrlr,
+		uint8_t threshold, uint8_t time,
+		spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	union spdk_nvme_feat_interrupt_coalescing feat_coalescing;
+
+	if (spdk_nvme_trtype_is_fabrics(ctrlr->trid.trtype)) {
+		return -ENOTSUP;
+	}
+
+	feat_coalescing.raw = 0;
+	feat_coalescing.bits.thr = threshold;
+	feat_coalescing.bits.time = time;
+
+	return spdk_nvme_ctrlr_cmd_set_feature(ctrlr, SPDK_NVME_FEAT_INTERRUPT_COALESCING,
+					       feat_coalescing.raw, 0, NULL, 0, cb_fn, cb_arg);
+}
+
 int
 nvme_ctrlr_cmd_set_num_queues(struct spdk_nvme_ctrlr *ctrlr,
 			      uint32_t num_queues, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
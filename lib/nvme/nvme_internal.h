@@ -156,6 +156,15 @@ extern struct spdk_nvme_transport_opts g_spdk_nvme_transport_opts;
 /* Maximum log page size to fetch for AERs. */
 #define NVME_MAX_AER_LOG_SIZE		(4096)
 
+/* Size of the FDP configurations log page to fetch when identifying namespaces. */
+#define NVME_FDP_CFG_LOG_PAGE_SIZE	(4096)
+
+/*
+ * Maximum number of per-namespace Identify commands kept in flight on the
+ *  admin queue while a controller is being initialized.
+ */
+#define NVME_MAX_OUTSTANDING_NS_IDENTIFY	(8)
+
 /*
  * NVME_MAX_IO_QUEUES in nvme_spec.h defines the 64K spec-limit, but this
  *  define specifies the maximum number of queues this driver will actually
@@ -537,6 +546,13 @@ struct spdk_nvme_ns {
 	/* Zoned Namespace Command Set Specific Identify Namespace data. */
 	struct spdk_nvme_zns_ns_data	*nsdata_zns;
 
+	/*
+	 * FDP configuration descriptor in use by the namespace's Endurance Group,
+	 * NULL if Flexible Data Placement is not enabled.  Points to the controller's
+	 * cache of the Endurance Group configurations.
+	 */
+	const struct spdk_nvme_fdp_cfg_descriptor	*fdp_cfg;
+
 	RB_ENTRY(spdk_nvme_ns)		node;
 };
 
@@ -755,6 +771,16 @@ enum nvme_ctrlr_state {
 	 */
 	NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS,
 
+	/**
+	 * Get the Flexible Data Placement configuration for each NS.
+	 */
+	NVME_CTRLR_STATE_IDENTIFY_NS_FDP,
+
+	/**
+	 * Waiting for the Flexible Data Placement configuration commands to be completed.
+	 */
+	NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS_FDP,
+
 	/**
 	 * Set supported log pages of the controller.
 	 */
@@ -873,6 +899,19 @@ struct nvme_register_completion {
 	pid_t					pid;
 };
 
+/*
+ * Flexible Data Placement configuration of an Endurance Group, retrieved when the
+ * controller is initialized.
+ */
+struct nvme_fdp_endurance_group {
+	uint16_t				endgid;
+
+	/* NULL if FDP is not enabled for the Endurance Group */
+	struct spdk_nvme_fdp_cfg_descriptor	*cfg;
+
+	TAILQ_ENTRY(nvme_fdp_endurance_group)	tailq;
+};
+
 struct spdk_nvme_ctrlr {
 	/* Hot data (accessed in I/O path) starts here. */
 
@@ -976,6 +1015,16 @@ struct spdk_nvme_ctrlr {
 	/* Extra sleep time during controller initialization */
 	uint64_t			sleep_timeout_tsc;
 
+	/* FDP configurations of the Endurance Groups of the active namespaces */
+	TAILQ_HEAD(, nvme_fdp_endurance_group)	fdp_endgrps;
+
+	/* Per-namespace Identify commands issued in parallel during initialization */
+	struct {
+		uint32_t		next_nsid;
+		uint32_t		outstanding;
+		bool			submitting;
+	} ns_identify;
+
 	/** Track all the processes manage this controller */
 	TAILQ_HEAD(, spdk_nvme_ctrlr_process)	active_procs;
 
@@ -1204,6 +1253,8 @@ int	nvme_ctrlr_get_bpinfo(struct spdk_nvme_ctrlr *ctrlr, union spdk_nvme_bpinfo_
 int	nvme_ctrlr_set_bprsel(struct spdk_nvme_ctrlr *ctrlr, union spdk_nvme_bprsel_register *bprsel);
 int	nvme_ctrlr_set_bpmbl(struct spdk_nvme_ctrlr *ctrlr, uint64_t bpmbl_value);
 bool	nvme_ctrlr_multi_iocs_enabled(struct spdk_nvme_ctrlr *ctrlr);
+const struct spdk_nvme_fdp_cfg_descriptor *nvme_ctrlr_get_fdp_cfg(struct spdk_nvme_ctrlr *ctrlr,
+		uint16_t endgid);
 void    nvme_ctrlr_process_async_event(struct spdk_nvme_ctrlr *ctrlr,
 				       const struct spdk_nvme_cpl *cpl);
 void nvme_ctrlr_disconnect_qpair(struct spdk_nvme_qpair *qpair);
@@ -1227,6 +1278,7 @@ void	nvme_ns_set_id_desc_list_data(struct spdk_nvme_ns *ns);
 void	nvme_ns_free_zns_specific_data(struct spdk_nvme_ns *ns);
 void	nvme_ns_free_iocs_specific_data(struct spdk_nvme_ns *ns);
 bool	nvme_ns_has_supported_iocs_specific_data(struct spdk_nvme_ns *ns);
+bool	nvme_ns_fdp_supported(struct spdk_nvme_ns *ns);
 int	nvme_ns_construct(struct spdk_nvme_ns *ns, uint32_t id,
 			  struct spdk_nvme_ctrlr *ctrlr);
 void	nvme_ns_destruct(struct spdk_nvme_ns *ns);
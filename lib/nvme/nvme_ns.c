@@ -498,6 +498,18 @@ nvme_ns_has_supported_iocs_specific_data(struct spdk_nvme_ns *ns)
 	}
 }
 
+bool
+nvme_ns_fdp_supported(struct spdk_nvme_ns *ns)
+{
+	return ns->ctrlr->cdata.ctratt.fdps && ns->nsdata.endgid != 0;
+}
+
+const struct spdk_nvme_fdp_cfg_descriptor *
+spdk_nvme_ns_get_fdp_cfg(const struct spdk_nvme_ns *ns)
+{
+	return ns->fdp_cfg;
+}
+
 uint32_t
 spdk_nvme_ns_get_ana_group_id(const struct spdk_nvme_ns *ns)
 {
@@ -545,6 +557,12 @@ nvme_ns_construct(struct spdk_nvme_ns *ns, uint32_t id,
 		}
 	}
 
+	/* The FDP configuration of the Endurance Group was retrieved when the controller
+	 * was initialized. */
+	if (nvme_ns_fdp_supported(ns)) {
+		ns->fdp_cfg = nvme_ctrlr_get_fdp_cfg(ctrlr, ns->nsdata.endgid);
+	}
+
 	return 0;
 }
 
@@ -561,6 +579,7 @@ nvme_ns_destruct(struct spdk_nvme_ns *ns)
 	memset(nsdata, 0, sizeof(*nsdata));
 	memset(ns->id_desc_list, 0, sizeof(ns->id_desc_list));
 	nvme_ns_free_iocs_specific_data(ns);
+	ns->fdp_cfg = NULL;
 	ns->sector_size = 0;
 	ns->extended_lba_size = 0;
 	ns->md_size = 0;
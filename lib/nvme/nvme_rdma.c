@@ -31,7 +31,8 @@
 /*
  * NVME RDMA qpair Resource Defaults
  */
-#define NVME_RDMA_DEFAULT_TX_SGE		2
+/* One send SGE for the command, the others for in-capsule data in separate buffers */
+#define NVME_RDMA_DEFAULT_TX_SGE		4
 #define NVME_RDMA_DEFAULT_RX_SGE		1
 
 /* Max number of NVMe-oF SGL descriptors supported by the host */
@@ -1600,6 +1601,15 @@ nvme_rdma_build_contig_request(struct nvme_rdma_qpair *rqpair,
 	return 0;
 }
 
+static inline bool
+nvme_rdma_keyed_sgl_mergeable(const struct spdk_nvme_sgl_descriptor *sgl,
+			      const struct nvme_rdma_memory_translation_ctx *ctx)
+{
+	return sgl->keyed.key == ctx->rkey &&
+	       sgl->address + sgl->keyed.length == (uint64_t)ctx->addr &&
+	       sgl->keyed.length + ctx->length <= NVME_RDMA_MAX_KEYED_SGL_LENGTH;
+}
+
 /*
  * Build SGL describing scattered payload buffer.
  */
@@ -1643,13 +1653,21 @@ nvme_rdma_build_sgl_request(struct nvme_rdma_qpair *rqpair,
 			return -1;
 		}
 
+		remaining_size -= ctx.length;
+
+		/* Buffers adjacent within the same memory region share one descriptor. */
+		if (num_sgl_desc > 0 &&
+		    nvme_rdma_keyed_sgl_mergeable(&cmd->sgl[num_sgl_desc - 1], &ctx)) {
+			cmd->sgl[num_sgl_desc - 1].keyed.length += (uint32_t)ctx.length;
+			continue;
+		}
+
 		cmd->sgl[num_sgl_desc].keyed.key = ctx.rkey;
 		cmd->sgl[num_sgl_desc].keyed.type = SPDK_NVME_SGL_TYPE_KEYED_DATA_BLOCK;
 		cmd->sgl[num_sgl_desc].keyed.subtype = SPDK_NVME_SGL_SUBTYPE_ADDRESS;
 		cmd->sgl[num_sgl_desc].keyed.length = (uint32_t)ctx.length;
 		cmd->sgl[num_sgl_desc].address = (uint64_t)ctx.addr;
 
-		remaining_size -= ctx.length;
 		num_sgl_desc++;
 	} while (remaining_size > 0 && num_sgl_desc < max_num_sgl);
 
@@ -1713,7 +1731,10 @@ nvme_rdma_build_sgl_inline_request(struct nvme_rdma_qpair *rqpair,
 {
 	struct nvme_request *req = rdma_req->req;
 	struct nvme_rdma_memory_translation_ctx ctx;
+	struct ibv_sge *sge;
+	uint32_t remaining_size;
 	uint32_t length;
+	uint32_t max_num_sge, num_sge;
 	int rc;
 
 	assert(req->payload_size != 0);
@@ -1722,31 +1743,44 @@ nvme_rdma_build_sgl_inline_request(struct nvme_rdma_qpair *rqpair,
 	assert(req->payload.next_sge_fn != NULL);
 	req->payload.reset_sgl_fn(req->payload.contig_or_cb_arg, req->payload_offset);
 
-	rc = req->payload.next_sge_fn(req->payload.contig_or_cb_arg, &ctx.addr, &length);
-	if (rc) {
-		return -1;
-	}
+	max_num_sge = spdk_min(rqpair->max_send_sge, NVME_RDMA_DEFAULT_TX_SGE);
+	remaining_size = req->payload_size;
+	/* The first element is reserved for the command capsule. */
+	num_sge = 1;
+	do {
+		rc = req->payload.next_sge_fn(req->payload.contig_or_cb_arg, &ctx.addr, &length);
+		if (rc) {
+			return -1;
+		}
 
-	if (length < req->payload_size) {
-		SPDK_DEBUGLOG(nvme, "Inline SGL request split so sending separately.\n");
-		return nvme_rdma_build_sgl_request(rqpair, rdma_req);
-	}
+		ctx.length = spdk_min(remaining_size, length);
+		rc = nvme_rdma_get_memory_translation(req, rqpair, &ctx);
+		if (spdk_unlikely(rc)) {
+			return -1;
+		}
 
-	if (length > req->payload_size) {
-		length = req->payload_size;
-	}
+		/* Buffers adjacent within the same memory region share one SGE. */
+		sge = &rdma_req->send_sgl[num_sge - 1];
+		if (num_sge > 1 && sge->lkey == ctx.lkey &&
+		    sge->addr + sge->length == (uint64_t)ctx.addr) {
+			sge->length += (uint32_t)ctx.length;
+		} else {
+			if (num_sge >= max_num_sge) {
+				SPDK_DEBUGLOG(nvme, "Inline SGL request split so sending separately.\n");
+				return nvme_rdma_build_sgl_request(rqpair, rdma_req);
+			}
 
-	ctx.length = length;
-	rc = nvme_rdma_get_memory_translation(req, rqpair, &ctx);
-	if (spdk_unlikely(rc)) {
-		return -1;
-	}
+			sge = &rdma_req->send_sgl[num_sge++];
+			sge->addr = (uint64_t)ctx.addr;
+			sge->length = (uint32_t)ctx.length;
+			sge->lkey = ctx.lkey;
+		}
 
-	rdma_req->send_sgl[1].addr = (uint64_t)ctx.addr;
-	rdma_req->send_sgl[1].length = (uint32_t)ctx.length;
-	rdma_req->send_sgl[1].lkey = ctx.lkey;
+		remaining_size -= ctx.length;
+	} while (remaining_size > 0);
 
-	rdma_req->send_wr.num_sge = 2;
+	/* The RDMA SGL contains the command followed by the in-capsule data elements. */
+	rdma_req->send_wr.num_sge = num_sge;
 
 	/* The first element of this SGL is pointing at an
 	 * spdk_nvmf_cmd object. For this particular command,
@@ -1757,7 +1791,7 @@ nvme_rdma_build_sgl_inline_request(struct nvme_rdma_qpair *rqpair,
 	req->cmd.psdt = SPDK_NVME_PSDT_SGL_MPTR_CONTIG;
 	req->cmd.dptr.sgl1.unkeyed.type = SPDK_NVME_SGL_TYPE_DATA_BLOCK;
 	req->cmd.dptr.sgl1.unkeyed.subtype = SPDK_NVME_SGL_SUBTYPE_OFFSET;
-	req->cmd.dptr.sgl1.unkeyed.length = (uint32_t)ctx.length;
+	req->cmd.dptr.sgl1.unkeyed.length = req->payload_size;
 	/* Inline only supported for icdoff == 0 currently.  This function will
 	 * not get called for controllers with other values. */
 	req->cmd.dptr.sgl1.address = (uint64_t)0;
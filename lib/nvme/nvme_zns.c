@@ -253,3 +253,495 @@ spdk_nvme_zns_set_zone_desc_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair
 
 	return nvme_qpair_submit_request(qpair, req);
 }
+
+#define NVME_ZNS_STREAM_DEFAULT_OPEN_ZONES	4
+#define NVME_ZNS_STREAM_DEFAULT_QD_PER_ZONE	16
+
+enum nvme_zns_stream_zone_state {
+	/* Slot not bound to any zone */
+	NVME_ZNS_STREAM_ZONE_FREE,
+	/* Zone accepting new appends */
+	NVME_ZNS_STREAM_ZONE_ACTIVE,
+	/* Zone not accepting appends, waiting for the outstanding ones */
+	NVME_ZNS_STREAM_ZONE_RETIRING,
+	/* Zone finish command outstanding */
+	NVME_ZNS_STREAM_ZONE_FINISHING,
+};
+
+struct nvme_zns_stream_zone {
+	struct spdk_nvme_zns_stream		*stream;
+	enum nvme_zns_stream_zone_state		state;
+	uint64_t				slba;
+	/* Sectors handed out to submitted appends */
+	uint64_t				reserved;
+	/* Sectors written by completed appends */
+	uint64_t				written;
+	uint32_t				outstanding;
+};
+
+struct nvme_zns_stream_req {
+	struct nvme_zns_stream_zone		*zone;
+	void					*buffer;
+	void					*metadata;
+	uint32_t				lba_count;
+	uint32_t				io_flags;
+	spdk_nvme_zns_stream_cb			cb_fn;
+	void					*cb_arg;
+	STAILQ_ENTRY(nvme_zns_stream_req)	stailq;
+};
+
+struct spdk_nvme_zns_stream {
+	struct spdk_nvme_ns			*ns;
+	struct spdk_nvme_qpair			*qpair;
+	struct spdk_nvme_zns_stream_opts	opts;
+	uint64_t				zone_size;
+	/* Index, relative to the first zone, of the next zone to start writing */
+	uint64_t				next_zone;
+	uint32_t				rr_index;
+	uint32_t				outstanding;
+	struct nvme_zns_stream_zone		*zones;
+	struct nvme_zns_stream_req		*reqs;
+	STAILQ_HEAD(, nvme_zns_stream_req)	free_reqs;
+	STAILQ_HEAD(, nvme_zns_stream_req)	queued_reqs;
+};
+
+void
+spdk_nvme_zns_stream_get_default_opts(struct spdk_nvme_ns *ns,
+				      struct spdk_nvme_zns_stream_opts *opts,
+				      size_t opts_size)
+{
+	uint32_t max_open_zones;
+
+	assert(opts);
+
+	memset(opts, 0, opts_size);
+
+#define FIELD_OK(field) \
+	offsetof(struct spdk_nvme_zns_stream_opts, field) + sizeof(opts->field) <= opts_size
+
+	if (FIELD_OK(first_zone_slba)) {
+		opts->first_zone_slba = 0;
+	}
+
+	if (FIELD_OK(num_zones)) {
+		opts->num_zones = 0;
+	}
+
+	if (FIELD_OK(max_open_zones)) {
+		opts->max_open_zones = NVME_ZNS_STREAM_DEFAULT_OPEN_ZONES;
+		max_open_zones = ns->nsdata_zns != NULL ? spdk_nvme_zns_ns_get_max_open_zones(ns) : 0;
+		if (max_open_zones != 0) {
+			opts->max_open_zones = spdk_min(opts->max_open_zones, max_open_zones);
+		}
+	}
+
+	if (FIELD_OK(max_qd_per_zone)) {
+		opts->max_qd_per_zone = NVME_ZNS_STREAM_DEFAULT_QD_PER_ZONE;
+	}
+
+	if (FIELD_OK(zone_capacity)) {
+		opts->zone_capacity = 0;
+	}
+
+#undef FIELD_OK
+}
+
+struct spdk_nvme_zns_stream *
+spdk_nvme_zns_stream_create(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+			    const struct spdk_nvme_zns_stream_opts *opts, size_t opts_size)
+{
+	struct spdk_nvme_zns_stream *stream;
+	uint64_t num_zones;
+	uint32_t i, num_reqs;
+
+	if (ns->csi != SPDK_NVME_CSI_ZNS || ns->nsdata_zns == NULL) {
+		SPDK_ERRLOG("Namespace %u is not a zoned namespace\n", ns->id);
+		return NULL;
+	}
+
+	stream = calloc(1, sizeof(*stream));
+	if (stream == NULL) {
+		return NULL;
+	}
+
+	stream->ns = ns;
+	stream->qpair = qpair;
+	stream->zone_size = spdk_nvme_zns_ns_get_zone_size_sectors(ns);
+
+	spdk_nvme_zns_stream_get_default_opts(ns, &stream->opts, sizeof(stream->opts));
+	if (opts != NULL) {
+		memcpy(&stream->opts, opts, spdk_min(opts_size, sizeof(stream->opts)));
+	}
+
+	num_zones = spdk_nvme_zns_ns_get_num_zones(ns);
+	if (stream->zone_size == 0 || stream->opts.first_zone_slba % stream->zone_size != 0 ||
+	    stream->opts.first_zone_slba / stream->zone_size >= num_zones) {
+		SPDK_ERRLOG("Invalid first zone start LBA 0x%" PRIx64 "\n", stream->opts.first_zone_slba);
+		goto err;
+	}
+
+	num_zones -= stream->opts.first_zone_slba / stream->zone_size;
+	if (stream->opts.num_zones == 0) {
+		stream->opts.num_zones = num_zones;
+	} else if (stream->opts.num_zones > num_zones) {
+		SPDK_ERRLOG("Stream zone range exceeds the namespace\n");
+		goto err;
+	}
+
+	if (stream->opts.zone_capacity == 0) {
+		stream->opts.zone_capacity = stream->zone_size;
+	} else if (stream->opts.zone_capacity > stream->zone_size) {
+		SPDK_ERRLOG("Zone capacity larger than the zone size\n");
+		goto err;
+	}
+
+	if (stream->opts.max_open_zones == 0 || stream->opts.max_qd_per_zone == 0) {
+		SPDK_ERRLOG("Invalid stream queue depth\n");
+		goto err;
+	}
+
+	stream->zones = calloc(stream->opts.max_open_zones, sizeof(*stream->zones));
+	if (stream->zones == NULL) {
+		goto err;
+	}
+
+	for (i = 0; i < stream->opts.max_open_zones; i++) {
+		stream->zones[i].stream = stream;
+		stream->zones[i].state = NVME_ZNS_STREAM_ZONE_FREE;
+	}
+
+	/* Leave room to queue as many writes as can be outstanding. */
+	num_reqs = 2 * stream->opts.max_open_zones * stream->opts.max_qd_per_zone;
+	stream->reqs = calloc(num_reqs, sizeof(*stream->reqs));
+	if (stream->reqs == NULL) {
+		goto err;
+	}
+
+	STAILQ_INIT(&stream->free_reqs);
+	STAILQ_INIT(&stream->queued_reqs);
+	for (i = 0; i < num_reqs; i++) {
+		STAILQ_INSERT_TAIL(&stream->free_reqs, &stream->reqs[i], stailq);
+	}
+
+	return stream;
+
+err:
+	free(stream->zones);
+	free(stream);
+	return NULL;
+}
+
+static int nvme_zns_stream_release_zone(struct nvme_zns_stream_zone *zone);
+
+int
+spdk_nvme_zns_stream_free(struct spdk_nvme_zns_stream *stream)
+{
+	struct nvme_zns_stream_zone *zone;
+	uint32_t i;
+	int rc;
+
+	if (stream == NULL) {
+		return 0;
+	}
+
+	if (stream->outstanding != 0 || !STAILQ_EMPTY(&stream->queued_reqs)) {
+		return -EBUSY;
+	}
+
+	for (i = 0; i < stream->opts.max_open_zones; i++) {
+		zone = &stream->zones[i];
+
+		/* The finish of this zone could not be submitted, the zone is still open. */
+		if (zone->state == NVME_ZNS_STREAM_ZONE_RETIRING) {
+			rc = nvme_zns_stream_release_zone(zone);
+			if (rc != 0) {
+				return rc;
+			}
+		}
+
+		if (zone->state == NVME_ZNS_STREAM_ZONE_FINISHING) {
+			return -EBUSY;
+		}
+	}
+
+	free(stream->reqs);
+	free(stream->zones);
+	free(stream);
+
+	return 0;
+}
+
+static void nvme_zns_stream_submit_queued(struct spdk_nvme_zns_stream *stream);
+
+static void
+nvme_zns_stream_finish_done(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_zns_stream_zone *zone = cb_arg;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		SPDK_ERRLOG("Failed to finish zone 0x%" PRIx64 "\n", zone->slba);
+	}
+
+	assert(zone->state == NVME_ZNS_STREAM_ZONE_FINISHING);
+	zone->state = NVME_ZNS_STREAM_ZONE_FREE;
+
+	nvme_zns_stream_submit_queued(zone->stream);
+}
+
+/*
+ * Called once a retiring zone has no outstanding appends left. If the zone finish
+ * cannot be submitted, the zone is left retiring and the finish is retried by the
+ * next write or by freeing the stream.
+ */
+static int
+nvme_zns_stream_release_zone(struct nvme_zns_stream_zone *zone)
+{
+	struct spdk_nvme_zns_stream *stream = zone->stream;
+	int rc;
+
+	assert(zone->state == NVME_ZNS_STREAM_ZONE_RETIRING);
+	assert(zone->outstanding == 0);
+
+	/* A zone written up to its capacity transitions to full on its own. */
+	if (zone->written == stream->opts.zone_capacity) {
+		zone->state = NVME_ZNS_STREAM_ZONE_FREE;
+		return 0;
+	}
+
+	rc = nvme_zns_zone_mgmt_send(stream->ns, stream->qpair, zone->slba, false,
+				     SPDK_NVME_ZONE_FINISH, nvme_zns_stream_finish_done, zone);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to submit zone 0x%" PRIx64 " finish: %d\n", zone->slba, rc);
+		return rc;
+	}
+
+	zone->state = NVME_ZNS_STREAM_ZONE_FINISHING;
+	return 0;
+}
+
+static int
+nvme_zns_stream_retire_zone(struct nvme_zns_stream_zone *zone)
+{
+	if (zone->state != NVME_ZNS_STREAM_ZONE_ACTIVE) {
+		return 0;
+	}
+
+	zone->state = NVME_ZNS_STREAM_ZONE_RETIRING;
+	if (zone->outstanding == 0) {
+		return nvme_zns_stream_release_zone(zone);
+	}
+
+	return 0;
+}
+
+static void
+nvme_zns_stream_start_zone(struct nvme_zns_stream_zone *zone)
+{
+	struct spdk_nvme_zns_stream *stream = zone->stream;
+
+	assert(zone->state == NVME_ZNS_STREAM_ZONE_FREE);
+
+	if (stream->next_zone >= stream->opts.num_zones) {
+		return;
+	}
+
+	/* The first append implicitly opens the zone. */
+	zone->state = NVME_ZNS_STREAM_ZONE_ACTIVE;
+	zone->slba = stream->opts.first_zone_slba + stream->next_zone * stream->zone_size;
+	zone->reserved = 0;
+	zone->written = 0;
+	stream->next_zone++;
+}
+
+static struct nvme_zns_stream_zone *
+nvme_zns_stream_get_zone(struct spdk_nvme_zns_stream *stream, uint32_t lba_count, int *rc)
+{
+	struct nvme_zns_stream_zone *zone;
+	uint32_t i, idx;
+	bool active = false;
+
+	for (i = 0; i < stream->opts.max_open_zones; i++) {
+		idx = (stream->rr_index + i) % stream->opts.max_open_zones;
+		zone = &stream->zones[idx];
+
+		if (zone->state == NVME_ZNS_STREAM_ZONE_RETIRING && zone->outstanding == 0) {
+			/* Retry the zone finish that could not be submitted. */
+			*rc = nvme_zns_stream_release_zone(zone);
+		} else if (zone->state == NVME_ZNS_STREAM_ZONE_ACTIVE &&
+			   zone->reserved + lba_count > stream->opts.zone_capacity) {
+			*rc = nvme_zns_stream_retire_zone(zone);
+		}
+
+		if (*rc != 0) {
+			return NULL;
+		}
+
+		if (zone->state == NVME_ZNS_STREAM_ZONE_FREE) {
+			nvme_zns_stream_start_zone(zone);
+		}
+
+		if (zone->state != NVME_ZNS_STREAM_ZONE_ACTIVE) {
+			continue;
+		}
+
+		active = true;
+		if (zone->outstanding >= stream->opts.max_qd_per_zone) {
+			continue;
+		}
+
+		stream->rr_index = (idx + 1) % stream->opts.max_open_zones;
+		return zone;
+	}
+
+	if (!active && stream->next_zone >= stream->opts.num_zones) {
+		*rc = -ENOSPC;
+	} else {
+		*rc = -EAGAIN;
+	}
+
+	return NULL;
+}
+
+static void
+nvme_zns_stream_append_done(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_zns_stream_req *req = cb_arg;
+	struct nvme_zns_stream_zone *zone = req->zone;
+	struct spdk_nvme_zns_stream *stream = zone->stream;
+	spdk_nvme_zns_stream_cb cb_fn = req->cb_fn;
+	void *req_cb_arg = req->cb_arg;
+	uint64_t lba = 0;
+
+	assert(zone->outstanding > 0);
+	zone->outstanding--;
+	stream->outstanding--;
+
+	if (spdk_nvme_cpl_is_success(cpl)) {
+		zone->written += req->lba_count;
+		lba = (uint64_t)cpl->cdw1 << 32 | cpl->cdw0;
+	} else {
+		/* The zone state is unknown after a failed append, stop using it. */
+		nvme_zns_stream_retire_zone(zone);
+	}
+
+	/* A failed finish submission is retried when the stream looks for a zone. */
+	if (zone->state == NVME_ZNS_STREAM_ZONE_RETIRING && zone->outstanding == 0) {
+		nvme_zns_stream_release_zone(zone);
+	}
+
+	STAILQ_INSERT_HEAD(&stream->free_reqs, req, stailq);
+
+	cb_fn(req_cb_arg, lba, cpl);
+
+	nvme_zns_stream_submit_queued(stream);
+}
+
+static int
+nvme_zns_stream_submit(struct spdk_nvme_zns_stream *stream, struct nvme_zns_stream_req *req)
+{
+	struct nvme_zns_stream_zone *zone;
+	int rc = 0;
+
+	zone = nvme_zns_stream_get_zone(stream, req->lba_count, &rc);
+	if (zone == NULL) {
+		return rc;
+	}
+
+	rc = nvme_ns_cmd_zone_append_with_md(stream->ns, stream->qpair, req->buffer, req->metadata,
+					     zone->slba, req->lba_count, nvme_zns_stream_append_done,
+					     req, req->io_flags, 0, 0);
+	if (rc != 0) {
+		return rc;
+	}
+
+	req->zone = zone;
+	zone->reserved += req->lba_count;
+	zone->outstanding++;
+	stream->outstanding++;
+
+	/* No room left for another append, stop using the zone once this one completes. */
+	if (zone->reserved == stream->opts.zone_capacity) {
+		nvme_zns_stream_retire_zone(zone);
+	}
+
+	return 0;
+}
+
+static void
+nvme_zns_stream_complete_queued(struct nvme_zns_stream_req *req, int rc)
+{
+	struct spdk_nvme_cpl cpl = {};
+
+	if (rc == -ENOSPC) {
+		cpl.status.sct = SPDK_NVME_SCT_COMMAND_SPECIFIC;
+		cpl.status.sc = SPDK_NVME_SC_ZONE_IS_FULL;
+	} else {
+		cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+		cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+	}
+
+	req->cb_fn(req->cb_arg, 0, &cpl);
+}
+
+static void
+nvme_zns_stream_submit_queued(struct spdk_nvme_zns_stream *stream)
+{
+	struct nvme_zns_stream_req *req;
+	int rc;
+
+	while ((req = STAILQ_FIRST(&stream->queued_reqs)) != NULL) {
+		rc = nvme_zns_stream_submit(stream, req);
+		if (rc == -EAGAIN || (rc == -ENOMEM && stream->outstanding > 0)) {
+			break;
+		}
+
+		STAILQ_REMOVE_HEAD(&stream->queued_reqs, stailq);
+		if (rc != 0) {
+			STAILQ_INSERT_HEAD(&stream->free_reqs, req, stailq);
+			nvme_zns_stream_complete_queued(req, rc);
+		}
+	}
+}
+
+int
+spdk_nvme_zns_stream_write(struct spdk_nvme_zns_stream *stream, void *buffer, void *metadata,
+			   uint32_t lba_count, spdk_nvme_zns_stream_cb cb_fn, void *cb_arg,
+			   uint32_t io_flags)
+{
+	struct nvme_zns_stream_req *req;
+	int rc;
+
+	if (lba_count == 0 || lba_count > stream->opts.zone_capacity) {
+		return -EINVAL;
+	}
+
+	req = STAILQ_FIRST(&stream->free_reqs);
+	if (req == NULL) {
+		return -ENOMEM;
+	}
+
+	req->buffer = buffer;
+	req->metadata = metadata;
+	req->lba_count = lba_count;
+	req->io_flags = io_flags;
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->zone = NULL;
+
+	/* Keep the submission order of the writes waiting for a zone. */
+	if (!STAILQ_EMPTY(&stream->queued_reqs)) {
+		rc = -EAGAIN;
+	} else {
+		rc = nvme_zns_stream_submit(stream, req);
+	}
+
+	if (rc == 0 || rc == -EAGAIN) {
+		STAILQ_REMOVE_HEAD(&stream->free_reqs, stailq);
+		if (rc == -EAGAIN) {
+			STAILQ_INSERT_TAIL(&stream->queued_reqs, req, stailq);
+		}
+		return 0;
+	}
+
+	return rc;
+}
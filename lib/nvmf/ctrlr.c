@@ -13,6 +13,7 @@
 #include "spdk/bdev_zone.h"
 #include "spdk/bit_array.h"
 #include "spdk/endian.h"
+#include "spdk/histogram_data.h"
 #include "spdk/thread.h"
 #include "spdk/nvme_spec.h"
 #include "spdk/nvmf_cmd.h"
@@ -948,8 +949,9 @@ nvmf_ctrlr_cmd_connect(struct spdk_nvmf_request *req)
 	}
 
 	if ((subsystem->state == SPDK_NVMF_SUBSYSTEM_INACTIVE) ||
-	    (subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSING) ||
-	    (subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED) ||
+	    ((subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSING ||
+	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED) &&
+	     !nvmf_subsystem_is_ns_paused(subsystem)) ||
 	    (subsystem->state == SPDK_NVMF_SUBSYSTEM_DEACTIVATING)) {
 		struct spdk_nvmf_subsystem_poll_group *sgroup;
 
@@ -2250,115 +2252,135 @@ nvmf_get_error_log_page(struct spdk_nvmf_ctrlr *ctrlr, struct iovec *iovs, int i
 	/* TODO: actually fill out log page data */
 }
 
-static void
-nvmf_get_ana_log_page(struct spdk_nvmf_ctrlr *ctrlr, struct iovec *iovs, int iovcnt,
-		      uint64_t offset, uint32_t length, uint32_t rae)
+/*
+ * Builds the ANA log page reported to the controllers connected through a listener. Without
+ * a listener, every ANA group is reported inaccessible.
+ */
+struct nvmf_ana_log_page *
+nvmf_ctrlr_build_ana_log_page(struct spdk_nvmf_subsystem *subsystem,
+			      const struct spdk_nvmf_subsystem_listener *listener)
 {
-	struct spdk_nvme_ana_page ana_hdr;
-	struct spdk_nvme_ana_group_descriptor ana_desc;
-	size_t copy_len, copied_len;
-	uint32_t num_anagrp = 0, anagrpid;
+	struct spdk_nvme_ana_page *ana_hdr;
+	struct spdk_nvme_ana_group_descriptor *ana_desc;
 	struct spdk_nvmf_ns *ns;
-	struct spdk_iov_xfer ix;
-
-	spdk_iov_xfer_init(&ix, iovs, iovcnt);
-
-	if (length == 0) {
-		goto done;
-	}
-
-	if (offset >= sizeof(ana_hdr)) {
-		offset -= sizeof(ana_hdr);
-	} else {
-		for (anagrpid = 1; anagrpid <= ctrlr->subsys->max_nsid; anagrpid++) {
-			if (ctrlr->subsys->ana_group[anagrpid - 1] > 0) {
-				num_anagrp++;
-			}
+	struct nvmf_ana_log_page *page;
+	uint32_t anagrpid, num_anagrp = 0, num_ns = 0;
+	size_t len;
+	uint8_t *pos;
+
+	for (anagrpid = 1; anagrpid <= subsystem->max_nsid; anagrpid++) {
+		if (subsystem->ana_group[anagrpid - 1] > 0) {
+			num_anagrp++;
+			num_ns += subsystem->ana_group[anagrpid - 1];
 		}
-
-		memset(&ana_hdr, 0, sizeof(ana_hdr));
-
-		ana_hdr.num_ana_group_desc = num_anagrp;
-		/* TODO: Support Change Count. */
-		ana_hdr.change_count = 0;
-
-		copy_len = spdk_min(sizeof(ana_hdr) - offset, length);
-		copied_len = spdk_iov_xfer_from_buf(&ix, (const char *)&ana_hdr + offset, copy_len);
-		assert(copied_len == copy_len);
-		length -= copied_len;
-		offset = 0;
 	}
 
-	if (length == 0) {
-		goto done;
+	len = sizeof(*ana_hdr) + num_anagrp * sizeof(*ana_desc) + num_ns * sizeof(uint32_t);
+	page = calloc(1, sizeof(*page) + len);
+	if (page == NULL) {
+		return NULL;
 	}
 
-	for (anagrpid = 1; anagrpid <= ctrlr->subsys->max_nsid; anagrpid++) {
-		if (ctrlr->subsys->ana_group[anagrpid - 1] == 0) {
+	ana_hdr = (struct spdk_nvme_ana_page *)page->data;
+	ana_hdr->change_count = listener != NULL ? listener->ana_state_change_count : 0;
+	ana_hdr->num_ana_group_desc = num_anagrp;
+	pos = page->data + sizeof(*ana_hdr);
+
+	for (anagrpid = 1; anagrpid <= subsystem->max_nsid; anagrpid++) {
+		if (subsystem->ana_group[anagrpid - 1] == 0) {
 			continue;
 		}
 
-		if (offset >= sizeof(ana_desc)) {
-			offset -= sizeof(ana_desc);
+		ana_desc = (struct spdk_nvme_ana_group_descriptor *)pos;
+		ana_desc->ana_group_id = anagrpid;
+		ana_desc->num_of_nsid = subsystem->ana_group[anagrpid - 1];
+		if (!subsystem->flags.ana_reporting) {
+			ana_desc->ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+		} else if (listener == NULL) {
+			ana_desc->ana_state = SPDK_NVME_ANA_INACCESSIBLE_STATE;
 		} else {
-			memset(&ana_desc, 0, sizeof(ana_desc));
-
-			ana_desc.ana_group_id = anagrpid;
-			ana_desc.num_of_nsid = ctrlr->subsys->ana_group[anagrpid - 1];
-			ana_desc.ana_state = nvmf_ctrlr_get_ana_state(ctrlr, anagrpid);
-
-			copy_len = spdk_min(sizeof(ana_desc) - offset, length);
-			copied_len = spdk_iov_xfer_from_buf(&ix, (const char *)&ana_desc + offset,
-							    copy_len);
-			assert(copied_len == copy_len);
-			length -= copied_len;
-			offset = 0;
-
-			if (length == 0) {
-				goto done;
-			}
+			ana_desc->ana_state = listener->ana_state[anagrpid - 1];
 		}
+		pos += sizeof(*ana_desc);
 
 		/* TODO: Revisit here about O(n^2) cost if we have subsystem with
 		 * many namespaces in the future.
 		 */
-		for (ns = spdk_nvmf_subsystem_get_first_ns(ctrlr->subsys); ns != NULL;
-		     ns = spdk_nvmf_subsystem_get_next_ns(ctrlr->subsys, ns)) {
-			if (ns->anagrpid != anagrpid) {
-				continue;
+		for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
+		     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
+			if (ns->anagrpid == anagrpid) {
+				memcpy(pos, &ns->nsid, sizeof(uint32_t));
+				pos += sizeof(uint32_t);
 			}
+		}
+	}
+	assert(pos == page->data + len);
+	page->len = len;
 
-			if (offset >= sizeof(uint32_t)) {
-				offset -= sizeof(uint32_t);
-				continue;
-			}
+	return page;
+}
 
-			copy_len = spdk_min(sizeof(uint32_t) - offset, length);
-			copied_len = spdk_iov_xfer_from_buf(&ix, (const char *)&ns->nsid + offset,
-							    copy_len);
-			assert(copied_len == copy_len);
-			length -= copied_len;
-			offset = 0;
+static int
+nvmf_get_ana_log_page(struct spdk_nvmf_ctrlr *ctrlr, struct iovec *iovs, int iovcnt,
+		      uint64_t offset, uint32_t length, uint32_t rae)
+{
+	const struct nvmf_ana_log_page *page = NULL;
+	struct nvmf_ana_log_page *tmp_page = NULL;
+	size_t copy_len;
+	struct spdk_iov_xfer ix;
 
-			if (length == 0) {
-				goto done;
-			}
+	spdk_iov_xfer_init(&ix, iovs, iovcnt);
+
+	if (length == 0) {
+		goto done;
+	}
+
+	/* The page may be replaced while the namespace being added or removed is paused, but
+	 * the old one is only freed once this poll group has gone through the resume.
+	 */
+	if (ctrlr->listener != NULL) {
+		page = __atomic_load_n(&ctrlr->listener->ana_log_page, __ATOMIC_ACQUIRE);
+	}
+	if (page == NULL) {
+		/* The page could not be allocated when it was last updated */
+		tmp_page = nvmf_ctrlr_build_ana_log_page(ctrlr->subsys, ctrlr->listener);
+		if (tmp_page == NULL) {
+			return -ENOMEM;
 		}
+		page = tmp_page;
+	}
+
+	if (offset < page->len) {
+		copy_len = spdk_min(page->len - offset, length);
+		spdk_iov_xfer_from_buf(&ix, (const char *)page->data + offset, copy_len);
 	}
+	free(tmp_page);
 
 done:
 	if (!rae) {
 		nvmf_ctrlr_unmask_aen(ctrlr, SPDK_NVME_ASYNC_EVENT_ANA_CHANGE_MASK_BIT);
 	}
+
+	return 0;
 }
 
-void
-nvmf_ctrlr_ns_changed(struct spdk_nvmf_ctrlr *ctrlr, uint32_t nsid)
+struct nvmf_ctrlr_ns_changed_ctx {
+	struct spdk_nvmf_ctrlr	*ctrlr;
+	uint32_t		nsid;
+};
+
+static void
+_nvmf_ctrlr_ns_changed(void *_ctx)
 {
+	struct nvmf_ctrlr_ns_changed_ctx *ctx = _ctx;
+	struct spdk_nvmf_ctrlr *ctrlr = ctx->ctrlr;
+	uint32_t nsid = ctx->nsid;
 	uint16_t max_changes = SPDK_COUNTOF(ctrlr->changed_ns_list.ns_list);
 	uint16_t i;
 	bool found = false;
 
+	free(ctx);
+
 	for (i = 0; i < ctrlr->changed_ns_list_count; i++) {
 		if (ctrlr->changed_ns_list.ns_list[i] == nsid) {
 			/* nsid is already in the list */
@@ -2380,6 +2402,27 @@ nvmf_ctrlr_ns_changed(struct spdk_nvmf_ctrlr *ctrlr, uint32_t nsid)
 	}
 }
 
+/*
+ * Namespaces may be added or removed while only they are paused, so admin commands keep running.
+ * The changed namespace list is read and cleared by Get Log Page on the controller's thread, so
+ * it is only updated there as well.
+ */
+void
+nvmf_ctrlr_ns_changed(struct spdk_nvmf_ctrlr *ctrlr, uint32_t nsid)
+{
+	struct nvmf_ctrlr_ns_changed_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Unable to record the change of namespace %u\n", nsid);
+		return;
+	}
+	ctx->ctrlr = ctrlr;
+	ctx->nsid = nsid;
+
+	spdk_thread_send_msg(ctrlr->thread, _nvmf_ctrlr_ns_changed, ctx);
+}
+
 static void
 nvmf_get_changed_ns_list_log_page(struct spdk_nvmf_ctrlr *ctrlr,
 				  struct iovec *iovs, int iovcnt, uint64_t offset, uint32_t length, uint32_t rae)
@@ -2596,7 +2639,10 @@ nvmf_ctrlr_get_log_page(struct spdk_nvmf_request *req)
 			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 		case SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS:
 			if (subsystem->flags.ana_reporting) {
-				nvmf_get_ana_log_page(ctrlr, req->iov, req->iovcnt, offset, len, rae);
+				if (nvmf_get_ana_log_page(ctrlr, req->iov, req->iovcnt, offset, len, rae) != 0) {
+					response->status.sct = SPDK_NVME_SCT_GENERIC;
+					response->status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+				}
 				return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 			} else {
 				goto invalid_log_page;
@@ -2666,7 +2712,13 @@ spdk_nvmf_ctrlr_identify_ns(struct spdk_nvmf_ctrlr *ctrlr,
 		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 	}
 
-	nvmf_bdev_ctrlr_identify_ns(ns, nsdata, ctrlr->dif_insert_or_strip);
+	/* DIF insert/strip only changes the data of namespaces with metadata */
+	if (ns->identify_data != NULL &&
+	    (!ctrlr->dif_insert_or_strip || ns->identify_data->lbaf[0].ms == 0)) {
+		memcpy(nsdata, ns->identify_data, sizeof(*nsdata));
+	} else {
+		nvmf_bdev_ctrlr_identify_ns(ns, nsdata, ctrlr->dif_insert_or_strip);
+	}
 
 	assert(ctrlr->admin_qpair);
 
@@ -4356,6 +4408,64 @@ spdk_nvmf_request_free(struct spdk_nvmf_request *req)
 	return 0;
 }
 
+/*
+ * The request may already be reused once the transport completed it, so everything the statistics
+ * need is captured by the caller before that.
+ */
+static void
+nvmf_qpair_update_ns_io_stat(struct spdk_nvmf_qpair *qpair,
+			     struct spdk_nvmf_subsystem_poll_group *sgroup, uint32_t nsid,
+			     uint8_t opc, uint32_t length, bool success, uint64_t latency_tsc)
+{
+	struct spdk_nvmf_ns_io_stat *stat, **ns_io_stats;
+
+	stat = nsid <= qpair->num_ns_io_stats ? qpair->ns_io_stats[nsid - 1] : NULL;
+	if (spdk_unlikely(stat == NULL)) {
+		stat = nvmf_poll_group_get_ns_io_stat(sgroup, nsid, qpair->ctrlr->hostnqn);
+		if (stat == NULL) {
+			return;
+		}
+
+		/* The subsystem may have grown since the array was allocated */
+		if (nsid > qpair->num_ns_io_stats) {
+			ns_io_stats = realloc(qpair->ns_io_stats, sgroup->num_ns * sizeof(*ns_io_stats));
+			if (ns_io_stats != NULL) {
+				memset(&ns_io_stats[qpair->num_ns_io_stats], 0,
+				       (sgroup->num_ns - qpair->num_ns_io_stats) * sizeof(*ns_io_stats));
+				qpair->ns_io_stats = ns_io_stats;
+				qpair->num_ns_io_stats = sgroup->num_ns;
+			}
+		}
+		if (nsid <= qpair->num_ns_io_stats) {
+			qpair->ns_io_stats[nsid - 1] = stat;
+		}
+	}
+
+	switch (opc) {
+	case SPDK_NVME_OPC_READ:
+		stat->num_read_ops++;
+		if (spdk_likely(success)) {
+			stat->bytes_read += length;
+		}
+		break;
+	case SPDK_NVME_OPC_WRITE:
+		stat->num_write_ops++;
+		if (spdk_likely(success)) {
+			stat->bytes_written += length;
+		}
+		break;
+	default:
+		stat->num_other_ops++;
+		break;
+	}
+
+	if (spdk_unlikely(!success)) {
+		stat->num_errors++;
+	}
+
+	spdk_histogram_data_tally(stat->latency, latency_tsc);
+}
+
 static void
 _nvmf_request_complete(void *ctx)
 {
@@ -4368,20 +4478,28 @@ _nvmf_request_complete(void *ctx)
 	uint32_t nsid;
 	bool paused;
 	uint8_t opcode;
+	uint8_t opc;
+	uint32_t length;
+	bool success;
+	uint64_t latency_tsc = 0;
 
 	rsp->sqid = 0;
 	rsp->status.p = 0;
 	rsp->cid = req->cmd->nvme_cmd.cid;
 	nsid = req->cmd->nvme_cmd.nsid;
 	opcode = req->cmd->nvmf_cmd.opcode;
+	opc = req->cmd->nvme_cmd.opc;
+	length = req->length;
+	success = !spdk_nvme_cpl_is_error(rsp);
 
 	qpair = req->qpair;
 	if (qpair->ctrlr) {
 		sgroup = &qpair->group->sgroups[qpair->ctrlr->subsys->id];
 		assert(sgroup != NULL);
-		is_aer = req->cmd->nvme_cmd.opc == SPDK_NVME_OPC_ASYNC_EVENT_REQUEST;
+		is_aer = opc == SPDK_NVME_OPC_ASYNC_EVENT_REQUEST;
 		if (spdk_likely(qpair->qid != 0)) {
 			qpair->group->stat.completed_nvme_io++;
+			latency_tsc = spdk_get_ticks() - req->exec_tsc;
 		}
 
 		/*
@@ -4443,7 +4561,20 @@ _nvmf_request_complete(void *ctx)
 
 				/* NOTE: This implicitly also checks for 0, since 0 - 1 wraps around to UINT32_MAX. */
 				if (spdk_likely(nsid - 1 < sgroup->num_ns)) {
-					sgroup->ns_info[nsid - 1].io_outstanding--;
+					ns_info = &sgroup->ns_info[nsid - 1];
+					ns_info->io_outstanding--;
+					nvmf_qpair_update_ns_io_stat(qpair, sgroup, nsid, opc, length, success,
+								     latency_tsc);
+
+					/* Only this namespace is being paused, see nvmf_poll_group_pause_subsystem() */
+					if (spdk_unlikely(ns_info->state == SPDK_NVMF_SUBSYSTEM_PAUSING &&
+							  sgroup->state == SPDK_NVMF_SUBSYSTEM_ACTIVE &&
+							  ns_info->io_outstanding == 0)) {
+						ns_info->state = SPDK_NVMF_SUBSYSTEM_PAUSED;
+						sgroup->cb_fn(sgroup->cb_arg, 0);
+						sgroup->cb_fn = NULL;
+						sgroup->cb_arg = NULL;
+					}
 				}
 			}
 		}
@@ -4535,6 +4666,15 @@ nvmf_check_subsystem_active(struct spdk_nvmf_request *req)
 				TAILQ_INSERT_TAIL(&sgroup->queued, req, link);
 				return false;
 			}
+
+			/* Admin commands addressed to a paused namespace wait for it as well */
+			nsid = req->cmd->nvme_cmd.nsid;
+			if (spdk_unlikely(req->cmd->nvmf_cmd.opcode != SPDK_NVME_OPC_FABRIC &&
+					  nsid - 1 < sgroup->num_ns &&
+					  sgroup->ns_info[nsid - 1].state != SPDK_NVMF_SUBSYSTEM_ACTIVE)) {
+				TAILQ_INSERT_TAIL(&sgroup->queued, req, link);
+				return false;
+			}
 			sgroup->mgmt_io_outstanding++;
 		} else {
 			nsid = req->cmd->nvme_cmd.nsid;
@@ -4560,6 +4700,7 @@ nvmf_check_subsystem_active(struct spdk_nvmf_request *req)
 				req->rsp->nvme_cpl.status.dnr = 1;
 				TAILQ_INSERT_TAIL(&qpair->outstanding, req, link);
 				ns_info->io_outstanding++;
+				req->exec_tsc = spdk_get_ticks();
 				_nvmf_request_complete(req);
 				return false;
 			}
@@ -4571,6 +4712,7 @@ nvmf_check_subsystem_active(struct spdk_nvmf_request *req)
 			}
 
 			ns_info->io_outstanding++;
+			req->exec_tsc = spdk_get_ticks();
 		}
 
 		if (qpair->state != SPDK_NVMF_QPAIR_ACTIVE) {
@@ -3102,6 +3102,12 @@ nvmf_fc_adm_subsystem_paused_cb(struct spdk_nvmf_subsystem *subsystem, void *cb_
 	ASSERT_SPDK_FC_MAIN_THREAD();
 	struct nvmf_fc_add_rem_listener_ctx *ctx = (struct nvmf_fc_add_rem_listener_ctx *)cb_arg;
 
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to pause subsystem: %s\n", subsystem->subnqn);
+		free(ctx);
+		return;
+	}
+
 	if (ctx->add_listener) {
 		spdk_nvmf_subsystem_add_listener(subsystem, &ctx->trid, nvmf_fc_adm_listen_done, ctx);
 	} else {
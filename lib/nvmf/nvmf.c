@@ -11,6 +11,8 @@
 #include "spdk/thread.h"
 #include "spdk/nvmf.h"
 #include "spdk/endian.h"
+#include "spdk/histogram_data.h"
+#include "spdk/crc32.h"
 #include "spdk/string.h"
 #include "spdk/log.h"
 #include "spdk_internal/usdt.h"
@@ -77,6 +79,21 @@ nvmf_poll_group_poll(void *ctx)
 	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+static void
+nvmf_poll_group_free_ns_io_stats(struct spdk_nvmf_subsystem_poll_group *sgroup)
+{
+	struct spdk_nvmf_ns_io_stat *stat;
+
+	while ((stat = TAILQ_FIRST(&sgroup->io_stats)) != NULL) {
+		TAILQ_REMOVE(&sgroup->io_stats, stat, link);
+		spdk_histogram_data_free(stat->latency);
+		free(stat);
+	}
+
+	free(sgroup->io_stats_hash);
+	sgroup->io_stats_hash = NULL;
+}
+
 /*
  * Reset and clean up the poll group (I/O channel code will actually free the
  * group).
@@ -106,6 +123,7 @@ nvmf_tgt_cleanup_poll_group(struct spdk_nvmf_poll_group *group)
 		}
 
 		free(sgroup->ns_info);
+		nvmf_poll_group_free_ns_io_stats(sgroup);
 	}
 
 	free(group->sgroups);
@@ -1180,6 +1198,11 @@ spdk_nvmf_poll_group_remove(struct spdk_nvmf_qpair *qpair)
 
 	TAILQ_REMOVE(&qpair->group->qpairs, qpair, link);
 	qpair->group = NULL;
+
+	/* The statistics themselves belong to the poll group and outlive the host's connections */
+	free(qpair->ns_io_stats);
+	qpair->ns_io_stats = NULL;
+	qpair->num_ns_io_stats = 0;
 }
 
 static void
@@ -1345,6 +1368,75 @@ spdk_nvmf_qpair_get_listen_trid(struct spdk_nvmf_qpair *qpair,
 	return nvmf_transport_qpair_get_listen_trid(qpair, trid);
 }
 
+/*
+ * Entries are kept for every host that ever did I/O to the subsystem, so that the statistics never
+ * go backwards, and looked up through a hash of the host NQN and NSID rather than the list.
+ */
+struct spdk_nvmf_ns_io_stat *
+nvmf_poll_group_get_ns_io_stat(struct spdk_nvmf_subsystem_poll_group *sgroup, uint32_t nsid,
+			       const char *hostnqn)
+{
+	struct nvmf_ns_io_stat_bucket *bucket;
+	struct spdk_nvmf_ns_io_stat *stat;
+	uint32_t hash;
+
+	if (spdk_unlikely(sgroup->io_stats_hash == NULL)) {
+		sgroup->io_stats_hash = calloc(NVMF_IO_STAT_HASH_BUCKETS, sizeof(*bucket));
+		if (sgroup->io_stats_hash == NULL) {
+			return NULL;
+		}
+	}
+
+	hash = spdk_crc32c_update(hostnqn, strlen(hostnqn), nsid);
+	bucket = &sgroup->io_stats_hash[hash % NVMF_IO_STAT_HASH_BUCKETS];
+
+	SLIST_FOREACH(stat, bucket, hash_link) {
+		if (stat->nsid == nsid && strcmp(stat->hostnqn, hostnqn) == 0) {
+			return stat;
+		}
+	}
+
+	stat = calloc(1, sizeof(*stat));
+	if (stat == NULL) {
+		return NULL;
+	}
+
+	stat->latency = spdk_histogram_data_alloc_sized(NVMF_IO_STAT_HISTOGRAM_BUCKET_SHIFT);
+	if (stat->latency == NULL) {
+		free(stat);
+		return NULL;
+	}
+
+	stat->nsid = nsid;
+	snprintf(stat->hostnqn, sizeof(stat->hostnqn), "%s", hostnqn);
+	TAILQ_INSERT_TAIL(&sgroup->io_stats, stat, link);
+	SLIST_INSERT_HEAD(bucket, stat, hash_link);
+
+	return stat;
+}
+
+/*
+ * Qpairs keep pointers to the statistics, so the ones of a removed or replaced namespace are
+ * cleared rather than freed.
+ */
+static void
+nvmf_poll_group_reset_ns_io_stats(struct spdk_nvmf_subsystem_poll_group *sgroup, uint32_t nsid)
+{
+	struct spdk_nvmf_ns_io_stat *stat;
+
+	TAILQ_FOREACH(stat, &sgroup->io_stats, link) {
+		if (stat->nsid == nsid) {
+			stat->num_read_ops = 0;
+			stat->bytes_read = 0;
+			stat->num_write_ops = 0;
+			stat->bytes_written = 0;
+			stat->num_other_ops = 0;
+			stat->num_errors = 0;
+			spdk_histogram_data_reset(stat->latency);
+		}
+	}
+}
+
 static int
 poll_group_update_subsystem(struct spdk_nvmf_poll_group *group,
 			    struct spdk_nvmf_subsystem *subsystem)
@@ -1436,6 +1528,7 @@ poll_group_update_subsystem(struct spdk_nvmf_poll_group *group,
 			ns_changed = true;
 			spdk_put_io_channel(ch);
 			ns_info->channel = NULL;
+			nvmf_poll_group_reset_ns_io_stats(sgroup, i + 1);
 		} else if (ns != NULL && ch == NULL) {
 			/* A namespace appeared but there is no channel yet */
 			ns_changed = true;
@@ -1450,6 +1543,7 @@ poll_group_update_subsystem(struct spdk_nvmf_poll_group *group,
 			ns_changed = true;
 			spdk_put_io_channel(ns_info->channel);
 			memset(ns_info, 0, sizeof(*ns_info));
+			nvmf_poll_group_reset_ns_io_stats(sgroup, i + 1);
 
 			ch = spdk_bdev_get_io_channel(ns->desc);
 			if (ch == NULL) {
@@ -1530,6 +1624,7 @@ nvmf_poll_group_add_subsystem(struct spdk_nvmf_poll_group *group,
 	uint32_t i;
 
 	TAILQ_INIT(&sgroup->queued);
+	TAILQ_INIT(&sgroup->io_stats);
 
 	rc = poll_group_update_subsystem(group, subsystem);
 	if (rc) {
@@ -1585,6 +1680,7 @@ _nvmf_poll_group_remove_subsystem_cb(void *ctx, int status)
 	sgroup->num_ns = 0;
 	free(sgroup->ns_info);
 	sgroup->ns_info = NULL;
+	nvmf_poll_group_free_ns_io_stats(sgroup);
 fini:
 	free(qpair_ctx);
 	if (cpl_fn) {
@@ -1682,6 +1778,30 @@ nvmf_poll_group_pause_subsystem(struct spdk_nvmf_poll_group *group,
 	if (sgroup->state == SPDK_NVMF_SUBSYSTEM_PAUSED) {
 		goto fini;
 	}
+
+	if (nvmf_subsystem_nsid_is_single_ns(nsid)) {
+		/* Only the I/O to this namespace needs to drain.  Admin commands and the other
+		 * namespaces keep running, the subsystem defers freeing anything they may still
+		 * reference until it is resumed.
+		 */
+		if (nsid - 1 >= sgroup->num_ns) {
+			goto fini;
+		}
+
+		ns_info = &sgroup->ns_info[nsid - 1];
+		ns_info->state = SPDK_NVMF_SUBSYSTEM_PAUSING;
+		if (ns_info->io_outstanding > 0) {
+			assert(sgroup->cb_fn == NULL);
+			sgroup->cb_fn = cb_fn;
+			assert(sgroup->cb_arg == NULL);
+			sgroup->cb_arg = cb_arg;
+			return;
+		}
+
+		ns_info->state = SPDK_NVMF_SUBSYSTEM_PAUSED;
+		goto fini;
+	}
+
 	sgroup->state = SPDK_NVMF_SUBSYSTEM_PAUSING;
 
 	if (nsid == SPDK_NVME_GLOBAL_NS_TAG) {
@@ -1689,12 +1809,6 @@ nvmf_poll_group_pause_subsystem(struct spdk_nvmf_poll_group *group,
 			ns_info = &sgroup->ns_info[i];
 			ns_info->state = SPDK_NVMF_SUBSYSTEM_PAUSING;
 		}
-	} else {
-		/* NOTE: This implicitly also checks for 0, since 0 - 1 wraps around to UINT32_MAX. */
-		if (nsid - 1 < sgroup->num_ns) {
-			ns_info  = &sgroup->ns_info[nsid - 1];
-			ns_info->state = SPDK_NVMF_SUBSYSTEM_PAUSING;
-		}
 	}
 
 	if (sgroup->mgmt_io_outstanding > 0) {
@@ -1717,14 +1831,6 @@ nvmf_poll_group_pause_subsystem(struct spdk_nvmf_poll_group *group,
 				return;
 			}
 		}
-	} else {
-		if (ns_info != NULL && ns_info->io_outstanding > 0) {
-			assert(sgroup->cb_fn == NULL);
-			sgroup->cb_fn = cb_fn;
-			assert(sgroup->cb_arg == NULL);
-			sgroup->cb_arg = cb_arg;
-			return;
-		}
 	}
 
 	assert(sgroup->mgmt_io_outstanding == 0);
@@ -1753,7 +1859,15 @@ nvmf_poll_group_resume_subsystem(struct spdk_nvmf_poll_group *group,
 	sgroup = &group->sgroups[subsystem->id];
 
 	if (sgroup->state == SPDK_NVMF_SUBSYSTEM_ACTIVE) {
-		goto fini;
+		/* Nothing to do unless a single namespace was paused */
+		for (i = 0; i < sgroup->num_ns; i++) {
+			if (sgroup->ns_info[i].state != SPDK_NVMF_SUBSYSTEM_ACTIVE) {
+				break;
+			}
+		}
+		if (i == sgroup->num_ns) {
+			goto fini;
+		}
 	}
 
 	rc = poll_group_update_subsystem(group, subsystem);
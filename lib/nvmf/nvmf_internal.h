@@ -83,6 +83,13 @@ struct spdk_nvmf_host {
 	TAILQ_ENTRY(spdk_nvmf_host)	link;
 };
 
+/* The length travels with the data so that a reader only has to load one pointer */
+struct nvmf_ana_log_page {
+	size_t					len;
+	TAILQ_ENTRY(nvmf_ana_log_page)		link;
+	uint8_t					data[];
+};
+
 struct spdk_nvmf_subsystem_listener {
 	struct spdk_nvmf_subsystem			*subsystem;
 	spdk_nvmf_tgt_subsystem_listen_done_fn		cb_fn;
@@ -91,6 +98,8 @@ struct spdk_nvmf_subsystem_listener {
 	struct spdk_nvmf_transport			*transport;
 	enum spdk_nvme_ana_state			*ana_state;
 	uint64_t					ana_state_change_count;
+	/* ANA log page precomputed for the controllers connected through this listener */
+	struct nvmf_ana_log_page			*ana_log_page;
 	uint16_t					id;
 	struct spdk_nvmf_listener_opts			opts;
 	TAILQ_ENTRY(spdk_nvmf_subsystem_listener)	link;
@@ -132,6 +141,30 @@ struct spdk_nvmf_subsystem_pg_ns_info {
 	enum spdk_nvmf_subsystem_state	state;
 };
 
+/* Four latency buckets per power of two, i.e. 252 buckets per histogram */
+#define NVMF_IO_STAT_HISTOGRAM_BUCKET_SHIFT	2
+/* Number of hash buckets indexing the I/O statistics of a subsystem poll group */
+#define NVMF_IO_STAT_HASH_BUCKETS		256
+
+/*
+ * I/O statistics of the controllers of one host to one namespace, on one poll group.  They are
+ * only updated by the poll group's thread and summed up over all poll groups when queried.
+ */
+struct spdk_nvmf_ns_io_stat {
+	uint32_t				nsid;
+	char					hostnqn[SPDK_NVMF_NQN_MAX_LEN + 1];
+	uint64_t				num_read_ops;
+	uint64_t				bytes_read;
+	uint64_t				num_write_ops;
+	uint64_t				bytes_written;
+	uint64_t				num_other_ops;
+	uint64_t				num_errors;
+	/* Ticks from a command starting to execute to its completion */
+	struct spdk_histogram_data		*latency;
+	TAILQ_ENTRY(spdk_nvmf_ns_io_stat)	link;
+	SLIST_ENTRY(spdk_nvmf_ns_io_stat)	hash_link;
+};
+
 typedef void(*spdk_nvmf_poll_group_mod_done)(void *cb_arg, int status);
 
 struct spdk_nvmf_subsystem_poll_group {
@@ -146,6 +179,11 @@ struct spdk_nvmf_subsystem_poll_group {
 	void					*cb_arg;
 
 	TAILQ_HEAD(, spdk_nvmf_request)		queued;
+
+	/* I/O statistics of each host to each namespace, kept until the subsystem is stopped */
+	TAILQ_HEAD(, spdk_nvmf_ns_io_stat)	io_stats;
+	/* Index of io_stats by host NQN and NSID, allocated along with the first entry */
+	SLIST_HEAD(nvmf_ns_io_stat_bucket, spdk_nvmf_ns_io_stat)	*io_stats_hash;
 };
 
 struct spdk_nvmf_registrant {
@@ -182,6 +220,9 @@ struct spdk_nvmf_ns {
 	bool zcopy;
 	/* Command Set Identifier */
 	enum spdk_nvme_csi csi;
+	/* Identify Namespace data built from the bdev, without DIF insert/strip */
+	struct spdk_nvme_ns_data *identify_data;
+	TAILQ_ENTRY(spdk_nvmf_ns) link;
 };
 
 /*
@@ -277,6 +318,11 @@ struct spdk_nvmf_subsystem {
 	/* boolean for state change synchronization */
 	bool						changing_state;
 
+	/* NSID passed to the last pause.  When it names a single namespace, only the I/O to
+	 * that namespace is quiesced: admin commands and the other namespaces keep running.
+	 */
+	uint32_t					pause_nsid;
+
 	bool						destroying;
 	bool						async_destroy;
 
@@ -306,6 +352,13 @@ struct spdk_nvmf_subsystem {
 	TAILQ_HEAD(, spdk_nvmf_subsystem_listener)	listeners;
 	struct spdk_bit_array				*used_listener_ids;
 
+	/* Namespaces and ANA log pages replaced while admin commands could still reference them.
+	 * They are freed once the subsystem is resumed, i.e. after every poll group went through
+	 * a message.
+	 */
+	TAILQ_HEAD(, spdk_nvmf_ns)			removed_ns;
+	TAILQ_HEAD(, nvmf_ana_log_page)			stale_ana_log_pages;
+
 	TAILQ_ENTRY(spdk_nvmf_subsystem)		entries;
 
 	nvmf_subsystem_destroy_cb			async_destroy_cb;
@@ -329,6 +382,21 @@ subsystem_cmp(struct spdk_nvmf_subsystem *subsystem1, struct spdk_nvmf_subsystem
 
 RB_GENERATE_STATIC(subsystem_tree, spdk_nvmf_subsystem, link, subsystem_cmp);
 
+static inline bool
+nvmf_subsystem_nsid_is_single_ns(uint32_t nsid)
+{
+	return nsid != 0 && nsid != SPDK_NVME_GLOBAL_NS_TAG;
+}
+
+/* Returns true if the subsystem is being paused, or is paused, for a single namespace only */
+static inline bool
+nvmf_subsystem_is_ns_paused(struct spdk_nvmf_subsystem *subsystem)
+{
+	return (subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSING ||
+		subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED) &&
+	       nvmf_subsystem_nsid_is_single_ns(subsystem->pause_nsid);
+}
+
 int nvmf_poll_group_update_subsystem(struct spdk_nvmf_poll_group *group,
 				     struct spdk_nvmf_subsystem *subsystem);
 int nvmf_poll_group_add_subsystem(struct spdk_nvmf_poll_group *group,
@@ -343,6 +411,14 @@ void nvmf_poll_group_pause_subsystem(struct spdk_nvmf_poll_group *group,
 void nvmf_poll_group_resume_subsystem(struct spdk_nvmf_poll_group *group,
 				      struct spdk_nvmf_subsystem *subsystem, spdk_nvmf_poll_group_mod_done cb_fn, void *cb_arg);
 
+/**
+ * Find the I/O statistics of a host to a namespace on a poll group, allocating them if needed.
+ *
+ * \return The statistics, or NULL if they could not be allocated.
+ */
+struct spdk_nvmf_ns_io_stat *nvmf_poll_group_get_ns_io_stat(struct spdk_nvmf_subsystem_poll_group
+		*sgroup, uint32_t nsid, const char *hostnqn);
+
 void nvmf_update_discovery_log(struct spdk_nvmf_tgt *tgt, const char *hostnqn);
 void nvmf_get_discovery_log_page(struct spdk_nvmf_tgt *tgt, const char *hostnqn, struct iovec *iov,
 				 uint32_t iovcnt, uint64_t offset, uint32_t length,
@@ -355,6 +431,8 @@ bool nvmf_ctrlr_dsm_supported(struct spdk_nvmf_ctrlr *ctrlr);
 bool nvmf_ctrlr_write_zeroes_supported(struct spdk_nvmf_ctrlr *ctrlr);
 bool nvmf_ctrlr_copy_supported(struct spdk_nvmf_ctrlr *ctrlr);
 void nvmf_ctrlr_ns_changed(struct spdk_nvmf_ctrlr *ctrlr, uint32_t nsid);
+struct nvmf_ana_log_page *nvmf_ctrlr_build_ana_log_page(struct spdk_nvmf_subsystem *subsystem,
+		const struct spdk_nvmf_subsystem_listener *listener);
 bool nvmf_ctrlr_use_zcopy(struct spdk_nvmf_request *req);
 
 void nvmf_bdev_ctrlr_identify_ns(struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *nsdata,
@@ -468,6 +546,22 @@ nvmf_qpair_is_admin_queue(struct spdk_nvmf_qpair *qpair)
 	return qpair->qid == 0;
 }
 
+static inline uint32_t
+nvmf_poll_group_get_io_qpair_count(struct spdk_nvmf_poll_group *pg)
+{
+	uint32_t count;
+
+	/* Just assume that unassociated qpairs will eventually be io
+	 * qpairs.  This is close enough for the use cases for this
+	 * function.
+	 */
+	pthread_mutex_lock(&pg->mutex);
+	count = pg->stat.current_io_qpairs + pg->current_unassociated_qpairs;
+	pthread_mutex_unlock(&pg->mutex);
+
+	return count;
+}
+
 /**
  * Initiates a zcopy start operation
  *
@@ -13,6 +13,8 @@
 #include "spdk/string.h"
 #include "spdk/util.h"
 #include "spdk/bit_array.h"
+#include "spdk/base64.h"
+#include "spdk/histogram_data.h"
 
 #include "spdk_internal/assert.h"
 
@@ -757,6 +759,14 @@ nvmf_rpc_listen_paused(struct spdk_nvmf_subsystem *subsystem,
 	struct nvmf_rpc_listener_ctx *ctx = cb_arg;
 	int rc;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		nvmf_rpc_listener_ctx_free(ctx);
+		return;
+	}
+
 	if (ctx->op == NVMF_RPC_LISTEN_ADD) {
 		if (!nvmf_subsystem_find_listener(subsystem, &ctx->trid)) {
 			rc = spdk_nvmf_tgt_listen_ext(ctx->tgt, &ctx->trid, &ctx->opts);
@@ -1232,6 +1242,14 @@ nvmf_rpc_ns_paused(struct spdk_nvmf_subsystem *subsystem,
 	struct nvmf_rpc_ns_ctx *ctx = cb_arg;
 	struct spdk_nvmf_ns_opts ns_opts;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		nvmf_rpc_ns_ctx_free(ctx);
+		return;
+	}
+
 	spdk_nvmf_ns_opts_get_defaults(&ns_opts, sizeof(ns_opts));
 	ns_opts.nsid = ctx->ns_params.nsid;
 
@@ -1369,6 +1387,14 @@ nvmf_rpc_remove_ns_paused(struct spdk_nvmf_subsystem *subsystem,
 	struct nvmf_rpc_remove_ns_ctx *ctx = cb_arg;
 	int ret;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		nvmf_rpc_remove_ns_ctx_free(ctx);
+		return;
+	}
+
 	ret = spdk_nvmf_subsystem_remove_ns(subsystem, ctx->nsid);
 	if (ret < 0) {
 		SPDK_ERRLOG("Unable to remove namespace ID %u\n", ctx->nsid);
@@ -2201,6 +2227,277 @@ rpc_nvmf_get_stats(struct spdk_jsonrpc_request *request,
 
 SPDK_RPC_REGISTER("nvmf_get_stats", rpc_nvmf_get_stats, SPDK_RPC_RUNTIME)
 
+struct rpc_nvmf_io_stats_subsystem {
+	uint32_t				id;
+	char					nqn[SPDK_NVMF_NQN_MAX_LEN + 1];
+	/* Sums over all poll groups, sorted by host NQN and NSID */
+	TAILQ_HEAD(, spdk_nvmf_ns_io_stat)	stats;
+};
+
+struct rpc_nvmf_get_io_stats_ctx {
+	char					*tgt_name;
+	char					*nqn;
+	struct spdk_jsonrpc_request		*request;
+	struct rpc_nvmf_io_stats_subsystem	*subsystems;
+	uint32_t				num_subsystems;
+};
+
+static const struct spdk_json_object_decoder rpc_get_io_stats_decoders[] = {
+	{"tgt_name", offsetof(struct rpc_nvmf_get_io_stats_ctx, tgt_name), spdk_json_decode_string, true},
+	{"nqn", offsetof(struct rpc_nvmf_get_io_stats_ctx, nqn), spdk_json_decode_string, true},
+};
+
+static void
+free_get_io_stats_ctx(struct rpc_nvmf_get_io_stats_ctx *ctx)
+{
+	struct spdk_nvmf_ns_io_stat *stat;
+	uint32_t i;
+
+	for (i = 0; i < ctx->num_subsystems; i++) {
+		while ((stat = TAILQ_FIRST(&ctx->subsystems[i].stats)) != NULL) {
+			TAILQ_REMOVE(&ctx->subsystems[i].stats, stat, link);
+			spdk_histogram_data_free(stat->latency);
+			free(stat);
+		}
+	}
+
+	free(ctx->subsystems);
+	free(ctx->tgt_name);
+	free(ctx->nqn);
+	free(ctx);
+}
+
+static int
+rpc_nvmf_io_stats_merge(struct rpc_nvmf_io_stats_subsystem *subsystem,
+			const struct spdk_nvmf_ns_io_stat *src)
+{
+	struct spdk_nvmf_ns_io_stat *dst, *next;
+	int cmp = 1;
+
+	TAILQ_FOREACH(next, &subsystem->stats, link) {
+		cmp = strcmp(next->hostnqn, src->hostnqn);
+		if (cmp == 0) {
+			cmp = (next->nsid > src->nsid) - (next->nsid < src->nsid);
+		}
+		if (cmp >= 0) {
+			break;
+		}
+	}
+
+	if (cmp == 0) {
+		dst = next;
+	} else {
+		dst = calloc(1, sizeof(*dst));
+		if (dst == NULL) {
+			return -ENOMEM;
+		}
+
+		dst->latency = spdk_histogram_data_alloc_sized(src->latency->bucket_shift);
+		if (dst->latency == NULL) {
+			free(dst);
+			return -ENOMEM;
+		}
+
+		dst->nsid = src->nsid;
+		snprintf(dst->hostnqn, sizeof(dst->hostnqn), "%s", src->hostnqn);
+		if (next != NULL) {
+			TAILQ_INSERT_BEFORE(next, dst, link);
+		} else {
+			TAILQ_INSERT_TAIL(&subsystem->stats, dst, link);
+		}
+	}
+
+	dst->num_read_ops += src->num_read_ops;
+	dst->bytes_read += src->bytes_read;
+	dst->num_write_ops += src->num_write_ops;
+	dst->bytes_written += src->bytes_written;
+	dst->num_other_ops += src->num_other_ops;
+	dst->num_errors += src->num_errors;
+
+	return spdk_histogram_data_merge(dst->latency, src->latency);
+}
+
+static int
+rpc_nvmf_encode_histogram(struct spdk_nvmf_ns_io_stat *stat, char **encoded)
+{
+	size_t src_len = SPDK_HISTOGRAM_NUM_BUCKETS(stat->latency) * sizeof(uint64_t);
+	int rc;
+
+	*encoded = malloc(spdk_base64_get_encoded_strlen(src_len) + 1);
+	if (*encoded == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_base64_encode(*encoded, stat->latency->bucket, src_len);
+	if (rc != 0) {
+		free(*encoded);
+		*encoded = NULL;
+	}
+
+	return rc;
+}
+
+static void
+rpc_nvmf_get_io_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct rpc_nvmf_get_io_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_json_write_ctx *w;
+	struct spdk_nvmf_ns_io_stat *stat;
+	char *encoded_histogram;
+	uint32_t s;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(-status));
+		free_get_io_stats_ctx(ctx);
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_uint32(w, "bucket_shift", NVMF_IO_STAT_HISTOGRAM_BUCKET_SHIFT);
+	spdk_json_write_named_array_begin(w, "io_stats");
+
+	for (s = 0; s < ctx->num_subsystems; s++) {
+		TAILQ_FOREACH(stat, &ctx->subsystems[s].stats, link) {
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "nqn", ctx->subsystems[s].nqn);
+			spdk_json_write_named_string(w, "hostnqn", stat->hostnqn);
+			spdk_json_write_named_uint32(w, "nsid", stat->nsid);
+			spdk_json_write_named_uint64(w, "num_read_ops", stat->num_read_ops);
+			spdk_json_write_named_uint64(w, "bytes_read", stat->bytes_read);
+			spdk_json_write_named_uint64(w, "num_write_ops", stat->num_write_ops);
+			spdk_json_write_named_uint64(w, "bytes_written", stat->bytes_written);
+			spdk_json_write_named_uint64(w, "num_other_ops", stat->num_other_ops);
+			spdk_json_write_named_uint64(w, "num_errors", stat->num_errors);
+			if (rpc_nvmf_encode_histogram(stat, &encoded_histogram) == 0) {
+				spdk_json_write_named_string(w, "latency_histogram", encoded_histogram);
+				free(encoded_histogram);
+			}
+			spdk_json_write_object_end(w);
+		}
+	}
+
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+	free_get_io_stats_ctx(ctx);
+}
+
+static void
+_rpc_nvmf_get_io_stats(struct spdk_io_channel_iter *i)
+{
+	struct rpc_nvmf_get_io_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_nvmf_poll_group *group = spdk_io_channel_get_ctx(ch);
+	struct spdk_nvmf_subsystem_poll_group *sgroup;
+	struct spdk_nvmf_ns_io_stat *stat;
+	uint32_t s;
+	int rc;
+
+	for (s = 0; s < ctx->num_subsystems; s++) {
+		if (ctx->subsystems[s].id >= group->num_sgroups) {
+			continue;
+		}
+
+		sgroup = &group->sgroups[ctx->subsystems[s].id];
+		TAILQ_FOREACH(stat, &sgroup->io_stats, link) {
+			rc = rpc_nvmf_io_stats_merge(&ctx->subsystems[s], stat);
+			if (rc != 0) {
+				spdk_for_each_channel_continue(i, rc);
+				return;
+			}
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+rpc_nvmf_get_io_stats(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_get_io_stats_ctx *ctx;
+	struct spdk_nvmf_tgt *tgt;
+	struct spdk_nvmf_subsystem *subsystem;
+	uint32_t count = 0;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		return;
+	}
+	ctx->request = request;
+
+	if (params) {
+		if (spdk_json_decode_object(params, rpc_get_io_stats_decoders,
+					    SPDK_COUNTOF(rpc_get_io_stats_decoders),
+					    ctx)) {
+			SPDK_ERRLOG("spdk_json_decode_object failed\n");
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+			free_get_io_stats_ctx(ctx);
+			return;
+		}
+	}
+
+	tgt = spdk_nvmf_get_tgt(ctx->tgt_name);
+	if (!tgt) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Unable to find a target.");
+		free_get_io_stats_ctx(ctx);
+		return;
+	}
+
+	if (ctx->nqn != NULL) {
+		subsystem = spdk_nvmf_tgt_find_subsystem(tgt, ctx->nqn);
+		if (!subsystem) {
+			SPDK_ERRLOG("Unable to find subsystem with NQN %s\n", ctx->nqn);
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							 "Invalid parameters");
+			free_get_io_stats_ctx(ctx);
+			return;
+		}
+	}
+
+	for (subsystem = spdk_nvmf_subsystem_get_first(tgt); subsystem != NULL;
+	     subsystem = spdk_nvmf_subsystem_get_next(subsystem)) {
+		count++;
+	}
+
+	/* The poll groups only know the subsystems by their ID, so remember which NQN each has */
+	ctx->subsystems = calloc(spdk_max(count, 1), sizeof(*ctx->subsystems));
+	if (!ctx->subsystems) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		free_get_io_stats_ctx(ctx);
+		return;
+	}
+
+	for (subsystem = spdk_nvmf_subsystem_get_first(tgt); subsystem != NULL;
+	     subsystem = spdk_nvmf_subsystem_get_next(subsystem)) {
+		if (spdk_nvmf_subsystem_get_type(subsystem) != SPDK_NVMF_SUBTYPE_NVME ||
+		    (ctx->nqn != NULL && strcmp(ctx->nqn, subsystem->subnqn) != 0)) {
+			continue;
+		}
+
+		ctx->subsystems[ctx->num_subsystems].id = subsystem->id;
+		snprintf(ctx->subsystems[ctx->num_subsystems].nqn, sizeof(ctx->subsystems[0].nqn), "%s",
+			 subsystem->subnqn);
+		TAILQ_INIT(&ctx->subsystems[ctx->num_subsystems].stats);
+		ctx->num_subsystems++;
+	}
+
+	spdk_for_each_channel(tgt,
+			      _rpc_nvmf_get_io_stats,
+			      ctx,
+			      rpc_nvmf_get_io_stats_done);
+}
+
+SPDK_RPC_REGISTER("nvmf_get_io_stats", rpc_nvmf_get_io_stats, SPDK_RPC_RUNTIME)
+
 static void
 dump_nvmf_ctrlr(struct spdk_json_write_ctx *w, struct spdk_nvmf_ctrlr *ctrlr)
 {
@@ -2338,6 +2635,14 @@ rpc_nvmf_get_controllers_paused(struct spdk_nvmf_subsystem *subsystem,
 	struct spdk_json_write_ctx *w;
 	struct spdk_nvmf_ctrlr *ctrlr;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		free_rpc_subsystem_query_ctx(ctx);
+		return;
+	}
+
 	w = spdk_jsonrpc_begin_result(ctx->request);
 
 	spdk_json_write_array_begin(w);
@@ -2398,6 +2703,14 @@ rpc_nvmf_get_qpairs_paused(struct spdk_nvmf_subsystem *subsystem,
 {
 	struct rpc_subsystem_query_ctx *ctx = cb_arg;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		free_rpc_subsystem_query_ctx(ctx);
+		return;
+	}
+
 	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
 
 	spdk_json_write_array_begin(ctx->w);
@@ -2416,6 +2729,14 @@ rpc_nvmf_get_listeners_paused(struct spdk_nvmf_subsystem *subsystem,
 	struct spdk_json_write_ctx *w;
 	struct spdk_nvmf_subsystem_listener *listener;
 
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 status == -EBUSY ? "subsystem busy, retry later.\n" :
+						 "Internal error");
+		free_rpc_subsystem_query_ctx(ctx);
+		return;
+	}
+
 	w = spdk_jsonrpc_begin_result(ctx->request);
 
 	spdk_json_write_array_begin(w);
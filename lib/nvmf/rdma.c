@@ -42,6 +42,13 @@ SPDK_STATIC_ASSERT(NVMF_DEFAULT_MSDBD <= SPDK_NVMF_MAX_SGL_ENTRIES,
 #define DEFAULT_NVMF_RDMA_CQ_SIZE	4096
 #define MAX_WR_PER_QP(queue_depth)	(queue_depth * 3 + 2)
 
+/* Bounds of the number of completions reaped by a single ibv_poll_cq() call */
+#define NVMF_RDMA_CQ_POLL_BATCH_MIN	16
+#define NVMF_RDMA_CQ_POLL_BATCH_DEFAULT	32
+#define NVMF_RDMA_CQ_POLL_BATCH_MAX	128
+/* Number of consecutive empty CQ polls after which the CQ poll interval is doubled */
+#define NVMF_RDMA_CQ_IDLE_POLLS_BEFORE_BACKOFF	1024
+
 static int g_spdk_nvmf_ibv_query_mask =
 	IBV_QP_STATE |
 	IBV_QP_PKEY_INDEX |
@@ -403,6 +410,13 @@ struct spdk_nvmf_rdma_poller {
 	int					required_num_wr;
 	struct ibv_cq				*cq;
 
+	/* Adaptive CQ polling: number of completions reaped per ibv_poll_cq() call and,
+	 * when the CQ stays empty, the number of poll group iterations between two polls. */
+	uint32_t				cq_poll_batch;
+	uint32_t				cq_poll_interval;
+	uint32_t				cq_polls_skipped;
+	uint32_t				cq_idle_polls;
+
 	/* The maximum number of I/O outstanding on the shared receive queue at one time */
 	uint16_t				max_srq_depth;
 	bool					need_destroy;
@@ -470,6 +484,7 @@ struct rdma_transport_opts {
 	bool		no_srq;
 	bool		no_wr_batching;
 	int		acceptor_backlog;
+	uint32_t	max_cq_poll_interval;
 };
 
 struct spdk_nvmf_rdma_transport {
@@ -527,6 +542,10 @@ static const struct spdk_json_object_decoder rdma_transport_opts_decoder[] = {
 		"acceptor_backlog", offsetof(struct rdma_transport_opts, acceptor_backlog),
 		spdk_json_decode_int32, true
 	},
+	{
+		"max_cq_poll_interval", offsetof(struct rdma_transport_opts, max_cq_poll_interval),
+		spdk_json_decode_uint32, true
+	},
 };
 
 static int
@@ -2456,6 +2475,7 @@ nvmf_rdma_request_process(struct spdk_nvmf_rdma_transport *rtransport,
 #define SPDK_NVMF_RDMA_ACCEPTOR_BACKLOG 100
 #define SPDK_NVMF_RDMA_DEFAULT_ABORT_TIMEOUT_SEC 1
 #define SPDK_NVMF_RDMA_DEFAULT_NO_WR_BATCHING false
+#define SPDK_NVMF_RDMA_DEFAULT_MAX_CQ_POLL_INTERVAL 1
 
 static void
 nvmf_rdma_opts_init(struct spdk_nvmf_transport_opts *opts)
@@ -2647,6 +2667,7 @@ nvmf_rdma_create(struct spdk_nvmf_transport_opts *opts)
 	rtransport->rdma_opts.no_srq = SPDK_NVMF_RDMA_DEFAULT_NO_SRQ;
 	rtransport->rdma_opts.acceptor_backlog = SPDK_NVMF_RDMA_ACCEPTOR_BACKLOG;
 	rtransport->rdma_opts.no_wr_batching = SPDK_NVMF_RDMA_DEFAULT_NO_WR_BATCHING;
+	rtransport->rdma_opts.max_cq_poll_interval = SPDK_NVMF_RDMA_DEFAULT_MAX_CQ_POLL_INTERVAL;
 	if (opts->transport_specific != NULL &&
 	    spdk_json_decode_object_relaxed(opts->transport_specific, rdma_transport_opts_decoder,
 					    SPDK_COUNTOF(rdma_transport_opts_decoder),
@@ -2661,7 +2682,8 @@ nvmf_rdma_create(struct spdk_nvmf_transport_opts *opts)
 		     "  max_io_qpairs_per_ctrlr=%d, io_unit_size=%d,\n"
 		     "  in_capsule_data_size=%d, max_aq_depth=%d,\n"
 		     "  num_shared_buffers=%d, num_cqe=%d, max_srq_depth=%d, no_srq=%d,"
-		     "  acceptor_backlog=%d, no_wr_batching=%d abort_timeout_sec=%d\n",
+		     "  acceptor_backlog=%d, no_wr_batching=%d abort_timeout_sec=%d,\n"
+		     "  max_cq_poll_interval=%u\n",
 		     opts->max_queue_depth,
 		     opts->max_io_size,
 		     opts->max_qpairs_per_ctrlr - 1,
@@ -2674,7 +2696,8 @@ nvmf_rdma_create(struct spdk_nvmf_transport_opts *opts)
 		     rtransport->rdma_opts.no_srq,
 		     rtransport->rdma_opts.acceptor_backlog,
 		     rtransport->rdma_opts.no_wr_batching,
-		     opts->abort_timeout_sec);
+		     opts->abort_timeout_sec,
+		     rtransport->rdma_opts.max_cq_poll_interval);
 
 	/* I/O unit size cannot be larger than max I/O size */
 	if (opts->io_unit_size > opts->max_io_size) {
@@ -2687,6 +2710,12 @@ nvmf_rdma_create(struct spdk_nvmf_transport_opts *opts)
 		rtransport->rdma_opts.acceptor_backlog = SPDK_NVMF_RDMA_ACCEPTOR_BACKLOG;
 	}
 
+	if (rtransport->rdma_opts.max_cq_poll_interval == 0) {
+		SPDK_ERRLOG("The max CQ poll interval cannot be less than 1, setting to the default value of (%d).\n",
+			    SPDK_NVMF_RDMA_DEFAULT_MAX_CQ_POLL_INTERVAL);
+		rtransport->rdma_opts.max_cq_poll_interval = SPDK_NVMF_RDMA_DEFAULT_MAX_CQ_POLL_INTERVAL;
+	}
+
 	if (opts->num_shared_buffers < (SPDK_NVMF_MAX_SGL_ENTRIES * 2)) {
 		SPDK_ERRLOG("The number of shared data buffers (%d) is less than"
 			    "the minimum number required to guarantee that forward progress can be made (%d)\n",
@@ -2836,6 +2865,7 @@ nvmf_rdma_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json_writ
 	}
 	spdk_json_write_named_int32(w, "acceptor_backlog", rtransport->rdma_opts.acceptor_backlog);
 	spdk_json_write_named_bool(w, "no_wr_batching", rtransport->rdma_opts.no_wr_batching);
+	spdk_json_write_named_uint32(w, "max_cq_poll_interval", rtransport->rdma_opts.max_cq_poll_interval);
 }
 
 static int
@@ -3950,6 +3980,8 @@ nvmf_rdma_poller_create(struct spdk_nvmf_rdma_transport *rtransport,
 
 	poller->device = device;
 	poller->group = rgroup;
+	poller->cq_poll_batch = NVMF_RDMA_CQ_POLL_BATCH_DEFAULT;
+	poller->cq_poll_interval = 1;
 	*out_poller = poller;
 
 	RB_INIT(&poller->qpairs);
@@ -4069,22 +4101,6 @@ nvmf_rdma_poll_group_create(struct spdk_nvmf_transport *transport,
 	return &rgroup->group;
 }
 
-static uint32_t
-nvmf_poll_group_get_io_qpair_count(struct spdk_nvmf_poll_group *pg)
-{
-	uint32_t count;
-
-	/* Just assume that unassociated qpairs will eventually be io
-	 * qpairs.  This is close enough for the use cases for this
-	 * function.
-	 */
-	pthread_mutex_lock(&pg->mutex);
-	count = pg->stat.current_io_qpairs + pg->current_unassociated_qpairs;
-	pthread_mutex_unlock(&pg->mutex);
-
-	return count;
-}
-
 static struct spdk_nvmf_transport_poll_group *
 nvmf_rdma_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 {
@@ -4575,11 +4591,38 @@ nvmf_rdma_log_wc_status(struct spdk_nvmf_rdma_qpair *rqpair, struct ibv_wc *wc)
 	}
 }
 
+static void
+nvmf_rdma_poller_adapt_cq_polling(struct spdk_nvmf_rdma_poller *rpoller, int reaped,
+				  uint32_t max_cq_poll_interval)
+{
+	/* Reap more completions per call while the CQ keeps filling the whole batch and
+	 * fewer once it doesn't, so that a busy CQ doesn't need as many calls to drain. */
+	if ((uint32_t)reaped == rpoller->cq_poll_batch) {
+		rpoller->cq_poll_batch = spdk_min(rpoller->cq_poll_batch * 2, NVMF_RDMA_CQ_POLL_BATCH_MAX);
+	} else if ((uint32_t)reaped < rpoller->cq_poll_batch / 4) {
+		rpoller->cq_poll_batch = spdk_max(rpoller->cq_poll_batch / 2, NVMF_RDMA_CQ_POLL_BATCH_MIN);
+	}
+
+	/* Poll an idle CQ less and less often, up to once every max_cq_poll_interval
+	 * poll group iterations, and go back to polling it every time as soon as
+	 * anything shows up. */
+	if (reaped > 0) {
+		rpoller->cq_idle_polls = 0;
+		rpoller->cq_polls_skipped = 0;
+		rpoller->cq_poll_interval = 1;
+	} else if (rpoller->cq_poll_interval < max_cq_poll_interval &&
+		   ++rpoller->cq_idle_polls >= NVMF_RDMA_CQ_IDLE_POLLS_BEFORE_BACKOFF) {
+		rpoller->cq_idle_polls = 0;
+		rpoller->cq_polls_skipped = 0;
+		rpoller->cq_poll_interval = spdk_min(rpoller->cq_poll_interval * 2, max_cq_poll_interval);
+	}
+}
+
 static int
 nvmf_rdma_poller_poll(struct spdk_nvmf_rdma_transport *rtransport,
 		      struct spdk_nvmf_rdma_poller *rpoller)
 {
-	struct ibv_wc wc[32];
+	struct ibv_wc wc[NVMF_RDMA_CQ_POLL_BATCH_MAX];
 	struct spdk_nvmf_rdma_wr	*rdma_wr;
 	struct spdk_nvmf_rdma_request	*rdma_req;
 	struct spdk_nvmf_rdma_recv	*rdma_recv;
@@ -4601,8 +4644,18 @@ nvmf_rdma_poller_poll(struct spdk_nvmf_rdma_transport *rtransport,
 		return 0;
 	}
 
+	if (rpoller->cq_poll_interval > 1) {
+		if (++rpoller->cq_polls_skipped < rpoller->cq_poll_interval) {
+			/* Still submit work requests queued since the last poll. */
+			_poller_submit_recvs(rtransport, rpoller);
+			_poller_submit_sends(rtransport, rpoller);
+			return 0;
+		}
+		rpoller->cq_polls_skipped = 0;
+	}
+
 	/* Poll for completing operations. */
-	reaped = ibv_poll_cq(rpoller->cq, 32, wc);
+	reaped = ibv_poll_cq(rpoller->cq, rpoller->cq_poll_batch, wc);
 	if (reaped < 0) {
 		SPDK_ERRLOG("Error polling CQ! (%d): %s\n",
 			    errno, spdk_strerror(errno));
@@ -4613,6 +4666,7 @@ nvmf_rdma_poller_poll(struct spdk_nvmf_rdma_transport *rtransport,
 
 	rpoller->stat.polls++;
 	rpoller->stat.completions += reaped;
+	nvmf_rdma_poller_adapt_cq_polling(rpoller, reaped, rtransport->rdma_opts.max_cq_poll_interval);
 
 	for (i = 0; i < reaped; i++) {
 
@@ -267,6 +267,8 @@ spdk_nvmf_subsystem_create(struct spdk_nvmf_tgt *tgt,
 	TAILQ_INIT(&subsystem->listeners);
 	TAILQ_INIT(&subsystem->hosts);
 	TAILQ_INIT(&subsystem->ctrlrs);
+	TAILQ_INIT(&subsystem->removed_ns);
+	TAILQ_INIT(&subsystem->stale_ana_log_pages);
 	subsystem->used_listener_ids = spdk_bit_array_create(NVMF_MAX_LISTENERS_PER_SUBSYSTEM);
 	if (subsystem->used_listener_ids == NULL) {
 		pthread_mutex_destroy(&subsystem->mutex);
@@ -316,6 +318,65 @@ nvmf_subsystem_remove_host(struct spdk_nvmf_subsystem *subsystem, struct spdk_nv
 	free(host);
 }
 
+static void nvmf_subsystem_update_ana_log_pages(struct spdk_nvmf_subsystem *subsystem);
+
+static void
+nvmf_ns_free(struct spdk_nvmf_ns *ns)
+{
+	free(ns->identify_data);
+	free(ns->ptpl_file);
+	spdk_bdev_close(ns->desc);
+	free(ns);
+}
+
+/*
+ * While only a single namespace is paused, admin commands keep running on the poll groups and
+ * may still be looking at a namespace or an ANA log page that was just replaced.  Those are
+ * freed once the subsystem is resumed: the resume visits every poll group, so by the time it
+ * completes, no admin command can reference them anymore.
+ */
+static void
+nvmf_subsystem_retire_ns(struct spdk_nvmf_subsystem *subsystem, struct spdk_nvmf_ns *ns)
+{
+	if (nvmf_subsystem_is_ns_paused(subsystem)) {
+		TAILQ_INSERT_TAIL(&subsystem->removed_ns, ns, link);
+	} else {
+		nvmf_ns_free(ns);
+	}
+}
+
+static void
+nvmf_subsystem_retire_ana_log_page(struct spdk_nvmf_subsystem *subsystem,
+				   struct nvmf_ana_log_page *page)
+{
+	if (page == NULL) {
+		return;
+	}
+
+	if (nvmf_subsystem_is_ns_paused(subsystem)) {
+		TAILQ_INSERT_TAIL(&subsystem->stale_ana_log_pages, page, link);
+	} else {
+		free(page);
+	}
+}
+
+static void
+nvmf_subsystem_free_retired(struct spdk_nvmf_subsystem *subsystem)
+{
+	struct spdk_nvmf_ns *ns;
+	struct nvmf_ana_log_page *page;
+
+	while ((ns = TAILQ_FIRST(&subsystem->removed_ns)) != NULL) {
+		TAILQ_REMOVE(&subsystem->removed_ns, ns, link);
+		nvmf_ns_free(ns);
+	}
+
+	while ((page = TAILQ_FIRST(&subsystem->stale_ana_log_pages)) != NULL) {
+		TAILQ_REMOVE(&subsystem->stale_ana_log_pages, page, link);
+		free(page);
+	}
+}
+
 static void
 _nvmf_subsystem_remove_listener(struct spdk_nvmf_subsystem *subsystem,
 				struct spdk_nvmf_subsystem_listener *listener,
@@ -339,6 +400,7 @@ _nvmf_subsystem_remove_listener(struct spdk_nvmf_subsystem *subsystem,
 
 	TAILQ_REMOVE(&subsystem->listeners, listener, link);
 	nvmf_update_discovery_log(listener->subsystem->tgt, NULL);
+	free(listener->ana_log_page);
 	free(listener->ana_state);
 	spdk_bit_array_clear(subsystem->used_listener_ids, listener->id);
 	free(listener);
@@ -380,6 +442,8 @@ _nvmf_subsystem_destroy(struct spdk_nvmf_subsystem *subsystem)
 		ns = next_ns;
 	}
 
+	nvmf_subsystem_free_retired(subsystem);
+
 	free(subsystem->ns);
 	free(subsystem->ana_group);
 
@@ -601,6 +665,8 @@ subsystem_state_change_done(struct spdk_io_channel_iter *i, int status)
 		status = nvmf_subsystem_set_state(ctx->subsystem, ctx->requested_state);
 		if (status) {
 			status = -1;
+		} else if (ctx->requested_state != SPDK_NVMF_SUBSYSTEM_PAUSED) {
+			nvmf_subsystem_free_retired(ctx->subsystem);
 		}
 	}
 
@@ -695,8 +761,14 @@ nvmf_subsystem_state_change(struct spdk_nvmf_subsystem *subsystem,
 	/* If we are already in the requested state, just call the callback immediately. */
 	if (subsystem->state == requested_state) {
 		subsystem->changing_state = false;
+		/* Pausing a single namespace leaves the rest of the subsystem running */
+		if (nvmf_subsystem_is_ns_paused(subsystem) && nsid != subsystem->pause_nsid) {
+			rc = -EBUSY;
+		} else {
+			rc = 0;
+		}
 		if (cb_fn) {
-			cb_fn(subsystem, cb_arg, 0);
+			cb_fn(subsystem, cb_arg, rc);
 		}
 		return 0;
 	}
@@ -711,6 +783,9 @@ nvmf_subsystem_state_change(struct spdk_nvmf_subsystem *subsystem,
 	}
 
 	ctx->original_state = subsystem->state;
+	if (requested_state == SPDK_NVMF_SUBSYSTEM_PAUSED) {
+		subsystem->pause_nsid = nsid;
+	}
 	rc = nvmf_subsystem_set_state(subsystem, intermediate_state);
 	if (rc) {
 		free(ctx);
@@ -1069,6 +1144,7 @@ _nvmf_subsystem_add_listener_done(void *ctx, int status)
 	}
 
 	TAILQ_INSERT_HEAD(&listener->subsystem->listeners, listener, link);
+	nvmf_subsystem_update_ana_log_pages(listener->subsystem);
 	nvmf_update_discovery_log(listener->subsystem->tgt, NULL);
 	listener->cb_fn(listener->cb_arg, status);
 }
@@ -1152,7 +1228,8 @@ _nvmf_subsystem_add_listener(struct spdk_nvmf_subsystem *subsystem,
 	assert(cb_fn != NULL);
 
 	if (!(subsystem->state == SPDK_NVMF_SUBSYSTEM_INACTIVE ||
-	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED)) {
+	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED) ||
+	    nvmf_subsystem_is_ns_paused(subsystem)) {
 		cb_fn(cb_arg, -EAGAIN);
 		return;
 	}
@@ -1259,7 +1336,8 @@ spdk_nvmf_subsystem_remove_listener(struct spdk_nvmf_subsystem *subsystem,
 	struct spdk_nvmf_subsystem_listener *listener;
 
 	if (!(subsystem->state == SPDK_NVMF_SUBSYSTEM_INACTIVE ||
-	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED)) {
+	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED) ||
+	    nvmf_subsystem_is_ns_paused(subsystem)) {
 		return -EAGAIN;
 	}
 
@@ -1438,12 +1516,11 @@ spdk_nvmf_subsystem_remove_ns(struct spdk_nvmf_subsystem *subsystem, uint32_t ns
 	assert(subsystem->ana_group[ns->anagrpid - 1] > 0);
 
 	subsystem->ana_group[ns->anagrpid - 1]--;
+	nvmf_subsystem_update_ana_log_pages(subsystem);
 
-	free(ns->ptpl_file);
 	nvmf_ns_reservation_clear_all_registrants(ns);
 	spdk_bdev_module_release_bdev(ns->bdev);
-	spdk_bdev_close(ns->desc);
-	free(ns);
+	nvmf_subsystem_retire_ns(subsystem, ns);
 
 	for (transport = spdk_nvmf_transport_get_first(subsystem->tgt); transport;
 	     transport = spdk_nvmf_transport_get_next(transport)) {
@@ -1463,6 +1540,8 @@ struct subsystem_ns_change_ctx {
 	uint32_t				nsid;
 };
 
+static void nvmf_ns_change_msg(void *ns_ctx);
+
 static void
 _nvmf_ns_hot_remove(struct spdk_nvmf_subsystem *subsystem,
 		    void *cb_arg, int status)
@@ -1470,6 +1549,12 @@ _nvmf_ns_hot_remove(struct spdk_nvmf_subsystem *subsystem,
 	struct subsystem_ns_change_ctx *ctx = cb_arg;
 	int rc;
 
+	if (status == -EBUSY) {
+		/* Another namespace is paused, try again */
+		spdk_thread_send_msg(spdk_get_thread(), nvmf_ns_change_msg, ctx);
+		return;
+	}
+
 	rc = spdk_nvmf_subsystem_remove_ns(subsystem, ctx->nsid);
 	if (rc != 0) {
 		SPDK_ERRLOG("Failed to make changes to NVME-oF subsystem with id: %u\n", subsystem->id);
@@ -1535,10 +1620,41 @@ nvmf_ns_hot_remove(void *remove_ctx)
 	}
 }
 
+/*
+ * Identify Namespace data only changes when the bdev is resized, which happens with the
+ * subsystem paused, so it is built once here instead of for each Identify command.
+ */
+static void
+nvmf_ns_update_identify_data(struct spdk_nvmf_ns *ns)
+{
+	if (ns->identify_data == NULL) {
+		ns->identify_data = calloc(1, sizeof(*ns->identify_data));
+		if (ns->identify_data == NULL) {
+			return;
+		}
+	} else {
+		memset(ns->identify_data, 0, sizeof(*ns->identify_data));
+	}
+
+	nvmf_bdev_ctrlr_identify_ns(ns, ns->identify_data, false);
+}
+
 static void
 _nvmf_ns_resize(struct spdk_nvmf_subsystem *subsystem, void *cb_arg, int status)
 {
 	struct subsystem_ns_change_ctx *ctx = cb_arg;
+	struct spdk_nvmf_ns *ns;
+
+	if (status == -EBUSY) {
+		/* Another namespace is paused, try again */
+		spdk_thread_send_msg(spdk_get_thread(), nvmf_ns_change_msg, ctx);
+		return;
+	}
+
+	ns = _nvmf_subsystem_get_ns(subsystem, ctx->nsid);
+	if (ns != NULL) {
+		nvmf_ns_update_identify_data(ns);
+	}
 
 	nvmf_subsystem_ns_changed(subsystem, ctx->nsid);
 	if (spdk_nvmf_subsystem_resume(subsystem, NULL, NULL) != 0) {
@@ -1861,6 +1977,9 @@ spdk_nvmf_subsystem_add_ns_ext(struct spdk_nvmf_subsystem *subsystem, const char
 		}
 	}
 
+	nvmf_ns_update_identify_data(ns);
+	nvmf_subsystem_update_ana_log_pages(subsystem);
+
 	SPDK_DEBUGLOG(nvmf, "Subsystem %s: bdev %s assigned nsid %" PRIu32 "\n",
 		      spdk_nvmf_subsystem_get_nqn(subsystem),
 		      bdev_name,
@@ -1874,13 +1993,13 @@ spdk_nvmf_subsystem_add_ns_ext(struct spdk_nvmf_subsystem *subsystem, const char
 
 err_subsystem_add_ns:
 	free(ns->ptpl_file);
+	ns->ptpl_file = NULL;
 err_strdup:
 	nvmf_ns_reservation_clear_all_registrants(ns);
 err_ns_reservation_restore:
 	subsystem->ns[opts.nsid - 1] = NULL;
 	spdk_bdev_module_release_bdev(ns->bdev);
-	spdk_bdev_close(ns->desc);
-	free(ns);
+	nvmf_subsystem_retire_ns(subsystem, ns);
 
 	return 0;
 }
@@ -3269,6 +3388,7 @@ spdk_nvmf_subsystem_set_ana_reporting(struct spdk_nvmf_subsystem *subsystem,
 	}
 
 	subsystem->flags.ana_reporting = ana_reporting;
+	nvmf_subsystem_update_ana_log_pages(subsystem);
 
 	return 0;
 }
@@ -3279,6 +3399,35 @@ nvmf_subsystem_get_ana_reporting(struct spdk_nvmf_subsystem *subsystem)
 	return subsystem->flags.ana_reporting;
 }
 
+/*
+ * The ANA log page only changes when namespaces, ANA groups or ANA states change, so it is built
+ * once here and admin commands just copy it.  If the allocation fails, the page is built for each
+ * Get Log Page instead.  A namespace-only pause keeps admin commands running, so a Get Log Page
+ * may still be copying the old page: it is published atomically and the old page is retired by
+ * nvmf_subsystem_retire_ana_log_page(), which defers freeing it until the subsystem is resumed.
+ */
+static void
+nvmf_subsystem_listener_update_ana_log_page(struct spdk_nvmf_subsystem_listener *listener)
+{
+	struct nvmf_ana_log_page *page, *old_page = listener->ana_log_page;
+
+	page = nvmf_ctrlr_build_ana_log_page(listener->subsystem, listener);
+
+	/* Admin commands may be reading the page concurrently during a namespace-only pause */
+	__atomic_store_n(&listener->ana_log_page, page, __ATOMIC_RELEASE);
+	nvmf_subsystem_retire_ana_log_page(listener->subsystem, old_page);
+}
+
+static void
+nvmf_subsystem_update_ana_log_pages(struct spdk_nvmf_subsystem *subsystem)
+{
+	struct spdk_nvmf_subsystem_listener *listener;
+
+	TAILQ_FOREACH(listener, &subsystem->listeners, link) {
+		nvmf_subsystem_listener_update_ana_log_page(listener);
+	}
+}
+
 struct subsystem_listener_update_ctx {
 	struct spdk_nvmf_subsystem_listener *listener;
 
@@ -3383,6 +3532,7 @@ nvmf_subsystem_set_ana_state(struct spdk_nvmf_subsystem *subsystem,
 		}
 	}
 	listener->ana_state_change_count++;
+	nvmf_subsystem_update_ana_log_pages(subsystem);
 
 	ctx->listener = listener;
 	ctx->cb_fn = cb_fn;
@@ -46,6 +46,15 @@
 #define SPDK_NVMF_TCP_DEFAULT_DIF_INSERT_OR_STRIP false
 #define SPDK_NVMF_TCP_DEFAULT_ABORT_TIMEOUT_SEC 1
 
+/* How often each poll group samples the busy/idle ticks of its thread */
+#define NVMF_TCP_POLL_GROUP_LOAD_PERIOD_US (100 * 1000)
+/* Poll groups whose busy percentage falls into the same bucket are considered
+ * equally loaded, in which case the number of I/O qpairs decides. */
+#define NVMF_TCP_POLL_GROUP_BUSY_BUCKET_PCT 10
+/* A sock placement hint is ignored if it points to a poll group that is busier
+ * than the least loaded one by more than this many percentage points. */
+#define NVMF_TCP_PLACEMENT_MAX_BUSY_DELTA_PCT 25
+
 #define TCP_PSK_INVALID_PERMISSIONS 0177
 
 const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp;
@@ -234,6 +243,14 @@ struct spdk_nvmf_tcp_req  {
 	bool					pdu_in_use;
 	bool					has_in_capsule_data;
 	bool					fused_failed;
+	/* The capsule response is sent together with the last C2H data PDU */
+	bool					c2h_rsp_pending;
+
+	/* Capsule response header (and header digest) following the last C2H data PDU */
+	struct {
+		struct spdk_nvme_tcp_rsp	hdr;
+		uint8_t				hdgst[SPDK_NVME_TCP_DIGEST_LEN];
+	} c2h_rsp;
 
 	/* transfer_tag */
 	uint16_t				ttag;
@@ -248,6 +265,9 @@ struct spdk_nvmf_tcp_req  {
 	STAILQ_ENTRY(spdk_nvmf_tcp_req)		link;
 	TAILQ_ENTRY(spdk_nvmf_tcp_req)		state_link;
 };
+SPDK_STATIC_ASSERT(offsetof(struct spdk_nvmf_tcp_req, c2h_rsp.hdgst) -
+		   offsetof(struct spdk_nvmf_tcp_req, c2h_rsp) == sizeof(struct spdk_nvme_tcp_rsp),
+		   "Incorrect c2h_rsp layout");
 
 struct spdk_nvmf_tcp_qpair {
 	struct spdk_nvmf_qpair			qpair;
@@ -330,6 +350,15 @@ struct spdk_nvmf_tcp_poll_group {
 	struct spdk_io_channel			*accel_channel;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
+	/* Thread load, sampled periodically by the poll group's own thread and
+	 * read by nvmf_tcp_get_optimal_poll_group() on the acceptor thread. */
+	struct {
+		struct spdk_poller		*poller;
+		uint64_t			busy_tsc;
+		uint64_t			idle_tsc;
+		uint32_t			busy_pct;
+	} load;
+
 	TAILQ_ENTRY(spdk_nvmf_tcp_poll_group)	link;
 };
 
@@ -1046,6 +1075,27 @@ _pdu_write_done(struct nvme_tcp_pdu *pdu, int err)
 	pdu->sock_req.cb_fn(pdu->sock_req.cb_arg, err);
 }
 
+static void
+nvmf_tcp_c2h_append_rsp(struct nvme_tcp_pdu *pdu)
+{
+	/* C2H data PDUs are always sent on behalf of a request */
+	struct spdk_nvmf_tcp_req *tcp_req = pdu->sock_req.cb_arg;
+
+	if (!tcp_req->c2h_rsp_pending) {
+		return;
+	}
+
+	if (spdk_unlikely(pdu->sock_req.iovcnt >= (int)SPDK_COUNTOF(pdu->iov))) {
+		/* No room left, the response will be sent once the data is out */
+		tcp_req->c2h_rsp_pending = false;
+		return;
+	}
+
+	pdu->iov[pdu->sock_req.iovcnt].iov_base = &tcp_req->c2h_rsp;
+	pdu->iov[pdu->sock_req.iovcnt].iov_len = tcp_req->c2h_rsp.hdr.common.plen;
+	pdu->sock_req.iovcnt++;
+}
+
 static void
 _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 {
@@ -1055,6 +1105,9 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 
 	pdu->sock_req.iovcnt = nvme_tcp_build_iovs(pdu->iov, SPDK_COUNTOF(pdu->iov), pdu,
 			       tqpair->host_hdgst_enable, tqpair->host_ddgst_enable, &mapped_length);
+	if (pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_C2H_DATA) {
+		nvmf_tcp_c2h_append_rsp(pdu);
+	}
 	spdk_sock_writev_async(tqpair->sock, &pdu->sock_req);
 
 	if (pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_IC_RESP ||
@@ -1439,6 +1492,31 @@ nvmf_tcp_control_msg_list_free(struct spdk_nvmf_tcp_control_msg_list *list)
 	free(list);
 }
 
+static int
+nvmf_tcp_poll_group_update_load(void *ctx)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = ctx;
+	struct spdk_thread_stats stats;
+	uint64_t busy_tsc, total_tsc;
+
+	if (spdk_thread_get_stats(&stats) != 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	busy_tsc = stats.busy_tsc - tgroup->load.busy_tsc;
+	total_tsc = busy_tsc + stats.idle_tsc - tgroup->load.idle_tsc;
+	tgroup->load.busy_tsc = stats.busy_tsc;
+	tgroup->load.idle_tsc = stats.idle_tsc;
+
+	if (total_tsc != 0) {
+		__atomic_store_n(&tgroup->load.busy_pct, (uint32_t)(busy_tsc * 100 / total_tsc),
+				 __ATOMIC_RELAXED);
+	}
+
+	/* Don't count the sampling itself as useful work */
+	return SPDK_POLLER_IDLE;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 			   struct spdk_nvmf_poll_group *group)
@@ -1477,6 +1555,13 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 		goto cleanup;
 	}
 
+	tgroup->load.poller = SPDK_POLLER_REGISTER(nvmf_tcp_poll_group_update_load, tgroup,
+			      NVMF_TCP_POLL_GROUP_LOAD_PERIOD_US);
+	if (!tgroup->load.poller) {
+		SPDK_ERRLOG("Cannot create load poller for tgroup=%p\n", tgroup);
+		goto cleanup;
+	}
+
 	TAILQ_INSERT_TAIL(&ttransport->poll_groups, tgroup, link);
 	if (ttransport->next_pg == NULL) {
 		ttransport->next_pg = tgroup;
@@ -1489,13 +1574,60 @@ cleanup:
 	return NULL;
 }
 
+static inline uint32_t
+nvmf_tcp_poll_group_get_busy_pct(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	return __atomic_load_n(&tgroup->load.busy_pct, __ATOMIC_RELAXED);
+}
+
+static uint64_t
+nvmf_tcp_poll_group_get_load(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	uint64_t busy_bucket;
+
+	busy_bucket = nvmf_tcp_poll_group_get_busy_pct(tgroup) / NVMF_TCP_POLL_GROUP_BUSY_BUCKET_PCT;
+
+	return (busy_bucket << 32) | nvmf_poll_group_get_io_qpair_count(tgroup->group.group);
+}
+
+static struct spdk_nvmf_tcp_poll_group *
+nvmf_tcp_get_least_loaded_poll_group(struct spdk_nvmf_tcp_transport *ttransport)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup, *min_tgroup;
+	uint64_t load, min_load;
+
+	/* Start at next_pg, so that equally loaded poll groups are still picked round robin */
+	tgroup = min_tgroup = ttransport->next_pg;
+	min_load = nvmf_tcp_poll_group_get_load(tgroup);
+
+	while (true) {
+		tgroup = TAILQ_NEXT(tgroup, link);
+		if (tgroup == NULL) {
+			tgroup = TAILQ_FIRST(&ttransport->poll_groups);
+		}
+
+		if (tgroup == ttransport->next_pg) {
+			break;
+		}
+
+		load = nvmf_tcp_poll_group_get_load(tgroup);
+		if (load < min_load) {
+			min_load = load;
+			min_tgroup = tgroup;
+		}
+	}
+
+	return min_tgroup;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 {
 	struct spdk_nvmf_tcp_transport *ttransport;
-	struct spdk_nvmf_tcp_poll_group **pg;
+	struct spdk_nvmf_tcp_poll_group *tgroup, *min_tgroup;
+	struct spdk_nvmf_transport_poll_group *result;
 	struct spdk_nvmf_tcp_qpair *tqpair;
-	struct spdk_sock_group *group = NULL, *hint = NULL;
+	struct spdk_sock_group *group = NULL;
 	int rc;
 
 	ttransport = SPDK_CONTAINEROF(qpair->transport, struct spdk_nvmf_tcp_transport, transport);
@@ -1504,26 +1636,36 @@ nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 		return NULL;
 	}
 
-	pg = &ttransport->next_pg;
-	assert(*pg != NULL);
-	hint = (*pg)->sock_group;
+	assert(ttransport->next_pg != NULL);
+	min_tgroup = nvmf_tcp_get_least_loaded_poll_group(ttransport);
 
 	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
-	rc = spdk_sock_get_optimal_sock_group(tqpair->sock, &group, hint);
+	rc = spdk_sock_get_optimal_sock_group(tqpair->sock, &group, min_tgroup->sock_group);
 	if (rc != 0) {
 		return NULL;
 	} else if (group != NULL) {
-		/* Optimal poll group was found */
-		return spdk_sock_group_get_ctx(group);
+		/* Optimal poll group was found.  Follow it, unless that poll group is
+		 * already considerably busier than the least loaded one. */
+		result = spdk_sock_group_get_ctx(group);
+		tgroup = SPDK_CONTAINEROF(result, struct spdk_nvmf_tcp_poll_group, group);
+		if (tgroup != min_tgroup) {
+			if (nvmf_tcp_poll_group_get_busy_pct(tgroup) <= nvmf_tcp_poll_group_get_busy_pct(min_tgroup) +
+			    NVMF_TCP_PLACEMENT_MAX_BUSY_DELTA_PCT) {
+				return result;
+			}
+
+			SPDK_DEBUGLOG(nvmf_tcp, "Ignoring placement of tqpair=%p on busy tgroup=%p\n",
+				      tqpair, tgroup);
+		}
 	}
 
-	/* The hint was used for optimal poll group, advance next_pg. */
-	*pg = TAILQ_NEXT(*pg, link);
-	if (*pg == NULL) {
-		*pg = TAILQ_FIRST(&ttransport->poll_groups);
+	/* The least loaded poll group was used, advance next_pg past it. */
+	ttransport->next_pg = TAILQ_NEXT(min_tgroup, link);
+	if (ttransport->next_pg == NULL) {
+		ttransport->next_pg = TAILQ_FIRST(&ttransport->poll_groups);
 	}
 
-	return spdk_sock_group_get_ctx(hint);
+	return &min_tgroup->group;
 }
 
 static void
@@ -1533,6 +1675,7 @@ nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 	struct spdk_nvmf_tcp_transport *ttransport;
 
 	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	spdk_poller_unregister(&tgroup->load.poller);
 	spdk_sock_group_close(&tgroup->sock_group);
 	if (tgroup->control_msg_list) {
 		nvmf_tcp_control_msg_list_free(tgroup->control_msg_list);
@@ -1845,7 +1988,8 @@ nvmf_tcp_pdu_c2h_data_complete(void *cb_arg)
 		return;
 	}
 
-	if (tcp_req->pdu->hdr.c2h_data.common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) {
+	if ((tcp_req->pdu->hdr.c2h_data.common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) ||
+	    tcp_req->c2h_rsp_pending) {
 		nvmf_tcp_request_free(tcp_req);
 	} else {
 		nvmf_tcp_send_capsule_resp_pdu(tcp_req, tqpair);
@@ -2377,12 +2521,23 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				pdu->ddgst_enable = true;
 			}
 
-			rc = nvme_tcp_read_payload_data(tqpair->sock, pdu);
+			/* The first read is usually served from the socket's receive pipe, which
+			 * only holds the part of the payload that arrived along with the headers.
+			 * Keep reading, so that the rest of the payload is received directly into
+			 * the request's data buffers in this poll instead of going through the
+			 * pipe (and being copied) on the next one. */
+			do {
+				rc = nvme_tcp_read_payload_data(tqpair->sock, pdu);
+				if (rc <= 0) {
+					break;
+				}
+				pdu->rw_offset += rc;
+			} while (pdu->rw_offset < data_len);
+
 			if (rc < 0) {
 				nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
 			}
-			pdu->rw_offset += rc;
 
 			if (pdu->rw_offset < data_len) {
 				return NVME_TCP_PDU_IN_PROGRESS;
@@ -2609,6 +2764,32 @@ nvmf_tcp_dif_error_to_compl_status(uint8_t err_type) {
 	return result;
 }
 
+/*
+ * Prepare the capsule response to be written right behind the last C2H data PDU,
+ * within the same socket request, instead of waiting for the data to be sent.
+ */
+static void
+nvmf_tcp_prep_c2h_rsp(struct spdk_nvmf_tcp_qpair *tqpair,
+		      struct spdk_nvmf_tcp_req *tcp_req)
+{
+	struct spdk_nvme_tcp_rsp *capsule_resp = &tcp_req->c2h_rsp.hdr;
+	uint32_t crc32c;
+
+	memset(capsule_resp, 0, sizeof(*capsule_resp));
+	capsule_resp->common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_RESP;
+	capsule_resp->common.plen = capsule_resp->common.hlen = sizeof(*capsule_resp);
+	capsule_resp->rccqe = tcp_req->req.rsp->nvme_cpl;
+	if (tqpair->host_hdgst_enable) {
+		capsule_resp->common.flags |= SPDK_NVME_TCP_CH_FLAGS_HDGSTF;
+		capsule_resp->common.plen += SPDK_NVME_TCP_DIGEST_LEN;
+		crc32c = spdk_crc32c_update(capsule_resp, sizeof(*capsule_resp), ~0);
+		crc32c = crc32c ^ SPDK_CRC32C_XOR;
+		MAKE_DIGEST_WORD(tcp_req->c2h_rsp.hdgst, crc32c);
+	}
+
+	tcp_req->c2h_rsp_pending = true;
+}
+
 static void
 _nvmf_tcp_send_c2h_data(struct spdk_nvmf_tcp_qpair *tqpair,
 			struct spdk_nvmf_tcp_req *tcp_req)
@@ -2725,6 +2906,12 @@ _nvmf_tcp_send_c2h_data(struct spdk_nvmf_tcp_qpair *tqpair,
 		}
 	}
 
+	tcp_req->c2h_rsp_pending = false;
+	if ((c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU) &&
+	    !(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS)) {
+		nvmf_tcp_prep_c2h_rsp(tqpair, tcp_req);
+	}
+
 	rsp_pdu->rw_offset += c2h_data->datal;
 	nvmf_tcp_qpair_write_req_pdu(tqpair, tcp_req, nvmf_tcp_pdu_c2h_data_complete, tcp_req);
 }
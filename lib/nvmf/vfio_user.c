@@ -4747,6 +4747,39 @@ nvmf_vfio_user_poll_group_create(struct spdk_nvmf_transport *transport,
 	return &vu_group->group;
 }
 
+/*
+ * Return the poll group that owns I/O CQ cqid of a controller whose admin queue
+ * is on admin_group.  Guests typically create I/O queue N for their Nth vCPU,
+ * so CQ N goes N poll groups after admin_group: the I/O queues of a controller
+ * are spread over all poll groups, with consecutive vCPUs on distinct ones.
+ * As admin queues themselves are distributed round robin, different
+ * controllers start from different poll groups.
+ *
+ * Must be called with pg_lock held.
+ */
+static struct nvmf_vfio_user_poll_group *
+vfio_user_cq_to_poll_group(struct nvmf_vfio_user_transport *vu_transport,
+			   struct nvmf_vfio_user_poll_group *admin_group, uint16_t cqid)
+{
+	struct nvmf_vfio_user_poll_group *vu_group;
+	uint32_t num_groups = 0, offset;
+
+	TAILQ_FOREACH(vu_group, &vu_transport->poll_groups, link) {
+		num_groups++;
+	}
+	assert(num_groups > 0);
+
+	vu_group = admin_group;
+	for (offset = cqid % num_groups; offset > 0; offset--) {
+		vu_group = TAILQ_NEXT(vu_group, link);
+		if (vu_group == NULL) {
+			vu_group = TAILQ_FIRST(&vu_transport->poll_groups);
+		}
+	}
+
+	return vu_group;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_vfio_user_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 {
@@ -4790,6 +4823,16 @@ nvmf_vfio_user_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 			goto out;
 		}
 
+		/*
+		 * Otherwise, shard the controller's I/O queues over all poll
+		 * groups based on the CQ ID, rather than taking the next poll
+		 * group in the transport-wide round robin.  The latter can end
+		 * up placing many queues of one controller on the same few poll
+		 * groups when several controllers create queues concurrently.
+		 */
+		result = &vfio_user_cq_to_poll_group(vu_transport, ctrlr_to_poll_group(sq->ctrlr),
+						     sq->cqid)->group;
+		goto out;
 	}
 
 	vu_group = &vu_transport->next_pg;
@@ -14,6 +14,8 @@ DEFINE_WRAPPER(pthread_mutex_init, int,
 DEFINE_WRAPPER(pthread_mutexattr_init, int,
 	       (pthread_mutexattr_t *attr), (attr))
 
+DEFINE_WRAPPER(readv, ssize_t, (int fd, const struct iovec *iov, int iovcnt), (fd, iov, iovcnt))
+
 DEFINE_WRAPPER(recvmsg, ssize_t, (int sockfd, struct msghdr *msg, int flags), (sockfd, msg, flags))
 
 DEFINE_WRAPPER(sendmsg, ssize_t, (int sockfd, const struct msghdr *msg, int flags), (sockfd, msg,
@@ -446,6 +446,52 @@ spdk_bit_pool_allocate_bit(struct spdk_bit_pool *pool)
 	return bit_index;
 }
 
+int
+spdk_bit_pool_allocate_bit_at(struct spdk_bit_pool *pool, uint32_t bit_index)
+{
+	if (bit_index >= spdk_bit_array_capacity(pool->array)) {
+		return -EINVAL;
+	}
+
+	if (spdk_bit_array_get(pool->array, bit_index)) {
+		return -EBUSY;
+	}
+
+	spdk_bit_array_set(pool->array, bit_index);
+	if (bit_index == pool->lowest_free_bit) {
+		pool->lowest_free_bit = spdk_bit_array_find_first_clear(pool->array, bit_index);
+	}
+	pool->free_count--;
+	return 0;
+}
+
+uint32_t
+spdk_bit_pool_find_free_range(const struct spdk_bit_pool *pool, uint32_t start_bit_index,
+			      uint32_t num_bits)
+{
+	uint32_t bit_index, next_set;
+
+	if (start_bit_index < pool->lowest_free_bit) {
+		start_bit_index = pool->lowest_free_bit;
+	}
+
+	bit_index = spdk_bit_array_find_first_clear(pool->array, start_bit_index);
+	while (bit_index != UINT32_MAX) {
+		next_set = spdk_bit_array_find_first_set(pool->array, bit_index);
+		if (next_set == UINT32_MAX) {
+			next_set = spdk_bit_array_capacity(pool->array);
+		}
+
+		if (next_set - bit_index >= num_bits) {
+			return bit_index;
+		}
+
+		bit_index = spdk_bit_array_find_first_clear(pool->array, next_set);
+	}
+
+	return UINT32_MAX;
+}
+
 void
 spdk_bit_pool_free_bit(struct spdk_bit_pool *pool, uint32_t bit_index)
 {
@@ -7,6 +7,7 @@ SPDK_MOCK_SYSCALLS += \
 	calloc \
 	pthread_mutexattr_init \
 	pthread_mutex_init \
+	readv \
 	recvmsg \
 	sendmsg \
 	writev
@@ -20,6 +20,8 @@ struct vbdev_lvol_io {
 
 static TAILQ_HEAD(, lvol_store_bdev) g_spdk_lvol_pairs = TAILQ_HEAD_INITIALIZER(
 			g_spdk_lvol_pairs);
+static TAILQ_HEAD(, lvol_store_recovery) g_lvs_recoveries = TAILQ_HEAD_INITIALIZER(
+			g_lvs_recoveries);
 
 static int vbdev_lvs_init(void);
 static void vbdev_lvs_fini_start(void);
@@ -215,16 +217,7 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 		 enum lvs_clear_method clear_method, uint32_t num_md_pages_per_cluster_ratio,
 		 spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
-	struct spdk_bs_dev *bs_dev;
-	struct spdk_lvs_with_handle_req *lvs_req;
 	struct spdk_lvs_opts opts;
-	int rc;
-	int len;
-
-	if (base_bdev_name == NULL) {
-		SPDK_ERRLOG("missing base_bdev_name param\n");
-		return -EINVAL;
-	}
 
 	spdk_lvs_opts_init(&opts);
 	if (cluster_sz != 0) {
@@ -239,6 +232,23 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 		opts.num_md_pages_per_cluster_ratio = num_md_pages_per_cluster_ratio;
 	}
 
+	return vbdev_lvs_create_ext(base_bdev_name, name, &opts, cb_fn, cb_arg);
+}
+
+int
+vbdev_lvs_create_ext(const char *base_bdev_name, const char *name, struct spdk_lvs_opts *opts,
+		     spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_dev *bs_dev;
+	struct spdk_lvs_with_handle_req *lvs_req;
+	int rc;
+	int len;
+
+	if (base_bdev_name == NULL) {
+		SPDK_ERRLOG("missing base_bdev_name param\n");
+		return -EINVAL;
+	}
+
 	if (name == NULL) {
 		SPDK_ERRLOG("missing name param\n");
 		return -EINVAL;
@@ -250,8 +260,8 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 		SPDK_ERRLOG("name must be between 1 and %d characters\n", SPDK_LVS_NAME_MAX - 1);
 		return -EINVAL;
 	}
-	snprintf(opts.name, sizeof(opts.name), "%s", name);
-	opts.esnap_bs_dev_create = vbdev_lvol_esnap_dev_create;
+	snprintf(opts->name, sizeof(opts->name), "%s", name);
+	opts->esnap_bs_dev_create = vbdev_lvol_esnap_dev_create;
 
 	lvs_req = calloc(1, sizeof(*lvs_req));
 	if (!lvs_req) {
@@ -272,7 +282,7 @@ vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_
 	lvs_req->cb_fn = cb_fn;
 	lvs_req->cb_arg = cb_arg;
 
-	rc = spdk_lvs_init(bs_dev, &opts, _vbdev_lvs_create_cb, lvs_req);
+	rc = spdk_lvs_init(bs_dev, opts, _vbdev_lvs_create_cb, lvs_req);
 	if (rc < 0) {
 		free(lvs_req);
 		bs_dev->destroy(bs_dev);
@@ -1608,6 +1618,62 @@ vbdev_lvs_examine_config(struct spdk_bdev *bdev)
 	spdk_bdev_module_examine_done(&g_lvol_if);
 }
 
+static struct lvol_store_recovery *
+vbdev_lvs_recovery_get(struct spdk_bdev *bdev)
+{
+	struct lvol_store_recovery *recovery;
+
+	TAILQ_FOREACH(recovery, &g_lvs_recoveries, link) {
+		if (recovery->bdev == bdev) {
+			return recovery;
+		}
+	}
+
+	return NULL;
+}
+
+struct lvol_store_recovery *
+vbdev_lvs_recovery_next(struct lvol_store_recovery *prev)
+{
+	if (prev == NULL) {
+		return TAILQ_FIRST(&g_lvs_recoveries);
+	}
+
+	return TAILQ_NEXT(prev, link);
+}
+
+static void
+vbdev_lvs_recovery_progress(void *cb_arg, const struct spdk_bs_recovery_progress *progress)
+{
+	struct spdk_bdev *bdev = cb_arg;
+	struct lvol_store_recovery *recovery;
+
+	recovery = vbdev_lvs_recovery_get(bdev);
+	if (recovery == NULL) {
+		recovery = calloc(1, sizeof(*recovery));
+		if (recovery == NULL) {
+			return;
+		}
+		recovery->bdev = bdev;
+		TAILQ_INSERT_TAIL(&g_lvs_recoveries, recovery, link);
+		SPDK_NOTICELOG("Recovering lvol store on %s\n", bdev->name);
+	}
+
+	recovery->progress = *progress;
+}
+
+static void
+vbdev_lvs_recovery_done(struct spdk_bdev *bdev)
+{
+	struct lvol_store_recovery *recovery;
+
+	recovery = vbdev_lvs_recovery_get(bdev);
+	if (recovery != NULL) {
+		TAILQ_REMOVE(&g_lvs_recoveries, recovery, link);
+		free(recovery);
+	}
+}
+
 static void
 _vbdev_lvs_examine_cb(void *arg, struct spdk_lvol_store *lvol_store, int lvserrno)
 {
@@ -1616,6 +1682,8 @@ _vbdev_lvs_examine_cb(void *arg, struct spdk_lvol_store *lvol_store, int lvserrn
 	struct spdk_lvol *lvol, *tmp;
 	struct spdk_lvs_req *ori_req = req->cb_arg;
 
+	vbdev_lvs_recovery_done(req->base_bdev);
+
 	if (lvserrno == -EEXIST) {
 		SPDK_INFOLOG(vbdev_lvol,
 			     "Name for lvolstore on device %s conflicts with name for already loaded lvs\n",
@@ -1714,10 +1782,13 @@ vbdev_lvs_examine_done(void *arg, int lvserrno)
 static void
 vbdev_lvs_load(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
+	struct spdk_lvs_with_handle_req *req = cb_arg;
 	struct spdk_lvs_opts lvs_opts;
 
 	spdk_lvs_opts_init(&lvs_opts);
 	lvs_opts.esnap_bs_dev_create = vbdev_lvol_esnap_dev_create;
+	lvs_opts.recovery_progress_fn = vbdev_lvs_recovery_progress;
+	lvs_opts.recovery_progress_arg = req->base_bdev;
 	spdk_lvs_load_ext(bs_dev, &lvs_opts, cb_fn, cb_arg);
 }
 
@@ -21,6 +21,14 @@ struct lvol_store_bdev {
 	TAILQ_ENTRY(lvol_store_bdev)	lvol_stores;
 };
 
+/* Recovery of a lvolstore that was not shut down cleanly, while it is being loaded */
+struct lvol_store_recovery {
+	struct spdk_bdev			*bdev;
+	struct spdk_bs_recovery_progress	progress;
+
+	TAILQ_ENTRY(lvol_store_recovery)	link;
+};
+
 struct lvol_bdev {
 	struct spdk_bdev	bdev;
 	struct spdk_lvol	*lvol;
@@ -30,6 +38,12 @@ struct lvol_bdev {
 int vbdev_lvs_create(const char *base_bdev_name, const char *name, uint32_t cluster_sz,
 		     enum lvs_clear_method clear_method, uint32_t num_md_pages_per_cluster_ratio,
 		     spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg);
+/**
+ * Create a lvolstore named name on base_bdev_name with the other options of opts, which must be
+ * initialized with spdk_lvs_opts_init().
+ */
+int vbdev_lvs_create_ext(const char *base_bdev_name, const char *name, struct spdk_lvs_opts *opts,
+			 spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg);
 void vbdev_lvs_destruct(struct spdk_lvol_store *lvs, spdk_lvs_op_complete cb_fn, void *cb_arg);
 void vbdev_lvs_unload(struct spdk_lvol_store *lvs, spdk_lvs_op_complete cb_fn, void *cb_arg);
 
@@ -111,6 +125,13 @@ struct lvol_store_bdev *vbdev_get_lvs_bdev_by_lvs(struct spdk_lvol_store *lvs);
 
 struct spdk_lvol *vbdev_lvol_get_from_bdev(struct spdk_bdev *bdev);
 
+/**
+ * \brief Iterate over the lvolstores being recovered
+ * \param prev Previous recovery, or NULL to get the first one
+ * \return Next recovery in progress or NULL if there are no more.
+ */
+struct lvol_store_recovery *vbdev_lvs_recovery_next(struct lvol_store_recovery *prev);
+
 /**
  * \brief Grow given lvolstore.
  *
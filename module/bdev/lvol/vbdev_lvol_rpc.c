@@ -19,6 +19,9 @@ struct rpc_bdev_lvol_create_lvstore {
 	uint32_t cluster_sz;
 	char *clear_method;
 	uint32_t num_md_pages_per_cluster_ratio;
+	char *cluster_allocator;
+	uint32_t cluster_extent_sz;
+	uint32_t background_free_rate;
 };
 
 static int
@@ -57,6 +60,7 @@ free_rpc_bdev_lvol_create_lvstore(struct rpc_bdev_lvol_create_lvstore *req)
 	free(req->bdev_name);
 	free(req->lvs_name);
 	free(req->clear_method);
+	free(req->cluster_allocator);
 }
 
 static const struct spdk_json_object_decoder rpc_bdev_lvol_create_lvstore_decoders[] = {
@@ -65,6 +69,9 @@ static const struct spdk_json_object_decoder rpc_bdev_lvol_create_lvstore_decode
 	{"lvs_name", offsetof(struct rpc_bdev_lvol_create_lvstore, lvs_name), spdk_json_decode_string},
 	{"clear_method", offsetof(struct rpc_bdev_lvol_create_lvstore, clear_method), spdk_json_decode_string, true},
 	{"num_md_pages_per_cluster_ratio", offsetof(struct rpc_bdev_lvol_create_lvstore, num_md_pages_per_cluster_ratio), spdk_json_decode_uint32, true},
+	{"cluster_allocator", offsetof(struct rpc_bdev_lvol_create_lvstore, cluster_allocator), spdk_json_decode_string, true},
+	{"cluster_extent_sz", offsetof(struct rpc_bdev_lvol_create_lvstore, cluster_extent_sz), spdk_json_decode_uint32, true},
+	{"background_free_rate", offsetof(struct rpc_bdev_lvol_create_lvstore, background_free_rate), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -95,6 +102,7 @@ rpc_bdev_lvol_create_lvstore(struct spdk_jsonrpc_request *request,
 			     const struct spdk_json_val *params)
 {
 	struct rpc_bdev_lvol_create_lvstore req = {};
+	struct spdk_lvs_opts opts;
 	int rc = 0;
 	enum lvs_clear_method clear_method;
 
@@ -122,8 +130,30 @@ rpc_bdev_lvol_create_lvstore(struct spdk_jsonrpc_request *request,
 		clear_method = LVS_CLEAR_WITH_UNMAP;
 	}
 
-	rc = vbdev_lvs_create(req.bdev_name, req.lvs_name, req.cluster_sz, clear_method,
-			      req.num_md_pages_per_cluster_ratio, rpc_lvol_store_construct_cb, request);
+	spdk_lvs_opts_init(&opts);
+	if (req.cluster_sz != 0) {
+		opts.cluster_sz = req.cluster_sz;
+	}
+	opts.clear_method = clear_method;
+	if (req.num_md_pages_per_cluster_ratio != 0) {
+		opts.num_md_pages_per_cluster_ratio = req.num_md_pages_per_cluster_ratio;
+	}
+
+	if (req.cluster_allocator != NULL) {
+		if (!strcasecmp(req.cluster_allocator, "first_fit")) {
+			opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_FIRST_FIT;
+		} else if (!strcasecmp(req.cluster_allocator, "extent")) {
+			opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_EXTENT;
+		} else {
+			spdk_jsonrpc_send_error_response(request, -EINVAL, "Invalid cluster_allocator parameter");
+			goto cleanup;
+		}
+	}
+	opts.cluster_extent_sz = req.cluster_extent_sz;
+	opts.background_free_rate = req.background_free_rate;
+
+	rc = vbdev_lvs_create_ext(req.bdev_name, req.lvs_name, &opts, rpc_lvol_store_construct_cb,
+				  request);
 	if (rc < 0) {
 		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
 		goto cleanup;
@@ -1172,6 +1202,44 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_lvol_get_lvstores", rpc_bdev_lvol_get_lvstores, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_lvol_get_lvstores, get_lvol_stores)
 
+static void
+rpc_bdev_lvol_get_recovery_status(struct spdk_jsonrpc_request *request,
+				  const struct spdk_json_val *params)
+{
+	struct spdk_json_write_ctx *w;
+	struct lvol_store_recovery *recovery;
+	const struct spdk_bs_recovery_progress *progress;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "bdev_lvol_get_recovery_status requires no parameters");
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+
+	for (recovery = vbdev_lvs_recovery_next(NULL); recovery != NULL;
+	     recovery = vbdev_lvs_recovery_next(recovery)) {
+		progress = &recovery->progress;
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "base_bdev", spdk_bdev_get_name(recovery->bdev));
+		spdk_json_write_named_uint64(w, "md_pages_total", progress->md_pages_total);
+		spdk_json_write_named_uint64(w, "md_pages_scanned", progress->md_pages_scanned);
+		spdk_json_write_named_uint64(w, "md_pages_used", progress->md_pages_used);
+		spdk_json_write_named_uint64(w, "md_pages_parsed", progress->md_pages_parsed);
+		spdk_json_write_named_uint64(w, "num_blobs", progress->num_blobs);
+		spdk_json_write_object_end(w);
+	}
+
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_get_recovery_status", rpc_bdev_lvol_get_recovery_status,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_get_lvols {
 	char *lvs_uuid;
 	char *lvs_name;
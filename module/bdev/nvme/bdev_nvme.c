@@ -36,6 +36,9 @@
 
 #define NSID_STR_LEN 10
 
+/* Upper bound of the Reclaim Unit Handle Status read from a namespace */
+#define NVME_NS_RUHS_MAX_SIZE (64 * 1024)
+
 static int bdev_nvme_config_json(struct spdk_json_write_ctx *w);
 
 struct nvme_bdev_io {
@@ -161,7 +164,7 @@ static int bdev_nvme_no_pi_readv(struct nvme_bdev_io *bio, struct iovec *iov, in
 static int bdev_nvme_writev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 			    void *md, uint64_t lba_count, uint64_t lba,
 			    uint32_t flags, struct spdk_memory_domain *domain, void *domain_ctx,
-			    struct spdk_accel_sequence *seq);
+			    struct spdk_accel_sequence *seq, uint16_t placement_hint);
 static int bdev_nvme_zone_appendv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 				  void *md, uint64_t lba_count,
 				  uint64_t zslba, uint32_t flags);
@@ -2005,6 +2008,9 @@ bdev_nvme_start_reconnect_delay_timer(struct nvme_ctrlr *nvme_ctrlr)
 }
 
 static void remove_discovery_entry(struct nvme_ctrlr *nvme_ctrlr);
+struct bdev_nvme_set_interrupt_coalescing_ctx;
+static int bdev_nvme_apply_interrupt_coalescing(struct nvme_ctrlr *nvme_ctrlr,
+		struct bdev_nvme_set_interrupt_coalescing_ctx *ctx);
 
 static void
 _bdev_nvme_reset_ctrlr_complete(struct spdk_io_channel_iter *i, int status)
@@ -2034,6 +2040,13 @@ _bdev_nvme_reset_ctrlr_complete(struct spdk_io_channel_iter *i, int status)
 	op_after_reset = bdev_nvme_check_op_after_reset(nvme_ctrlr, success);
 	pthread_mutex_unlock(&nvme_ctrlr->mutex);
 
+	/* Feature settings do not survive a controller reset. */
+	if (success && nvme_ctrlr->int_coalescing_set) {
+		if (bdev_nvme_apply_interrupt_coalescing(nvme_ctrlr, NULL) != 0) {
+			SPDK_ERRLOG("Failed to restore interrupt coalescing after reset.\n");
+		}
+	}
+
 	if (ctrlr_op_cb_fn) {
 		ctrlr_op_cb_fn(ctrlr_op_cb_arg, success ? 0 : -1);
 	}
@@ -2947,7 +2960,8 @@ _bdev_nvme_submit_request(struct nvme_bdev_channel *nbdev_ch, struct spdk_bdev_i
 				      bdev->dif_check_flags,
 				      bdev_io->u.bdev.memory_domain,
 				      bdev_io->u.bdev.memory_domain_ctx,
-				      bdev_io->u.bdev.accel_sequence);
+				      bdev_io->u.bdev.accel_sequence,
+				      bdev_io->u.bdev.placement_hint);
 		break;
 	case SPDK_BDEV_IO_TYPE_COMPARE:
 		rc = bdev_nvme_comparev(nbdev_io,
@@ -4319,6 +4333,7 @@ nvme_ns_alloc(void)
 static void
 nvme_ns_free(struct nvme_ns *nvme_ns)
 {
+	free(nvme_ns->placement_handles);
 	free(nvme_ns->stat);
 	free(nvme_ns);
 }
@@ -4442,18 +4457,212 @@ nvme_bdev_add_ns(struct nvme_bdev *bdev, struct nvme_ns *nvme_ns)
 	return 0;
 }
 
+static void
+nvme_ns_populate_bdev(struct nvme_ns *nvme_ns)
+{
+	struct nvme_ctrlr	*nvme_ctrlr = nvme_ns->ctrlr;
+	struct nvme_bdev	*bdev;
+	int			rc;
+
+	bdev = nvme_bdev_ctrlr_get_bdev(nvme_ctrlr->nbdev_ctrlr, nvme_ns->id);
+	if (bdev == NULL) {
+		rc = nvme_bdev_create(nvme_ctrlr, nvme_ns);
+	} else {
+		rc = nvme_bdev_add_ns(bdev, nvme_ns);
+		if (rc == 0) {
+			return;
+		}
+	}
+
+	nvme_ctrlr_populate_namespace_done(nvme_ns, rc);
+}
+
+struct nvme_ns_ruhs_ctx {
+	struct nvme_ns			*nvme_ns;
+	struct spdk_nvme_qpair		*qpair;
+	struct spdk_poller		*poller;
+	struct spdk_nvme_fdp_ruhs	*ruhs;
+	uint32_t			ruhs_size;
+	bool				done;
+	int				rc;
+};
+
+/* Build the placement handle list of the namespace from its Reclaim Unit Handle Status.
+ * The status has a descriptor per placement handle and reclaim group, so the reclaim group
+ * is masked out of the placement identifiers and each placement handle is kept once.
+ */
+static int
+nvme_ns_set_placement_handles(struct nvme_ns *nvme_ns, const struct spdk_nvme_fdp_ruhs *ruhs,
+			      uint32_t ruhs_size)
+{
+	const struct spdk_nvme_fdp_cfg_descriptor *fdp_cfg;
+	uint16_t *handles, phndl, phndl_mask = UINT16_MAX;
+	uint32_t num_desc, num_handles = 0, i, j;
+
+	fdp_cfg = spdk_nvme_ns_get_fdp_cfg(nvme_ns->ns);
+	if (fdp_cfg == NULL) {
+		return -EINVAL;
+	}
+
+	if (fdp_cfg->fdpa.bits.rgif != 0) {
+		phndl_mask = (1U << (16 - fdp_cfg->fdpa.bits.rgif)) - 1;
+	}
+
+	num_desc = spdk_min(ruhs->nruhsd, (ruhs_size - sizeof(*ruhs)) / sizeof(ruhs->ruhs_desc[0]));
+	if (num_desc == 0) {
+		return -ENOENT;
+	}
+
+	handles = calloc(num_desc, sizeof(*handles));
+	if (handles == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_desc; i++) {
+		phndl = ruhs->ruhs_desc[i].pid & phndl_mask;
+		for (j = 0; j < num_handles; j++) {
+			if (handles[j] == phndl) {
+				break;
+			}
+		}
+		if (j == num_handles) {
+			handles[num_handles++] = phndl;
+		}
+	}
+
+	free(nvme_ns->placement_handles);
+	nvme_ns->placement_handles = handles;
+	nvme_ns->num_placement_handles = num_handles;
+
+	return 0;
+}
+
+static void
+nvme_ns_read_placement_handles_done(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_ns_ruhs_ctx *ctx = cb_arg;
+
+	ctx->done = true;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		ctx->rc = -EIO;
+		return;
+	}
+
+	ctx->rc = nvme_ns_set_placement_handles(ctx->nvme_ns, ctx->ruhs, ctx->ruhs_size);
+}
+
+static void
+nvme_ns_read_placement_handles_finish(struct nvme_ns_ruhs_ctx *ctx)
+{
+	struct nvme_ns *nvme_ns = ctx->nvme_ns;
+
+	if (ctx->rc != 0) {
+		SPDK_WARNLOG("Failed to read placement handles of NS %u, placement hints are "
+			     "ignored: %d\n", nvme_ns->id, ctx->rc);
+	}
+
+	spdk_poller_unregister(&ctx->poller);
+	if (ctx->qpair != NULL) {
+		spdk_nvme_ctrlr_free_io_qpair(ctx->qpair);
+	}
+	spdk_free(ctx->ruhs);
+	free(ctx);
+
+	nvme_ns_populate_bdev(nvme_ns);
+}
+
+static int
+nvme_ns_read_placement_handles_poll(void *arg)
+{
+	struct nvme_ns_ruhs_ctx *ctx = arg;
+	int32_t rc;
+
+	rc = spdk_nvme_qpair_process_completions(ctx->qpair, 0);
+	if (rc < 0) {
+		ctx->rc = rc;
+	} else if (!ctx->done) {
+		return rc > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+	}
+
+	nvme_ns_read_placement_handles_finish(ctx);
+	return SPDK_POLLER_BUSY;
+}
+
+/* The placement handles of a namespace are only reported by an I/O command, so a
+ * temporary I/O qpair is used to read them while the namespace is populated.
+ */
+static void
+nvme_ns_read_placement_handles(struct nvme_ns *nvme_ns,
+			       const struct spdk_nvme_fdp_cfg_descriptor *fdp_cfg)
+{
+	struct spdk_nvme_ctrlr *ctrlr = nvme_ns->ctrlr->ctrlr;
+	struct spdk_nvme_io_qpair_opts opts;
+	struct nvme_ns_ruhs_ctx *ctx;
+	uint64_t ruhs_size;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_WARNLOG("Failed to alloc placement handles context of NS %u\n", nvme_ns->id);
+		nvme_ns_populate_bdev(nvme_ns);
+		return;
+	}
+	ctx->nvme_ns = nvme_ns;
+
+	/* At most a descriptor per reclaim unit handle and reclaim group */
+	ruhs_size = sizeof(*ctx->ruhs) + (uint64_t)fdp_cfg->nruh * spdk_max(fdp_cfg->nrg, 1) *
+		    sizeof(ctx->ruhs->ruhs_desc[0]);
+	ctx->ruhs_size = spdk_min(ruhs_size, NVME_NS_RUHS_MAX_SIZE);
+	ctx->ruhs = spdk_zmalloc(ctx->ruhs_size, 0, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (ctx->ruhs == NULL) {
+		ctx->rc = -ENOMEM;
+		goto err;
+	}
+
+	spdk_nvme_ctrlr_get_default_io_qpair_opts(ctrlr, &opts, sizeof(opts));
+	opts.create_only = true;
+	ctx->qpair = spdk_nvme_ctrlr_alloc_io_qpair(ctrlr, &opts, sizeof(opts));
+	if (ctx->qpair == NULL) {
+		ctx->rc = -ENOMEM;
+		goto err;
+	}
+
+	ctx->rc = spdk_nvme_ctrlr_connect_io_qpair(ctrlr, ctx->qpair);
+	if (ctx->rc != 0) {
+		goto err;
+	}
+
+	ctx->rc = spdk_nvme_ns_cmd_io_mgmt_recv(nvme_ns->ns, ctx->qpair, ctx->ruhs, ctx->ruhs_size,
+						SPDK_NVME_FDP_IO_MGMT_RECV_RUHS, 0,
+						nvme_ns_read_placement_handles_done, ctx);
+	if (ctx->rc != 0) {
+		goto err;
+	}
+
+	ctx->poller = SPDK_POLLER_REGISTER(nvme_ns_read_placement_handles_poll, ctx, 0);
+	if (ctx->poller == NULL) {
+		/* Nothing else polls the qpair, the command is aborted when it is freed */
+		ctx->rc = -ENOMEM;
+		goto err;
+	}
+
+	return;
+
+err:
+	nvme_ns_read_placement_handles_finish(ctx);
+}
+
 static void
 nvme_ctrlr_populate_namespace(struct nvme_ctrlr *nvme_ctrlr, struct nvme_ns *nvme_ns)
 {
 	struct spdk_nvme_ns	*ns;
-	struct nvme_bdev	*bdev;
-	int			rc = 0;
+	const struct spdk_nvme_fdp_cfg_descriptor *fdp_cfg;
 
 	ns = spdk_nvme_ctrlr_get_ns(nvme_ctrlr->ctrlr, nvme_ns->id);
 	if (!ns) {
 		SPDK_DEBUGLOG(bdev_nvme, "Invalid NS %d\n", nvme_ns->id);
-		rc = -EINVAL;
-		goto done;
+		nvme_ctrlr_populate_namespace_done(nvme_ns, -EINVAL);
+		return;
 	}
 
 	nvme_ns->ns = ns;
@@ -4463,17 +4672,13 @@ nvme_ctrlr_populate_namespace(struct nvme_ctrlr *nvme_ctrlr, struct nvme_ns *nvm
 		bdev_nvme_parse_ana_log_page(nvme_ctrlr, nvme_ns_set_ana_state, nvme_ns);
 	}
 
-	bdev = nvme_bdev_ctrlr_get_bdev(nvme_ctrlr->nbdev_ctrlr, nvme_ns->id);
-	if (bdev == NULL) {
-		rc = nvme_bdev_create(nvme_ctrlr, nvme_ns);
-	} else {
-		rc = nvme_bdev_add_ns(bdev, nvme_ns);
-		if (rc == 0) {
-			return;
-		}
+	fdp_cfg = spdk_nvme_ns_get_fdp_cfg(ns);
+	if (fdp_cfg != NULL && fdp_cfg->nruh != 0) {
+		nvme_ns_read_placement_handles(nvme_ns, fdp_cfg);
+		return;
 	}
-done:
-	nvme_ctrlr_populate_namespace_done(nvme_ns, rc);
+
+	nvme_ns_populate_bdev(nvme_ns);
 }
 
 static void
@@ -5052,6 +5257,129 @@ exit:
 	cb_fn(cb_arg, rc);
 }
 
+struct bdev_nvme_set_interrupt_coalescing_ctx {
+	bdev_nvme_set_interrupt_coalescing_cb cb_fn;
+	void *cb_arg;
+	uint32_t outstanding;
+	int rc;
+};
+
+static void
+bdev_nvme_set_interrupt_coalescing_done(struct bdev_nvme_set_interrupt_coalescing_ctx *ctx,
+					int rc)
+{
+	if (rc != 0 && ctx->rc == 0) {
+		ctx->rc = rc;
+	}
+
+	assert(ctx->outstanding > 0);
+	if (--ctx->outstanding > 0) {
+		return;
+	}
+
+	if (ctx->cb_fn != NULL) {
+		ctx->cb_fn(ctx->cb_arg, ctx->rc);
+	}
+	free(ctx);
+}
+
+static void
+bdev_nvme_interrupt_coalescing_cpl(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct bdev_nvme_set_interrupt_coalescing_ctx *ctx = cb_arg;
+
+	if (spdk_nvme_cpl_is_error(cpl)) {
+		SPDK_ERRLOG("Failed to set interrupt coalescing, sct 0x%x sc 0x%x\n",
+			    cpl->status.sct, cpl->status.sc);
+	}
+
+	if (ctx != NULL) {
+		bdev_nvme_set_interrupt_coalescing_done(ctx, spdk_nvme_cpl_is_error(cpl) ? -EIO : 0);
+	}
+}
+
+static int
+bdev_nvme_apply_interrupt_coalescing(struct nvme_ctrlr *nvme_ctrlr,
+				     struct bdev_nvme_set_interrupt_coalescing_ctx *ctx)
+{
+	return spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(nvme_ctrlr->ctrlr,
+			nvme_ctrlr->int_coalescing.bits.thr,
+			nvme_ctrlr->int_coalescing.bits.time,
+			bdev_nvme_interrupt_coalescing_cpl, ctx);
+}
+
+int
+bdev_nvme_set_interrupt_coalescing(const char *name, uint8_t threshold, uint8_t time,
+				   bdev_nvme_set_interrupt_coalescing_cb cb_fn, void *cb_arg)
+{
+	struct bdev_nvme_set_interrupt_coalescing_ctx *ctx;
+	struct nvme_bdev_ctrlr *nbdev_ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr;
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to alloc context.\n");
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	pthread_mutex_lock(&g_bdev_nvme_mutex);
+
+	nbdev_ctrlr = nvme_bdev_ctrlr_get_by_name(name);
+	if (nbdev_ctrlr == NULL) {
+		pthread_mutex_unlock(&g_bdev_nvme_mutex);
+		SPDK_ERRLOG("Failed at NVMe bdev controller lookup\n");
+		free(ctx);
+		return -ENODEV;
+	}
+
+	TAILQ_FOREACH(nvme_ctrlr, &nbdev_ctrlr->ctrlrs, tailq) {
+		if (spdk_nvme_ctrlr_is_fabrics(nvme_ctrlr->ctrlr)) {
+			pthread_mutex_unlock(&g_bdev_nvme_mutex);
+			SPDK_ERRLOG("Interrupt coalescing is not supported by fabrics controllers\n");
+			free(ctx);
+			return -ENOTSUP;
+		}
+	}
+
+	/* Hold a reference on the context until all the commands are submitted. */
+	ctx->outstanding = 1;
+
+	TAILQ_FOREACH(nvme_ctrlr, &nbdev_ctrlr->ctrlrs, tailq) {
+		pthread_mutex_lock(&nvme_ctrlr->mutex);
+		nvme_ctrlr->int_coalescing_set = true;
+		nvme_ctrlr->int_coalescing.raw = 0;
+		nvme_ctrlr->int_coalescing.bits.thr = threshold;
+		nvme_ctrlr->int_coalescing.bits.time = time;
+
+		/* The settings are applied once the ongoing reset completes. */
+		if (nvme_ctrlr->resetting || nvme_ctrlr->disabled) {
+			pthread_mutex_unlock(&nvme_ctrlr->mutex);
+			continue;
+		}
+		pthread_mutex_unlock(&nvme_ctrlr->mutex);
+
+		ctx->outstanding++;
+		rc = bdev_nvme_apply_interrupt_coalescing(nvme_ctrlr, ctx);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to submit interrupt coalescing, rc %d\n", rc);
+			ctx->outstanding--;
+			if (ctx->rc == 0) {
+				ctx->rc = rc;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&g_bdev_nvme_mutex);
+
+	bdev_nvme_set_interrupt_coalescing_done(ctx, 0);
+
+	return 0;
+}
+
 static void
 aer_cb(void *arg, const struct spdk_nvme_cpl *cpl)
 {
@@ -7397,14 +7725,53 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	return rc;
 }
 
+/* Map a bdev placement hint onto the Directive Specific field of a write, i.e. onto
+ * a placement identifier of the namespace.  Hints are spread over the placement handles
+ * of the namespace first and then over the reclaim groups.  The reclaim group is only
+ * encoded, in the RGIF most significant bits of the placement identifier, if the FDP
+ * configuration has several reclaim groups.  Returns false if no hint is given or the
+ * namespace has no placement handles.
+ */
+static bool
+bdev_nvme_get_placement_dspec(struct nvme_ns *nvme_ns, uint16_t placement_hint, uint16_t *dspec)
+{
+	const struct spdk_nvme_fdp_cfg_descriptor *fdp_cfg;
+	uint32_t nrg = 1, rgid;
+	uint8_t rgif;
+
+	if (placement_hint == 0 || nvme_ns->num_placement_handles == 0) {
+		return false;
+	}
+
+	fdp_cfg = spdk_nvme_ns_get_fdp_cfg(nvme_ns->ns);
+	if (fdp_cfg == NULL) {
+		return false;
+	}
+
+	rgif = fdp_cfg->fdpa.bits.rgif;
+	if (rgif != 0 && fdp_cfg->nrg > 1) {
+		nrg = spdk_min(fdp_cfg->nrg, 1U << rgif);
+	}
+
+	rgid = (placement_hint / nvme_ns->num_placement_handles) % nrg;
+	*dspec = nvme_ns->placement_handles[placement_hint % nvme_ns->num_placement_handles];
+	if (rgid != 0) {
+		*dspec |= rgid << (16 - rgif);
+	}
+
+	return true;
+}
+
 static int
 bdev_nvme_writev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		 void *md, uint64_t lba_count, uint64_t lba, uint32_t flags,
 		 struct spdk_memory_domain *domain, void *domain_ctx,
-		 struct spdk_accel_sequence *seq)
+		 struct spdk_accel_sequence *seq, uint16_t placement_hint)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
 	struct spdk_nvme_qpair *qpair = bio->io_path->qpair->qpair;
+	uint16_t dspec = 0;
+	bool placement;
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "write %" PRIu64 " blocks with offset %#" PRIx64 "\n",
@@ -7415,14 +7782,24 @@ bdev_nvme_writev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iovpos = 0;
 	bio->iov_offset = 0;
 
-	if (domain != NULL || seq != NULL) {
+	placement = bdev_nvme_get_placement_dspec(bio->io_path->nvme_ns, placement_hint, &dspec);
+
+	if (domain != NULL || seq != NULL || placement) {
 		bio->ext_opts.size = SPDK_SIZEOF(&bio->ext_opts, accel_sequence);
 		bio->ext_opts.memory_domain = domain;
 		bio->ext_opts.memory_domain_ctx = domain_ctx;
 		bio->ext_opts.io_flags = flags;
 		bio->ext_opts.metadata = md;
+		bio->ext_opts.apptag_mask = 0;
+		bio->ext_opts.apptag = 0;
+		bio->ext_opts.cdw13 = 0;
 		bio->ext_opts.accel_sequence = seq;
 
+		if (placement) {
+			bio->ext_opts.io_flags |= SPDK_NVME_IO_FLAGS_DATA_PLACEMENT_DIRECTIVE;
+			bio->ext_opts.cdw13 = (uint32_t)dspec << 16;
+		}
+
 		rc = spdk_nvme_ns_cmd_writev_ext(ns, qpair, lba, lba_count,
 						 bdev_nvme_writev_done, bio,
 						 bdev_nvme_queued_reset_sgl,
@@ -7954,6 +8331,43 @@ nvme_ctrlr_config_json(struct spdk_json_write_ctx *w,
 	spdk_json_write_object_end(w);
 }
 
+/* The interrupt coalescing RPC applies to all the controllers of a NVMe bdev controller,
+ * so it is emitted once, after the controllers it applies to are attached.
+ */
+static void
+nvme_bdev_ctrlr_interrupt_coalescing_config_json(struct spdk_json_write_ctx *w,
+		struct nvme_bdev_ctrlr *nbdev_ctrlr)
+{
+	struct nvme_ctrlr *nvme_ctrlr, *coalescing_ctrlr = NULL;
+	bool attached = false;
+
+	TAILQ_FOREACH(nvme_ctrlr, &nbdev_ctrlr->ctrlrs, tailq) {
+		if (!nvme_ctrlr->opts.from_discovery_service) {
+			attached = true;
+		}
+		if (coalescing_ctrlr == NULL && nvme_ctrlr->int_coalescing_set) {
+			coalescing_ctrlr = nvme_ctrlr;
+		}
+	}
+
+	if (!attached || coalescing_ctrlr == NULL) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_nvme_set_interrupt_coalescing");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", nbdev_ctrlr->name);
+	spdk_json_write_named_uint8(w, "aggregation_threshold",
+				    coalescing_ctrlr->int_coalescing.bits.thr);
+	spdk_json_write_named_uint8(w, "aggregation_time",
+				    coalescing_ctrlr->int_coalescing.bits.time);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 static void
 bdev_nvme_hotplug_config_json(struct spdk_json_write_ctx *w)
 {
@@ -7983,6 +8397,7 @@ bdev_nvme_config_json(struct spdk_json_write_ctx *w)
 		TAILQ_FOREACH(nvme_ctrlr, &nbdev_ctrlr->ctrlrs, tailq) {
 			nvme_ctrlr_config_json(w, nvme_ctrlr);
 		}
+		nvme_bdev_ctrlr_interrupt_coalescing_config_json(w, nbdev_ctrlr);
 	}
 
 	TAILQ_FOREACH(ctx, &g_discovery_ctxs, tailq) {
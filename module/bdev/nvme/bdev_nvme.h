@@ -76,6 +76,9 @@ struct nvme_ns {
 	bool				ana_transition_timedout;
 	struct spdk_poller		*anatt_timer;
 	struct nvme_async_probe_ctx	*probe_ctx;
+	/* FDP placement handles of the namespace, in the order of its placement handle list */
+	uint16_t			*placement_handles;
+	uint16_t			num_placement_handles;
 	TAILQ_ENTRY(nvme_ns)		tailq;
 	RB_ENTRY(nvme_ns)		node;
 
@@ -155,6 +158,10 @@ struct nvme_ctrlr {
 
 	struct nvme_async_probe_ctx		*probe_ctx;
 
+	/* Interrupt coalescing set through RPC, restored after each reset. */
+	bool					int_coalescing_set;
+	union spdk_nvme_feat_interrupt_coalescing	int_coalescing;
+
 	pthread_mutex_t				mutex;
 };
 
@@ -411,4 +418,22 @@ void bdev_nvme_set_multipath_policy(const char *name,
 				    bdev_nvme_set_multipath_policy_cb cb_fn,
 				    void *cb_arg);
 
+typedef void (*bdev_nvme_set_interrupt_coalescing_cb)(void *cb_arg, int rc);
+
+/**
+ * Set interrupt coalescing for all NVMe controllers of an NVMe bdev controller.
+ *
+ * The settings are kept and applied again whenever a controller is reset.
+ *
+ * \param name NVMe bdev controller name
+ * \param threshold Aggregation threshold, 0's based number of completions per interrupt
+ * \param time Aggregation time in 100 microsecond increments
+ * \param cb_fn Function to be called back after completion.
+ * \param cb_arg Argument for callback function.
+ * \return 0 if the operation was started, -ENODEV if the controller is not found,
+ * -ENOTSUP for fabrics controllers, -ENOMEM on allocation failure.
+ */
+int bdev_nvme_set_interrupt_coalescing(const char *name, uint8_t threshold, uint8_t time,
+				       bdev_nvme_set_interrupt_coalescing_cb cb_fn, void *cb_arg);
+
 #endif /* SPDK_BDEV_NVME_H */
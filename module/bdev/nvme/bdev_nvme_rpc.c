@@ -2240,6 +2240,65 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_nvme_set_preferred_path", rpc_bdev_nvme_set_preferred_path,
 		  SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_nvme_set_interrupt_coalescing {
+	char *name;
+	uint8_t aggregation_threshold;
+	uint8_t aggregation_time;
+};
+
+static void
+free_rpc_bdev_nvme_set_interrupt_coalescing(struct rpc_bdev_nvme_set_interrupt_coalescing *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_nvme_set_interrupt_coalescing_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_nvme_set_interrupt_coalescing, name), spdk_json_decode_string},
+	{"aggregation_threshold", offsetof(struct rpc_bdev_nvme_set_interrupt_coalescing, aggregation_threshold), spdk_json_decode_uint8},
+	{"aggregation_time", offsetof(struct rpc_bdev_nvme_set_interrupt_coalescing, aggregation_time), spdk_json_decode_uint8},
+};
+
+static void
+rpc_bdev_nvme_set_interrupt_coalescing_done(void *cb_arg, int rc)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+
+static void
+rpc_bdev_nvme_set_interrupt_coalescing(struct spdk_jsonrpc_request *request,
+				       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_nvme_set_interrupt_coalescing req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_nvme_set_interrupt_coalescing_decoders,
+				    SPDK_COUNTOF(rpc_bdev_nvme_set_interrupt_coalescing_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 spdk_strerror(EINVAL));
+		goto cleanup;
+	}
+
+	rc = bdev_nvme_set_interrupt_coalescing(req.name, req.aggregation_threshold,
+						req.aggregation_time,
+						rpc_bdev_nvme_set_interrupt_coalescing_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+
+cleanup:
+	free_rpc_bdev_nvme_set_interrupt_coalescing(&req);
+}
+SPDK_RPC_REGISTER("bdev_nvme_set_interrupt_coalescing", rpc_bdev_nvme_set_interrupt_coalescing,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_set_multipath_policy {
 	char *name;
 	enum bdev_nvme_multipath_policy policy;
@@ -55,6 +55,10 @@ struct spdk_posix_sock {
 
 	SSL_CTX			*ctx;
 	SSL			*ssl;
+	bool			ssl_init_finished;
+	/* Record encryption/decryption is done by the kernel (kTLS) */
+	bool			ktls_send;
+	bool			ktls_recv;
 
 	TAILQ_ENTRY(spdk_posix_sock)	link;
 };
@@ -936,6 +940,65 @@ SSL_writev(SSL *ssl, struct iovec *iov, int iovcnt)
 	}
 }
 
+static void
+posix_sock_ssl_check_ktls(struct spdk_posix_sock *sock)
+{
+	if (spdk_likely(sock->ssl_init_finished) || !SSL_is_init_finished(sock->ssl)) {
+		return;
+	}
+
+	sock->ssl_init_finished = true;
+#ifdef BIO_get_ktls_send
+	/* OpenSSL installs the session keys into the kernel at the end of the handshake
+	 * if kTLS was enabled and is supported by the kernel for the negotiated cipher. */
+	sock->ktls_send = BIO_get_ktls_send(SSL_get_wbio(sock->ssl)) != 0;
+	sock->ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(sock->ssl)) != 0;
+#endif
+	SPDK_DEBUGLOG(sock_posix, "SSL handshake finished on fd %d, kTLS send: %d, recv: %d\n",
+		      sock->fd, sock->ktls_send, sock->ktls_recv);
+}
+
+static ssize_t
+posix_sock_ssl_readv(struct spdk_posix_sock *sock, struct iovec *iov, int iovcnt)
+{
+	ssize_t rc;
+
+	/* With kTLS the kernel hands out decrypted application data directly. Any other
+	 * record type (alerts, post-handshake messages) fails the read with EIO and has
+	 * to be consumed by OpenSSL, as does data OpenSSL has already buffered. */
+	if (sock->ktls_recv && !SSL_has_pending(sock->ssl)) {
+		rc = readv(sock->fd, iov, iovcnt);
+		if (rc >= 0 || errno != EIO) {
+			return rc;
+		}
+	}
+
+	rc = SSL_readv(sock->ssl, iov, iovcnt);
+	posix_sock_ssl_check_ktls(sock);
+
+	return rc;
+}
+
+static ssize_t
+posix_sock_ssl_writev(struct spdk_posix_sock *sock, struct iovec *iov, int iovcnt, int flags)
+{
+	struct msghdr msg = {};
+	ssize_t rc;
+
+	/* Let the kernel frame all the iovecs into records with a single syscall rather
+	 * than encrypting and writing each of them separately. */
+	if (sock->ktls_send) {
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+		return sendmsg(sock->fd, &msg, flags);
+	}
+
+	rc = SSL_writev(sock->ssl, iov, iovcnt);
+	posix_sock_ssl_check_ktls(sock);
+
+	return rc;
+}
+
 static struct spdk_sock *
 posix_sock_create(const char *ip, int port,
 		  enum posix_sock_create_type type,
@@ -1357,7 +1420,7 @@ _sock_flush(struct spdk_sock *sock)
 	msg.msg_iovlen = iovcnt;
 
 	if (psock->ssl) {
-		rc = SSL_writev(psock->ssl, iovs, iovcnt);
+		rc = posix_sock_ssl_writev(psock, iovs, iovcnt, flags);
 	} else {
 		rc = sendmsg(psock->fd, &msg, flags);
 	}
@@ -1506,7 +1569,7 @@ posix_sock_read(struct spdk_posix_sock *sock)
 	}
 
 	if (sock->ssl) {
-		bytes_recvd = SSL_readv(sock->ssl, iov, 2);
+		bytes_recvd = posix_sock_ssl_readv(sock, iov, 2);
 	} else {
 		bytes_recvd = readv(sock->fd, iov, 2);
 	}
@@ -1557,7 +1620,7 @@ posix_sock_readv(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
 			TAILQ_REMOVE(&group->socks_with_data, sock, link);
 		}
 		if (sock->ssl) {
-			return SSL_readv(sock->ssl, iov, iovcnt);
+			return posix_sock_ssl_readv(sock, iov, iovcnt);
 		} else {
 			return readv(sock->fd, iov, iovcnt);
 		}
@@ -1576,7 +1639,7 @@ posix_sock_readv(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
 		if (len >= MIN_SOCK_PIPE_SIZE) {
 			/* TODO: Should this detect if kernel socket is drained? */
 			if (sock->ssl) {
-				return SSL_readv(sock->ssl, iov, iovcnt);
+				return posix_sock_ssl_readv(sock, iov, iovcnt);
 			} else {
 				return readv(sock->fd, iov, iovcnt);
 			}
@@ -1623,7 +1686,7 @@ posix_sock_writev(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
 	}
 
 	if (sock->ssl) {
-		return SSL_writev(sock->ssl, iov, iovcnt);
+		return posix_sock_ssl_writev(sock, iov, iovcnt, MSG_NOSIGNAL);
 	} else {
 		return writev(sock->fd, iov, iovcnt);
 	}
@@ -1022,6 +1022,22 @@ def bdev_nvme_set_preferred_path(client, name, cntlid):
     return client.call('bdev_nvme_set_preferred_path', params)
 
 
+def bdev_nvme_set_interrupt_coalescing(client, name, aggregation_threshold, aggregation_time):
+    """Set interrupt coalescing of an NVMe bdev controller
+
+    Args:
+        name: NVMe bdev controller name
+        aggregation_threshold: Minimum number of completions aggregated per interrupt, 0's based
+        aggregation_time: Maximum interrupt delay in 100 microsecond increments
+    """
+
+    params = {'name': name,
+              'aggregation_threshold': aggregation_threshold,
+              'aggregation_time': aggregation_time}
+
+    return client.call('bdev_nvme_set_interrupt_coalescing', params)
+
+
 def bdev_nvme_set_multipath_policy(client, name, policy, selector, rr_min_io):
     """Set multipath policy of the NVMe bdev
 
@@ -5,7 +5,9 @@
 
 
 def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None,
-                             clear_method=None, num_md_pages_per_cluster_ratio=None):
+                             clear_method=None, num_md_pages_per_cluster_ratio=None,
+                             cluster_allocator=None, cluster_extent_sz=None,
+                             background_free_rate=None):
     """Construct a logical volume store.
 
     Args:
@@ -14,6 +16,9 @@ def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None,
         cluster_sz: cluster size of the logical volume store in bytes (optional)
         clear_method: Change clear method for data region. Available: none, unmap, write_zeroes (optional)
         num_md_pages_per_cluster_ratio: metadata pages per cluster (optional)
+        cluster_allocator: Cluster allocator. Available: first_fit, extent (optional)
+        cluster_extent_sz: clusters per extent of the extent allocator (optional)
+        background_free_rate: clusters per second released in the background after deletes (optional)
 
     Returns:
         UUID of created logical volume store.
@@ -25,6 +30,12 @@ def bdev_lvol_create_lvstore(client, bdev_name, lvs_name, cluster_sz=None,
         params['clear_method'] = clear_method
     if num_md_pages_per_cluster_ratio:
         params['num_md_pages_per_cluster_ratio'] = num_md_pages_per_cluster_ratio
+    if cluster_allocator:
+        params['cluster_allocator'] = cluster_allocator
+    if cluster_extent_sz:
+        params['cluster_extent_sz'] = cluster_extent_sz
+    if background_free_rate:
+        params['background_free_rate'] = background_free_rate
     return client.call('bdev_lvol_create_lvstore', params)
 
 
@@ -263,6 +274,11 @@ def bdev_lvol_get_lvstores(client, uuid=None, lvs_name=None):
     return client.call('bdev_lvol_get_lvstores', params)
 
 
+def bdev_lvol_get_recovery_status(client):
+    """List logical volume stores being recovered after an unclean shutdown, with their progress."""
+    return client.call('bdev_lvol_get_recovery_status')
+
+
 def bdev_lvol_get_lvols(client, lvs_uuid=None, lvs_name=None):
     """List logical volumes
 
@@ -124,6 +124,7 @@ def nvmf_create_transport(client, **params):
         disable_adaptive_irq: Disable adaptive interrupt feature - VFIO-USER specific (optional)
         disable_shadow_doorbells: disable shadow doorbell support - VFIO-USER specific (optional)
         acceptor_poll_rate: Acceptor poll period in microseconds (optional)
+        max_cq_poll_interval: Max number of poll group iterations between polls of an idle CQ - RDMA specific (optional)
     Returns:
         True or False
     """
@@ -577,6 +578,26 @@ def nvmf_get_stats(client, tgt_name=None):
     return client.call('nvmf_get_stats', params)
 
 
+def nvmf_get_io_stats(client, nqn=None, tgt_name=None):
+    """Query per-host and per-namespace I/O statistics.
+
+    Args:
+        nqn: Subsystem NQN (optional). If not given, all subsystems are reported.
+        tgt_name: name of the parent NVMe-oF target (optional).
+
+    Returns:
+        I/O counters and latency histograms summed over all poll groups.
+    """
+    params = {}
+
+    if nqn:
+        params['nqn'] = nqn
+    if tgt_name:
+        params['tgt_name'] = tgt_name
+
+    return client.call('nvmf_get_io_stats', params)
+
+
 def nvmf_set_crdt(client, crdt1=None, crdt2=None, crdt3=None):
     """Set the 3 crdt (Command Retry Delay Time) values
 
@@ -899,6 +899,22 @@ if __name__ == "__main__":
     p.add_argument('-c', '--cntlid', help='NVMe-oF controller ID', type=int, required=True)
     p.set_defaults(func=bdev_nvme_set_preferred_path)
 
+    def bdev_nvme_set_interrupt_coalescing(args):
+        rpc.bdev.bdev_nvme_set_interrupt_coalescing(args.client,
+                                                    name=args.name,
+                                                    aggregation_threshold=args.aggregation_threshold,
+                                                    aggregation_time=args.aggregation_time)
+
+    p = subparsers.add_parser('bdev_nvme_set_interrupt_coalescing',
+                              help="""Set interrupt coalescing of an NVMe bdev controller""")
+    p.add_argument('-b', '--name', help='Name of the NVMe bdev controller', required=True)
+    p.add_argument('-t', '--aggregation-threshold',
+                   help='Minimum number of completions aggregated per interrupt, 0\'s based',
+                   type=int, required=True)
+    p.add_argument('-T', '--aggregation-time',
+                   help='Maximum interrupt delay in 100 microsecond increments', type=int, required=True)
+    p.set_defaults(func=bdev_nvme_set_interrupt_coalescing)
+
     def bdev_nvme_set_multipath_policy(args):
         rpc.bdev.bdev_nvme_set_multipath_policy(args.client,
                                                 name=args.name,
@@ -1937,7 +1953,10 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                                      lvs_name=args.lvs_name,
                                                      cluster_sz=args.cluster_sz,
                                                      clear_method=args.clear_method,
-                                                     num_md_pages_per_cluster_ratio=args.md_pages_per_cluster_ratio))
+                                                     num_md_pages_per_cluster_ratio=args.md_pages_per_cluster_ratio,
+                                                     cluster_allocator=args.cluster_allocator,
+                                                     cluster_extent_sz=args.cluster_extent_sz,
+                                                     background_free_rate=args.background_free_rate))
 
     p = subparsers.add_parser('bdev_lvol_create_lvstore', help='Add logical volume store on base bdev')
     p.add_argument('bdev_name', help='base bdev name')
@@ -1946,6 +1965,11 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--clear-method', help="""Change clear method for data region.
         Available: none, unmap, write_zeroes""", required=False)
     p.add_argument('-m', '--md-pages-per-cluster-ratio', help='reserved metadata pages for each cluster', type=int, required=False)
+    p.add_argument('--cluster-allocator', help="""Cluster allocator.
+        Available: first_fit, extent""", required=False)
+    p.add_argument('--cluster-extent-sz', help='clusters per extent of the extent allocator', type=int, required=False)
+    p.add_argument('--background-free-rate', help="""clusters per second released in the background
+        after lvols are deleted, 0 to release them as part of the delete""", type=int, required=False)
     p.set_defaults(func=bdev_lvol_create_lvstore)
 
     def bdev_lvol_rename_lvstore(args):
@@ -2093,6 +2117,13 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-l', '--lvs-name', help='lvol store name', required=False)
     p.set_defaults(func=bdev_lvol_get_lvstores)
 
+    def bdev_lvol_get_recovery_status(args):
+        print_dict(rpc.lvol.bdev_lvol_get_recovery_status(args.client))
+
+    p = subparsers.add_parser('bdev_lvol_get_recovery_status',
+                              help='Display progress of logical volume stores being recovered')
+    p.set_defaults(func=bdev_lvol_get_recovery_status)
+
     def bdev_lvol_get_lvols(args):
         print_dict(rpc.lvol.bdev_lvol_get_lvols(args.client,
                                                 lvs_uuid=args.lvs_uuid,
@@ -2421,6 +2452,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-S', '--disable-shadow-doorbells', action='store_true', help="""Disable shadow doorbell support.
     Relevant only for VFIO-USER transport""")
     p.add_argument('--acceptor-poll-rate', help='Polling interval of the acceptor for incoming connections (usec)', type=int)
+    p.add_argument('--max-cq-poll-interval', help="""Max number of poll group iterations between polls of an idle CQ.
+    Relevant only for RDMA transport""", type=int)
     p.set_defaults(func=nvmf_create_transport)
 
     def nvmf_get_transports(args):
@@ -2648,6 +2681,15 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
     p.set_defaults(func=nvmf_get_stats)
 
+    def nvmf_get_io_stats(args):
+        print_dict(rpc.nvmf.nvmf_get_io_stats(args.client, nqn=args.nqn, tgt_name=args.tgt_name))
+
+    p = subparsers.add_parser(
+        'nvmf_get_io_stats', help='Display I/O statistics and latency histograms per host and namespace')
+    p.add_argument('-n', '--nqn', help='Subsystem NQN (optional)', type=str)
+    p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
+    p.set_defaults(func=nvmf_get_io_stats)
+
     def nvmf_set_crdt(args):
         print_dict(rpc.nvmf.nvmf_set_crdt(args.client, args.crdt1, args.crdt2, args.crdt3))
 
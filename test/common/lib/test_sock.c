@@ -4,6 +4,7 @@
  */
 
 #include "spdk/stdinc.h"
+#include "spdk/util.h"
 
 #include "spdk_internal/sock.h"
 #include "spdk_internal/mock.h"
@@ -21,9 +22,7 @@ DEFINE_STUB(spdk_sock_impl_get_opts, int, (const char *impl_name, struct spdk_so
 		size_t *len), 0);
 DEFINE_STUB(spdk_sock_accept, struct spdk_sock *, (struct spdk_sock *sock), NULL);
 DEFINE_STUB(spdk_sock_close, int, (struct spdk_sock **sock), 0);
-DEFINE_STUB(spdk_sock_recv, ssize_t, (struct spdk_sock *sock, void *buf, size_t len), 1);
 DEFINE_STUB(spdk_sock_writev, ssize_t, (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
-DEFINE_STUB(spdk_sock_readv, ssize_t, (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
 DEFINE_STUB(spdk_sock_set_recvlowat, int, (struct spdk_sock *sock, int nbytes), 0);
 DEFINE_STUB(spdk_sock_set_recvbuf, int, (struct spdk_sock *sock, int sz), 0);
 DEFINE_STUB(spdk_sock_set_sendbuf, int, (struct spdk_sock *sock, int sz), 0);
@@ -45,6 +44,62 @@ DEFINE_STUB(spdk_sock_group_provide_buf, int, (struct spdk_sock_group *group, vo
 
 static uint8_t g_buf[0x1000] = {};
 
+/* Byte stream served by spdk_sock_recv() and spdk_sock_readv() when set. Reads return
+ * whatever is left of it, up to the requested length, and fail with EAGAIN once it has
+ * been consumed, the way a nonblocking socket would. */
+static const uint8_t *g_sock_recv_data;
+static size_t g_sock_recv_len;
+static size_t g_sock_recv_offset;
+
+static ssize_t
+ut_sock_recv_data(struct iovec *iov, int iovcnt)
+{
+	size_t len, total = 0;
+	int i;
+
+	if (g_sock_recv_offset == g_sock_recv_len) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	for (i = 0; i < iovcnt && g_sock_recv_offset < g_sock_recv_len; i++) {
+		len = spdk_min(iov[i].iov_len, g_sock_recv_len - g_sock_recv_offset);
+		memcpy(iov[i].iov_base, g_sock_recv_data + g_sock_recv_offset, len);
+		g_sock_recv_offset += len;
+		total += len;
+	}
+
+	return total;
+}
+
+DEFINE_RETURN_MOCK(spdk_sock_recv, ssize_t);
+ssize_t
+spdk_sock_recv(struct spdk_sock *sock, void *buf, size_t len)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+
+	HANDLE_RETURN_MOCK(spdk_sock_recv);
+
+	if (g_sock_recv_data == NULL) {
+		return 1;
+	}
+
+	return ut_sock_recv_data(&iov, 1);
+}
+
+DEFINE_RETURN_MOCK(spdk_sock_readv, ssize_t);
+ssize_t
+spdk_sock_readv(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
+{
+	HANDLE_RETURN_MOCK(spdk_sock_readv);
+
+	if (g_sock_recv_data == NULL) {
+		return 0;
+	}
+
+	return ut_sock_recv_data(iov, iovcnt);
+}
+
 DEFINE_RETURN_MOCK(spdk_sock_recv_next, int);
 int
 spdk_sock_recv_next(struct spdk_sock *sock, void **buf, void **ctx)
@@ -123,6 +123,7 @@ struct ut_expected_io {
 	int				iovcnt;
 	struct iovec			iov[SPDK_BDEV_IO_NUM_CHILD_IOV];
 	void				*md_buf;
+	uint16_t			placement_hint;
 	TAILQ_ENTRY(ut_expected_io)	link;
 };
 
@@ -314,6 +315,10 @@ stub_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
 		CU_ASSERT(expected_io->md_buf == bdev_io->u.bdev.md_buf);
 	}
 
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		CU_ASSERT(expected_io->placement_hint == bdev_io->u.bdev.placement_hint);
+	}
+
 	if (expected_io->length == 0) {
 		free(expected_io);
 		return;
@@ -5781,15 +5786,18 @@ bdev_io_ext_split(void)
 	CU_ASSERT(g_io_done == true);
 	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
 
-	/* write */
+	/* write, the placement hint is passed to each child */
 	g_io_done = false;
+	ext_io_opts.placement_hint = 3;
 	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 14, 2, 1);
 	expected_io->md_buf = ext_io_opts.metadata;
+	expected_io->placement_hint = 3;
 	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 2 * 512);
 	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
 
 	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 16, 6, 1);
 	expected_io->md_buf = ext_io_opts.metadata + 2 * 8;
+	expected_io->placement_hint = 3;
 	ut_expected_io_set_iov(expected_io, 0, (void *)(0xF000 + 2 * 512), 6 * 512);
 	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
 
@@ -132,6 +132,25 @@ DEFINE_STUB(spdk_nvme_ctrlr_cmd_io_raw_with_md, int, (struct spdk_nvme_ctrlr *ct
 		struct spdk_nvme_qpair *qpair, struct spdk_nvme_cmd *cmd, void *buf,
 		uint32_t len, void *md_buf, spdk_nvme_cmd_cb cb_fn, void *cb_arg), 0);
 
+static uint32_t g_ut_int_coalescing_cmds;
+static union spdk_nvme_feat_interrupt_coalescing g_ut_int_coalescing;
+
+int
+spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(struct spdk_nvme_ctrlr *ctrlr,
+		uint8_t threshold, uint8_t time,
+		spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	struct spdk_nvme_cpl cpl = {};
+
+	g_ut_int_coalescing_cmds++;
+	g_ut_int_coalescing.bits.thr = threshold;
+	g_ut_int_coalescing.bits.time = time;
+
+	cb_fn(cb_arg, &cpl);
+
+	return 0;
+}
+
 DEFINE_STUB(spdk_nvme_cuse_get_ctrlr_name, int, (struct spdk_nvme_ctrlr *ctrlr, char *name,
 		size_t *size), 0);
 
@@ -252,6 +271,7 @@ struct spdk_nvme_ns {
 	struct spdk_uuid		*uuid;
 	enum spdk_nvme_ana_state	ana_state;
 	enum spdk_nvme_csi		csi;
+	struct spdk_nvme_fdp_cfg_descriptor	*fdp_cfg;
 };
 
 struct spdk_nvme_qpair {
@@ -985,6 +1005,12 @@ spdk_nvme_ns_get_data(struct spdk_nvme_ns *ns)
 	return _nvme_ns_get_data(ns);
 }
 
+const struct spdk_nvme_fdp_cfg_descriptor *
+spdk_nvme_ns_get_fdp_cfg(const struct spdk_nvme_ns *ns)
+{
+	return ns->fdp_cfg;
+}
+
 uint64_t
 spdk_nvme_ns_get_num_sectors(struct spdk_nvme_ns *ns)
 {
@@ -1055,7 +1081,25 @@ spdk_nvme_ns_cmd_readv_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpai
 	return ut_submit_nvme_request(ns, qpair, SPDK_NVME_OPC_READ, cb_fn, cb_arg);
 }
 
+static const struct spdk_nvme_fdp_ruhs *g_ut_ruhs;
+static uint32_t g_ut_ruhs_size;
+
+int
+spdk_nvme_ns_cmd_io_mgmt_recv(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+			      void *payload, uint32_t len, uint8_t mo, uint16_t mos,
+			      spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	CU_ASSERT(mo == SPDK_NVME_FDP_IO_MGMT_RECV_RUHS);
+
+	if (g_ut_ruhs != NULL) {
+		memcpy(payload, g_ut_ruhs, spdk_min(len, g_ut_ruhs_size));
+	}
+
+	return ut_submit_nvme_request(ns, qpair, SPDK_NVME_OPC_IO_MANAGEMENT_RECEIVE, cb_fn, cb_arg);
+}
+
 static bool g_ut_writev_ext_called;
+static struct spdk_nvme_ns_cmd_ext_io_opts g_ut_writev_ext_opts;
 int
 spdk_nvme_ns_cmd_writev_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
 			    uint64_t lba, uint32_t lba_count,
@@ -1065,6 +1109,7 @@ spdk_nvme_ns_cmd_writev_ext(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpa
 			    struct spdk_nvme_ns_cmd_ext_io_opts *opts)
 {
 	g_ut_writev_ext_called = true;
+	g_ut_writev_ext_opts = *opts;
 	return ut_submit_nvme_request(ns, qpair, SPDK_NVME_OPC_WRITE, cb_fn, cb_arg);
 }
 
@@ -1530,6 +1575,87 @@ test_reset_ctrlr(void)
 	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static void
+ut_set_interrupt_coalescing_done(void *cb_arg, int rc)
+{
+	int *result = cb_arg;
+
+	*result = rc;
+}
+
+static void
+test_set_interrupt_coalescing(void)
+{
+	struct spdk_nvme_transport_id trid = {};
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct nvme_ctrlr *nvme_ctrlr;
+	int rc, result;
+
+	ut_init_trid(&trid);
+	TAILQ_INIT(&ctrlr.active_io_qpairs);
+
+	set_thread(0);
+
+	rc = nvme_ctrlr_create(&ctrlr, "nvme0", &trid, NULL);
+	CU_ASSERT(rc == 0);
+
+	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
+
+	g_ut_int_coalescing_cmds = 0;
+
+	/* Unknown controller */
+	rc = bdev_nvme_set_interrupt_coalescing("nvme1", 7, 2, ut_set_interrupt_coalescing_done,
+						&result);
+	CU_ASSERT(rc == -ENODEV);
+
+	/* Fabrics controllers do not support interrupt coalescing */
+	rc = bdev_nvme_set_interrupt_coalescing("nvme0", 7, 2, ut_set_interrupt_coalescing_done,
+						&result);
+	CU_ASSERT(rc == -ENOTSUP);
+	CU_ASSERT(nvme_ctrlr->int_coalescing_set == false);
+
+	MOCK_SET(spdk_nvme_ctrlr_is_fabrics, false);
+
+	result = -1;
+	rc = bdev_nvme_set_interrupt_coalescing("nvme0", 7, 2, ut_set_interrupt_coalescing_done,
+						&result);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(result == 0);
+	CU_ASSERT(g_ut_int_coalescing_cmds == 1);
+	CU_ASSERT(g_ut_int_coalescing.bits.thr == 7);
+	CU_ASSERT(g_ut_int_coalescing.bits.time == 2);
+	CU_ASSERT(nvme_ctrlr->int_coalescing_set == true);
+	CU_ASSERT(nvme_ctrlr->int_coalescing.bits.thr == 7);
+	CU_ASSERT(nvme_ctrlr->int_coalescing.bits.time == 2);
+
+	/* The settings are applied again after a successful reset. */
+	g_ut_int_coalescing.raw = 0;
+
+	rc = bdev_nvme_reset_ctrlr(nvme_ctrlr);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr->resetting == false);
+	CU_ASSERT(g_ut_int_coalescing_cmds == 2);
+	CU_ASSERT(g_ut_int_coalescing.bits.thr == 7);
+	CU_ASSERT(g_ut_int_coalescing.bits.time == 2);
+
+	MOCK_SET(spdk_nvme_ctrlr_is_fabrics, true);
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
+}
+
 static void
 test_race_between_reset_and_destruct_ctrlr(void)
 {
@@ -2339,6 +2465,9 @@ test_submit_nvme_cmd(void)
 	struct nvme_bdev *bdev;
 	struct spdk_bdev_io *bdev_io;
 	struct spdk_io_channel *ch;
+	struct spdk_nvme_fdp_cfg_descriptor fdp_cfg = {};
+	uint16_t placement_handles[4] = { 0, 1, 2, 3 };
+	struct nvme_ns *nvme_ns;
 	int rc;
 
 	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
@@ -2362,7 +2491,9 @@ test_submit_nvme_cmd(void)
 	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
 	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
 
-	bdev = nvme_ctrlr_get_ns(nvme_ctrlr, 1)->bdev;
+	nvme_ns = nvme_ctrlr_get_ns(nvme_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(nvme_ns != NULL);
+	bdev = nvme_ns->bdev;
 	SPDK_CU_ASSERT_FATAL(bdev != NULL);
 
 	set_thread(0);
@@ -2395,6 +2526,71 @@ test_submit_nvme_cmd(void)
 	g_ut_readv_ext_called = false;
 	bdev_io->u.bdev.memory_domain = NULL;
 
+	/* Verify that a placement hint is ignored if the namespace does not use FDP */
+	g_ut_writev_ext_called = false;
+	bdev_io->u.bdev.placement_hint = 5;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == false);
+
+	/* Verify that a placement hint is folded onto the placement handles of the
+	 * namespace and passed as the data placement directive if the namespace uses FDP.
+	 */
+	fdp_cfg.nruh = 4;
+	ctrlr->ns[0].fdp_cfg = &fdp_cfg;
+	nvme_ns->placement_handles = placement_handles;
+	nvme_ns->num_placement_handles = 4;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == true);
+	CU_ASSERT(g_ut_writev_ext_opts.io_flags & SPDK_NVME_IO_FLAGS_DATA_PLACEMENT_DIRECTIVE);
+	CU_ASSERT(g_ut_writev_ext_opts.cdw13 == 1U << 16);
+	g_ut_writev_ext_called = false;
+
+	/* Verify that a placement hint is spread over the reclaim groups and the reclaim
+	 * group identifier is encoded in the RGIF most significant bits of the placement ID.
+	 */
+	fdp_cfg.nrg = 4;
+	fdp_cfg.fdpa.bits.rgif = 2;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == true);
+	CU_ASSERT(g_ut_writev_ext_opts.io_flags & SPDK_NVME_IO_FLAGS_DATA_PLACEMENT_DIRECTIVE);
+	CU_ASSERT(g_ut_writev_ext_opts.cdw13 == (uint32_t)((1U << 14) | 1) << 16);
+	g_ut_writev_ext_called = false;
+
+	/* Verify that the hint wraps around the reclaim groups */
+	bdev_io->u.bdev.placement_hint = 17;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == true);
+	CU_ASSERT(g_ut_writev_ext_opts.cdw13 == 1U << 16);
+	g_ut_writev_ext_called = false;
+
+	/* Verify that the hint indexes the placement handle list of the namespace, which
+	 * has fewer entries than the configuration has reclaim unit handles.
+	 */
+	fdp_cfg.nruh = 8;
+	placement_handles[0] = 6;
+	placement_handles[1] = 3;
+	nvme_ns->num_placement_handles = 2;
+	bdev_io->u.bdev.placement_hint = 5;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == true);
+	CU_ASSERT(g_ut_writev_ext_opts.cdw13 == (uint32_t)((2U << 14) | 3) << 16);
+	g_ut_writev_ext_called = false;
+
+	/* Verify that the reclaim group is not encoded with a single reclaim group */
+	fdp_cfg.nrg = 1;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == true);
+	CU_ASSERT(g_ut_writev_ext_opts.cdw13 == 3U << 16);
+	g_ut_writev_ext_called = false;
+
+	/* Verify that a placement hint is ignored without placement handles */
+	nvme_ns->placement_handles = NULL;
+	nvme_ns->num_placement_handles = 0;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_ut_writev_ext_called == false);
+	ctrlr->ns[0].fdp_cfg = NULL;
+	bdev_io->u.bdev.placement_hint = 0;
+
 	ut_test_submit_admin_cmd(ch, bdev_io, ctrlr);
 
 	free(bdev_io);
@@ -2415,6 +2611,116 @@ test_submit_nvme_cmd(void)
 	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static void
+test_read_placement_handles(void)
+{
+	struct spdk_nvme_transport_id trid = {};
+	struct spdk_nvme_ctrlr *ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr;
+	struct nvme_ns *nvme_ns;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct spdk_nvme_fdp_cfg_descriptor fdp_cfg = {};
+	uint8_t buf[sizeof(struct spdk_nvme_fdp_ruhs) + 6 * sizeof(struct spdk_nvme_fdp_ruhs_desc)];
+	struct spdk_nvme_fdp_ruhs *ruhs = (struct spdk_nvme_fdp_ruhs *)buf;
+	int rc, i;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&trid);
+
+	set_thread(0);
+
+	/* The namespace has 3 of the 8 reclaim unit handles of the configuration, in
+	 * 2 reclaim groups. Its status has a descriptor per handle and reclaim group.
+	 */
+	fdp_cfg.nruh = 8;
+	fdp_cfg.nrg = 2;
+	fdp_cfg.fdpa.bits.rgif = 1;
+	memset(buf, 0, sizeof(buf));
+	ruhs->nruhsd = 6;
+	for (i = 0; i < 6; i++) {
+		ruhs->ruhs_desc[i].pid = (uint16_t)((i / 3) << 15 | (2 - i % 3));
+		ruhs->ruhs_desc[i].ruhid = 7 - i % 3;
+	}
+	g_ut_ruhs = ruhs;
+	g_ut_ruhs_size = sizeof(buf);
+
+	ctrlr = ut_attach_ctrlr(&trid, 1, false, false);
+	SPDK_CU_ASSERT_FATAL(ctrlr != NULL);
+	ctrlr->ns[0].fdp_cfg = &fdp_cfg;
+
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	rc = bdev_nvme_create(&trid, "nvme0", attached_names, STRING_SIZE,
+			      attach_ctrlr_done, NULL, NULL, NULL, false);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
+
+	nvme_ns = nvme_ctrlr_get_ns(nvme_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(nvme_ns != NULL);
+	CU_ASSERT(nvme_ns->bdev != NULL);
+	CU_ASSERT(nvme_ns->num_placement_handles == 3);
+	SPDK_CU_ASSERT_FATAL(nvme_ns->placement_handles != NULL);
+	CU_ASSERT(nvme_ns->placement_handles[0] == 2);
+	CU_ASSERT(nvme_ns->placement_handles[1] == 1);
+	CU_ASSERT(nvme_ns->placement_handles[2] == 0);
+
+	/* The temporary qpair is freed */
+	CU_ASSERT(TAILQ_EMPTY(&ctrlr->active_io_qpairs));
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
+
+	/* Without any status descriptor, the namespace is still attached, without
+	 * placement handles.
+	 */
+	ruhs->nruhsd = 0;
+
+	ctrlr = ut_attach_ctrlr(&trid, 1, false, false);
+	SPDK_CU_ASSERT_FATAL(ctrlr != NULL);
+	ctrlr->ns[0].fdp_cfg = &fdp_cfg;
+
+	rc = bdev_nvme_create(&trid, "nvme0", attached_names, STRING_SIZE,
+			      attach_ctrlr_done, NULL, NULL, NULL, false);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
+
+	nvme_ns = nvme_ctrlr_get_ns(nvme_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(nvme_ns != NULL);
+	CU_ASSERT(nvme_ns->bdev != NULL);
+	CU_ASSERT(nvme_ns->num_placement_handles == 0);
+	CU_ASSERT(nvme_ns->placement_handles == NULL);
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
+
+	g_ut_ruhs = NULL;
+	g_ut_ruhs_size = 0;
+}
+
 static void
 test_add_remove_trid(void)
 {
@@ -7194,6 +7500,8 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, test_create_ctrlr);
 	CU_ADD_TEST(suite, test_reset_ctrlr);
+	CU_ADD_TEST(suite, test_read_placement_handles);
+	CU_ADD_TEST(suite, test_set_interrupt_coalescing);
 	CU_ADD_TEST(suite, test_race_between_reset_and_destruct_ctrlr);
 	CU_ADD_TEST(suite, test_failover_ctrlr);
 	CU_ADD_TEST(suite, test_race_between_failover_and_add_secondary_trid);
@@ -37,6 +37,7 @@ bool g_bdev_alias_already_exists = false;
 bool g_lvs_with_name_already_exists = false;
 bool g_ext_api_called;
 bool g_bdev_is_missing = false;
+struct spdk_bs_recovery_progress *g_recovery_progress = NULL;
 
 DEFINE_STUB_V(spdk_bdev_module_fini_start_done, (void));
 DEFINE_STUB(spdk_bdev_get_memory_domains, int, (struct spdk_bdev *bdev,
@@ -343,6 +344,21 @@ lvs_load(struct spdk_bs_dev *dev, const struct spdk_lvs_opts *lvs_opts,
 		return;
 	}
 
+	if (g_recovery_progress != NULL) {
+		struct lvol_store_recovery *recovery;
+
+		/* The recovery is listed while the lvol store is being loaded */
+		CU_ASSERT(vbdev_lvs_recovery_next(NULL) == NULL);
+		SPDK_CU_ASSERT_FATAL(lvs_opts->recovery_progress_fn != NULL);
+		lvs_opts->recovery_progress_fn(lvs_opts->recovery_progress_arg,
+					       g_recovery_progress);
+		recovery = vbdev_lvs_recovery_next(NULL);
+		SPDK_CU_ASSERT_FATAL(recovery != NULL);
+		CU_ASSERT(recovery->bdev == &g_bdev);
+		CU_ASSERT(recovery->progress.num_blobs == g_recovery_progress->num_blobs);
+		CU_ASSERT(vbdev_lvs_recovery_next(recovery) == NULL);
+	}
+
 	lvs = calloc(1, sizeof(*lvs));
 	SPDK_CU_ASSERT_FATAL(lvs != NULL);
 	lvs->blobstore = calloc(1, sizeof(*lvs->blobstore));
@@ -1189,6 +1205,8 @@ ut_lvs_examine_check(bool success)
 static void
 ut_lvol_examine_disk(void)
 {
+	struct spdk_bs_recovery_progress progress = { .md_pages_total = 64, .num_blobs = 3 };
+
 	/* Examine unsuccessfully - bdev already opened */
 	g_lvserrno = -1;
 	lvol_already_opened = true;
@@ -1251,6 +1269,18 @@ ut_lvol_examine_disk(void)
 	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_lvol_store->lvols));
 	vbdev_lvs_destruct(g_lvol_store, lvol_store_op_complete, NULL);
 	CU_ASSERT(g_lvserrno == 0);
+
+	/* Examine successfully after a recovery, which is not listed anymore once loaded */
+	g_num_lvols = 1;
+	g_registered_bdevs = 0;
+	lvol_already_opened = false;
+	g_recovery_progress = &progress;
+	vbdev_lvs_examine_disk(&g_bdev);
+	g_recovery_progress = NULL;
+	ut_lvs_examine_check(true);
+	CU_ASSERT(vbdev_lvs_recovery_next(NULL) == NULL);
+	vbdev_lvs_destruct(g_lvol_store, lvol_store_op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
 }
 
 static void
@@ -902,8 +902,9 @@ blob_snapshot_freeze_io(void)
 
 	/* This is implementation specific.
 	 * Flag 'frozen_io' is set in _spdk_bs_snapshot_freeze_cpl callback.
-	 * Four async I/O operations happen before that. */
-	poll_thread_times(0, 5);
+	 * Four async I/O operations happen before that, and the md writes
+	 * are merged with other ones in one more message. */
+	poll_thread_times(0, 6);
 
 	CU_ASSERT(TAILQ_EMPTY(&bs_channel->queued_io));
 
@@ -2893,7 +2894,11 @@ bs_test_recover_cluster_count(void)
 	memset(super_block.bstype.bstype, 0, sizeof(super_block.bstype.bstype));
 	super_block.size = dev->blockcnt * dev->blocklen;
 	super_block.io_unit_size = 0x1000;
-	memset(super_block.reserved, 0, 4000);
+	super_block.cluster_allocator = 0;
+	memset(super_block.reserved0, 0, sizeof(super_block.reserved0));
+	super_block.cluster_extent_sz = 0;
+	super_block.background_free_rate = 0;
+	memset(super_block.reserved, 0, sizeof(super_block.reserved));
 	super_block.crc = blob_md_page_calc_crc(&super_block);
 	memcpy(g_dev_buffer, &super_block, sizeof(struct spdk_bs_super_block));
 
@@ -2990,465 +2995,1115 @@ bs_test_grow(void)
 	g_bs = NULL;
 }
 
-/*
- * Create a blobstore and then unload it.
- */
-static void
-bs_unload(void)
+static uint64_t
+ut_blob_cluster(struct spdk_blob *blob, uint64_t cluster_num)
 {
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
-
-	/* Create a blob and open it. */
-	blob = ut_blob_create_and_open(bs, NULL);
-
-	/* Try to unload blobstore, should fail with open blob */
-	g_bserrno = -1;
-	spdk_bs_unload(bs, bs_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == -EBUSY);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-
-	/* Close the blob, then successfully unload blobstore */
-	g_bserrno = -1;
-	spdk_blob_close(blob, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	return bs_lba_to_cluster(blob->bs, blob->active.clusters[cluster_num]);
 }
 
-/*
- * Create a blobstore with a cluster size different than the default, and ensure it is
- *  persisted.
- */
 static void
-bs_cluster_sz(void)
+bs_cluster_allocator_extent(void)
 {
 	struct spdk_blob_store *bs;
 	struct spdk_bs_dev *dev;
-	struct spdk_bs_opts opts;
-	uint32_t cluster_sz;
-
-	/* Set cluster size to zero */
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz = 0;
-
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == -EINVAL);
-	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
-
-	/*
-	 * Set cluster size to blobstore page size,
-	 * to work it is required to be at least twice the blobstore page size.
-	 */
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz = SPDK_BS_PAGE_SIZE;
-
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == -ENOMEM);
-	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob1, *blob2, *blob3, *blob4;
+	struct spdk_io_channel *ch;
+	spdk_blob_id blobid3;
+	uint8_t payload[4096] = {};
+	uint64_t pages_per_cluster;
+	uint64_t i, n;
+	uint32_t *claimed, cluster;
+	struct spdk_bs_super_block *super_block;
 
-	/*
-	 * Set cluster size to lower than page size,
-	 * to work it is required to be at least twice the blobstore page size.
-	 */
+	/* An extent size is required */
 	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz = SPDK_BS_PAGE_SIZE - 1;
-
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_EXTENT;
+	bs_opts.cluster_extent_sz = 0;
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == -EINVAL);
 	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
 
-	/* Set cluster size to twice the default */
 	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz *= 2;
-	cluster_sz = opts.cluster_sz;
-
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+	bs_opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_EXTENT;
+	bs_opts.cluster_extent_sz = 4;
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 	bs = g_bs;
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
 
-	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
-
-	ut_bs_reload(&bs, &opts);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
 
-	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
+	/* Two thin blobs growing at the same time get clusters from separate extents */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 8;
+	blob1 = ut_blob_create_and_open(bs, &opts);
+	blob2 = ut_blob_create_and_open(bs, &opts);
 
-	spdk_bs_unload(bs, bs_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bs = NULL;
-}
+	for (i = 0; i < 8; i++) {
+		spdk_blob_io_write(blob1, ch, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		spdk_blob_io_write(blob2, ch, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
 
-/*
- * Create a blobstore, reload it and ensure total usable cluster count
- *  stays the same.
- */
-static void
-bs_usable_clusters(void)
-{
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
-	uint32_t clusters;
-	int i;
+	for (i = 0; i < 8; i++) {
+		if (i % 4 != 0) {
+			CU_ASSERT(ut_blob_cluster(blob1, i) == ut_blob_cluster(blob1, i - 1) + 1);
+			CU_ASSERT(ut_blob_cluster(blob2, i) == ut_blob_cluster(blob2, i - 1) + 1);
+		}
+	}
+	CU_ASSERT(ut_blob_cluster(blob2, 0) == ut_blob_cluster(blob1, 0) + 4);
+	CU_ASSERT(ut_blob_cluster(blob1, 4) == ut_blob_cluster(blob2, 0) + 4);
+	CU_ASSERT(ut_blob_cluster(blob2, 4) == ut_blob_cluster(blob1, 4) + 4);
 
+	/* A thick blob is fully contiguous, across extents */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 10;
+	blob3 = ut_blob_create_and_open(bs, &opts);
+	blobid3 = spdk_blob_get_id(blob3);
+	for (i = 1; i < 10; i++) {
+		CU_ASSERT(ut_blob_cluster(blob3, i) == ut_blob_cluster(blob3, 0) + i);
+	}
+	CU_ASSERT(ut_blob_cluster(blob3, 0) == ut_blob_cluster(blob2, 4) + 4);
 
-	clusters = spdk_bs_total_data_cluster_count(bs);
+	/* After being reopened, it continues after its last cluster */
+	spdk_blob_close(blob3, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_open_blob(bs, blobid3, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob3 = g_blob;
 
-	ut_bs_reload(&bs, NULL);
+	spdk_blob_resize(blob3, 12, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	for (i = 10; i < 12; i++) {
+		CU_ASSERT(ut_blob_cluster(blob3, i) == ut_blob_cluster(blob3, 0) + i);
+	}
 
-	CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
+	ut_blob_close_and_delete(bs, blob1);
+	ut_blob_close_and_delete(bs, blob2);
+	ut_blob_close_and_delete(bs, blob3);
 
-	/* Create and resize blobs to make sure that useable cluster count won't change */
-	for (i = 0; i < 4; i++) {
-		g_bserrno = -1;
-		g_blobid = SPDK_BLOBID_INVALID;
-		blob = ut_blob_create_and_open(bs, NULL);
+	/* Leave only single free clusters between used ones */
+	claimed = calloc(spdk_bit_pool_capacity(bs->used_clusters), sizeof(*claimed));
+	SPDK_CU_ASSERT_FATAL(claimed != NULL);
+	spdk_spin_lock(&bs->used_lock);
+	for (n = 0; (cluster = bs_claim_cluster(bs)) != UINT32_MAX; n++) {
+		claimed[n] = cluster;
+	}
+	SPDK_CU_ASSERT_FATAL(n >= 12);
+	for (i = 0; i < n; i += 2) {
+		bs_release_cluster(bs, claimed[i]);
+	}
+	spdk_spin_unlock(&bs->used_lock);
 
-		spdk_blob_resize(blob, 10, blob_op_complete, NULL);
+	/* Without any free run of an extent, claims take the lowest free cluster, and stop
+	 * scanning for runs
+	 */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob4 = ut_blob_create_and_open(bs, &opts);
+	for (i = 0; i < 2; i++) {
+		spdk_blob_io_write(blob4, ch, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(bs->clusters_fragmented);
+	}
+	CU_ASSERT(ut_blob_cluster(blob4, 0) == claimed[0]);
+	CU_ASSERT(ut_blob_cluster(blob4, 1) == claimed[2]);
 
-		g_bserrno = -1;
-		spdk_blob_close(blob, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
+	/* Releasing an extent worth of clusters makes runs worth looking for again */
+	spdk_spin_lock(&bs->used_lock);
+	for (i = 5; i < 11; i += 2) {
+		bs_release_cluster(bs, claimed[i]);
+		CU_ASSERT(bs->clusters_fragmented);
+	}
+	bs_release_cluster(bs, claimed[11]);
+	CU_ASSERT(!bs->clusters_fragmented);
+	spdk_spin_unlock(&bs->used_lock);
 
-		CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
+	spdk_blob_io_write(blob4, ch, payload, 2 * pages_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(!bs->clusters_fragmented);
+	CU_ASSERT(ut_blob_cluster(blob4, 2) >= claimed[4]);
+	CU_ASSERT(ut_blob_cluster(blob4, 2) + bs->cluster_extent_sz <= claimed[11] + 1);
+
+	ut_blob_close_and_delete(bs, blob4);
+	spdk_spin_lock(&bs->used_lock);
+	for (i = 0; i < n; i++) {
+		if (spdk_bit_pool_is_allocated(bs->used_clusters, claimed[i])) {
+			bs_release_cluster(bs, claimed[i]);
+		}
 	}
+	spdk_spin_unlock(&bs->used_lock);
+	free(claimed);
 
-	/* Reload the blob store to make sure that nothing changed */
-	ut_bs_reload(&bs, NULL);
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
 
-	CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
-}
+	/* The allocator is recorded in the super block and wins over the one given on load */
+	super_block = (struct spdk_bs_super_block *)g_dev_buffer;
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	ut_bs_reload(&bs, &bs_opts);
+	CU_ASSERT(super_block->cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(super_block->cluster_extent_sz == 4);
+	CU_ASSERT(bs->cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(bs->cluster_extent_sz == 4);
 
-/*
- * Test resizing of the metadata blob.  This requires creating enough blobs
- *  so that one cluster is not enough to fit the metadata for those blobs.
- *  To induce this condition to happen more quickly, we reduce the cluster
- *  size to 16KB, which means only 4 4KB blob metadata pages can fit.
- */
-static void
-bs_resize_md(void)
-{
-	struct spdk_blob_store *bs;
-	const int CLUSTER_PAGE_COUNT = 4;
-	const int NUM_BLOBS = CLUSTER_PAGE_COUNT * 4;
-	struct spdk_bs_dev *dev;
-	struct spdk_bs_opts opts;
-	struct spdk_blob *blob;
-	struct spdk_blob_opts blob_opts;
-	uint32_t cluster_sz;
-	spdk_blob_id blobids[NUM_BLOBS];
-	int i;
+	ut_bs_dirty_load(&bs, &bs_opts);
+	CU_ASSERT(bs->cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(bs->cluster_extent_sz == 4);
 
+	/* A super block without an allocator uses the one given on load, and records it */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	super_block->cluster_allocator = 0;
+	super_block->cluster_extent_sz = 0;
+	super_block->crc = blob_md_page_calc_crc(super_block);
 
 	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz = CLUSTER_PAGE_COUNT * 4096;
-	cluster_sz = opts.cluster_sz;
-
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	bs_opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_EXTENT;
+	bs_opts.cluster_extent_sz = 8;
+	spdk_bs_load(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 	bs = g_bs;
-
-	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
-
-	ut_spdk_blob_opts_init(&blob_opts);
-
-	for (i = 0; i < NUM_BLOBS; i++) {
-		g_bserrno = -1;
-		g_blobid = SPDK_BLOBID_INVALID;
-		spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(g_blobid !=  SPDK_BLOBID_INVALID);
-		blobids[i] = g_blobid;
-	}
-
-	ut_bs_reload(&bs, &opts);
-
-	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
-
-	for (i = 0; i < NUM_BLOBS; i++) {
-		g_bserrno = -1;
-		g_blob = NULL;
-		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(g_blob !=  NULL);
-		blob = g_blob;
-		g_bserrno = -1;
-		spdk_blob_close(blob, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-	}
+	CU_ASSERT(bs->cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(bs->cluster_extent_sz == 8);
 
 	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	g_bs = NULL;
+	CU_ASSERT(super_block->cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(super_block->cluster_extent_sz == 8);
 }
 
 static void
-bs_destroy(void)
+bs_delete_background_free(void)
 {
 	struct spdk_blob_store *bs;
 	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_pending_free *pending;
+	struct spdk_bs_super_block *super_block;
+	spdk_blob_id blobid, cloneid, snapshotid;
+	uint8_t payload[4096];
+	uint64_t free_clusters, pages_per_cluster, lba;
+	int i;
 
-	/* Initialize a new blob store */
 	dev = init_dev();
-	spdk_bs_init(dev, NULL, bs_op_with_handle_complete, NULL);
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+	/* Two clusters per period of the poller */
+	bs_opts.background_free_rate = 20;
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 	bs = g_bs;
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	memset(payload, 0xAA, sizeof(payload));
 
-	/* Destroy the blob store */
-	g_bserrno = -1;
-	spdk_bs_destroy(bs, bs_op_complete, NULL);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 8;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	spdk_blob_io_write(blob, ch, payload, 7 * pages_per_cluster, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-
-	/* Loading an non-existent blob store should fail. */
-	g_bs = NULL;
-	dev = init_dev();
-
-	g_bserrno = 0;
-	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
+	lba = bs_blob_cluster_lba(blob, 7);
+	CU_ASSERT(g_dev_buffer[lba * DEV_BUFFER_BLOCKLEN] == 0xAA);
+	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno != 0);
-}
-
-/* Try to hit all of the corner cases associated with serializing
- * a blob to disk
- */
-static void
-blob_serialize_test(void)
-{
-	struct spdk_bs_dev *dev;
-	struct spdk_bs_opts opts;
-	struct spdk_blob_store *bs;
-	spdk_blob_id blobid[2];
-	struct spdk_blob *blob[2];
-	uint64_t i;
-	char *value;
-	int rc;
-
-	dev = init_dev();
+	CU_ASSERT(g_bserrno == 0);
 
-	/* Initialize a new blobstore with very small clusters */
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	opts.cluster_sz = dev->blocklen * 8;
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	/* The delete completes before any cluster is released */
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 8);
+	CU_ASSERT(bs_blob_is_pending_free(bs, blobid));
 
-	/* Create and open two blobs */
-	for (i = 0; i < 2; i++) {
-		blob[i] = ut_blob_create_and_open(bs, NULL);
-		blobid[i] = spdk_blob_get_id(blob[i]);
+	/* The blob can no longer be opened or iterated */
+	g_blob = NULL;
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOENT);
+	CU_ASSERT(g_blob == NULL);
+	spdk_bs_iter_first(bs, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOENT);
+	CU_ASSERT(g_blob == NULL);
 
-		/* Set a fairly large xattr on both blobs to eat up
-		 * metadata space
-		 */
-		value = calloc(dev->blocklen - 64, sizeof(char));
-		SPDK_CU_ASSERT_FATAL(value != NULL);
-		memset(value, i, dev->blocklen / 2);
-		rc = spdk_blob_set_xattr(blob[i], "name", value, dev->blocklen - 64);
-		CU_ASSERT(rc == 0);
-		free(value);
-	}
+	/* Clusters are released and cleared from the end of the blob, two per period */
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
+	CU_ASSERT(g_dev_buffer[lba * DEV_BUFFER_BLOCKLEN] == 0);
 
-	/* Resize the blobs, alternating 1 cluster at a time.
-	 * This thwarts run length encoding and will cause spill
-	 * over of the extents.
-	 */
-	for (i = 0; i < 6; i++) {
-		spdk_blob_resize(blob[i % 2], (i / 2) + 1, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-	}
+	/* Releasing resumes after a dirty shutdown */
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+	ut_bs_dirty_load(&bs, &bs_opts);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
+	CU_ASSERT(bs_blob_is_pending_free(bs, blobid));
 
-	for (i = 0; i < 2; i++) {
-		spdk_blob_sync_md(blob[i], blob_op_complete, NULL);
+	/* The md read back from disk carries the invalid flag hiding the blob from
+	 * versions that do not release clusters in the background */
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4);
+	pending = TAILQ_FIRST(&bs->pending_frees);
+	SPDK_CU_ASSERT_FATAL(pending != NULL && pending->blob != NULL);
+	CU_ASSERT(pending->blob->invalid_flags & SPDK_BLOB_PENDING_FREE);
+
+	for (i = 1; i < 3; i++) {
+		spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
 		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4 + i * 2);
 	}
+	CU_ASSERT(!bs_blob_is_pending_free(bs, blobid));
+	CU_ASSERT(!spdk_bit_array_get(bs->used_blobids, bs_blobid_to_page(blobid)));
+	CU_ASSERT(TAILQ_EMPTY(&bs->pending_frees));
 
-	/* Close the blobs */
-	for (i = 0; i < 2; i++) {
-		spdk_blob_close(blob[i], blob_op_complete, NULL);
+	/* A clone pending free lets go of its snapshot */
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	cloneid = spdk_blob_get_id(blob);
+	for (i = 0; i < 4; i++) {
+		spdk_blob_io_write(blob, ch, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
 	}
 
-	ut_bs_reload(&bs, &opts);
+	spdk_bs_create_snapshot(bs, cloneid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
 
 	for (i = 0; i < 2; i++) {
-		blob[i] = NULL;
-
-		spdk_bs_open_blob(bs, blobid[i], blob_op_with_handle_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(g_blob != NULL);
-		blob[i] = g_blob;
-
-		CU_ASSERT(spdk_blob_get_num_clusters(blob[i]) == 3);
-
-		spdk_blob_close(blob[i], blob_op_complete, NULL);
+		spdk_blob_io_write(blob, ch, payload, i * pages_per_cluster, 1, blob_op_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
 	}
-
-	spdk_bs_unload(bs, bs_op_complete, NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
+	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	g_bs = NULL;
-}
-
-static void
-blob_crc(void)
-{
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
-	spdk_blob_id blobid;
-	uint32_t page_num;
-	int index;
-	struct spdk_blob_md_page *page;
 
-	blob = ut_blob_create_and_open(bs, NULL);
-	blobid = spdk_blob_get_id(blob);
+	spdk_bs_delete_blob(bs, cloneid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
+	CU_ASSERT(bs_blob_is_pending_free(bs, snapshotid));
 
-	page_num = bs_blobid_to_page(blobid);
-	index = DEV_BUFFER_BLOCKLEN * (bs->md_start + page_num);
-	page = (struct spdk_blob_md_page *)&g_dev_buffer[index];
-	page->crc = 0;
+	/* Only allocated clusters count against the rate */
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4);
+	CU_ASSERT(!bs_blob_is_pending_free(bs, cloneid));
 
-	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	/* An unload waits for the release in progress, the next load resumes */
+	spdk_bs_free_io_channel(ch);
 	poll_threads();
-	CU_ASSERT(g_bserrno == -EINVAL);
-	CU_ASSERT(g_blob == NULL);
-	g_bserrno = 0;
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_thread_times(0, 1);
+	CU_ASSERT(bs->background_free_busy);
+	ut_bs_reload(&bs, &bs_opts);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 2);
+	CU_ASSERT(bs_blob_is_pending_free(bs, snapshotid));
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+	CU_ASSERT(TAILQ_EMPTY(&bs->pending_frees));
 
+	/* The rate is recorded in the super block, a load without one keeps it */
+	super_block = (struct spdk_bs_super_block *)g_dev_buffer;
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	ut_bs_reload(&bs, &bs_opts);
+	CU_ASSERT(super_block->background_free_rate == 20);
+	CU_ASSERT(bs->background_free_rate == 20);
+
+	bs_opts.background_free_rate = 40;
+	ut_bs_reload(&bs, &bs_opts);
+	CU_ASSERT(bs->background_free_rate == 40);
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+
+	/* Without a rate, given or recorded, the blobs pending free after a load are released
+	 * at once
+	 */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 8;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno == -EINVAL);
-}
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 8);
 
-static void
-super_block_crc(void)
-{
-	struct spdk_blob_store *bs;
-	struct spdk_bs_dev *dev;
-	struct spdk_bs_super_block *super_block;
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(super_block->background_free_rate == 40);
+	super_block->background_free_rate = 0;
+	super_block->crc = blob_md_page_calc_crc(super_block);
 
 	dev = init_dev();
-	spdk_bs_init(dev, NULL, bs_op_with_handle_complete, NULL);
+	spdk_bs_load(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 	bs = g_bs;
+	CU_ASSERT(bs->background_free_rate == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 8);
+	spdk_delay_us(SPDK_BS_BACKGROUND_FREE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+	CU_ASSERT(TAILQ_EMPTY(&bs->pending_frees));
+
+	/* Blobs are deleted right away without a rate */
+	blob = ut_blob_create_and_open(bs, &opts);
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
 
 	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	g_bs = NULL;
+}
 
-	super_block = (struct spdk_bs_super_block *)g_dev_buffer;
-	super_block->crc = 0;
-	dev = init_dev();
+static struct spdk_bs_recovery_progress g_recovery_progress;
+static uint32_t g_recovery_progress_count;
 
-	/* Load an existing blob store */
-	g_bserrno = 0;
-	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == -EILSEQ);
+static void
+ut_recovery_progress(void *cb_arg, const struct spdk_bs_recovery_progress *progress)
+{
+	CU_ASSERT(cb_arg == &g_recovery_progress);
+	CU_ASSERT(progress->md_pages_scanned <= progress->md_pages_total);
+	CU_ASSERT(progress->md_pages_parsed <= progress->md_pages_used);
+	g_recovery_progress = *progress;
+	g_recovery_progress_count++;
 }
 
-/* For blob dirty shutdown test case we do the following sub-test cases:
- * 1 Initialize new blob store and create 1 super blob with some xattrs, then we
- *   dirty shutdown and reload the blob store and verify the xattrs.
- * 2 Resize the blob from 10 clusters to 20 clusters and then dirty shutdown,
- *   reload the blob store and verify the clusters number.
- * 3 Create the second blob and then dirty shutdown, reload the blob store
- *   and verify the second blob.
- * 4 Delete the second blob and then dirty shutdown, reload the blob store
- *   and verify the second blob is invalid.
- * 5 Create the second blob again and also create the third blob, modify the
- *   md of second blob which makes the md invalid, and then dirty shutdown,
- *   reload the blob store verify the second blob, it should invalid and also
- *   verify the third blob, it should correct.
- */
 static void
-blob_dirty_shutdown(void)
+bs_recover_md_replay(void)
 {
-	int rc;
-	int index;
-	struct spdk_blob_store *bs = g_bs;
-	spdk_blob_id blobid1, blobid2, blobid3;
-	struct spdk_blob *blob = g_blob;
-	uint64_t length;
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	struct spdk_blob *blob;
+	spdk_blob_id blobids[8];
+	bool used_md_pages[4096], used_blobids[4096], used_clusters[4096];
+	char xattr[3000] = {};
 	uint64_t free_clusters;
-	const void *value;
-	size_t value_len;
-	uint32_t page_num;
+	uint32_t md_start, md_len, extent_page;
 	struct spdk_blob_md_page *page;
-	struct spdk_blob_opts blob_opts;
-
-	/* Create first blob */
-	blobid1 = spdk_blob_get_id(blob);
-
-	/* Set some xattrs */
-	rc = spdk_blob_set_xattr(blob, "name", "log.txt", strlen("log.txt") + 1);
-	CU_ASSERT(rc == 0);
-
-	length = 2345;
-	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
-	CU_ASSERT(rc == 0);
-
-	/* Put xattr that fits exactly single page.
-	 * This results in adding additional pages to MD.
-	 * First is flags and smaller xattr, second the large xattr,
-	 * third are just the extents.
-	 */
-	size_t xattr_length = 4072 - sizeof(struct spdk_blob_md_descriptor_xattr) -
-			      strlen("large_xattr");
-	char *xattr = calloc(xattr_length, sizeof(char));
-	SPDK_CU_ASSERT_FATAL(xattr != NULL);
-	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
-	free(xattr);
-	SPDK_CU_ASSERT_FATAL(rc == 0);
+	uint32_t i;
+	int rc;
 
-	/* Resize the blob */
-	spdk_blob_resize(blob, 10, blob_op_complete, NULL);
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	md_start = bs->md_start;
+	md_len = bs->md_len;
+	/* The metadata region spans several replay windows */
+	SPDK_CU_ASSERT_FATAL(md_len > SPDK_BS_RECOVER_READ_PAGES * SPDK_BS_RECOVER_READ_DEPTH);
+	SPDK_CU_ASSERT_FATAL(md_len <= SPDK_COUNTOF(used_md_pages));
+	SPDK_CU_ASSERT_FATAL(bs->total_clusters <= SPDK_COUNTOF(used_clusters));
+
+	/* Blobs with chained md pages, thick and thin, with clusters spanning extent pages */
+	for (i = 0; i < SPDK_COUNTOF(blobids); i++) {
+		ut_spdk_blob_opts_init(&opts);
+		opts.thin_provision = i % 2;
+		opts.num_clusters = i * 150;
+		blob = ut_blob_create_and_open(bs, &opts);
+		blobids[i] = spdk_blob_get_id(blob);
+		if (i % 3 == 0) {
+			rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, sizeof(xattr));
+			CU_ASSERT(rc == 0);
+			rc = spdk_blob_set_xattr(blob, "large_xattr2", xattr, sizeof(xattr));
+			CU_ASSERT(rc == 0);
+		}
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
 
-	/* Set the blob as the super blob */
-	spdk_bs_set_super(bs, blobid1, blob_op_complete, NULL);
+	/* Leave a hole in the metadata */
+	spdk_bs_delete_blob(bs, blobids[3], blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	for (i = 0; i < md_len; i++) {
+		used_md_pages[i] = spdk_bit_array_get(bs->used_md_pages, i);
+		used_blobids[i] = spdk_bit_array_get(bs->used_blobids, i);
+	}
+	for (i = 0; i < bs->total_clusters; i++) {
+		used_clusters[i] = spdk_bit_pool_is_allocated(bs->used_clusters, i);
+	}
+
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.recovery_progress_fn = ut_recovery_progress;
+	bs_opts.recovery_progress_arg = &g_recovery_progress;
+	memset(&g_recovery_progress, 0, sizeof(g_recovery_progress));
+	g_recovery_progress_count = 0;
+	ut_bs_dirty_load(&bs, &bs_opts);
+
+	/* Progress was reported for each window, and all the metadata was replayed */
+	CU_ASSERT(g_recovery_progress_count > md_len / (SPDK_BS_RECOVER_READ_PAGES *
+			SPDK_BS_RECOVER_READ_DEPTH));
+	CU_ASSERT(g_recovery_progress.md_pages_total == md_len);
+	CU_ASSERT(g_recovery_progress.md_pages_scanned == md_len);
+	CU_ASSERT(g_recovery_progress.md_pages_used == spdk_bit_array_count_set(bs->used_md_pages));
+	CU_ASSERT(g_recovery_progress.md_pages_parsed == g_recovery_progress.md_pages_used);
+	CU_ASSERT(g_recovery_progress.num_blobs == SPDK_COUNTOF(blobids) - 1);
+
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+	for (i = 0; i < md_len; i++) {
+		CU_ASSERT(spdk_bit_array_get(bs->used_md_pages, i) == used_md_pages[i]);
+		CU_ASSERT(spdk_bit_array_get(bs->used_blobids, i) == used_blobids[i]);
+	}
+	for (i = 0; i < bs->total_clusters; i++) {
+		CU_ASSERT(spdk_bit_pool_is_allocated(bs->used_clusters, i) == used_clusters[i]);
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(blobids); i++) {
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		if (i == 3) {
+			CU_ASSERT(g_bserrno == -ENOENT);
+			continue;
+		}
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blob = g_blob;
+		CU_ASSERT(spdk_blob_get_num_clusters(blob) == i * 150);
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	if (!g_use_extent_table) {
+		spdk_bs_unload(bs, bs_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		g_bs = NULL;
+		return;
+	}
+
+	/* A corrupted extent page fails the recovery */
+	spdk_bs_open_blob(bs, blobids[2], blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	SPDK_CU_ASSERT_FATAL(blob->active.num_extent_pages > 0);
+	extent_page = blob->active.extent_pages[0];
+	SPDK_CU_ASSERT_FATAL(extent_page != 0);
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	bs_free(bs);
+	g_bs = NULL;
+	page = (struct spdk_blob_md_page *)&g_dev_buffer[(md_start + extent_page) *
+			SPDK_BS_PAGE_SIZE];
+	page->crc++;
+
+	dev = init_dev();
+	spdk_bs_load(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EILSEQ);
+	CU_ASSERT(g_bs == NULL);
+}
+
+/*
+ * Create a blobstore and then unload it.
+ */
+static void
+bs_unload(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+
+	/* Create a blob and open it. */
+	blob = ut_blob_create_and_open(bs, NULL);
+
+	/* Try to unload blobstore, should fail with open blob */
+	g_bserrno = -1;
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EBUSY);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+
+	/* Close the blob, then successfully unload blobstore */
+	g_bserrno = -1;
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+}
+
+/*
+ * Create a blobstore with a cluster size different than the default, and ensure it is
+ *  persisted.
+ */
+static void
+bs_cluster_sz(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts opts;
+	uint32_t cluster_sz;
+
+	/* Set cluster size to zero */
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = 0;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
+
+	/*
+	 * Set cluster size to blobstore page size,
+	 * to work it is required to be at least twice the blobstore page size.
+	 */
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = SPDK_BS_PAGE_SIZE;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOMEM);
+	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
+
+	/*
+	 * Set cluster size to lower than page size,
+	 * to work it is required to be at least twice the blobstore page size.
+	 */
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = SPDK_BS_PAGE_SIZE - 1;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	SPDK_CU_ASSERT_FATAL(g_bs == NULL);
+
+	/* Set cluster size to twice the default */
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz *= 2;
+	cluster_sz = opts.cluster_sz;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
+
+	ut_bs_reload(&bs, &opts);
+
+	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+/*
+ * Create a blobstore, reload it and ensure total usable cluster count
+ *  stays the same.
+ */
+static void
+bs_usable_clusters(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	uint32_t clusters;
+	int i;
+
+
+	clusters = spdk_bs_total_data_cluster_count(bs);
+
+	ut_bs_reload(&bs, NULL);
+
+	CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
+
+	/* Create and resize blobs to make sure that useable cluster count won't change */
+	for (i = 0; i < 4; i++) {
+		g_bserrno = -1;
+		g_blobid = SPDK_BLOBID_INVALID;
+		blob = ut_blob_create_and_open(bs, NULL);
+
+		spdk_blob_resize(blob, 10, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+
+		g_bserrno = -1;
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+
+		CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
+	}
+
+	/* Reload the blob store to make sure that nothing changed */
+	ut_bs_reload(&bs, NULL);
+
+	CU_ASSERT(spdk_bs_total_data_cluster_count(bs) == clusters);
+}
+
+/*
+ * Test resizing of the metadata blob.  This requires creating enough blobs
+ *  so that one cluster is not enough to fit the metadata for those blobs.
+ *  To induce this condition to happen more quickly, we reduce the cluster
+ *  size to 16KB, which means only 4 4KB blob metadata pages can fit.
+ */
+static void
+bs_resize_md(void)
+{
+	struct spdk_blob_store *bs;
+	const int CLUSTER_PAGE_COUNT = 4;
+	const int NUM_BLOBS = CLUSTER_PAGE_COUNT * 4;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts opts;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts blob_opts;
+	uint32_t cluster_sz;
+	spdk_blob_id blobids[NUM_BLOBS];
+	int i;
+
+
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = CLUSTER_PAGE_COUNT * 4096;
+	cluster_sz = opts.cluster_sz;
+
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
+
+	ut_spdk_blob_opts_init(&blob_opts);
+
+	for (i = 0; i < NUM_BLOBS; i++) {
+		g_bserrno = -1;
+		g_blobid = SPDK_BLOBID_INVALID;
+		spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(g_blobid !=  SPDK_BLOBID_INVALID);
+		blobids[i] = g_blobid;
+	}
+
+	ut_bs_reload(&bs, &opts);
+
+	CU_ASSERT(spdk_bs_get_cluster_size(bs) == cluster_sz);
+
+	for (i = 0; i < NUM_BLOBS; i++) {
+		g_bserrno = -1;
+		g_blob = NULL;
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(g_blob !=  NULL);
+		blob = g_blob;
+		g_bserrno = -1;
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+bs_destroy(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+
+	/* Initialize a new blob store */
+	dev = init_dev();
+	spdk_bs_init(dev, NULL, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	/* Destroy the blob store */
+	g_bserrno = -1;
+	spdk_bs_destroy(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Loading an non-existent blob store should fail. */
+	g_bs = NULL;
+	dev = init_dev();
+
+	g_bserrno = 0;
+	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno != 0);
+}
+
+/* Try to hit all of the corner cases associated with serializing
+ * a blob to disk
+ */
+static void
+blob_serialize_test(void)
+{
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts opts;
+	struct spdk_blob_store *bs;
+	spdk_blob_id blobid[2];
+	struct spdk_blob *blob[2];
+	uint64_t i;
+	char *value;
+	int rc;
+
+	dev = init_dev();
+
+	/* Initialize a new blobstore with very small clusters */
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = dev->blocklen * 8;
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	/* Create and open two blobs */
+	for (i = 0; i < 2; i++) {
+		blob[i] = ut_blob_create_and_open(bs, NULL);
+		blobid[i] = spdk_blob_get_id(blob[i]);
+
+		/* Set a fairly large xattr on both blobs to eat up
+		 * metadata space
+		 */
+		value = calloc(dev->blocklen - 64, sizeof(char));
+		SPDK_CU_ASSERT_FATAL(value != NULL);
+		memset(value, i, dev->blocklen / 2);
+		rc = spdk_blob_set_xattr(blob[i], "name", value, dev->blocklen - 64);
+		CU_ASSERT(rc == 0);
+		free(value);
+	}
+
+	/* Resize the blobs, alternating 1 cluster at a time.
+	 * This thwarts run length encoding and will cause spill
+	 * over of the extents.
+	 */
+	for (i = 0; i < 6; i++) {
+		spdk_blob_resize(blob[i % 2], (i / 2) + 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	for (i = 0; i < 2; i++) {
+		spdk_blob_sync_md(blob[i], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	/* Close the blobs */
+	for (i = 0; i < 2; i++) {
+		spdk_blob_close(blob[i], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	ut_bs_reload(&bs, &opts);
+
+	for (i = 0; i < 2; i++) {
+		blob[i] = NULL;
+
+		spdk_bs_open_blob(bs, blobid[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(g_blob != NULL);
+		blob[i] = g_blob;
+
+		CU_ASSERT(spdk_blob_get_num_clusters(blob[i]) == 3);
+
+		spdk_blob_close(blob[i], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_crc(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	spdk_blob_id blobid;
+	uint32_t page_num;
+	int index;
+	struct spdk_blob_md_page *page;
+
+	blob = ut_blob_create_and_open(bs, NULL);
+	blobid = spdk_blob_get_id(blob);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	page_num = bs_blobid_to_page(blobid);
+	index = DEV_BUFFER_BLOCKLEN * (bs->md_start + page_num);
+	page = (struct spdk_blob_md_page *)&g_dev_buffer[index];
+	page->crc = 0;
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(g_blob == NULL);
+	g_bserrno = 0;
+
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+}
+
+static void
+super_block_crc(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_super_block *super_block;
+
+	dev = init_dev();
+	spdk_bs_init(dev, NULL, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+
+	super_block = (struct spdk_bs_super_block *)g_dev_buffer;
+	super_block->crc = 0;
+	dev = init_dev();
+
+	/* Load an existing blob store */
+	g_bserrno = 0;
+	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EILSEQ);
+}
+
+/* For blob dirty shutdown test case we do the following sub-test cases:
+ * 1 Initialize new blob store and create 1 super blob with some xattrs, then we
+ *   dirty shutdown and reload the blob store and verify the xattrs.
+ * 2 Resize the blob from 10 clusters to 20 clusters and then dirty shutdown,
+ *   reload the blob store and verify the clusters number.
+ * 3 Create the second blob and then dirty shutdown, reload the blob store
+ *   and verify the second blob.
+ * 4 Delete the second blob and then dirty shutdown, reload the blob store
+ *   and verify the second blob is invalid.
+ * 5 Create the second blob again and also create the third blob, modify the
+ *   md of second blob which makes the md invalid, and then dirty shutdown,
+ *   reload the blob store verify the second blob, it should invalid and also
+ *   verify the third blob, it should correct.
+ */
+static void
+blob_dirty_shutdown(void)
+{
+	int rc;
+	int index;
+	struct spdk_blob_store *bs = g_bs;
+	spdk_blob_id blobid1, blobid2, blobid3;
+	struct spdk_blob *blob = g_blob;
+	uint64_t length;
+	uint64_t free_clusters;
+	const void *value;
+	size_t value_len;
+	uint32_t page_num;
+	struct spdk_blob_md_page *page;
+	struct spdk_blob_opts blob_opts;
+
+	/* Create first blob */
+	blobid1 = spdk_blob_get_id(blob);
+
+	/* Set some xattrs */
+	rc = spdk_blob_set_xattr(blob, "name", "log.txt", strlen("log.txt") + 1);
+	CU_ASSERT(rc == 0);
+
+	length = 2345;
+	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
+	CU_ASSERT(rc == 0);
+
+	/* Put xattr that fits exactly single page.
+	 * This results in adding additional pages to MD.
+	 * First is flags and smaller xattr, second the large xattr,
+	 * third are just the extents.
+	 */
+	size_t xattr_length = 4072 - sizeof(struct spdk_blob_md_descriptor_xattr) -
+			      strlen("large_xattr");
+	char *xattr = calloc(xattr_length, sizeof(char));
+	SPDK_CU_ASSERT_FATAL(xattr != NULL);
+	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
+	free(xattr);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	/* Resize the blob */
+	spdk_blob_resize(blob, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Set the blob as the super blob */
+	spdk_bs_set_super(bs, blobid1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	ut_bs_dirty_load(&bs, NULL);
+
+	/* Get the super blob */
+	spdk_bs_get_super(bs, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blobid1 == g_blobid);
+
+	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	/* Get the xattrs */
+	value = NULL;
+	rc = spdk_blob_get_xattr_value(blob, "length", &value, &value_len);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(*(uint64_t *)value == length);
+	CU_ASSERT(value_len == 8);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 10);
+
+	/* Resize the blob */
+	spdk_blob_resize(blob, 20, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	ut_bs_dirty_load(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 20);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	/* Create second blob */
+	blob = ut_blob_create_and_open(bs, NULL);
+	blobid2 = spdk_blob_get_id(blob);
+
+	/* Set some xattrs */
+	rc = spdk_blob_set_xattr(blob, "name", "log1.txt", strlen("log1.txt") + 1);
+	CU_ASSERT(rc == 0);
+
+	length = 5432;
+	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
+	CU_ASSERT(rc == 0);
+
+	/* Resize the blob */
+	spdk_blob_resize(blob, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 
@@ -3463,78 +4118,384 @@ blob_dirty_shutdown(void)
 
 	ut_bs_dirty_load(&bs, NULL);
 
-	/* Get the super blob */
-	spdk_bs_get_super(bs, blob_op_with_id_complete, NULL);
+	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+
+	/* Get the xattrs */
+	value = NULL;
+	rc = spdk_blob_get_xattr_value(blob, "length", &value, &value_len);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(*(uint64_t *)value == length);
+	CU_ASSERT(value_len == 8);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 10);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	ut_blob_close_and_delete(bs, blob);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	ut_bs_dirty_load(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno != 0);
+	CU_ASSERT(g_blob == NULL);
+
+	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	ut_bs_reload(&bs, NULL);
+
+	/* Create second blob */
+	ut_spdk_blob_opts_init(&blob_opts);
+	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	blobid2 = g_blobid;
+
+	/* Create third blob */
+	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	blobid3 = g_blobid;
+
+	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+
+	/* Set some xattrs for second blob */
+	rc = spdk_blob_set_xattr(blob, "name", "log1.txt", strlen("log1.txt") + 1);
+	CU_ASSERT(rc == 0);
+
+	length = 5432;
+	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
+	CU_ASSERT(rc == 0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	spdk_bs_open_blob(bs, blobid3, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+
+	/* Set some xattrs for third blob */
+	rc = spdk_blob_set_xattr(blob, "name", "log2.txt", strlen("log2.txt") + 1);
+	CU_ASSERT(rc == 0);
+
+	length = 5432;
+	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
+	CU_ASSERT(rc == 0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob = NULL;
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	/* Mark second blob as invalid */
+	page_num = bs_blobid_to_page(blobid2);
+
+	index = DEV_BUFFER_BLOCKLEN * (bs->md_start + page_num);
+	page = (struct spdk_blob_md_page *)&g_dev_buffer[index];
+	page->sequence_num = 1;
+	page->crc = blob_md_page_calc_crc(page);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	ut_bs_dirty_load(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno != 0);
+	CU_ASSERT(g_blob == NULL);
+
+	spdk_bs_open_blob(bs, blobid3, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
+
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+}
+
+static void
+blob_flags(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	spdk_blob_id blobid_invalid, blobid_data_ro, blobid_md_ro;
+	struct spdk_blob *blob_invalid, *blob_data_ro, *blob_md_ro;
+	struct spdk_blob_opts blob_opts;
+	int rc;
+
+	/* Create three blobs - one each for testing invalid, data_ro and md_ro flags. */
+	blob_invalid = ut_blob_create_and_open(bs, NULL);
+	blobid_invalid = spdk_blob_get_id(blob_invalid);
+
+	blob_data_ro = ut_blob_create_and_open(bs, NULL);
+	blobid_data_ro = spdk_blob_get_id(blob_data_ro);
+
+	ut_spdk_blob_opts_init(&blob_opts);
+	blob_opts.clear_method = BLOB_CLEAR_WITH_WRITE_ZEROES;
+	blob_md_ro = ut_blob_create_and_open(bs, &blob_opts);
+	blobid_md_ro = spdk_blob_get_id(blob_md_ro);
+	CU_ASSERT((blob_md_ro->md_ro_flags & SPDK_BLOB_MD_RO_FLAGS_MASK) == BLOB_CLEAR_WITH_WRITE_ZEROES);
+
+	/* Change the size of blob_data_ro to check if flags are serialized
+	 * when blob has non zero number of extents */
+	spdk_blob_resize(blob_data_ro, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Set the xattr to check if flags are serialized
+	 * when blob has non zero number of xattrs */
+	rc = spdk_blob_set_xattr(blob_md_ro, "name", "log.txt", strlen("log.txt") + 1);
+	CU_ASSERT(rc == 0);
+
+	blob_invalid->invalid_flags = (1ULL << 63);
+	blob_invalid->state = SPDK_BLOB_STATE_DIRTY;
+	blob_data_ro->data_ro_flags = (1ULL << 62);
+	blob_data_ro->state = SPDK_BLOB_STATE_DIRTY;
+	blob_md_ro->md_ro_flags = (1ULL << 61);
+	blob_md_ro->state = SPDK_BLOB_STATE_DIRTY;
+
+	g_bserrno = -1;
+	spdk_blob_sync_md(blob_invalid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bserrno = -1;
+	spdk_blob_sync_md(blob_data_ro, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bserrno = -1;
+	spdk_blob_sync_md(blob_md_ro, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	g_bserrno = -1;
+	spdk_blob_close(blob_invalid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob_invalid = NULL;
+	g_bserrno = -1;
+	spdk_blob_close(blob_data_ro, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob_data_ro = NULL;
+	g_bserrno = -1;
+	spdk_blob_close(blob_md_ro, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	blob_md_ro = NULL;
+
+	g_blob = NULL;
+	g_blobid = SPDK_BLOBID_INVALID;
+
+	ut_bs_reload(&bs, NULL);
+
+	g_blob = NULL;
+	g_bserrno = 0;
+	spdk_bs_open_blob(bs, blobid_invalid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno != 0);
+	CU_ASSERT(g_blob == NULL);
+
+	g_blob = NULL;
+	g_bserrno = -1;
+	spdk_bs_open_blob(bs, blobid_data_ro, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob_data_ro = g_blob;
+	/* If an unknown data_ro flag was found, the blob should be marked both data and md read-only. */
+	CU_ASSERT(blob_data_ro->data_ro == true);
+	CU_ASSERT(blob_data_ro->md_ro == true);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob_data_ro) == 10);
+
+	g_blob = NULL;
+	g_bserrno = -1;
+	spdk_bs_open_blob(bs, blobid_md_ro, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(blobid1 == g_blobid);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob_md_ro = g_blob;
+	CU_ASSERT(blob_md_ro->data_ro == false);
+	CU_ASSERT(blob_md_ro->md_ro == true);
 
-	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	g_bserrno = -1;
+	spdk_blob_sync_md(blob_md_ro, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
-	blob = g_blob;
 
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	ut_blob_close_and_delete(bs, blob_data_ro);
+	ut_blob_close_and_delete(bs, blob_md_ro);
+}
 
-	/* Get the xattrs */
-	value = NULL;
-	rc = spdk_blob_get_xattr_value(blob, "length", &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(*(uint64_t *)value == length);
-	CU_ASSERT(value_len == 8);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 10);
+static void
+bs_version(void)
+{
+	struct spdk_bs_super_block *super;
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts blob_opts;
+	spdk_blob_id blobid;
 
-	/* Resize the blob */
-	spdk_blob_resize(blob, 20, blob_op_complete, NULL);
+	/* Unload the blob store */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
+	/*
+	 * Change the bs version on disk.  This will allow us to
+	 *  test that the version does not get modified automatically
+	 *  when loading and unloading the blobstore.
+	 */
+	super = (struct spdk_bs_super_block *)&g_dev_buffer[0];
+	CU_ASSERT(super->version == SPDK_BS_VERSION);
+	CU_ASSERT(super->clean == 1);
+	super->version = 2;
+	/*
+	 * Version 2 metadata does not have a used blobid mask, so clear
+	 *  those fields in the super block and zero the corresponding
+	 *  region on "disk".  We will use this to ensure blob IDs are
+	 *  correctly reconstructed.
+	 */
+	memset(&g_dev_buffer[super->used_blobid_mask_start * SPDK_BS_PAGE_SIZE], 0,
+	       super->used_blobid_mask_len * SPDK_BS_PAGE_SIZE);
+	super->used_blobid_mask_start = 0;
+	super->used_blobid_mask_len = 0;
+	super->crc = blob_md_page_calc_crc(super);
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	/* Load an existing blob store */
+	dev = init_dev();
+	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
-	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	CU_ASSERT(super->clean == 1);
+	bs = g_bs;
 
-	ut_bs_dirty_load(&bs, NULL);
+	/*
+	 * Create a blob - just to make sure that when we unload it
+	 *  results in writing the super block (since metadata pages
+	 *  were allocated.
+	 */
+	ut_spdk_blob_opts_init(&blob_opts);
+	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	blobid = g_blobid;
 
-	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	/* Unload the blob store */
+	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
-	blob = g_blob;
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 20);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	g_bs = NULL;
+	CU_ASSERT(super->version == 2);
+	CU_ASSERT(super->used_blobid_mask_start == 0);
+	CU_ASSERT(super->used_blobid_mask_len == 0);
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	dev = init_dev();
+	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
 	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blob != NULL);
+	blob = g_blob;
 
-	/* Create second blob */
-	blob = ut_blob_create_and_open(bs, NULL);
-	blobid2 = spdk_blob_get_id(blob);
+	ut_blob_close_and_delete(bs, blob);
 
-	/* Set some xattrs */
-	rc = spdk_blob_set_xattr(blob, "name", "log1.txt", strlen("log1.txt") + 1);
+	CU_ASSERT(super->version == 2);
+	CU_ASSERT(super->used_blobid_mask_start == 0);
+	CU_ASSERT(super->used_blobid_mask_len == 0);
+}
+
+static void
+blob_set_xattrs_test(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts opts;
+	const void *value;
+	size_t value_len;
+	char *xattr;
+	size_t xattr_length;
+	int rc;
+
+	/* Create blob with extra attributes */
+	ut_spdk_blob_opts_init(&opts);
+
+	opts.xattrs.names = g_xattr_names;
+	opts.xattrs.get_value = _get_xattr_value;
+	opts.xattrs.count = 3;
+	opts.xattrs.ctx = &g_ctx;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	/* Get the xattrs */
+	value = NULL;
+
+	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[0], &value, &value_len);
 	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(value_len == strlen(g_xattr_values[0]));
+	CU_ASSERT_NSTRING_EQUAL_FATAL(value, g_xattr_values[0], value_len);
 
-	length = 5432;
-	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
+	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[1], &value, &value_len);
 	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(value_len == strlen(g_xattr_values[1]));
+	CU_ASSERT_NSTRING_EQUAL((char *)value, g_xattr_values[1], value_len);
 
-	/* Resize the blob */
-	spdk_blob_resize(blob, 10, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[2], &value, &value_len);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(value != NULL);
+	CU_ASSERT(value_len == strlen(g_xattr_values[2]));
+	CU_ASSERT_NSTRING_EQUAL((char *)value, g_xattr_values[2], value_len);
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
+	/* Try to get non existing attribute */
+
+	rc = spdk_blob_get_xattr_value(blob, "foobar", &value, &value_len);
+	CU_ASSERT(rc == -ENOENT);
+
+	/* Try xattr exceeding maximum length of descriptor in single page */
+	xattr_length = SPDK_BS_MAX_DESC_SIZE - sizeof(struct spdk_blob_md_descriptor_xattr) -
+		       strlen("large_xattr") + 1;
+	xattr = calloc(xattr_length, sizeof(char));
+	SPDK_CU_ASSERT_FATAL(xattr != NULL);
+	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
+	free(xattr);
+	SPDK_CU_ASSERT_FATAL(rc == -ENOMEM);
 
 	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
@@ -3543,483 +4504,565 @@ blob_dirty_shutdown(void)
 	g_blob = NULL;
 	g_blobid = SPDK_BLOBID_INVALID;
 
-	ut_bs_dirty_load(&bs, NULL);
+	/* NULL callback */
+	ut_spdk_blob_opts_init(&opts);
+	opts.xattrs.names = g_xattr_names;
+	opts.xattrs.get_value = NULL;
+	opts.xattrs.count = 1;
+	opts.xattrs.ctx = &g_ctx;
 
-	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
-	blob = g_blob;
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
 
-	/* Get the xattrs */
-	value = NULL;
-	rc = spdk_blob_get_xattr_value(blob, "length", &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(*(uint64_t *)value == length);
-	CU_ASSERT(value_len == 8);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 10);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	/* NULL values */
+	ut_spdk_blob_opts_init(&opts);
+	opts.xattrs.names = g_xattr_names;
+	opts.xattrs.get_value = _get_xattr_value_null;
+	opts.xattrs.count = 1;
+	opts.xattrs.ctx = NULL;
 
-	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+}
+
+static void
+blob_thin_prov_alloc(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid;
+	uint64_t free_clusters;
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
 
-	ut_bs_dirty_load(&bs, NULL);
+	/* Set blob as thin provisioned */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
 
-	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno != 0);
-	CU_ASSERT(g_blob == NULL);
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	spdk_bs_open_blob(bs, blobid1, blob_op_with_handle_complete, NULL);
+	CU_ASSERT(blob->active.num_clusters == 0);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 0);
+
+	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
+	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
-	blob = g_blob;
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	CU_ASSERT(blob->active.num_clusters == 5);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+
+	/* Grow it to 1TB - still unallocated */
+	spdk_blob_resize(blob, 262144, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 262144);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 262144);
 
-	ut_bs_reload(&bs, NULL);
-
-	/* Create second blob */
-	ut_spdk_blob_opts_init(&blob_opts);
-	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	blobid2 = g_blobid;
+	/* Sync must not change anything */
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 262144);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 262144);
+	/* Since clusters are not allocated,
+	 * number of metadata pages is expected to be minimal.
+	 */
+	CU_ASSERT(blob->active.num_pages == 1);
 
-	/* Create third blob */
-	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
+	/* Shrink the blob to 3 clusters - still unallocated */
+	spdk_blob_resize(blob, 3, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	blobid3 = g_blobid;
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 3);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 3);
 
-	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
-	blob = g_blob;
-
-	/* Set some xattrs for second blob */
-	rc = spdk_blob_set_xattr(blob, "name", "log1.txt", strlen("log1.txt") + 1);
-	CU_ASSERT(rc == 0);
-
-	length = 5432;
-	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
-	CU_ASSERT(rc == 0);
+	/* Sync must not change anything */
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 3);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 3);
 
 	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
-	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
 
-	spdk_bs_open_blob(bs, blobid3, blob_op_with_handle_complete, NULL);
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
 
-	/* Set some xattrs for third blob */
-	rc = spdk_blob_set_xattr(blob, "name", "log2.txt", strlen("log2.txt") + 1);
-	CU_ASSERT(rc == 0);
+	/* Check that clusters allocation and size is still the same */
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 3);
 
-	length = 5432;
-	rc = spdk_blob_set_xattr(blob, "length", &length, sizeof(length));
-	CU_ASSERT(rc == 0);
+	ut_blob_close_and_delete(bs, blob);
+}
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
-	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
+static void
+blob_insert_cluster_msg_test(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts opts;
+	struct spdk_blob_md_page page = {};
+	spdk_blob_id blobid;
+	uint64_t free_clusters;
+	uint64_t new_cluster = 0;
+	uint32_t cluster_num = 3;
+	uint32_t extent_page = 0;
 
-	/* Mark second blob as invalid */
-	page_num = bs_blobid_to_page(blobid2);
+	free_clusters = spdk_bs_free_cluster_count(bs);
 
-	index = DEV_BUFFER_BLOCKLEN * (bs->md_start + page_num);
-	page = (struct spdk_blob_md_page *)&g_dev_buffer[index];
-	page->sequence_num = 1;
-	page->crc = blob_md_page_calc_crc(page);
+	/* Set blob as thin provisioned */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	ut_bs_dirty_load(&bs, NULL);
+	CU_ASSERT(blob->active.num_clusters == 4);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 4);
+	CU_ASSERT(blob->active.clusters[cluster_num] == 0);
 
-	spdk_bs_open_blob(bs, blobid2, blob_op_with_handle_complete, NULL);
+	/* Specify cluster_num to allocate and new_cluster will be returned to insert on md_thread.
+	 * This is to simulate behaviour when cluster is allocated after blob creation.
+	 * Such as _spdk_bs_allocate_and_copy_cluster(). */
+	spdk_spin_lock(&bs->used_lock);
+	bs_allocate_cluster(blob, cluster_num, &new_cluster, &extent_page, false);
+	CU_ASSERT(blob->active.clusters[cluster_num] == 0);
+	spdk_spin_unlock(&bs->used_lock);
+
+	blob_insert_cluster_on_md_thread(blob, cluster_num, new_cluster, extent_page, &page, false,
+					 blob_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno != 0);
-	CU_ASSERT(g_blob == NULL);
 
-	spdk_bs_open_blob(bs, blobid3, blob_op_with_handle_complete, NULL);
+	CU_ASSERT(blob->active.clusters[cluster_num] != 0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
+
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
 
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.clusters[cluster_num] != 0);
+
+	ut_blob_close_and_delete(bs, blob);
 }
 
 static void
-blob_flags(void)
+blob_thin_prov_rw(void)
 {
+	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	spdk_blob_id blobid_invalid, blobid_data_ro, blobid_md_ro;
-	struct spdk_blob *blob_invalid, *blob_data_ro, *blob_md_ro;
-	struct spdk_blob_opts blob_opts;
-	int rc;
-
-	/* Create three blobs - one each for testing invalid, data_ro and md_ro flags. */
-	blob_invalid = ut_blob_create_and_open(bs, NULL);
-	blobid_invalid = spdk_blob_get_id(blob_invalid);
+	struct spdk_blob *blob, *blob_id0;
+	struct spdk_io_channel *channel, *channel_thread1;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters;
+	uint64_t page_size;
+	uint8_t payload_read[10 * 4096];
+	uint8_t payload_write[10 * 4096];
+	uint64_t write_bytes;
+	uint64_t read_bytes;
 
-	blob_data_ro = ut_blob_create_and_open(bs, NULL);
-	blobid_data_ro = spdk_blob_get_id(blob_data_ro);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	page_size = spdk_bs_get_page_size(bs);
 
-	ut_spdk_blob_opts_init(&blob_opts);
-	blob_opts.clear_method = BLOB_CLEAR_WITH_WRITE_ZEROES;
-	blob_md_ro = ut_blob_create_and_open(bs, &blob_opts);
-	blobid_md_ro = spdk_blob_get_id(blob_md_ro);
-	CU_ASSERT((blob_md_ro->md_ro_flags & SPDK_BLOB_MD_RO_FLAGS_MASK) == BLOB_CLEAR_WITH_WRITE_ZEROES);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
 
-	/* Change the size of blob_data_ro to check if flags are serialized
-	 * when blob has non zero number of extents */
-	spdk_blob_resize(blob_data_ro, 10, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
 
-	/* Set the xattr to check if flags are serialized
-	 * when blob has non zero number of xattrs */
-	rc = spdk_blob_set_xattr(blob_md_ro, "name", "log.txt", strlen("log.txt") + 1);
-	CU_ASSERT(rc == 0);
+	/* Create and delete blob at md page 0, so that next md page allocation
+	 * for extent will use that. */
+	blob_id0 = ut_blob_create_and_open(bs, &opts);
+	blob = ut_blob_create_and_open(bs, &opts);
+	ut_blob_close_and_delete(bs, blob_id0);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	blob_invalid->invalid_flags = (1ULL << 63);
-	blob_invalid->state = SPDK_BLOB_STATE_DIRTY;
-	blob_data_ro->data_ro_flags = (1ULL << 62);
-	blob_data_ro->state = SPDK_BLOB_STATE_DIRTY;
-	blob_md_ro->md_ro_flags = (1ULL << 61);
-	blob_md_ro->state = SPDK_BLOB_STATE_DIRTY;
+	CU_ASSERT(blob->active.num_clusters == 0);
 
-	g_bserrno = -1;
-	spdk_blob_sync_md(blob_invalid, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bserrno = -1;
-	spdk_blob_sync_md(blob_data_ro, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bserrno = -1;
-	spdk_blob_sync_md(blob_md_ro, blob_op_complete, NULL);
+	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
+	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 5);
 
-	g_bserrno = -1;
-	spdk_blob_close(blob_invalid, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	blob_invalid = NULL;
-	g_bserrno = -1;
-	spdk_blob_close(blob_data_ro, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	blob_data_ro = NULL;
-	g_bserrno = -1;
-	spdk_blob_close(blob_md_ro, blob_op_complete, NULL);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	blob_md_ro = NULL;
-
-	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
-
-	ut_bs_reload(&bs, NULL);
-
-	g_blob = NULL;
-	g_bserrno = 0;
-	spdk_bs_open_blob(bs, blobid_invalid, blob_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno != 0);
-	CU_ASSERT(g_blob == NULL);
+	/* Sync must not change anything */
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == 5);
 
-	g_blob = NULL;
-	g_bserrno = -1;
-	spdk_bs_open_blob(bs, blobid_data_ro, blob_op_with_handle_complete, NULL);
+	/* Payload should be all zeros from unallocated clusters */
+	memset(payload_read, 0xFF, sizeof(payload_read));
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	blob_data_ro = g_blob;
-	/* If an unknown data_ro flag was found, the blob should be marked both data and md read-only. */
-	CU_ASSERT(blob_data_ro->data_ro == true);
-	CU_ASSERT(blob_data_ro->md_ro == true);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob_data_ro) == 10);
+	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	g_blob = NULL;
-	g_bserrno = -1;
-	spdk_bs_open_blob(bs, blobid_md_ro, blob_op_with_handle_complete, NULL);
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
+
+	/* Perform write on thread 1. That will allocate cluster on thread 0 via send_msg */
+	set_thread(1);
+	channel_thread1 = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel_thread1 != NULL);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel_thread1, payload_write, 4, 10, blob_op_complete, NULL);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	/* Perform write on thread 0. That will try to allocate cluster,
+	 * but fail due to another thread issuing the cluster allocation first. */
+	set_thread(0);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	blob_md_ro = g_blob;
-	CU_ASSERT(blob_md_ro->data_ro == false);
-	CU_ASSERT(blob_md_ro->md_ro == true);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	/* For thin-provisioned blob we need to write 20 pages plus one page metadata and
+	 * read 0 bytes */
+	if (g_use_extent_table) {
+		/* Add one more page for EXTENT_PAGE write */
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 22);
+	} else {
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 21);
+	}
+	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
 
-	g_bserrno = -1;
-	spdk_blob_sync_md(blob_md_ro, blob_op_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	ut_blob_close_and_delete(bs, blob_data_ro);
-	ut_blob_close_and_delete(bs, blob_md_ro);
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	set_thread(1);
+	spdk_bs_free_io_channel(channel_thread1);
+	set_thread(0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	g_blob = NULL;
+	g_blobid = 0;
 }
 
 static void
-bs_version(void)
+blob_thin_prov_write_batch(void)
 {
-	struct spdk_bs_super_block *super;
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_bs_dev *dev;
 	struct spdk_blob *blob;
-	struct spdk_blob_opts blob_opts;
+	struct spdk_io_channel *ch;
+	struct spdk_blob_opts opts;
 	spdk_blob_id blobid;
+	uint64_t free_clusters;
+	uint64_t page_size;
+	uint64_t pages_per_cluster;
+	uint64_t write_bytes;
+	uint8_t payload_write[4096];
+	uint8_t payload_read[4096];
+	const uint32_t num_writes = SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS + 2;
+	int rc[SPDK_BLOB_CHANNEL_CLUSTER_ALLOCS + 2];
+	uint32_t i;
 
-	/* Unload the blob store */
-	spdk_bs_unload(bs, bs_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bs = NULL;
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	page_size = spdk_bs_get_page_size(bs);
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / page_size;
 
-	/*
-	 * Change the bs version on disk.  This will allow us to
-	 *  test that the version does not get modified automatically
-	 *  when loading and unloading the blobstore.
-	 */
-	super = (struct spdk_bs_super_block *)&g_dev_buffer[0];
-	CU_ASSERT(super->version == SPDK_BS_VERSION);
-	CU_ASSERT(super->clean == 1);
-	super->version = 2;
-	/*
-	 * Version 2 metadata does not have a used blobid mask, so clear
-	 *  those fields in the super block and zero the corresponding
-	 *  region on "disk".  We will use this to ensure blob IDs are
-	 *  correctly reconstructed.
-	 */
-	memset(&g_dev_buffer[super->used_blobid_mask_start * SPDK_BS_PAGE_SIZE], 0,
-	       super->used_blobid_mask_len * SPDK_BS_PAGE_SIZE);
-	super->used_blobid_mask_start = 0;
-	super->used_blobid_mask_len = 0;
-	super->crc = blob_md_page_calc_crc(super);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
 
-	/* Load an existing blob store */
-	dev = init_dev();
-	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	CU_ASSERT(super->clean == 1);
-	bs = g_bs;
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = num_writes;
 
-	/*
-	 * Create a blob - just to make sure that when we unload it
-	 *  results in writing the super block (since metadata pages
-	 *  were allocated.
-	 */
-	ut_spdk_blob_opts_init(&blob_opts);
-	spdk_bs_create_blob_ext(bs, &blob_opts, blob_op_with_id_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	blobid = g_blobid;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	/* Unload the blob store */
-	spdk_bs_unload(bs, bs_op_complete, NULL);
+	/* Issue first writes to more clusters than the channel can allocate at once */
+	write_bytes = g_dev_write_bytes;
+	memset(payload_write, 0xA5, sizeof(payload_write));
+	for (i = 0; i < num_writes; i++) {
+		rc[i] = -1;
+		spdk_blob_io_write(blob, ch, payload_write, i * pages_per_cluster, 1, blob_op_complete, &rc[i]);
+	}
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bs = NULL;
-	CU_ASSERT(super->version == 2);
-	CU_ASSERT(super->used_blobid_mask_start == 0);
-	CU_ASSERT(super->used_blobid_mask_len == 0);
 
-	dev = init_dev();
-	spdk_bs_load(dev, NULL, bs_op_with_handle_complete, NULL);
+	for (i = 0; i < num_writes; i++) {
+		CU_ASSERT(rc[i] == 0);
+		CU_ASSERT(blob->active.clusters[i] != 0);
+	}
+	CU_ASSERT(free_clusters - num_writes == spdk_bs_free_cluster_count(bs));
+
+	/* The clusters allocated together are persisted together: one write of the new
+	 * extent page and one of the blob metadata for the first batch, then a single
+	 * update of the extent page, or of the metadata, for the remaining clusters. */
+	if (g_use_extent_table) {
+		CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == num_writes + 3);
+	} else {
+		CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == num_writes + 2);
+	}
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+
+	/* All the clusters have to be found after a reload */
+	ut_bs_reload(&bs, NULL);
 
-	g_blob = NULL;
 	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blob != NULL);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
 
-	ut_blob_close_and_delete(bs, blob);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	for (i = 0; i < num_writes; i++) {
+		CU_ASSERT(blob->active.clusters[i] != 0);
+		memset(payload_read, 0, sizeof(payload_read));
+		spdk_blob_io_read(blob, ch, payload_read, i * pages_per_cluster, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_write, payload_read, sizeof(payload_read)) == 0);
+	}
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
 
-	CU_ASSERT(super->version == 2);
-	CU_ASSERT(super->used_blobid_mask_start == 0);
-	CU_ASSERT(super->used_blobid_mask_len == 0);
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	g_blob = NULL;
+	g_blobid = 0;
 }
 
 static void
-blob_set_xattrs_test(void)
+blob_thin_prov_write_count_io(void)
 {
-	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob_store *bs;
 	struct spdk_blob *blob;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
 	struct spdk_blob_opts opts;
-	const void *value;
-	size_t value_len;
-	char *xattr;
-	size_t xattr_length;
-	int rc;
+	uint64_t free_clusters;
+	uint64_t page_size;
+	uint8_t payload_write[4096];
+	uint64_t write_bytes;
+	uint64_t read_bytes;
+	const uint32_t CLUSTER_SZ = 16384;
+	uint32_t pages_per_cluster;
+	uint32_t pages_per_extent_page;
+	uint32_t i;
 
-	/* Create blob with extra attributes */
-	ut_spdk_blob_opts_init(&opts);
+	/* Use a very small cluster size for this test.  This ensures we need multiple
+	 * extent pages to hold all of the clusters even for relatively small blobs like
+	 * we are restricted to for the unit tests (i.e. we don't want to allocate multi-GB
+	 * buffers).
+	 */
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = CLUSTER_SZ;
 
-	opts.xattrs.names = g_xattr_names;
-	opts.xattrs.get_value = _get_xattr_value;
-	opts.xattrs.count = 3;
-	opts.xattrs.ctx = &g_ctx;
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	page_size = spdk_bs_get_page_size(bs);
+	pages_per_cluster = CLUSTER_SZ / page_size;
+	pages_per_extent_page = SPDK_EXTENTS_PER_EP * pages_per_cluster;
+
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
 
 	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	/* Get the xattrs */
-	value = NULL;
+	/* Resize the blob so that it will require 8 extent pages to hold all of
+	 * the clusters.
+	 */
+	g_bserrno = -1;
+	spdk_blob_resize(blob, SPDK_EXTENTS_PER_EP * 8, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 
-	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[0], &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(value_len == strlen(g_xattr_values[0]));
-	CU_ASSERT_NSTRING_EQUAL_FATAL(value, g_xattr_values[0], value_len);
+	g_bserrno = -1;
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.num_clusters == SPDK_EXTENTS_PER_EP * 8);
 
-	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[1], &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(value_len == strlen(g_xattr_values[1]));
-	CU_ASSERT_NSTRING_EQUAL((char *)value, g_xattr_values[1], value_len);
+	memset(payload_write, 0, sizeof(payload_write));
+	for (i = 0; i < 8; i++) {
+		write_bytes = g_dev_write_bytes;
+		read_bytes = g_dev_read_bytes;
 
-	rc = spdk_blob_get_xattr_value(blob, g_xattr_names[2], &value, &value_len);
-	CU_ASSERT(rc == 0);
-	SPDK_CU_ASSERT_FATAL(value != NULL);
-	CU_ASSERT(value_len == strlen(g_xattr_values[2]));
-	CU_ASSERT_NSTRING_EQUAL((char *)value, g_xattr_values[2], value_len);
+		g_bserrno = -1;
+		spdk_blob_io_write(blob, ch, payload_write, pages_per_extent_page * i, 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(free_clusters - (2 * i + 1) == spdk_bs_free_cluster_count(bs));
 
-	/* Try to get non existing attribute */
+		CU_ASSERT(g_dev_read_bytes == read_bytes);
+		if (!g_use_extent_table) {
+			/* For legacy metadata, we should have written two pages - one for the
+			 * write I/O itself, another for the blob's primary metadata.
+			 */
+			CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 2);
+		} else {
+			/* For extent table metadata, we should have written three pages - one
+			 * for the write I/O, one for the extent page, one for the blob's primary
+			 * metadata.
+			 */
+			CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 3);
+		}
 
-	rc = spdk_blob_get_xattr_value(blob, "foobar", &value, &value_len);
-	CU_ASSERT(rc == -ENOENT);
+		/* The write should have synced the metadata already.  Do another sync here
+		 * just to confirm.
+		 */
+		write_bytes = g_dev_write_bytes;
+		read_bytes = g_dev_read_bytes;
 
-	/* Try xattr exceeding maximum length of descriptor in single page */
-	xattr_length = SPDK_BS_MAX_DESC_SIZE - sizeof(struct spdk_blob_md_descriptor_xattr) -
-		       strlen("large_xattr") + 1;
-	xattr = calloc(xattr_length, sizeof(char));
-	SPDK_CU_ASSERT_FATAL(xattr != NULL);
-	rc = spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length);
-	free(xattr);
-	SPDK_CU_ASSERT_FATAL(rc == -ENOMEM);
+		g_bserrno = -1;
+		spdk_blob_sync_md(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(free_clusters - (2 * i + 1) == spdk_bs_free_cluster_count(bs));
+
+		CU_ASSERT(g_dev_read_bytes == read_bytes);
+		CU_ASSERT(g_dev_write_bytes == write_bytes);
+
+		/* Now write to another unallocated cluster that is part of the same extent page. */
+		g_bserrno = -1;
+		spdk_blob_io_write(blob, ch, payload_write, pages_per_extent_page * i + pages_per_cluster,
+				   1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(free_clusters - (2 * i + 2) == spdk_bs_free_cluster_count(bs));
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	blob = NULL;
-	g_blob = NULL;
-	g_blobid = SPDK_BLOBID_INVALID;
+		CU_ASSERT(g_dev_read_bytes == read_bytes);
+		/*
+		 * For legacy metadata, we should have written the I/O and the primary metadata page.
+		 * For extent table metadata, we should have written the I/O and the extent metadata page.
+		 */
+		CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 2);
+	}
 
-	/* NULL callback */
-	ut_spdk_blob_opts_init(&opts);
-	opts.xattrs.names = g_xattr_names;
-	opts.xattrs.get_value = NULL;
-	opts.xattrs.count = 1;
-	opts.xattrs.ctx = &g_ctx;
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	spdk_bs_free_io_channel(ch);
 	poll_threads();
-	CU_ASSERT(g_bserrno == -EINVAL);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-
-	/* NULL values */
-	ut_spdk_blob_opts_init(&opts);
-	opts.xattrs.names = g_xattr_names;
-	opts.xattrs.get_value = _get_xattr_value_null;
-	opts.xattrs.count = 1;
-	opts.xattrs.ctx = NULL;
+	g_blob = NULL;
+	g_blobid = 0;
 
-	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
 }
 
 static void
-blob_thin_prov_alloc(void)
+blob_thin_prov_rle(void)
 {
+	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
 	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
 	spdk_blob_id blobid;
 	uint64_t free_clusters;
+	uint64_t page_size;
+	uint8_t payload_read[10 * 4096];
+	uint8_t payload_write[10 * 4096];
+	uint64_t write_bytes;
+	uint64_t read_bytes;
+	uint64_t io_unit;
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
+	page_size = spdk_bs_get_page_size(bs);
 
-	/* Set blob as thin provisioned */
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
+	opts.num_clusters = 5;
 
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(blob->active.num_clusters == 0);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 0);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
 
-	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
-	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 5);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+	/* Target specifically second cluster in a blob as first allocation */
+	io_unit = bs_cluster_to_page(bs, 1) * bs_io_unit_per_page(bs);
 
-	/* Grow it to 1TB - still unallocated */
-	spdk_blob_resize(blob, 262144, blob_op_complete, NULL);
+	/* Payload should be all zeros from unallocated clusters */
+	memset(payload_read, 0xFF, sizeof(payload_read));
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 262144);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 262144);
+	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	write_bytes = g_dev_write_bytes;
+	read_bytes = g_dev_read_bytes;
+
+	/* Issue write to second cluster in a blob */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	/* Sync must not change anything */
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 262144);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 262144);
-	/* Since clusters are not allocated,
-	 * number of metadata pages is expected to be minimal.
-	 */
-	CU_ASSERT(blob->active.num_pages == 1);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	/* For thin-provisioned blob we need to write 10 pages plus one page metadata and
+	 * read 0 bytes */
+	if (g_use_extent_table) {
+		/* Add one more page for EXTENT_PAGE write */
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12);
+	} else {
+		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11);
+	}
+	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
 
-	/* Shrink the blob to 3 clusters - still unallocated */
-	spdk_blob_resize(blob, 3, blob_op_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 3);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 3);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	/* Sync must not change anything */
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 3);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 3);
 
 	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
@@ -4033,89 +5076,209 @@ blob_thin_prov_alloc(void)
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
 
-	/* Check that clusters allocation and size is still the same */
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 3);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Read second cluster after blob reload to confirm data written */
+	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
 
 	ut_blob_close_and_delete(bs, blob);
 }
 
 static void
-blob_insert_cluster_msg_test(void)
+blob_thin_prov_sparse_map(void)
 {
+	static const uint8_t zero[4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	struct spdk_blob_md_page page = {};
-	spdk_blob_id blobid;
+	spdk_blob_id blobid, snapshotid;
 	uint64_t free_clusters;
-	uint64_t new_cluster = 0;
-	uint32_t cluster_num = 3;
-	uint32_t extent_page = 0;
+	uint64_t num_clusters = 4 * SPDK_BLOB_CLUSTER_CHUNK_SZ + 10;
+	uint64_t far_cluster = 3 * SPDK_BLOB_CLUSTER_CHUNK_SZ + 5;
+	uint64_t io_units_per_cluster;
+	uint8_t payload_read[4096];
+	uint8_t payload_write[4096];
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
 
-	/* Set blob as thin provisioned */
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Small thin blobs and thick blobs keep a flat cluster map */
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
-	opts.num_clusters = 4;
+	opts.num_clusters = SPDK_BLOB_CLUSTER_CHUNK_SZ;
+	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(blob->active.cluster_chunks == NULL);
+	ut_blob_close_and_delete(bs, blob);
 
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 5;
+	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(blob->active.cluster_chunks == NULL);
+	ut_blob_close_and_delete(bs, blob);
+
+	/* Larger thin blobs only allocate the chunks of the map holding allocated clusters */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = num_clusters;
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
+	SPDK_CU_ASSERT_FATAL(blob->active.cluster_chunks != NULL);
+	CU_ASSERT(blob->active.clusters == NULL);
+	CU_ASSERT(blob->active.num_clusters == num_clusters);
+	CU_ASSERT(blob->active.cluster_chunks[0] == NULL);
+	CU_ASSERT(blob->active.cluster_chunks[4] == NULL);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(blob->active.num_clusters == 4);
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 4);
-	CU_ASSERT(blob->active.clusters[cluster_num] == 0);
-
-	/* Specify cluster_num to allocate and new_cluster will be returned to insert on md_thread.
-	 * This is to simulate behaviour when cluster is allocated after blob creation.
-	 * Such as _spdk_bs_allocate_and_copy_cluster(). */
-	spdk_spin_lock(&bs->used_lock);
-	bs_allocate_cluster(blob, cluster_num, &new_cluster, &extent_page, false);
-	CU_ASSERT(blob->active.clusters[cluster_num] == 0);
-	spdk_spin_unlock(&bs->used_lock);
+	io_units_per_cluster = bs_io_units_per_cluster(blob);
 
-	blob_insert_cluster_on_md_thread(blob, cluster_num, new_cluster, extent_page, &page,
-					 blob_op_complete, NULL);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, io_units_per_cluster + 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_write, far_cluster * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
 	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(blob->active.clusters[cluster_num] != 0);
+	CU_ASSERT(blob->active.cluster_chunks[0] != NULL);
+	CU_ASSERT(blob->active.cluster_chunks[1] == NULL);
+	CU_ASSERT(blob->active.cluster_chunks[2] == NULL);
+	CU_ASSERT(blob->active.cluster_chunks[3] != NULL);
+	CU_ASSERT(blob->active.cluster_chunks[4] == NULL);
+	CU_ASSERT(bs_blob_cluster_lba(blob, 0) == 0);
+	CU_ASSERT(bs_blob_cluster_lba(blob, 1) != 0);
+	CU_ASSERT(bs_blob_cluster_lba(blob, far_cluster) != 0);
+	CU_ASSERT(bs_blob_cluster_lba(blob, SPDK_BLOB_CLUSTER_CHUNK_SZ + 1) == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, far_cluster * io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 4096) == 0);
 
+	/* Clusters of the map survive a reload */
 	spdk_blob_close(blob, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
 
 	ut_bs_reload(&bs, NULL);
 
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
 	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	blob = g_blob;
 
-	CU_ASSERT(blob->active.clusters[cluster_num] != 0);
+	SPDK_CU_ASSERT_FATAL(blob->active.cluster_chunks != NULL);
+	CU_ASSERT(blob->active.num_clusters == num_clusters);
+	CU_ASSERT(blob->active.cluster_chunks[0] != NULL);
+	CU_ASSERT(blob->active.cluster_chunks[1] == NULL);
+	CU_ASSERT(blob->active.cluster_chunks[3] != NULL);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+
+	spdk_blob_io_read(blob, channel, payload_read, io_units_per_cluster + 1, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 4096) == 0);
+
+	/* The snapshot takes the map over, the clone starts with an empty one */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	CU_ASSERT(bs_blob_cluster_lba(snapshot, far_cluster) != 0);
+	SPDK_CU_ASSERT_FATAL(blob->active.cluster_chunks != NULL);
+	CU_ASSERT(blob->active.cluster_chunks[0] == NULL);
+	CU_ASSERT(blob->active.cluster_chunks[3] == NULL);
+
+	spdk_blob_io_read(blob, channel, payload_read, far_cluster * io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 4096) == 0);
+
+	/* Deleting the snapshot moves its clusters back to the map of the clone */
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.cluster_chunks[0] != NULL);
+	CU_ASSERT(blob->active.cluster_chunks[3] != NULL);
+	CU_ASSERT(bs_blob_cluster_lba(blob, far_cluster) != 0);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+
+	/* Shrinking releases the truncated clusters and chunks */
+	spdk_blob_resize(blob, 2 * SPDK_BLOB_CLUSTER_CHUNK_SZ, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(blob->active.cluster_array_size == 2 * SPDK_BLOB_CLUSTER_CHUNK_SZ);
+	CU_ASSERT(blob->active.cluster_chunks[3] == NULL);
+
+	/* Clusters added back to the blob are unallocated */
+	spdk_blob_resize(blob, num_clusters, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_blob_cluster_lba(blob, far_cluster) == 0);
+
+	memset(payload_read, 0xFF, sizeof(payload_read));
+	spdk_blob_io_read(blob, channel, payload_read, far_cluster * io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(zero, payload_read, 4096) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
 
 	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 }
 
 static void
-blob_thin_prov_rw(void)
+blob_thin_prov_rw_iov(void)
 {
 	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *blob_id0;
-	struct spdk_io_channel *channel, *channel_thread1;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
 	uint64_t free_clusters;
-	uint64_t page_size;
 	uint8_t payload_read[10 * 4096];
 	uint8_t payload_write[10 * 4096];
-	uint64_t write_bytes;
-	uint64_t read_bytes;
+	struct iovec iov_read[3];
+	struct iovec iov_write[3];
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
-	page_size = spdk_bs_get_page_size(bs);
 
 	channel = spdk_bs_alloc_io_channel(bs);
 	CU_ASSERT(channel != NULL);
@@ -4123,11 +5286,7 @@ blob_thin_prov_rw(void)
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
 
-	/* Create and delete blob at md page 0, so that next md page allocation
-	 * for extent will use that. */
-	blob_id0 = ut_blob_create_and_open(bs, &opts);
 	blob = ut_blob_create_and_open(bs, &opts);
-	ut_blob_close_and_delete(bs, blob_id0);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
 	CU_ASSERT(blob->active.num_clusters == 0);
@@ -4147,184 +5306,137 @@ blob_thin_prov_rw(void)
 	CU_ASSERT(blob->active.num_clusters == 5);
 
 	/* Payload should be all zeros from unallocated clusters */
-	memset(payload_read, 0xFF, sizeof(payload_read));
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	memset(payload_read, 0xAA, sizeof(payload_read));
+	iov_read[0].iov_base = payload_read;
+	iov_read[0].iov_len = 3 * 4096;
+	iov_read[1].iov_base = payload_read + 3 * 4096;
+	iov_read[1].iov_len = 4 * 4096;
+	iov_read[2].iov_base = payload_read + 7 * 4096;
+	iov_read[2].iov_len = 3 * 4096;
+	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	write_bytes = g_dev_write_bytes;
-	read_bytes = g_dev_read_bytes;
-
-	/* Perform write on thread 1. That will allocate cluster on thread 0 via send_msg */
-	set_thread(1);
-	channel_thread1 = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel_thread1 != NULL);
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel_thread1, payload_write, 4, 10, blob_op_complete, NULL);
-	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
-	/* Perform write on thread 0. That will try to allocate cluster,
-	 * but fail due to another thread issuing the cluster allocation first. */
-	set_thread(0);
 	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
-	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+	iov_write[0].iov_base = payload_write;
+	iov_write[0].iov_len = 1 * 4096;
+	iov_write[1].iov_base = payload_write + 1 * 4096;
+	iov_write[1].iov_len = 5 * 4096;
+	iov_write[2].iov_base = payload_write + 6 * 4096;
+	iov_write[2].iov_len = 4 * 4096;
+
+	spdk_blob_io_writev(blob, channel, iov_write, 3, 250, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
-	/* For thin-provisioned blob we need to write 20 pages plus one page metadata and
-	 * read 0 bytes */
-	if (g_use_extent_table) {
-		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 22);
-	} else {
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 21);
-	}
-	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
 
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	memset(payload_read, 0xAA, sizeof(payload_read));
+	iov_read[0].iov_base = payload_read;
+	iov_read[0].iov_len = 3 * 4096;
+	iov_read[1].iov_base = payload_read + 3 * 4096;
+	iov_read[1].iov_len = 4 * 4096;
+	iov_read[2].iov_base = payload_read + 7 * 4096;
+	iov_read[2].iov_len = 3 * 4096;
+	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	ut_blob_close_and_delete(bs, blob);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-
-	set_thread(1);
-	spdk_bs_free_io_channel(channel_thread1);
-	set_thread(0);
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	g_blob = NULL;
-	g_blobid = 0;
+
+	ut_blob_close_and_delete(bs, blob);
 }
 
+struct iter_ctx {
+	int		current_iter;
+	spdk_blob_id	blobid[4];
+};
+
 static void
-blob_thin_prov_write_count_io(void)
+test_iter(void *arg, struct spdk_blob *blob, int bserrno)
+{
+	struct iter_ctx *iter_ctx = arg;
+	spdk_blob_id blobid;
+
+	CU_ASSERT(bserrno == 0);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(blobid == iter_ctx->blobid[iter_ctx->current_iter++]);
+}
+
+static void
+bs_load_iter_test(void)
 {
 	struct spdk_blob_store *bs;
-	struct spdk_blob *blob;
-	struct spdk_io_channel *ch;
 	struct spdk_bs_dev *dev;
-	struct spdk_bs_opts bs_opts;
-	struct spdk_blob_opts opts;
-	uint64_t free_clusters;
-	uint64_t page_size;
-	uint8_t payload_write[4096];
-	uint64_t write_bytes;
-	uint64_t read_bytes;
-	const uint32_t CLUSTER_SZ = 16384;
-	uint32_t pages_per_cluster;
-	uint32_t pages_per_extent_page;
-	uint32_t i;
+	struct iter_ctx iter_ctx = { 0 };
+	struct spdk_blob *blob;
+	int i, rc;
+	struct spdk_bs_opts opts;
 
-	/* Use a very small cluster size for this test.  This ensures we need multiple
-	 * extent pages to hold all of the clusters even for relatively small blobs like
-	 * we are restricted to for the unit tests (i.e. we don't want to allocate multi-GB
-	 * buffers).
-	 */
 	dev = init_dev();
-	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
-	bs_opts.cluster_sz = CLUSTER_SZ;
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
 
-	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	/* Initialize a new blob store */
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
 	bs = g_bs;
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
-	page_size = spdk_bs_get_page_size(bs);
-	pages_per_cluster = CLUSTER_SZ / page_size;
-	pages_per_extent_page = SPDK_EXTENTS_PER_EP * pages_per_cluster;
+	for (i = 0; i < 4; i++) {
+		blob = ut_blob_create_and_open(bs, NULL);
+		iter_ctx.blobid[i] = spdk_blob_get_id(blob);
 
-	ch = spdk_bs_alloc_io_channel(bs);
-	SPDK_CU_ASSERT_FATAL(ch != NULL);
+		/* Just save the blobid as an xattr for testing purposes. */
+		rc = spdk_blob_set_xattr(blob, "blobid", &iter_ctx.blobid[i], sizeof(spdk_blob_id));
+		CU_ASSERT(rc == 0);
 
-	ut_spdk_blob_opts_init(&opts);
-	opts.thin_provision = true;
+		/* Resize the blob */
+		spdk_blob_resize(blob, i, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
 
-	blob = ut_blob_create_and_open(bs, &opts);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
 
-	/* Resize the blob so that it will require 8 extent pages to hold all of
-	 * the clusters.
-	 */
 	g_bserrno = -1;
-	spdk_blob_resize(blob, SPDK_EXTENTS_PER_EP * 8, blob_op_complete, NULL);
+	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 
-	g_bserrno = -1;
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	opts.iter_cb_fn = test_iter;
+	opts.iter_cb_arg = &iter_ctx;
+
+	/* Test blob iteration during load after a clean shutdown. */
+	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == SPDK_EXTENTS_PER_EP * 8);
-
-	memset(payload_write, 0, sizeof(payload_write));
-	for (i = 0; i < 8; i++) {
-		write_bytes = g_dev_write_bytes;
-		read_bytes = g_dev_read_bytes;
-
-		g_bserrno = -1;
-		spdk_blob_io_write(blob, ch, payload_write, pages_per_extent_page * i, 1, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(free_clusters - (2 * i + 1) == spdk_bs_free_cluster_count(bs));
-
-		CU_ASSERT(g_dev_read_bytes == read_bytes);
-		if (!g_use_extent_table) {
-			/* For legacy metadata, we should have written two pages - one for the
-			 * write I/O itself, another for the blob's primary metadata.
-			 */
-			CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 2);
-		} else {
-			/* For extent table metadata, we should have written three pages - one
-			 * for the write I/O, one for the extent page, one for the blob's primary
-			 * metadata.
-			 */
-			CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 3);
-		}
-
-		/* The write should have synced the metadata already.  Do another sync here
-		 * just to confirm.
-		 */
-		write_bytes = g_dev_write_bytes;
-		read_bytes = g_dev_read_bytes;
-
-		g_bserrno = -1;
-		spdk_blob_sync_md(blob, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(free_clusters - (2 * i + 1) == spdk_bs_free_cluster_count(bs));
-
-		CU_ASSERT(g_dev_read_bytes == read_bytes);
-		CU_ASSERT(g_dev_write_bytes == write_bytes);
-
-		/* Now write to another unallocated cluster that is part of the same extent page. */
-		g_bserrno = -1;
-		spdk_blob_io_write(blob, ch, payload_write, pages_per_extent_page * i + pages_per_cluster,
-				   1, blob_op_complete, NULL);
-		poll_threads();
-		CU_ASSERT(g_bserrno == 0);
-		CU_ASSERT(free_clusters - (2 * i + 2) == spdk_bs_free_cluster_count(bs));
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
 
-		CU_ASSERT(g_dev_read_bytes == read_bytes);
-		/*
-		 * For legacy metadata, we should have written the I/O and the primary metadata page.
-		 * For extent table metadata, we should have written the I/O and the extent metadata page.
-		 */
-		CU_ASSERT((g_dev_write_bytes - write_bytes) / page_size == 2);
-	}
+	/* Dirty shutdown */
+	bs_free(bs);
 
-	ut_blob_close_and_delete(bs, blob);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	opts.iter_cb_fn = test_iter;
+	iter_ctx.current_iter = 0;
+	opts.iter_cb_arg = &iter_ctx;
 
-	spdk_bs_free_io_channel(ch);
+	/* Test blob iteration during load after a dirty shutdown. */
+	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
-	g_blob = NULL;
-	g_blobid = 0;
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
 
 	spdk_bs_unload(bs, bs_op_complete, NULL);
 	poll_threads();
@@ -4333,25 +5445,33 @@ blob_thin_prov_write_count_io(void)
 }
 
 static void
-blob_thin_prov_rle(void)
+blob_snapshot_rw(void)
 {
 	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
+	struct spdk_blob *blob, *snapshot;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	spdk_blob_id blobid;
+	spdk_blob_id blobid, snapshotid;
 	uint64_t free_clusters;
+	uint64_t cluster_size;
 	uint64_t page_size;
 	uint8_t payload_read[10 * 4096];
 	uint8_t payload_write[10 * 4096];
+	uint64_t write_bytes_start;
+	uint64_t read_bytes_start;
+	uint64_t copy_bytes_start;
 	uint64_t write_bytes;
 	uint64_t read_bytes;
-	uint64_t io_unit;
+	uint64_t copy_bytes;
 
 	free_clusters = spdk_bs_free_cluster_count(bs);
+	cluster_size = spdk_bs_get_cluster_size(bs);
 	page_size = spdk_bs_get_page_size(bs);
 
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
 	opts.num_clusters = 5;
@@ -4360,81 +5480,96 @@ blob_thin_prov_rle(void)
 	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
-
-	/* Target specifically second cluster in a blob as first allocation */
-	io_unit = bs_cluster_to_page(bs, 1) * bs_io_unit_per_page(bs);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
 
-	/* Payload should be all zeros from unallocated clusters */
 	memset(payload_read, 0xFF, sizeof(payload_read));
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
-
-	write_bytes = g_dev_write_bytes;
-	read_bytes = g_dev_read_bytes;
-
-	/* Issue write to second cluster in a blob */
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, io_unit, 10, blob_op_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
-	/* For thin-provisioned blob we need to write 10 pages plus one page metadata and
-	 * read 0 bytes */
-	if (g_use_extent_table) {
-		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 12);
-	} else {
-		CU_ASSERT(g_dev_write_bytes - write_bytes == page_size * 11);
-	}
-	CU_ASSERT(g_dev_read_bytes - read_bytes == 0);
+	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
 
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	spdk_bs_free_io_channel(channel);
+	/* Create snapshot from blob */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
 
-	spdk_blob_close(blob, blob_op_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	CU_ASSERT(snapshot->data_ro == true);
+	CU_ASSERT(snapshot->md_ro == true);
 
-	ut_bs_reload(&bs, NULL);
+	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
 
-	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	write_bytes_start = g_dev_write_bytes;
+	read_bytes_start = g_dev_read_bytes;
+	copy_bytes_start = g_dev_copy_bytes;
+
+	memset(payload_write, 0xAA, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	blob = g_blob;
+	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
 
-	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
+	/* For a clone we need to allocate and copy one cluster, update one page of metadata
+	 * and then write 10 pages of payload.
+	 */
+	write_bytes = g_dev_write_bytes - write_bytes_start;
+	read_bytes = g_dev_read_bytes - read_bytes_start;
+	copy_bytes = g_dev_copy_bytes - copy_bytes_start;
+	if (g_dev_copy_enabled) {
+		CU_ASSERT(copy_bytes == cluster_size);
+	} else {
+		CU_ASSERT(copy_bytes == 0);
+	}
+	if (g_use_extent_table) {
+		/* Add one more page for EXTENT_PAGE write */
+		CU_ASSERT(write_bytes + copy_bytes == page_size * 12 + cluster_size);
+	} else {
+		CU_ASSERT(write_bytes + copy_bytes == page_size * 11 + cluster_size);
+	}
+	CU_ASSERT(read_bytes + copy_bytes == cluster_size);
 
-	/* Read second cluster after blob reload to confirm data written */
-	spdk_blob_io_read(blob, channel, payload_read, io_unit, 10, blob_op_complete, NULL);
+	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
-	spdk_bs_free_io_channel(channel);
+	/* Data on snapshot should not change after write to clone */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_read(snapshot, channel, payload_read, 4, 10, blob_op_complete, NULL);
 	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
 	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	g_blob = NULL;
+	g_blobid = 0;
 }
 
 static void
-blob_thin_prov_rw_iov(void)
+blob_snapshot_rw_iov(void)
 {
 	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob;
+	struct spdk_blob *blob, *snapshot;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
 	uint64_t free_clusters;
 	uint8_t payload_read[10 * 4096];
 	uint8_t payload_write[10 * 4096];
@@ -4448,25 +5583,29 @@ blob_thin_prov_rw_iov(void)
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
+	opts.num_clusters = 5;
 
 	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
 	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
 
-	CU_ASSERT(blob->active.num_clusters == 0);
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
 
-	/* The blob started at 0 clusters. Resize it to be 5, but still unallocated. */
-	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
+	/* Create snapshot from blob */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 5);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
 
-	spdk_blob_sync_md(blob, blob_op_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	/* Sync must not change anything */
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-	CU_ASSERT(blob->active.num_clusters == 5);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	CU_ASSERT(snapshot->data_ro == true);
+	CU_ASSERT(snapshot->md_ro == true);
+	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
 
 	/* Payload should be all zeros from unallocated clusters */
 	memset(payload_read, 0xAA, sizeof(payload_read));
@@ -4509,159 +5648,335 @@ blob_thin_prov_rw_iov(void)
 	poll_threads();
 
 	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
 }
 
-struct iter_ctx {
-	int		current_iter;
-	spdk_blob_id	blobid[4];
-};
+static void
+ut_subcluster_cow_check(struct spdk_blob *blob, struct spdk_io_channel *channel,
+			uint64_t offset, uint64_t pages, const uint8_t *expected)
+{
+	uint8_t *payload_read;
+	struct iovec iov[3];
+
+	payload_read = calloc(pages, 4096);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL);
+
+	spdk_blob_io_read(blob, channel, payload_read, offset, pages, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, expected, pages * 4096) == 0);
+
+	/* Same with iovs that do not match the runs of written pages */
+	memset(payload_read, 0, pages * 4096);
+	iov[0].iov_base = payload_read;
+	iov[0].iov_len = 4096 + 512;
+	iov[1].iov_base = payload_read + iov[0].iov_len;
+	iov[1].iov_len = 512;
+	iov[2].iov_base = payload_read + iov[0].iov_len + iov[1].iov_len;
+	iov[2].iov_len = pages * 4096 - iov[0].iov_len - iov[1].iov_len;
+	spdk_blob_io_readv(blob, channel, iov, 3, offset, pages, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, expected, pages * 4096) == 0);
+
+	free(payload_read);
+}
 
 static void
-test_iter(void *arg, struct spdk_blob *blob, int bserrno)
+ut_snapshot_chain_check(struct spdk_blob *blob, struct spdk_io_channel *channel,
+			uint64_t num_clusters, uint8_t first_value)
 {
-	struct iter_ctx *iter_ctx = arg;
-	spdk_blob_id blobid;
+	uint64_t pages_per_cluster = spdk_bs_get_cluster_size(blob->bs) / spdk_bs_get_page_size(blob->bs);
+	uint8_t payload_read[2 * 4096];
+	uint8_t expected[2 * 4096];
+	struct iovec iov[2];
+	uint64_t i;
 
-	CU_ASSERT(bserrno == 0);
-	blobid = spdk_blob_get_id(blob);
-	CU_ASSERT(blobid == iter_ctx->blobid[iter_ctx->current_iter++]);
+	for (i = 0; i < num_clusters; i++) {
+		memset(expected, 0, sizeof(expected));
+		memset(expected, first_value + i, 4096);
+
+		memset(payload_read, 0xFF, sizeof(payload_read));
+		spdk_blob_io_read(blob, channel, payload_read, i * pages_per_cluster, 2,
+				  blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_read, expected, sizeof(expected)) == 0);
+
+		memset(payload_read, 0xFF, sizeof(payload_read));
+		iov[0].iov_base = payload_read;
+		iov[0].iov_len = 4096;
+		iov[1].iov_base = payload_read + 4096;
+		iov[1].iov_len = 4096;
+		spdk_blob_io_readv(blob, channel, iov, 2, i * pages_per_cluster, 2,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_read, expected, sizeof(expected)) == 0);
+	}
 }
 
 static void
-bs_load_iter_test(void)
+blob_snapshot_chain_resolve(void)
 {
-	struct spdk_blob_store *bs;
-	struct spdk_bs_dev *dev;
-	struct iter_ctx iter_ctx = { 0 };
-	struct spdk_blob *blob;
-	int i, rc;
-	struct spdk_bs_opts opts;
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotids[4];
+	uint64_t pages_per_cluster;
+	uint64_t read_bytes;
+	uint64_t entry;
+	uint8_t payload_write[4096];
+	uint8_t payload_read[4096];
+	uint32_t gen;
+	uint64_t i;
 
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
 
-	/* Initialize a new blob store */
-	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Reads of thin blobs without a parent do not need the cache */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	spdk_blob_io_read(blob, channel, payload_read, 0, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	CU_ASSERT(blob->resolve_cache == NULL);
 
+	/* blob -> snapshot 3 -> ... -> snapshot 0, cluster N is in snapshot N */
 	for (i = 0; i < 4; i++) {
-		blob = ut_blob_create_and_open(bs, NULL);
-		iter_ctx.blobid[i] = spdk_blob_get_id(blob);
+		memset(payload_write, 0x10 + i, sizeof(payload_write));
+		spdk_blob_io_write(blob, channel, payload_write, i * pages_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
 
-		/* Just save the blobid as an xattr for testing purposes. */
-		rc = spdk_blob_set_xattr(blob, "blobid", &iter_ctx.blobid[i], sizeof(spdk_blob_id));
-		CU_ASSERT(rc == 0);
+		spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+		snapshotids[i] = g_blobid;
+	}
+	CU_ASSERT(blob->parent_id == snapshotids[3]);
 
-		/* Resize the blob */
-		spdk_blob_resize(blob, i, blob_op_complete, NULL);
+	ut_snapshot_chain_check(blob, channel, 4, 0x10);
+	SPDK_CU_ASSERT_FATAL(blob->resolve_cache != NULL);
+
+	memset(payload_read, 0xFF, sizeof(payload_read));
+	spdk_blob_io_read(blob, channel, payload_read, 4 * pages_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_mem_all_zero(payload_read, sizeof(payload_read)));
+
+	/* Cluster 2 is read straight from snapshot 2 */
+	spdk_bs_open_blob(bs, snapshotids[2], blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+
+	gen = bs->backing_chain_gen;
+	entry = blob->resolve_cache->chunks[0][2];
+	CU_ASSERT(entry >> 32 == gen);
+	CU_ASSERT((uint32_t)entry == bs_lba_to_cluster(bs, bs_blob_cluster_lba(snapshot, 2)));
+	CU_ASSERT((uint32_t)blob->resolve_cache->chunks[0][4] == SPDK_BLOB_RESOLVED_ZEROES);
+
+	read_bytes = g_dev_read_bytes;
+	spdk_blob_io_read(blob, channel, payload_read, 2 * pages_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_dev_read_bytes - read_bytes == 4096);
+	CU_ASSERT(payload_read[0] == 0x12);
+
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Deleting a snapshot in the middle of the chain invalidates the cache */
+	spdk_bs_delete_blob(bs, snapshotids[2], blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->backing_chain_gen != gen);
+	CU_ASSERT(blob->resolve_cache->chunks[0][2] >> 32 != bs->backing_chain_gen);
+
+	ut_snapshot_chain_check(blob, channel, 4, 0x10);
+	CU_ASSERT(blob->resolve_cache->chunks[0][2] >> 32 == bs->backing_chain_gen);
+
+	/* And so does writing to the clone and inflating it */
+	memset(payload_write, 0x20, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, 4 * pages_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	gen = bs->backing_chain_gen;
+	spdk_bs_inflate_blob(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->parent_id == SPDK_BLOBID_INVALID);
+	CU_ASSERT(bs->backing_chain_gen != gen);
+
+	ut_snapshot_chain_check(blob, channel, 4, 0x10);
+	spdk_blob_io_read(blob, channel, payload_read, 4 * pages_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(payload_read[0] == 0x20);
+
+	ut_blob_close_and_delete(bs, blob);
+	for (i = 4; i > 0; i--) {
+		if (i - 1 == 2) {
+			continue;
+		}
+		spdk_bs_delete_blob(bs, snapshotids[i - 1], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+}
+
+static void
+blob_snapshot_chain_release(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch0, *ch1;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotids[2];
+	uint64_t pages_per_cluster;
+	uint8_t payload_write[4096];
+	uint64_t i;
+
+	SPDK_CU_ASSERT_FATAL(g_ut_num_threads > 1);
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
+
+	set_thread(1);
+	ch1 = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(ch1 != NULL);
+	set_thread(0);
+	ch0 = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(ch0 != NULL);
+
+	/* blob -> snapshot 1 -> snapshot 0, cluster N is in snapshot N */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 2;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	for (i = 0; i < 2; i++) {
+		memset(payload_write, 0x10 + i, sizeof(payload_write));
+		spdk_blob_io_write(blob, ch0, payload_write, i * pages_per_cluster, 1,
+				   blob_op_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
 
-		spdk_blob_close(blob, blob_op_complete, NULL);
+		spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 		poll_threads();
 		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+		snapshotids[i] = g_blobid;
 	}
+	ut_snapshot_chain_check(blob, ch1, 2, 0x10);
 
+	/* Snapshot 1 is only kept open by the back_bs_dev of the blob */
+	SPDK_CU_ASSERT_FATAL(blob_lookup(bs, snapshotids[1]) != NULL);
+
+	/*
+	 * Decoupling the blob switches it to snapshot 0. Reads on thread 1 may still walk
+	 * the chain through snapshot 1, so it must stay open until thread 1 was visited.
+	 */
 	g_bserrno = -1;
-	spdk_bs_unload(bs, bs_op_complete, NULL);
-	poll_threads();
+	spdk_bs_blob_decouple_parent(bs, ch0, blobid, blob_op_complete, NULL);
+	while (g_bserrno == -1) {
+		poll_thread(0);
+	}
 	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->parent_id == snapshotids[0]);
+	CU_ASSERT(bs->back_bs_devs_releasing == 1);
+	CU_ASSERT(blob_lookup(bs, snapshotids[1]) != NULL);
 
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
-	opts.iter_cb_fn = test_iter;
-	opts.iter_cb_arg = &iter_ctx;
-
-	/* Test blob iteration during load after a clean shutdown. */
-	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
-
-	/* Dirty shutdown */
-	bs_free(bs);
-
-	dev = init_dev();
-	spdk_bs_opts_init(&opts, sizeof(opts));
-	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "TESTTYPE");
-	opts.iter_cb_fn = test_iter;
-	iter_ctx.current_iter = 0;
-	opts.iter_cb_arg = &iter_ctx;
+	CU_ASSERT(bs->back_bs_devs_releasing == 0);
+	CU_ASSERT(blob_lookup(bs, snapshotids[1]) == NULL);
+	ut_snapshot_chain_check(blob, ch1, 2, 0x10);
 
-	/* Test blob iteration during load after a dirty shutdown. */
-	spdk_bs_load(dev, &opts, bs_op_with_handle_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
-	bs = g_bs;
+	ut_blob_close_and_delete(bs, blob);
+	for (i = 2; i > 0; i--) {
+		spdk_bs_delete_blob(bs, snapshotids[i - 1], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
 
-	spdk_bs_unload(bs, bs_op_complete, NULL);
+	spdk_bs_free_io_channel(ch0);
+	set_thread(1);
+	spdk_bs_free_io_channel(ch1);
+	set_thread(0);
 	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	g_bs = NULL;
 }
 
 static void
-blob_snapshot_rw(void)
+blob_subcluster_cow(void)
 {
-	static const uint8_t zero[10 * 4096] = { 0 };
 	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *snapshot;
+	struct spdk_blob *blob, *snapshot, *snapshot2;
 	struct spdk_io_channel *channel;
 	struct spdk_blob_opts opts;
-	spdk_blob_id blobid, snapshotid;
-	uint64_t free_clusters;
-	uint64_t cluster_size;
-	uint64_t page_size;
-	uint8_t payload_read[10 * 4096];
-	uint8_t payload_write[10 * 4096];
-	uint64_t write_bytes_start;
-	uint64_t read_bytes_start;
-	uint64_t copy_bytes_start;
-	uint64_t write_bytes;
-	uint64_t read_bytes;
-	uint64_t copy_bytes;
+	spdk_blob_id blobid, snapshotid, snapshotid2;
+	uint64_t pages_per_cluster;
+	uint64_t read_bytes_start, copy_bytes_start, write_bytes_start;
+	struct spdk_blob_partial_chunk *chunk;
+	uint32_t num_partial;
+	uint8_t *expected, *payload_write;
+	struct iovec iov[2];
+	uint64_t i;
 
-	free_clusters = spdk_bs_free_cluster_count(bs);
-	cluster_size = spdk_bs_get_cluster_size(bs);
-	page_size = spdk_bs_get_page_size(bs);
+	pages_per_cluster = spdk_bs_get_cluster_size(bs) / spdk_bs_get_page_size(bs);
+	expected = calloc(pages_per_cluster, 4096);
+	payload_write = calloc(pages_per_cluster, 4096);
+	SPDK_CU_ASSERT_FATAL(expected != NULL && payload_write != NULL);
 
 	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
 	ut_spdk_blob_opts_init(&opts);
 	opts.thin_provision = true;
 	opts.num_clusters = 5;
+	opts.subcluster_cow = true;
+
+	/* The bitmaps of partial clusters are kept in the extent pages */
+	opts.use_extent_table = false;
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
 
+	opts.use_extent_table = true;
 	blob = ut_blob_create_and_open(bs, &opts);
 	blobid = spdk_blob_get_id(blob);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
-
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
-
-	memset(payload_read, 0xFF, sizeof(payload_read));
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(blob->invalid_flags & SPDK_BLOB_SUBCLUSTER_COW);
+	SPDK_CU_ASSERT_FATAL(blob->partial_table != NULL);
 
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
-	poll_threads();
-	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
+	/* Without a parent the clusters are allocated as usual */
+	memset(payload_write, 0xAA, pages_per_cluster * 4096);
+	for (i = 0; i < 4; i++) {
+		spdk_blob_io_write(blob, channel, payload_write, i * pages_per_cluster,
+				   pages_per_cluster, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	CU_ASSERT(blob->num_partial_clusters == 0);
 
-	/* Create snapshot from blob */
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
 	snapshotid = g_blobid;
 
 	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
@@ -4669,149 +5984,214 @@ blob_snapshot_rw(void)
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
 	snapshot = g_blob;
-	CU_ASSERT(snapshot->data_ro == true);
-	CU_ASSERT(snapshot->md_ro == true);
-
-	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
+	CU_ASSERT(snapshot->invalid_flags & SPDK_BLOB_SUBCLUSTER_COW);
 
-	write_bytes_start = g_dev_write_bytes;
+	/* Writing a page of the clone allocates the cluster without copying it */
 	read_bytes_start = g_dev_read_bytes;
 	copy_bytes_start = g_dev_copy_bytes;
-
-	memset(payload_write, 0xAA, sizeof(payload_write));
-	spdk_blob_io_write(blob, channel, payload_write, 4, 10, blob_op_complete, NULL);
+	memset(payload_write, 0xBB, 4096);
+	spdk_blob_io_write(blob, channel, payload_write, 2, 1, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(free_clusters != spdk_bs_free_cluster_count(bs));
-
-	/* For a clone we need to allocate and copy one cluster, update one page of metadata
-	 * and then write 10 pages of payload.
-	 */
-	write_bytes = g_dev_write_bytes - write_bytes_start;
-	read_bytes = g_dev_read_bytes - read_bytes_start;
-	copy_bytes = g_dev_copy_bytes - copy_bytes_start;
-	if (g_dev_copy_enabled) {
-		CU_ASSERT(copy_bytes == cluster_size);
-	} else {
-		CU_ASSERT(copy_bytes == 0);
-	}
-	if (g_use_extent_table) {
-		/* Add one more page for EXTENT_PAGE write */
-		CU_ASSERT(write_bytes + copy_bytes == page_size * 12 + cluster_size);
-	} else {
-		CU_ASSERT(write_bytes + copy_bytes == page_size * 11 + cluster_size);
-	}
-	CU_ASSERT(read_bytes + copy_bytes == cluster_size);
+	CU_ASSERT(g_dev_read_bytes == read_bytes_start);
+	CU_ASSERT(g_dev_copy_bytes == copy_bytes_start);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	CU_ASSERT(blob->num_partial_clusters == 1);
+	SPDK_CU_ASSERT_FATAL(blob_partial_cluster_get(blob, 0) != NULL);
+	CU_ASSERT(spdk_bit_array_count_set(blob_partial_cluster_get(blob, 0)->written) == 1);
+	CU_ASSERT(spdk_bit_array_get(blob_partial_cluster_get(blob, 0)->written, 2));
 
-	spdk_blob_io_read(blob, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	/* Write zeroes and writev to the same cluster */
+	spdk_blob_io_write_zeroes(blob, channel, 4, 2, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
-
-	/* Data on snapshot should not change after write to clone */
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	spdk_blob_io_read(snapshot, channel, payload_read, 4, 10, blob_op_complete, NULL);
+	memset(payload_write, 0xCC, 2 * 4096);
+	iov[0].iov_base = payload_write;
+	iov[0].iov_len = 4096;
+	iov[1].iov_base = payload_write + 4096;
+	iov[1].iov_len = 4096;
+	write_bytes_start = g_dev_write_bytes;
+	spdk_blob_io_writev(blob, channel, iov, 2, 7, 2, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
+	CU_ASSERT(spdk_bit_array_count_set(blob_partial_cluster_get(blob, 0)->written) == 5);
+	/* Only the data and the extent page of the cluster are written, md is not synced */
+	CU_ASSERT(g_dev_write_bytes - write_bytes_start == 3 * 4096);
 
-	ut_blob_close_and_delete(bs, blob);
-	ut_blob_close_and_delete(bs, snapshot);
+	/* Reads merge the pages written to the clone with the ones of the snapshot */
+	memset(expected, 0xAA, 10 * 4096);
+	memset(expected + 2 * 4096, 0xBB, 4096);
+	memset(expected + 4 * 4096, 0, 2 * 4096);
+	memset(expected + 7 * 4096, 0xCC, 2 * 4096);
+	ut_subcluster_cow_check(blob, channel, 0, 10, expected);
 
+	/* Data of the snapshot did not change */
+	memset(payload_write, 0xAA, 10 * 4096);
+	ut_subcluster_cow_check(snapshot, channel, 0, 10, payload_write);
+
+	/* The written pages are persisted */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
-	g_blob = NULL;
-	g_blobid = 0;
-}
 
-static void
-blob_snapshot_rw_iov(void)
-{
-	static const uint8_t zero[10 * 4096] = { 0 };
-	struct spdk_blob_store *bs = g_bs;
-	struct spdk_blob *blob, *snapshot;
-	struct spdk_io_channel *channel;
-	struct spdk_blob_opts opts;
-	spdk_blob_id blobid, snapshotid;
-	uint64_t free_clusters;
-	uint8_t payload_read[10 * 4096];
-	uint8_t payload_write[10 * 4096];
-	struct iovec iov_read[3];
-	struct iovec iov_write[3];
-
-	free_clusters = spdk_bs_free_cluster_count(bs);
+	ut_bs_reload(&bs, NULL);
 
 	channel = spdk_bs_alloc_io_channel(bs);
-	CU_ASSERT(channel != NULL);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
 
-	ut_spdk_blob_opts_init(&opts);
-	opts.thin_provision = true;
-	opts.num_clusters = 5;
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->num_partial_clusters == 1);
+	SPDK_CU_ASSERT_FATAL(blob_partial_cluster_get(blob, 0) != NULL);
+	CU_ASSERT(spdk_bit_array_count_set(blob_partial_cluster_get(blob, 0)->written) == 5);
+	ut_subcluster_cow_check(blob, channel, 0, 10, expected);
 
-	blob = ut_blob_create_and_open(bs, &opts);
-	blobid = spdk_blob_get_id(blob);
-	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
 
-	CU_ASSERT(spdk_blob_get_num_clusters(blob) == 5);
+	/* Writing all the remaining pages retires the partial cluster */
+	memset(payload_write, 0xDD, pages_per_cluster * 4096);
+	spdk_blob_io_write(blob, channel, payload_write, 10, pages_per_cluster - 10,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_write, 0, 2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob_partial_cluster_get(blob, 0) != NULL);
+	spdk_blob_io_write(blob, channel, payload_write, 3, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_write, 6, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_write, 9, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob_partial_cluster_get(blob, 0) == NULL);
+	CU_ASSERT(blob->num_partial_clusters == 0);
+
+	/* A partial cluster of the clone moves to a new snapshot of it */
+	memset(payload_write, 0xEE, 4096);
+	spdk_blob_io_write(blob, channel, payload_write, pages_per_cluster + 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->num_partial_clusters == 1);
 
-	/* Create snapshot from blob */
 	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
-	snapshotid = g_blobid;
+	snapshotid2 = g_blobid;
 
-	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	spdk_bs_open_blob(bs, snapshotid2, blob_op_with_handle_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
-	snapshot = g_blob;
-	CU_ASSERT(snapshot->data_ro == true);
-	CU_ASSERT(snapshot->md_ro == true);
-	CU_ASSERT(spdk_blob_get_num_clusters(snapshot) == 5);
+	snapshot2 = g_blob;
+	CU_ASSERT(blob->num_partial_clusters == 0);
+	CU_ASSERT(snapshot2->num_partial_clusters == 1);
+	SPDK_CU_ASSERT_FATAL(blob_partial_cluster_get(snapshot2, 1) != NULL);
+
+	memset(expected, 0xAA, 4 * 4096);
+	memset(expected + 4096, 0xEE, 4096);
+	ut_subcluster_cow_check(blob, channel, pages_per_cluster, 4, expected);
+	ut_subcluster_cow_check(snapshot2, channel, pages_per_cluster, 4, expected);
+
+	/* The clone gets a partial cluster over the partial cluster of its snapshot */
+	memset(payload_write, 0x11, 4096);
+	spdk_blob_io_write(blob, channel, payload_write, pages_per_cluster + 3, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->num_partial_clusters == 1);
+	memset(expected + 3 * 4096, 0x11, 4096);
+	ut_subcluster_cow_check(blob, channel, pages_per_cluster, 4, expected);
 
-	/* Payload should be all zeros from unallocated clusters */
-	memset(payload_read, 0xAA, sizeof(payload_read));
-	iov_read[0].iov_base = payload_read;
-	iov_read[0].iov_len = 3 * 4096;
-	iov_read[1].iov_base = payload_read + 3 * 4096;
-	iov_read[1].iov_len = 4 * 4096;
-	iov_read[2].iov_base = payload_read + 7 * 4096;
-	iov_read[2].iov_len = 3 * 4096;
-	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
+	/* Deleting the middle snapshot fills its partial clusters and the ones of the clone */
+	spdk_blob_close(snapshot2, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(zero, payload_read, 10 * 4096) == 0);
+	spdk_bs_delete_blob(bs, snapshotid2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->parent_id == snapshotid);
+	CU_ASSERT(blob->num_partial_clusters == 0);
+	CU_ASSERT(blob->partial_cow_paused == false);
+	ut_subcluster_cow_check(blob, channel, pages_per_cluster, 4, expected);
+
+	/* Clusters whose extent page has no room for another bitmap are fully copied */
+	chunk = blob_partial_chunk(blob, 2);
+	SPDK_CU_ASSERT_FATAL(chunk != NULL);
+	num_partial = chunk->num_partial;
+	chunk->num_partial = bs_partial_clusters_per_extent_page(bs);
+	copy_bytes_start = g_dev_copy_bytes;
+	read_bytes_start = g_dev_read_bytes;
+	memset(payload_write, 0x33, 4096);
+	spdk_blob_io_write(blob, channel, payload_write, 3 * pages_per_cluster + 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	chunk->num_partial = num_partial;
+	CU_ASSERT(blob->active.clusters[3] != 0);
+	CU_ASSERT(blob_partial_cluster_get(blob, 3) == NULL);
+	CU_ASSERT(g_dev_copy_bytes - copy_bytes_start + g_dev_read_bytes - read_bytes_start >=
+		  spdk_bs_get_cluster_size(bs));
+	memset(expected, 0xAA, 4 * 4096);
+	memset(expected + 4096, 0x33, 4096);
+	ut_subcluster_cow_check(blob, channel, 3 * pages_per_cluster, 4, expected);
 
-	memset(payload_write, 0xE5, sizeof(payload_write));
-	iov_write[0].iov_base = payload_write;
-	iov_write[0].iov_len = 1 * 4096;
-	iov_write[1].iov_base = payload_write + 1 * 4096;
-	iov_write[1].iov_len = 5 * 4096;
-	iov_write[2].iov_base = payload_write + 6 * 4096;
-	iov_write[2].iov_len = 4 * 4096;
+	/* Inflating the clone fills its partial clusters */
+	memset(payload_write, 0x22, 4096);
+	spdk_blob_io_write(blob, channel, payload_write, 2 * pages_per_cluster + 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->num_partial_clusters == 1);
+	spdk_blob_io_write(blob, channel, payload_write, pages_per_cluster + 5, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
 
-	spdk_blob_io_writev(blob, channel, iov_write, 3, 250, 10, blob_op_complete, NULL);
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 
-	memset(payload_read, 0xAA, sizeof(payload_read));
-	iov_read[0].iov_base = payload_read;
-	iov_read[0].iov_len = 3 * 4096;
-	iov_read[1].iov_base = payload_read + 3 * 4096;
-	iov_read[1].iov_len = 4 * 4096;
-	iov_read[2].iov_base = payload_read + 7 * 4096;
-	iov_read[2].iov_len = 3 * 4096;
-	spdk_blob_io_readv(blob, channel, iov_read, 3, 250, 10, blob_op_complete, NULL);
+	spdk_bs_inflate_blob(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->parent_id == SPDK_BLOBID_INVALID);
+	CU_ASSERT(blob->num_partial_clusters == 0);
+	CU_ASSERT(blob->partial_cow_paused == false);
+	memset(expected, 0xAA, 6 * 4096);
+	memset(expected + 4096, 0xEE, 4096);
+	memset(expected + 3 * 4096, 0x11, 4096);
+	memset(expected + 5 * 4096, 0x22, 4096);
+	ut_subcluster_cow_check(blob, channel, pages_per_cluster, 6, expected);
+	memset(expected, 0xAA, 4 * 4096);
+	memset(expected + 4096, 0x22, 4096);
+	ut_subcluster_cow_check(blob, channel, 2 * pages_per_cluster, 4, expected);
+
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
-	CU_ASSERT(memcmp(payload_write, payload_read, 10 * 4096) == 0);
 
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
-
-	ut_blob_close_and_delete(bs, blob);
-	ut_blob_close_and_delete(bs, snapshot);
+	free(expected);
+	free(payload_write);
 }
 
 /**
@@ -5130,6 +6510,331 @@ blob_inflate_rw(void)
 	_blob_inflate_rw(true);
 }
 
+static void
+blob_inflate_ext(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *clone;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	struct spdk_bs_inflate_opts inflate_opts;
+	spdk_blob_id blobid, snapshotid, cloneid;
+	uint64_t free_clusters, cluster_size, pages_per_cluster;
+	uint8_t *payload, *expected;
+	int i;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	pages_per_cluster = cluster_size / spdk_bs_get_page_size(bs);
+	payload = malloc(cluster_size * 16);
+	SPDK_CU_ASSERT_FATAL(payload != NULL);
+	expected = malloc(cluster_size * 16);
+	SPDK_CU_ASSERT_FATAL(expected != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 16;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	for (i = 0; i < 16; i++) {
+		memset(expected + i * cluster_size, i + 1, cluster_size);
+	}
+	spdk_blob_io_write(blob, channel, expected, 0, 16 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
+
+	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	cloneid = g_blobid;
+	spdk_bs_open_blob(bs, cloneid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	clone = g_blob;
+	g_blob = NULL;
+
+	spdk_bs_inflate_opts_init(&inflate_opts, sizeof(inflate_opts));
+	CU_ASSERT(inflate_opts.queue_depth == SPDK_BS_INFLATE_QUEUE_DEPTH);
+	CU_ASSERT(inflate_opts.rate_limit == 0);
+
+	inflate_opts.queue_depth = 0;
+	spdk_bs_inflate_blob_ext(bs, channel, blobid, &inflate_opts, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(spdk_bs_inflate_blob_cancel(bs, blobid) == -ENOENT);
+
+	/* Clusters are copied up to queue_depth at a time */
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	inflate_opts.queue_depth = 4;
+	g_bserrno = -1;
+	spdk_bs_inflate_blob_ext(bs, channel, blobid, &inflate_opts, blob_op_complete, NULL);
+	for (i = 0; i < 10 && blob->inflate_ctx == NULL; i++) {
+		poll_thread_times(0, 1);
+	}
+	SPDK_CU_ASSERT_FATAL(blob->inflate_ctx != NULL);
+	CU_ASSERT(blob->inflate_ctx->outstanding == 4);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->inflate_ctx == NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 16);
+	CU_ASSERT(!spdk_blob_is_thin_provisioned(blob));
+	CU_ASSERT(!spdk_blob_is_clone(blob));
+
+	memset(payload, 0, cluster_size * 16);
+	spdk_blob_io_read(blob, channel, payload, 0, 16 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 16) == 0);
+
+	/* Two clusters are copied per period at 20 clusters per second, until cancelled */
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	inflate_opts.queue_depth = 8;
+	inflate_opts.rate_limit = 20;
+	g_bserrno = -1;
+	spdk_bs_blob_decouple_parent_ext(bs, channel, cloneid, &inflate_opts, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -1);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 2);
+
+	spdk_delay_us(SPDK_BS_INFLATE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -1);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4);
+
+	CU_ASSERT(spdk_bs_inflate_blob_cancel(bs, cloneid) == 0);
+	spdk_delay_us(SPDK_BS_INFLATE_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ECANCELED);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4);
+	CU_ASSERT(spdk_bs_inflate_blob_cancel(bs, cloneid) == -ENOENT);
+	CU_ASSERT(spdk_blob_is_clone(clone));
+	CU_ASSERT(spdk_blob_get_parent_snapshot(bs, cloneid) == snapshotid);
+	CU_ASSERT(!clone->locked_operation_in_progress);
+
+	memset(payload, 0, cluster_size * 16);
+	spdk_blob_io_read(clone, channel, payload, 0, 16 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 16) == 0);
+
+	/* Without a limit, the remaining clusters are copied */
+	spdk_bs_blob_decouple_parent_ext(bs, channel, cloneid, NULL, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 16);
+	CU_ASSERT(!spdk_blob_is_clone(clone));
+
+	ut_blob_close_and_delete(bs, clone);
+	ut_blob_close_and_delete(bs, blob);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(payload);
+	free(expected);
+}
+
+static void
+blob_dedup(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *image;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid, snapshot2id, imageid;
+	uint64_t free_clusters, cluster_size, pages_per_cluster;
+	uint8_t *payload, *expected;
+	spdk_blob_id ids[2];
+	size_t count;
+	int i;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	pages_per_cluster = cluster_size / spdk_bs_get_page_size(bs);
+	payload = malloc(cluster_size * 5);
+	SPDK_CU_ASSERT_FATAL(payload != NULL);
+	expected = malloc(cluster_size * 5);
+	SPDK_CU_ASSERT_FATAL(expected != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	/* Golden image, the snapshot of which holds a different pattern in each cluster */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	for (i = 0; i < 4; i++) {
+		memset(payload + i * cluster_size, 0x10 + i, cluster_size);
+	}
+	spdk_blob_io_write(blob, channel, payload, 0, 4 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
+
+	/* Image imported independently: clusters 0 and 2 match the snapshot, cluster 1
+	 * does not, cluster 3 differs in its last page and cluster 4 is past its end. */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 5;
+	image = ut_blob_create_and_open(bs, &opts);
+	imageid = spdk_blob_get_id(image);
+	memset(expected + cluster_size, 0xEE, cluster_size);
+	memset(expected + 4 * cluster_size, 0x10, cluster_size);
+	expected[4 * cluster_size - 1] = 0xEE;
+	memcpy(expected, payload, cluster_size);
+	memcpy(expected + 2 * cluster_size, payload + 2 * cluster_size, 2 * cluster_size - 1);
+	spdk_blob_io_write(image, channel, expected, 0, 5 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	/* Only read-only blobs can be deduplicated against */
+	spdk_bs_blob_dedup(bs, channel, imageid, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	spdk_bs_blob_dedup(bs, channel, snapshotid, imageid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(!spdk_blob_is_clone(image));
+
+	spdk_bs_blob_dedup(bs, channel, imageid, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 2);
+	CU_ASSERT(spdk_blob_is_clone(image));
+	CU_ASSERT(spdk_blob_is_thin_provisioned(image));
+	CU_ASSERT(spdk_blob_get_parent_snapshot(bs, imageid) == snapshotid);
+	count = SPDK_COUNTOF(ids);
+	CU_ASSERT(spdk_blob_get_clones(bs, snapshotid, ids, &count) == 0);
+	CU_ASSERT(count == 2);
+
+	memset(payload, 0, cluster_size * 5);
+	spdk_blob_io_read(image, channel, payload, 0, 5 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 5) == 0);
+
+	/* Writes to a released cluster copy it from the snapshot again */
+	memset(expected, 0xAB, spdk_bs_get_page_size(bs));
+	spdk_blob_io_write(image, channel, expected, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 1);
+
+	/* Nothing left to release */
+	spdk_bs_blob_dedup(bs, channel, imageid, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 1);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_close(image, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_bs_reload(&bs, NULL);
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 1);
+	CU_ASSERT(spdk_blob_get_parent_snapshot(bs, imageid) == snapshotid);
+
+	spdk_bs_open_blob(bs, imageid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	image = g_blob;
+	memset(payload, 0, cluster_size * 5);
+	spdk_blob_io_read(image, channel, payload, 0, 5 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 5) == 0);
+	ut_blob_close_and_delete(bs, image);
+
+	/* A thin blob never written in cluster 1 would read the data of the snapshot there */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 2;
+	image = ut_blob_create_and_open(bs, &opts);
+	imageid = spdk_blob_get_id(image);
+	memset(expected, 0x10, cluster_size);
+	memset(expected + cluster_size, 0, cluster_size);
+	spdk_blob_io_write(image, channel, expected, 0, pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	spdk_bs_blob_dedup(bs, channel, imageid, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+	CU_ASSERT(!spdk_blob_is_clone(image));
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+
+	memset(payload, 0xFF, cluster_size * 2);
+	spdk_blob_io_read(image, channel, payload, 0, 2 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 2) == 0);
+
+	/* It is deduplicated against a snapshot not holding data there either */
+	spdk_bs_create_snapshot(bs, imageid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshot2id = g_blobid;
+	ut_blob_close_and_delete(bs, image);
+
+	image = ut_blob_create_and_open(bs, &opts);
+	imageid = spdk_blob_get_id(image);
+	spdk_blob_io_write(image, channel, expected, 0, pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	spdk_bs_blob_dedup(bs, channel, imageid, snapshot2id, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_is_clone(image));
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 1);
+
+	memset(payload, 0xFF, cluster_size * 2);
+	spdk_blob_io_read(image, channel, payload, 0, 2 * pages_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload, expected, cluster_size * 2) == 0);
+	ut_blob_close_and_delete(bs, image);
+
+	spdk_bs_delete_blob(bs, snapshot2id, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(payload);
+	free(expected);
+}
+
 /**
  * Snapshot-clones relation test
  *
@@ -7294,6 +8999,128 @@ blob_persist_test(void)
 	poll_threads();
 }
 
+static void
+blob_sync_md_group_cpl(void *cb_arg, int bserrno)
+{
+	int *rc = cb_arg;
+
+	*rc = bserrno;
+}
+
+static void
+blob_sync_md_group(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blobs[16];
+	spdk_blob_id blobids[16];
+	struct spdk_power_failure_thresholds thresholds = {};
+	int rcs[16];
+	char *large_xattr;
+	const void *value;
+	size_t value_len;
+	uint64_t write_ops;
+	int i, rc;
+
+	large_xattr = calloc(1, SPDK_BS_PAGE_SIZE);
+	SPDK_CU_ASSERT_FATAL(large_xattr != NULL);
+
+	for (i = 0; i < 16; i++) {
+		blobs[i] = ut_blob_create_and_open(bs, NULL);
+		blobids[i] = spdk_blob_get_id(blobs[i]);
+	}
+
+	/* The root pages of blobs synced at once are written with a single write */
+	for (i = 0; i < 16; i++) {
+		rc = spdk_blob_set_xattr(blobs[i], "index", &i, sizeof(i));
+		CU_ASSERT(rc == 0);
+	}
+	write_ops = g_dev_write_ops;
+	g_dev_write_bytes = 0;
+	for (i = 0; i < 16; i++) {
+		rcs[i] = -1;
+		spdk_blob_sync_md(blobs[i], blob_sync_md_group_cpl, &rcs[i]);
+	}
+	poll_threads();
+	for (i = 0; i < 16; i++) {
+		CU_ASSERT(rcs[i] == 0);
+	}
+	CU_ASSERT(g_dev_write_ops - write_ops == 1);
+	CU_ASSERT(g_dev_write_bytes == 16 * SPDK_BS_PAGE_SIZE);
+
+	/* With md spanning two pages, all the second pages are written before the root pages */
+	memset(large_xattr, 0xA5, SPDK_BS_PAGE_SIZE - 64);
+	for (i = 0; i < 16; i++) {
+		rc = spdk_blob_set_xattr(blobs[i], "large", large_xattr, SPDK_BS_PAGE_SIZE - 64);
+		CU_ASSERT(rc == 0);
+	}
+	write_ops = g_dev_write_ops;
+	for (i = 0; i < 16; i++) {
+		rcs[i] = -1;
+		spdk_blob_sync_md(blobs[i], blob_sync_md_group_cpl, &rcs[i]);
+	}
+	poll_threads();
+	for (i = 0; i < 16; i++) {
+		CU_ASSERT(rcs[i] == 0);
+		CU_ASSERT(blobs[i]->active.num_pages == 2);
+	}
+	CU_ASSERT(g_dev_write_ops - write_ops == 2);
+
+	/* A failed write is reported to every sync it was merged from */
+	for (i = 0; i < 16; i++) {
+		rc = spdk_blob_set_xattr(blobs[i], "index", &blobids[i], sizeof(blobids[i]));
+		CU_ASSERT(rc == 0);
+	}
+	thresholds.write_threshold = 1;
+	dev_set_power_failure_thresholds(thresholds);
+	for (i = 0; i < 16; i++) {
+		rcs[i] = 0;
+		spdk_blob_sync_md(blobs[i], blob_sync_md_group_cpl, &rcs[i]);
+	}
+	poll_threads();
+	for (i = 0; i < 16; i++) {
+		CU_ASSERT(rcs[i] == -EIO);
+	}
+	dev_reset_power_failure_event();
+
+	for (i = 0; i < 16; i++) {
+		rc = spdk_blob_set_xattr(blobs[i], "index", &i, sizeof(i));
+		CU_ASSERT(rc == 0);
+		rcs[i] = -1;
+		spdk_blob_sync_md(blobs[i], blob_sync_md_group_cpl, &rcs[i]);
+	}
+	poll_threads();
+	for (i = 0; i < 16; i++) {
+		CU_ASSERT(rcs[i] == 0);
+		spdk_blob_close(blobs[i], blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	/* Verify that the md of all the blobs made it to disk */
+	ut_bs_reload(&bs, NULL);
+
+	for (i = 0; i < 16; i++) {
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blobs[i] = g_blob;
+
+		rc = spdk_blob_get_xattr_value(blobs[i], "index", &value, &value_len);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(value_len == sizeof(i));
+		CU_ASSERT(value != NULL && *(const int *)value == i);
+		rc = spdk_blob_get_xattr_value(blobs[i], "large", &value, &value_len);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(value_len == SPDK_BS_PAGE_SIZE - 64);
+		CU_ASSERT(value != NULL && memcmp(value, large_xattr, value_len) == 0);
+
+		ut_blob_close_and_delete(bs, blobs[i]);
+	}
+
+	free(large_xattr);
+}
+
 static void
 blob_decouple_snapshot(void)
 {
@@ -8801,6 +10628,9 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite, bs_super_block);
 		CU_ADD_TEST(suite, bs_test_recover_cluster_count);
 		CU_ADD_TEST(suite, bs_test_grow);
+		CU_ADD_TEST(suite, bs_cluster_allocator_extent);
+		CU_ADD_TEST(suite, bs_delete_background_free);
+		CU_ADD_TEST(suite, bs_recover_md_replay);
 		CU_ADD_TEST(suite, blob_serialize_test);
 		CU_ADD_TEST(suite_bs, blob_crc);
 		CU_ADD_TEST(suite, super_block_crc);
@@ -8812,11 +10642,16 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
 		CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_write_batch);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_sparse_map);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
 		CU_ADD_TEST(suite, bs_load_iter_test);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw_iov);
+		CU_ADD_TEST(suite_bs, blob_subcluster_cow);
+		CU_ADD_TEST(suite_bs, blob_snapshot_chain_resolve);
+		CU_ADD_TEST(suite_bs, blob_snapshot_chain_release);
 		CU_ADD_TEST(suite, blob_relations);
 		CU_ADD_TEST(suite, blob_relations2);
 		CU_ADD_TEST(suite, blob_relations3);
@@ -8824,6 +10659,8 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite, blob_delete_snapshot_power_failure);
 		CU_ADD_TEST(suite, blob_create_snapshot_power_failure);
 		CU_ADD_TEST(suite_bs, blob_inflate_rw);
+		CU_ADD_TEST(suite_bs, blob_inflate_ext);
+		CU_ADD_TEST(suite_bs, blob_dedup);
 		CU_ADD_TEST(suite_bs, blob_snapshot_freeze_io);
 		CU_ADD_TEST(suite_bs, blob_operation_split_rw);
 		CU_ADD_TEST(suite_bs, blob_operation_split_rw_iov);
@@ -8831,6 +10668,7 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite, blob_io_unit_compatibility);
 		CU_ADD_TEST(suite_bs, blob_simultaneous_operations);
 		CU_ADD_TEST(suite_bs, blob_persist_test);
+		CU_ADD_TEST(suite_bs, blob_sync_md_group);
 		CU_ADD_TEST(suite_bs, blob_decouple_snapshot);
 		CU_ADD_TEST(suite_bs, blob_seek_io_unit);
 		CU_ADD_TEST(suite_esnap_bs, blob_esnap_create);
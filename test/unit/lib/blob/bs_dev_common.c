@@ -13,6 +13,7 @@
 #define DEV_BUFFER_BLOCKCNT (DEV_BUFFER_SIZE / DEV_BUFFER_BLOCKLEN)
 uint8_t *g_dev_buffer;
 uint64_t g_dev_write_bytes;
+uint64_t g_dev_write_ops;
 uint64_t g_dev_read_bytes;
 uint64_t g_dev_copy_bytes;
 bool g_dev_writev_ext_called;
@@ -171,6 +172,7 @@ dev_write(struct spdk_bs_dev *dev, struct spdk_io_channel *channel, void *payloa
 
 		memcpy(&g_dev_buffer[offset], payload, length);
 		g_dev_write_bytes += length;
+		g_dev_write_ops++;
 	} else {
 		g_power_failure_rc = -EIO;
 	}
@@ -273,6 +275,7 @@ dev_writev(struct spdk_bs_dev *dev, struct spdk_io_channel *channel,
 		}
 
 		g_dev_write_bytes += length;
+		g_dev_write_ops++;
 	} else {
 		g_power_failure_rc = -EIO;
 	}
@@ -167,6 +167,7 @@ spdk_bs_load(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts,
 
 	if (ut_dev->load_status == 0) {
 		bs = ut_dev->bs;
+		memcpy(&bs->bs_opts, opts, sizeof(struct spdk_bs_opts));
 	}
 
 	cb_fn(cb_arg, bs, ut_dev->load_status);
@@ -710,10 +711,16 @@ lvs_init_opts_success(void)
 	spdk_lvs_opts_init(&opts);
 	snprintf(opts.name, sizeof(opts.name), "lvs");
 	opts.cluster_sz = 8192;
+	opts.cluster_allocator = BS_CLUSTER_ALLOCATOR_EXTENT;
+	opts.cluster_extent_sz = 16;
+	opts.background_free_rate = 100;
 	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(g_lvserrno == 0);
 	CU_ASSERT(dev.bs->bs_opts.cluster_sz == opts.cluster_sz);
+	CU_ASSERT(dev.bs->bs_opts.cluster_allocator == BS_CLUSTER_ALLOCATOR_EXTENT);
+	CU_ASSERT(dev.bs->bs_opts.cluster_extent_sz == 16);
+	CU_ASSERT(dev.bs->bs_opts.background_free_rate == 100);
 	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
 
 	g_lvserrno = -1;
@@ -1164,6 +1171,11 @@ null_cb(void *ctx, struct spdk_blob_store *bs, int bserrno)
 	SPDK_CU_ASSERT_FATAL(bs != NULL);
 }
 
+static void
+ut_recovery_progress(void *cb_arg, const struct spdk_bs_recovery_progress *progress)
+{
+}
+
 static void
 test_lvs_load(void)
 {
@@ -1260,6 +1272,23 @@ test_lvs_load(void)
 	CU_ASSERT(g_lvserrno == 0);
 	CU_ASSERT(TAILQ_EMPTY(&g_lvol_stores));
 
+	/* Load successfully, passing the recovery progress callback down to the blobstore */
+	g_lvserrno = -1;
+	spdk_lvs_opts_init(&opts);
+	opts.recovery_progress_fn = ut_recovery_progress;
+	opts.recovery_progress_arg = req;
+	spdk_lvs_load_ext(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+	CU_ASSERT(dev.bs->bs_opts.recovery_progress_fn == ut_recovery_progress);
+	CU_ASSERT(dev.bs->bs_opts.recovery_progress_arg == req);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_lvol_stores));
+
 	free(req);
 	free_dev(&dev);
 }
@@ -322,11 +322,16 @@ spdk_nvme_ctrlr_cmd_set_feature(struct spdk_nvme_ctrlr *ctrlr, uint8_t feature,
 	return 0;
 }
 
+static uint32_t g_ut_fdp_feat_count;
+
 int
 spdk_nvme_ctrlr_cmd_get_feature(struct spdk_nvme_ctrlr *ctrlr, uint8_t feature,
 				uint32_t cdw11, void *payload, uint32_t payload_size,
 				spdk_nvme_cmd_cb cb_fn, void *cb_arg)
 {
+	if (feature == SPDK_NVME_FEAT_FDP) {
+		g_ut_fdp_feat_count++;
+	}
 	fake_cpl_sc(cb_fn, cb_arg);
 	return 0;
 }
@@ -365,12 +370,18 @@ spdk_nvme_ctrlr_cmd_get_log_page(struct spdk_nvme_ctrlr *ctrlr, uint8_t log_page
 	return 0;
 }
 
+static uint8_t g_ut_fdp_log[NVME_FDP_CFG_LOG_PAGE_SIZE];
+
 int
 spdk_nvme_ctrlr_cmd_get_log_page_ext(struct spdk_nvme_ctrlr *ctrlr, uint8_t log_page,
 				     uint32_t nsid, void *payload, uint32_t payload_size,
 				     uint64_t offset, uint32_t cdw10, uint32_t cdw11,
 				     uint32_t cdw14, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
 {
+	if (log_page == SPDK_NVME_LOG_FDP_CONFIGURATIONS) {
+		CU_ASSERT(payload_size <= sizeof(g_ut_fdp_log));
+		memcpy(payload, g_ut_fdp_log, payload_size);
+	}
 	fake_cpl_sc(cb_fn, cb_arg);
 	return 0;
 }
@@ -475,6 +486,14 @@ static uint32_t g_active_ns_list_length = 0;
 static struct spdk_nvme_ctrlr_data *g_cdata = NULL;
 static bool g_fail_next_identify = false;
 
+/* When set, per-namespace identify commands are queued here instead of completing inline */
+static bool g_defer_ns_identify = false;
+static struct {
+	spdk_nvme_cmd_cb	cb_fn;
+	void			*cb_arg;
+} g_deferred_ns_identify[64];
+static uint32_t g_deferred_ns_identify_count;
+
 int
 nvme_ctrlr_cmd_identify(struct spdk_nvme_ctrlr *ctrlr, uint8_t cns, uint16_t cntid, uint32_t nsid,
 			uint8_t csi, void *payload, size_t payload_size,
@@ -485,6 +504,15 @@ nvme_ctrlr_cmd_identify(struct spdk_nvme_ctrlr *ctrlr, uint8_t cns, uint16_t cnt
 		return 1;
 	}
 
+	if (g_defer_ns_identify && (cns == SPDK_NVME_IDENTIFY_NS ||
+				    cns == SPDK_NVME_IDENTIFY_NS_ID_DESCRIPTOR_LIST)) {
+		SPDK_CU_ASSERT_FATAL(g_deferred_ns_identify_count < SPDK_COUNTOF(g_deferred_ns_identify));
+		g_deferred_ns_identify[g_deferred_ns_identify_count].cb_fn = cb_fn;
+		g_deferred_ns_identify[g_deferred_ns_identify_count].cb_arg = cb_arg;
+		g_deferred_ns_identify_count++;
+		return 0;
+	}
+
 	memset(payload, 0, payload_size);
 	if (cns == SPDK_NVME_IDENTIFY_ACTIVE_NS_LIST) {
 		uint32_t count = 0;
@@ -655,6 +683,12 @@ nvme_ns_free_zns_specific_data(struct spdk_nvme_ns *ns)
 	}
 }
 
+bool
+nvme_ns_fdp_supported(struct spdk_nvme_ns *ns)
+{
+	return ns->ctrlr->cdata.ctratt.fdps && ns->nsdata.endgid != 0;
+}
+
 void
 nvme_ns_destruct(struct spdk_nvme_ns *ns)
 {
@@ -2680,6 +2714,88 @@ test_nvme_ctrlr_active_ns_list_v0(void)
 	nvme_ctrlr_destruct(&ctrlr);
 }
 
+static void
+test_nvme_ctrlr_identify_namespaces_parallel(void)
+{
+	struct spdk_nvme_cpl cpl = {};
+	uint32_t completed = 0;
+	DECLARE_AND_CONSTRUCT_CTRLR();
+
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr_construct(&ctrlr) == 0);
+
+	ctrlr.vs.bits.mjr = 1;
+	ctrlr.vs.bits.mnr = 3;
+	ctrlr.vs.bits.ter = 0;
+	ctrlr.cdata.nn = 20;
+
+	ctrlr.state = NVME_CTRLR_STATE_IDENTIFY_ACTIVE_NS;
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr_process_init(&ctrlr) == 0);
+	SPDK_CU_ASSERT_FATAL(ctrlr.state == NVME_CTRLR_STATE_IDENTIFY_NS);
+
+	g_defer_ns_identify = true;
+	g_deferred_ns_identify_count = 0;
+
+	/* Identify NS is issued for several namespaces at once */
+	CU_ASSERT(nvme_ctrlr_process_init(&ctrlr) == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_NS);
+	CU_ASSERT(g_deferred_ns_identify_count == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+	CU_ASSERT(ctrlr.ns_identify.outstanding == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+
+	/* Each completion refills the window until all namespaces were issued */
+	while (completed < g_deferred_ns_identify_count) {
+		g_deferred_ns_identify[completed].cb_fn(g_deferred_ns_identify[completed].cb_arg, &cpl);
+		completed++;
+		CU_ASSERT(ctrlr.ns_identify.outstanding <= NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+	}
+	CU_ASSERT(g_deferred_ns_identify_count == 20);
+	CU_ASSERT(ctrlr.ns_identify.outstanding == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_IDENTIFY_ID_DESCS);
+
+	/* A failed NS ID Desc List stops further submissions, but lets the in-flight ones finish */
+	g_deferred_ns_identify_count = 0;
+	completed = 0;
+	CU_ASSERT(nvme_ctrlr_process_init(&ctrlr) == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS);
+	CU_ASSERT(g_deferred_ns_identify_count == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+
+	cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+	cpl.status.sc = SPDK_NVME_SC_INVALID_FIELD;
+	g_deferred_ns_identify[completed].cb_fn(g_deferred_ns_identify[completed].cb_arg, &cpl);
+	completed++;
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_WAIT_FOR_IDENTIFY_ID_DESCS);
+
+	cpl.status.sc = SPDK_NVME_SC_SUCCESS;
+	while (completed < g_deferred_ns_identify_count) {
+		g_deferred_ns_identify[completed].cb_fn(g_deferred_ns_identify[completed].cb_arg, &cpl);
+		completed++;
+	}
+	CU_ASSERT(g_deferred_ns_identify_count == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+	CU_ASSERT(ctrlr.ns_identify.outstanding == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_IDENTIFY_NS_IOCS_SPECIFIC);
+
+	/* An Identify NS failure moves the controller to the error state */
+	g_deferred_ns_identify_count = 0;
+	nvme_ctrlr_set_state(&ctrlr, NVME_CTRLR_STATE_IDENTIFY_NS, NVME_TIMEOUT_INFINITE);
+	CU_ASSERT(nvme_ctrlr_process_init(&ctrlr) == 0);
+	CU_ASSERT(g_deferred_ns_identify_count == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+
+	cpl.status.sc = SPDK_NVME_SC_INVALID_FIELD;
+	g_deferred_ns_identify[0].cb_fn(g_deferred_ns_identify[0].cb_arg, &cpl);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_ERROR);
+
+	cpl.status.sc = SPDK_NVME_SC_SUCCESS;
+	for (completed = 1; completed < NVME_MAX_OUTSTANDING_NS_IDENTIFY; completed++) {
+		g_deferred_ns_identify[completed].cb_fn(g_deferred_ns_identify[completed].cb_arg, &cpl);
+	}
+	CU_ASSERT(g_deferred_ns_identify_count == NVME_MAX_OUTSTANDING_NS_IDENTIFY);
+	CU_ASSERT(ctrlr.ns_identify.outstanding == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_ERROR);
+
+	g_defer_ns_identify = false;
+	g_deferred_ns_identify_count = 0;
+	nvme_ctrlr_destruct(&ctrlr);
+}
+
 static void
 test_nvme_ctrlr_active_ns_list_v2(void)
 {
@@ -3009,7 +3125,7 @@ test_nvme_ctrlr_identify_namespaces_iocs_specific_next(void)
 	ctrlr.opts.admin_timeout_ms = NVME_TIMEOUT_INFINITE;
 	rc = nvme_ctrlr_identify_namespaces_iocs_specific_next(&ctrlr, prev_nsid);
 	CU_ASSERT(rc == 0);
-	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_IDENTIFY_NS_FDP);
 	CU_ASSERT(ctrlr.state_timeout_tsc == NVME_TIMEOUT_INFINITE);
 
 	/* case 2: move on to the next active NS, and no namespace with (supported) iocs specific data found , expect: pass */
@@ -3024,7 +3140,7 @@ test_nvme_ctrlr_identify_namespaces_iocs_specific_next(void)
 	ns[1].id = 2;
 	rc = nvme_ctrlr_identify_namespaces_iocs_specific_next(&ctrlr, prev_nsid);
 	CU_ASSERT(rc == 0);
-	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_IDENTIFY_NS_FDP);
 	CU_ASSERT(ctrlr.state_timeout_tsc == NVME_TIMEOUT_INFINITE);
 
 	/* case 3: ns.csi is SPDK_NVME_CSI_ZNS, do not loop, expect: pass */
@@ -3068,6 +3184,161 @@ test_nvme_ctrlr_identify_namespaces_iocs_specific_next(void)
 	CU_ASSERT(pthread_mutex_destroy(&ctrlr.ctrlr_lock) == 0);
 }
 
+static void
+ut_fdp_build_cfg_log_page(void)
+{
+	struct spdk_nvme_fdp_cfg_log_page *log = (void *)g_ut_fdp_log;
+	struct spdk_nvme_fdp_cfg_descriptor *desc;
+	uint32_t offset = sizeof(*log);
+
+	memset(g_ut_fdp_log, 0, sizeof(g_ut_fdp_log));
+
+	/* Two configurations, with 2 and 4 reclaim unit handles */
+	log->ncfg = 1;
+
+	desc = (void *)&g_ut_fdp_log[offset];
+	desc->ds = sizeof(*desc) + 2 * sizeof(struct spdk_nvme_fdp_ruh_descriptor);
+	desc->fdpa.bits.fdpcv = 1;
+	desc->nrg = 1;
+	desc->nruh = 2;
+	offset += desc->ds;
+
+	desc = (void *)&g_ut_fdp_log[offset];
+	desc->ds = sizeof(*desc) + 4 * sizeof(struct spdk_nvme_fdp_ruh_descriptor);
+	desc->fdpa.bits.fdpcv = 1;
+	desc->nrg = 1;
+	desc->nruh = 4;
+	desc->ruh_desc[3].ruht = SPDK_NVME_FDP_RUHT_PERSISTENTLY_ISOLATED;
+	offset += desc->ds;
+
+	log->size = offset;
+}
+
+static void
+test_nvme_ctrlr_set_fdp_cfg(void)
+{
+	struct spdk_nvme_fdp_cfg_log_page *log = (void *)g_ut_fdp_log;
+	struct spdk_nvme_fdp_cfg_descriptor *desc;
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct nvme_fdp_endurance_group endgrp = { .endgid = 1 };
+	int rc;
+
+	ut_fdp_build_cfg_log_page();
+
+	/* Case 1: second configuration is selected */
+	rc = nvme_ctrlr_set_fdp_cfg(&ctrlr, &endgrp, log, sizeof(g_ut_fdp_log), 1);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(endgrp.cfg != NULL);
+	CU_ASSERT(endgrp.cfg->nruh == 4);
+	CU_ASSERT(endgrp.cfg->ruh_desc[3].ruht == SPDK_NVME_FDP_RUHT_PERSISTENTLY_ISOLATED);
+	free(endgrp.cfg);
+	endgrp.cfg = NULL;
+
+	/* Case 2: configuration index out of range */
+	rc = nvme_ctrlr_set_fdp_cfg(&ctrlr, &endgrp, log, sizeof(g_ut_fdp_log), 2);
+	CU_ASSERT(rc == -ENOENT);
+	CU_ASSERT(endgrp.cfg == NULL);
+
+	/* Case 3: selected configuration does not fit into the log page */
+	rc = nvme_ctrlr_set_fdp_cfg(&ctrlr, &endgrp, log, log->size - 1, 1);
+	CU_ASSERT(rc == -ENOENT);
+	CU_ASSERT(endgrp.cfg == NULL);
+
+	/* Case 4: selected configuration is not valid */
+	desc = (void *)&g_ut_fdp_log[sizeof(*log)];
+	desc->fdpa.bits.fdpcv = 0;
+	rc = nvme_ctrlr_set_fdp_cfg(&ctrlr, &endgrp, log, sizeof(g_ut_fdp_log), 0);
+	CU_ASSERT(rc == -EINVAL);
+	CU_ASSERT(endgrp.cfg == NULL);
+}
+
+static void
+test_nvme_ctrlr_identify_namespaces_fdp(void)
+{
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct spdk_nvme_ns ns[3] = {};
+	union spdk_nvme_feat_fdp_cdw12 fdp = {};
+	int rc;
+	int i;
+
+	RB_INIT(&ctrlr.ns);
+	TAILQ_INIT(&ctrlr.fdp_endgrps);
+	for (i = 0; i < 3; i++) {
+		ns[i].id = i + 1;
+		ns[i].active = true;
+		ns[i].ctrlr = &ctrlr;
+		RB_INSERT(nvme_ns_tree, &ctrlr.ns, &ns[i]);
+	}
+
+	CU_ASSERT(pthread_mutex_init(&ctrlr.ctrlr_lock, NULL) == 0);
+
+	ctrlr.cdata.nn = 3;
+	ctrlr.active_ns_count = 3;
+	ctrlr.opts.admin_timeout_ms = NVME_TIMEOUT_INFINITE;
+	/* NS 2 and 3 share an Endurance Group, NS 1 is not part of one */
+	ns[1].nsdata.endgid = 1;
+	ns[2].nsdata.endgid = 1;
+	ut_fdp_build_cfg_log_page();
+
+	/* case 1: FDP not supported by the controller, move on to the next state */
+	g_ut_fdp_feat_count = 0;
+	rc = nvme_ctrlr_identify_namespaces_fdp(&ctrlr);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(g_ut_fdp_feat_count == 0);
+	CU_ASSERT(TAILQ_EMPTY(&ctrlr.fdp_endgrps));
+
+	/* case 2: FDP supported, but not enabled for the Endurance Group */
+	ctrlr.cdata.ctratt.fdps = 1;
+	ctrlr.state = NVME_CTRLR_STATE_IDENTIFY_NS_FDP;
+	fake_cpl.cdw0 = 0;
+	rc = nvme_ctrlr_identify_namespaces_fdp(&ctrlr);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(g_ut_fdp_feat_count == 1);
+	CU_ASSERT(nvme_ctrlr_get_fdp_cfg(&ctrlr, 1) == NULL);
+	CU_ASSERT(ns[1].fdp_cfg == NULL);
+	CU_ASSERT(ns[2].fdp_cfg == NULL);
+
+	/* case 3: FDP enabled, the Endurance Group is queried once and its namespaces
+	 * share the cached configuration */
+	fdp.bits.fdpe = 1;
+	fdp.bits.fdpci = 1;
+	fake_cpl.cdw0 = fdp.raw;
+	g_ut_fdp_feat_count = 0;
+	ctrlr.state = NVME_CTRLR_STATE_IDENTIFY_NS_FDP;
+	rc = nvme_ctrlr_identify_namespaces_fdp(&ctrlr);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(g_ut_fdp_feat_count == 1);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr_get_fdp_cfg(&ctrlr, 1) != NULL);
+	CU_ASSERT(nvme_ctrlr_get_fdp_cfg(&ctrlr, 1)->nruh == 4);
+	CU_ASSERT(ns[0].fdp_cfg == NULL);
+	CU_ASSERT(ns[1].fdp_cfg == nvme_ctrlr_get_fdp_cfg(&ctrlr, 1));
+	CU_ASSERT(ns[2].fdp_cfg == nvme_ctrlr_get_fdp_cfg(&ctrlr, 1));
+
+	/* case 4: Get Features fails, the initialization is not failed and the
+	 * configuration retrieved by the previous initialization is dropped */
+	set_status_code = SPDK_NVME_SC_INVALID_FIELD;
+	g_ut_fdp_feat_count = 0;
+	ctrlr.state = NVME_CTRLR_STATE_IDENTIFY_NS_FDP;
+	rc = nvme_ctrlr_identify_namespaces_fdp(&ctrlr);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ctrlr.state == NVME_CTRLR_STATE_SET_SUPPORTED_LOG_PAGES);
+	CU_ASSERT(g_ut_fdp_feat_count == 1);
+	CU_ASSERT(nvme_ctrlr_get_fdp_cfg(&ctrlr, 1) == NULL);
+	CU_ASSERT(ns[1].fdp_cfg == NULL);
+	CU_ASSERT(ns[2].fdp_cfg == NULL);
+
+	set_status_code = SPDK_NVME_SC_SUCCESS;
+	fake_cpl.cdw0 = 0;
+
+	nvme_ctrlr_free_fdp_data(&ctrlr);
+	CU_ASSERT(TAILQ_EMPTY(&ctrlr.fdp_endgrps));
+
+	CU_ASSERT(pthread_mutex_destroy(&ctrlr.ctrlr_lock) == 0);
+}
+
 static void
 test_nvme_ctrlr_set_supported_log_pages(void)
 {
@@ -3404,11 +3675,14 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_ctrlr_set_state);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_active_ns_list_v0);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_active_ns_list_v2);
+	CU_ADD_TEST(suite, test_nvme_ctrlr_identify_namespaces_parallel);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_ns_mgmt);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_reset);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_aer_callback);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_ns_attr_changed);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_identify_namespaces_iocs_specific_next);
+	CU_ADD_TEST(suite, test_nvme_ctrlr_set_fdp_cfg);
+	CU_ADD_TEST(suite, test_nvme_ctrlr_identify_namespaces_fdp);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_set_supported_log_pages);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_set_intel_supported_log_pages);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_parse_ana_log_page);
@@ -582,6 +582,39 @@ test_set_feature_cmd(void)
 	DECONSTRUCT_CTRLR();
 }
 
+static void
+test_set_interrupt_coalescing_cmds(void)
+{
+	DECLARE_AND_CONSTRUCT_CTRLR();
+	union spdk_nvme_feat_interrupt_coalescing coalescing = {};
+	int rc;
+
+	ctrlr.trid.trtype = SPDK_NVME_TRANSPORT_PCIE;
+	adminq.ctrlr = &ctrlr;
+
+	/* Controller-wide aggregation threshold and time */
+	coalescing.bits.thr = 7;
+	coalescing.bits.time = 2;
+	feature = SPDK_NVME_FEAT_INTERRUPT_COALESCING;
+	feature_cdw11 = coalescing.raw;
+	feature_cdw12 = 0;
+	verify_fn = verify_set_feature_cmd;
+
+	rc = spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(&ctrlr, 7, 2, NULL, NULL);
+	CU_ASSERT(rc == 0);
+
+	/* Fabrics controllers do not use interrupts */
+	ctrlr.trid.trtype = SPDK_NVME_TRANSPORT_TCP;
+	rc = spdk_nvme_ctrlr_cmd_set_interrupt_coalescing(&ctrlr, 7, 2, NULL, NULL);
+	CU_ASSERT(rc == -ENOTSUP);
+
+	feature = 1;
+	feature_cdw11 = 1;
+	feature_cdw12 = 1;
+
+	DECONSTRUCT_CTRLR();
+}
+
 static void
 test_get_feature_ns_cmd(void)
 {
@@ -1034,6 +1067,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_get_log_pages);
 	CU_ADD_TEST(suite, test_set_feature_cmd);
 	CU_ADD_TEST(suite, test_set_feature_ns_cmd);
+	CU_ADD_TEST(suite, test_set_interrupt_coalescing_cmds);
 	CU_ADD_TEST(suite, test_get_feature_cmd);
 	CU_ADD_TEST(suite, test_get_feature_ns_cmd);
 	CU_ADD_TEST(suite, test_abort_cmd);
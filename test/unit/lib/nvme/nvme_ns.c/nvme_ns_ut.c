@@ -72,6 +72,15 @@ nvme_completion_poll_cb(void *arg, const struct spdk_nvme_cpl *cpl)
 {
 }
 
+static uint16_t g_ut_fdp_endgid;
+static const struct spdk_nvme_fdp_cfg_descriptor *g_ut_fdp_cfg;
+
+const struct spdk_nvme_fdp_cfg_descriptor *
+nvme_ctrlr_get_fdp_cfg(struct spdk_nvme_ctrlr *ctrlr, uint16_t endgid)
+{
+	return endgid == g_ut_fdp_endgid ? g_ut_fdp_cfg : NULL;
+}
+
 int32_t
 spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
 {
@@ -494,6 +503,54 @@ test_nvme_ns_find_id_desc(void)
 	CU_ASSERT(csi == NULL);
 }
 
+static void
+test_nvme_ns_construct_fdp(void)
+{
+	struct spdk_nvme_ns ns = {};
+	struct spdk_nvme_ns_data nsdata = {};
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct spdk_nvme_fdp_cfg_descriptor fdp_cfg = {};
+
+	nsdata.nsze = 1000;
+	nsdata.ncap = 1000;
+	nsdata.endgid = 1;
+	fake_nsdata = &nsdata;
+	fdp_cfg.nruh = 2;
+	g_ut_fdp_endgid = 1;
+
+	/* Case 1: FDP is not enabled for the Endurance Group */
+	ctrlr.cdata.ctratt.fdps = 1;
+	g_ut_fdp_cfg = NULL;
+	CU_ASSERT(nvme_ns_construct(&ns, 1, &ctrlr) == 0);
+	CU_ASSERT(spdk_nvme_ns_get_fdp_cfg(&ns) == NULL);
+	nvme_ns_destruct(&ns);
+
+	/* Case 2: the configuration cached for the Endurance Group is used */
+	g_ut_fdp_cfg = &fdp_cfg;
+	CU_ASSERT(nvme_ns_construct(&ns, 1, &ctrlr) == 0);
+	CU_ASSERT(spdk_nvme_ns_get_fdp_cfg(&ns) == &fdp_cfg);
+	nvme_ns_destruct(&ns);
+	CU_ASSERT(spdk_nvme_ns_get_fdp_cfg(&ns) == NULL);
+
+	/* Case 3: the controller does not support FDP */
+	ctrlr.cdata.ctratt.fdps = 0;
+	CU_ASSERT(nvme_ns_construct(&ns, 1, &ctrlr) == 0);
+	CU_ASSERT(spdk_nvme_ns_get_fdp_cfg(&ns) == NULL);
+	nvme_ns_destruct(&ns);
+
+	/* Case 4: the namespace is not part of an Endurance Group */
+	ctrlr.cdata.ctratt.fdps = 1;
+	nsdata.endgid = 0;
+	g_ut_fdp_endgid = 0;
+	CU_ASSERT(nvme_ns_construct(&ns, 1, &ctrlr) == 0);
+	CU_ASSERT(spdk_nvme_ns_get_fdp_cfg(&ns) == NULL);
+	nvme_ns_destruct(&ns);
+
+	g_ut_fdp_cfg = NULL;
+	g_ut_fdp_endgid = 0;
+	fake_nsdata = NULL;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -516,6 +573,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_ctrlr_identify_ns_iocs_specific);
 	CU_ADD_TEST(suite, test_nvme_ctrlr_identify_id_desc);
 	CU_ADD_TEST(suite, test_nvme_ns_find_id_desc);
+	CU_ADD_TEST(suite, test_nvme_ns_construct_fdp);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -285,6 +285,39 @@ test_nvme_rdma_build_sgl_request(void)
 	}
 	rc = nvme_rdma_build_sgl_request(&rqpair, &rdma_req);
 	SPDK_CU_ASSERT_FATAL(rc == -1);
+
+	/* Test case 7: 4 adjacent buffers in one memory region, coalesced into a single SGL. Expected: PASS */
+	ctrlr.ioccsz_bytes = 4096;
+	bio.iovpos = 0;
+	req.payload_offset = 0;
+	req.payload_size = 0x4000;
+	for (i = 0; i < 4; i++) {
+		bio.iovs[i].iov_base = (void *)0x100000 + i * 0x1000;
+		bio.iovs[i].iov_len = 0x1000;
+	}
+	rc = nvme_rdma_build_sgl_request(&rqpair, &rdma_req);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(bio.iovpos == 4);
+	CU_ASSERT(req.cmd.dptr.sgl1.keyed.type == SPDK_NVME_SGL_TYPE_KEYED_DATA_BLOCK);
+	CU_ASSERT(req.cmd.dptr.sgl1.keyed.subtype == SPDK_NVME_SGL_SUBTYPE_ADDRESS);
+	CU_ASSERT(req.cmd.dptr.sgl1.keyed.length == req.payload_size);
+	CU_ASSERT(req.cmd.dptr.sgl1.keyed.key == RDMA_UT_RKEY);
+	CU_ASSERT(req.cmd.dptr.sgl1.address == (uint64_t)bio.iovs[0].iov_base);
+	CU_ASSERT(rdma_req.send_sgl[0].length == sizeof(struct spdk_nvme_cmd));
+
+	/* Test case 8: 2 pairs of adjacent buffers, coalesced into 2 SGL descriptors. Expected: PASS */
+	bio.iovpos = 0;
+	bio.iovs[2].iov_base = (void *)0x200000;
+	bio.iovs[3].iov_base = (void *)0x201000;
+	rc = nvme_rdma_build_sgl_request(&rqpair, &rdma_req);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(bio.iovpos == 4);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.type == SPDK_NVME_SGL_TYPE_LAST_SEGMENT);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.length == 2 * sizeof(struct spdk_nvme_sgl_descriptor));
+	CU_ASSERT(cmd.sgl[0].keyed.length == 0x2000);
+	CU_ASSERT(cmd.sgl[0].address == (uint64_t)bio.iovs[0].iov_base);
+	CU_ASSERT(cmd.sgl[1].keyed.length == 0x2000);
+	CU_ASSERT(cmd.sgl[1].address == (uint64_t)bio.iovs[2].iov_base);
 }
 
 static void
@@ -300,11 +333,13 @@ test_nvme_rdma_build_sgl_inline_request(void)
 
 	ctrlr.max_sges = NVME_RDMA_MAX_SGL_DESCRIPTORS;
 	ctrlr.cdata.nvmf_specific.msdbd = 16;
+	ctrlr.ioccsz_bytes = 4096;
 
 	rqpair.mr_map = (struct spdk_rdma_mem_map *)0xdeadbeef;
 	rqpair.rdma_qp = (struct spdk_rdma_qp *)0xdeadbeef;
 	rqpair.qpair.ctrlr = &ctrlr;
 	rqpair.cmds = &cmd;
+	rqpair.max_send_sge = NVME_RDMA_DEFAULT_TX_SGE;
 	cmd.sgl[0].address = 0x1111;
 	rdma_req.id = 0;
 	rdma_req.req = &req;
@@ -346,6 +381,41 @@ test_nvme_rdma_build_sgl_inline_request(void)
 	CU_ASSERT(rdma_req.send_sgl[1].length == req.payload_size);
 	CU_ASSERT(rdma_req.send_sgl[1].addr == (uint64_t)bio.iovs[0].iov_base);
 	CU_ASSERT(rdma_req.send_sgl[1].lkey == RDMA_UT_LKEY);
+
+	/* Test case 3: 3 buffers, the first 2 adjacent, sent as 2 inline SGEs. Expected: PASS */
+	bio.iovpos = 0;
+	req.payload_offset = 0;
+	req.payload_size = 0x1800;
+	bio.iovs[0].iov_base = (void *)0x100000;
+	bio.iovs[0].iov_len = 0x800;
+	bio.iovs[1].iov_base = (void *)0x100800;
+	bio.iovs[1].iov_len = 0x800;
+	bio.iovs[2].iov_base = (void *)0x200000;
+	bio.iovs[2].iov_len = 0x800;
+	rc = nvme_rdma_build_sgl_inline_request(&rqpair, &rdma_req);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(bio.iovpos == 3);
+	CU_ASSERT(rdma_req.send_wr.num_sge == 3);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.type == SPDK_NVME_SGL_TYPE_DATA_BLOCK);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.length == req.payload_size);
+	CU_ASSERT(rdma_req.send_sgl[0].length == sizeof(struct spdk_nvme_cmd));
+	CU_ASSERT(rdma_req.send_sgl[1].addr == (uint64_t)bio.iovs[0].iov_base);
+	CU_ASSERT(rdma_req.send_sgl[1].length == 0x1000);
+	CU_ASSERT(rdma_req.send_sgl[2].addr == (uint64_t)bio.iovs[2].iov_base);
+	CU_ASSERT(rdma_req.send_sgl[2].length == 0x800);
+
+	/* Test case 4: more scattered buffers than inline SGEs, sent as keyed SGL. Expected: PASS */
+	bio.iovpos = 0;
+	req.payload_size = 0x2000;
+	bio.iovs[1].iov_base = (void *)0x300000;
+	bio.iovs[3].iov_base = (void *)0x400000;
+	bio.iovs[3].iov_len = 0x800;
+	rc = nvme_rdma_build_sgl_inline_request(&rqpair, &rdma_req);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(bio.iovpos == 4);
+	CU_ASSERT(rdma_req.send_wr.num_sge == 1);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.type == SPDK_NVME_SGL_TYPE_LAST_SEGMENT);
+	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.length == 4 * sizeof(struct spdk_nvme_sgl_descriptor));
 }
 
 static void
@@ -823,6 +893,7 @@ test_nvme_rdma_req_init(void)
 	rqpair.rdma_qp = (struct spdk_rdma_qp *)0xdeadbeef;
 	rqpair.qpair.ctrlr = &ctrlr;
 	rqpair.cmds = &cmd;
+	rqpair.max_send_sge = NVME_RDMA_DEFAULT_TX_SGE;
 	cmd.sgl[0].address = 0x1111;
 	rdma_req.id = 0;
 	req.cmd.opc = SPDK_NVME_DATA_HOST_TO_CONTROLLER;
@@ -0,0 +1,448 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation. All rights reserved.
+ */
+
+#include "spdk_internal/cunit.h"
+
+#include "nvme/nvme_zns.c"
+
+#include "spdk_internal/mock.h"
+
+#define UT_ZONE_SIZE	64
+#define UT_NUM_ZONES	4
+#define UT_MAX_APPENDS	64
+
+pid_t g_spdk_nvme_pid;
+
+DEFINE_STUB(nvme_ns_cmd_zone_appendv_with_md, int,
+	    (struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair, uint64_t zslba,
+	     uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg, uint32_t io_flags,
+	     spdk_nvme_req_reset_sgl_cb reset_sgl_fn, spdk_nvme_req_next_sge_cb next_sge_fn,
+	     void *metadata, uint16_t apptag_mask, uint16_t apptag), 0);
+
+DEFINE_STUB(nvme_allocate_request_user_copy, struct nvme_request *,
+	    (struct spdk_nvme_qpair *qpair, void *buffer, uint32_t payload_size,
+	     spdk_nvme_cmd_cb cb_fn, void *cb_arg, bool host_to_controller), NULL);
+
+DEFINE_STUB(spdk_nvme_ns_get_format_index, uint32_t, (const struct spdk_nvme_ns_data *nsdata), 0);
+
+DEFINE_STUB(spdk_nvme_ns_get_sector_size, uint32_t, (struct spdk_nvme_ns *ns), 4096);
+
+const struct spdk_nvme_ns_data *
+spdk_nvme_ns_get_data(struct spdk_nvme_ns *ns)
+{
+	return &ns->nsdata;
+}
+
+uint64_t
+spdk_nvme_ns_get_num_sectors(struct spdk_nvme_ns *ns)
+{
+	return ns->nsdata.nsze;
+}
+
+struct ut_append {
+	uint64_t		zslba;
+	uint32_t		lba_count;
+	spdk_nvme_cmd_cb	cb_fn;
+	void			*cb_arg;
+};
+
+static struct ut_append g_appends[UT_MAX_APPENDS];
+static uint32_t g_num_appends;
+static uint64_t g_finished_zones[UT_NUM_ZONES];
+static uint32_t g_num_finished_zones;
+static struct nvme_request *g_finish_reqs[UT_NUM_ZONES];
+
+int
+nvme_ns_cmd_zone_append_with_md(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+				void *buffer, void *metadata, uint64_t zslba,
+				uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg,
+				uint32_t io_flags, uint16_t apptag_mask, uint16_t apptag)
+{
+	struct ut_append *append;
+
+	SPDK_CU_ASSERT_FATAL(g_num_appends < UT_MAX_APPENDS);
+
+	append = &g_appends[g_num_appends++];
+	append->zslba = zslba;
+	append->lba_count = lba_count;
+	append->cb_fn = cb_fn;
+	append->cb_arg = cb_arg;
+
+	return 0;
+}
+
+int
+nvme_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req)
+{
+	CU_ASSERT(req->cmd.opc == SPDK_NVME_OPC_ZONE_MGMT_SEND);
+	CU_ASSERT(req->cmd.cdw13 == SPDK_NVME_ZONE_FINISH);
+	SPDK_CU_ASSERT_FATAL(g_num_finished_zones < UT_NUM_ZONES);
+
+	g_finish_reqs[g_num_finished_zones] = req;
+	g_finished_zones[g_num_finished_zones++] = *(uint64_t *)&req->cmd.cdw10;
+
+	return 0;
+}
+
+static void
+ut_complete_finish(uint32_t idx)
+{
+	struct spdk_nvme_cpl cpl = {};
+	struct nvme_request *req = g_finish_reqs[idx];
+
+	SPDK_CU_ASSERT_FATAL(req != NULL);
+	g_finish_reqs[idx] = NULL;
+
+	req->cb_fn(req->cb_arg, &cpl);
+	STAILQ_INSERT_HEAD(&req->qpair->free_req, req, stailq);
+}
+
+/* Complete an append at the current write pointer of its zone. */
+static void
+ut_complete_append(uint32_t idx, uint64_t *write_pointers)
+{
+	struct spdk_nvme_cpl cpl = {};
+	struct ut_append *append = &g_appends[idx];
+	uint64_t zone = append->zslba / UT_ZONE_SIZE;
+
+	cpl.cdw0 = write_pointers[zone];
+	write_pointers[zone] += append->lba_count;
+
+	append->cb_fn(append->cb_arg, &cpl);
+}
+
+struct ut_write_ctx {
+	bool		done;
+	uint64_t	lba;
+	bool		success;
+};
+
+static void
+ut_write_done(void *cb_arg, uint64_t lba, const struct spdk_nvme_cpl *cpl)
+{
+	struct ut_write_ctx *ctx = cb_arg;
+
+	ctx->done = true;
+	ctx->lba = lba;
+	ctx->success = spdk_nvme_cpl_is_success(cpl);
+}
+
+static void
+ut_init_ns(struct spdk_nvme_ns *ns, struct spdk_nvme_zns_ns_data *nsdata_zns,
+	   struct spdk_nvme_qpair *qpair, struct nvme_request *reqs, uint32_t num_reqs)
+{
+	uint32_t i;
+
+	memset(ns, 0, sizeof(*ns));
+	memset(nsdata_zns, 0, sizeof(*nsdata_zns));
+	memset(qpair, 0, sizeof(*qpair));
+
+	ns->id = 1;
+	ns->csi = SPDK_NVME_CSI_ZNS;
+	ns->nsdata.nsze = UT_ZONE_SIZE * UT_NUM_ZONES;
+	ns->nsdata_zns = nsdata_zns;
+	nsdata_zns->lbafe[0].zsze = UT_ZONE_SIZE;
+	/* Maximum open resources, 0's based */
+	nsdata_zns->mor = 1;
+
+	STAILQ_INIT(&qpair->free_req);
+	for (i = 0; i < num_reqs; i++) {
+		reqs[i].qpair = qpair;
+		STAILQ_INSERT_TAIL(&qpair->free_req, &reqs[i], stailq);
+	}
+
+	g_num_appends = 0;
+	g_num_finished_zones = 0;
+	memset(g_finish_reqs, 0, sizeof(g_finish_reqs));
+}
+
+static void
+test_zns_stream_create(void)
+{
+	struct spdk_nvme_ns ns;
+	struct spdk_nvme_zns_ns_data nsdata_zns;
+	struct spdk_nvme_qpair qpair;
+	struct nvme_request reqs[4];
+	struct spdk_nvme_zns_stream_opts opts;
+	struct spdk_nvme_zns_stream *stream;
+
+	ut_init_ns(&ns, &nsdata_zns, &qpair, reqs, SPDK_COUNTOF(reqs));
+
+	/* The default number of open zones is limited by the namespace. */
+	spdk_nvme_zns_stream_get_default_opts(&ns, &opts, sizeof(opts));
+	CU_ASSERT(opts.max_open_zones == 2);
+	CU_ASSERT(opts.max_qd_per_zone == NVME_ZNS_STREAM_DEFAULT_QD_PER_ZONE);
+
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, NULL, 0);
+	SPDK_CU_ASSERT_FATAL(stream != NULL);
+	CU_ASSERT(stream->opts.num_zones == UT_NUM_ZONES);
+	CU_ASSERT(stream->opts.zone_capacity == UT_ZONE_SIZE);
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == 0);
+
+	/* First zone not aligned to a zone boundary */
+	opts.first_zone_slba = 1;
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	CU_ASSERT(stream == NULL);
+
+	/* Range past the end of the namespace */
+	opts.first_zone_slba = UT_ZONE_SIZE;
+	opts.num_zones = UT_NUM_ZONES;
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	CU_ASSERT(stream == NULL);
+
+	/* Zone capacity larger than the zone size */
+	opts.num_zones = 0;
+	opts.zone_capacity = UT_ZONE_SIZE + 1;
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	CU_ASSERT(stream == NULL);
+
+	/* Not a zoned namespace */
+	ns.csi = SPDK_NVME_CSI_NVM;
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, NULL, 0);
+	CU_ASSERT(stream == NULL);
+}
+
+static void
+test_zns_stream_write(void)
+{
+	struct spdk_nvme_ns ns;
+	struct spdk_nvme_zns_ns_data nsdata_zns;
+	struct spdk_nvme_qpair qpair;
+	struct nvme_request reqs[4];
+	struct spdk_nvme_zns_stream_opts opts;
+	struct spdk_nvme_zns_stream *stream;
+	struct ut_write_ctx ctx[8] = {};
+	uint64_t write_pointers[UT_NUM_ZONES];
+	uint32_t i;
+	int rc;
+
+	ut_init_ns(&ns, &nsdata_zns, &qpair, reqs, SPDK_COUNTOF(reqs));
+	for (i = 0; i < UT_NUM_ZONES; i++) {
+		write_pointers[i] = i * UT_ZONE_SIZE;
+	}
+
+	spdk_nvme_zns_stream_get_default_opts(&ns, &opts, sizeof(opts));
+	opts.max_open_zones = 2;
+	opts.max_qd_per_zone = 2;
+
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	SPDK_CU_ASSERT_FATAL(stream != NULL);
+
+	/* Writes larger than a zone are rejected. */
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, UT_ZONE_SIZE + 1, ut_write_done, &ctx[0], 0);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Writes are spread round-robin across two zones, two per zone. */
+	for (i = 0; i < 4; i++) {
+		rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 16, ut_write_done, &ctx[i], 0);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_num_appends == 4);
+	CU_ASSERT(g_appends[0].zslba == 0);
+	CU_ASSERT(g_appends[1].zslba == UT_ZONE_SIZE);
+	CU_ASSERT(g_appends[2].zslba == 0);
+	CU_ASSERT(g_appends[3].zslba == UT_ZONE_SIZE);
+
+	/* Both zones are at their maximum queue depth, the next writes are queued. */
+	for (i = 4; i < 8; i++) {
+		rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 16, ut_write_done, &ctx[i], 0);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_num_appends == 4);
+
+	/* The request pool of the stream is exhausted. */
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 16, ut_write_done, &ctx[0], 0);
+	CU_ASSERT(rc == -ENOMEM);
+
+	/* Completing an append reports its LBA and submits a queued write. */
+	ut_complete_append(0, write_pointers);
+	CU_ASSERT(ctx[0].done == true);
+	CU_ASSERT(ctx[0].success == true);
+	CU_ASSERT(ctx[0].lba == 0);
+	CU_ASSERT(g_num_appends == 5);
+	CU_ASSERT(g_appends[4].zslba == 0);
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == -EBUSY);
+
+	for (i = 1; i < 8; i++) {
+		ut_complete_append(i, write_pointers);
+		CU_ASSERT(ctx[i].done == true);
+		CU_ASSERT(ctx[i].success == true);
+	}
+	CU_ASSERT(g_num_appends == 8);
+	CU_ASSERT(ctx[1].lba == UT_ZONE_SIZE);
+	CU_ASSERT(ctx[2].lba == 16);
+	CU_ASSERT(ctx[3].lba == UT_ZONE_SIZE + 16);
+	CU_ASSERT(ctx[4].lba == 32);
+	CU_ASSERT(ctx[5].lba == UT_ZONE_SIZE + 32);
+	CU_ASSERT(ctx[6].lba == 48);
+	CU_ASSERT(ctx[7].lba == UT_ZONE_SIZE + 48);
+
+	/* Both zones were written up to their capacity and are full, no finish is needed. */
+	CU_ASSERT(g_num_finished_zones == 0);
+
+	/* The next writes go to zones 2 and 3. */
+	memset(ctx, 0, sizeof(ctx));
+	for (i = 0; i < 2; i++) {
+		rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 48, ut_write_done, &ctx[i], 0);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_num_appends == 10);
+	CU_ASSERT(g_appends[8].zslba == 2 * UT_ZONE_SIZE);
+	CU_ASSERT(g_appends[9].zslba == 3 * UT_ZONE_SIZE);
+	ut_complete_append(8, write_pointers);
+	ut_complete_append(9, write_pointers);
+	CU_ASSERT(ctx[0].lba == 2 * UT_ZONE_SIZE);
+	CU_ASSERT(ctx[1].lba == 3 * UT_ZONE_SIZE);
+
+	/*
+	 * Zones 2 and 3 have 16 sectors left. A 32 sector write does not fit, so both
+	 * are finished, and no zone is left for the write.
+	 */
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 32, ut_write_done, &ctx[2], 0);
+	CU_ASSERT(rc == -ENOSPC);
+	CU_ASSERT(g_num_finished_zones == 2);
+	CU_ASSERT(g_finished_zones[0] == 2 * UT_ZONE_SIZE || g_finished_zones[0] == 3 * UT_ZONE_SIZE);
+	CU_ASSERT(g_finished_zones[1] == 2 * UT_ZONE_SIZE || g_finished_zones[1] == 3 * UT_ZONE_SIZE);
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == -EBUSY);
+	ut_complete_finish(0);
+	ut_complete_finish(1);
+
+	/* Retired zones are not written again. */
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 16, ut_write_done, &ctx[3], 0);
+	CU_ASSERT(rc == -ENOSPC);
+
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == 0);
+}
+
+static void
+test_zns_stream_full(void)
+{
+	struct spdk_nvme_ns ns;
+	struct spdk_nvme_zns_ns_data nsdata_zns;
+	struct spdk_nvme_qpair qpair;
+	struct nvme_request reqs[4];
+	struct spdk_nvme_zns_stream_opts opts;
+	struct spdk_nvme_zns_stream *stream;
+	struct ut_write_ctx ctx[4] = {};
+	uint64_t write_pointers[UT_NUM_ZONES];
+	uint32_t i;
+	int rc;
+
+	ut_init_ns(&ns, &nsdata_zns, &qpair, reqs, SPDK_COUNTOF(reqs));
+	for (i = 0; i < UT_NUM_ZONES; i++) {
+		write_pointers[i] = i * UT_ZONE_SIZE;
+	}
+
+	spdk_nvme_zns_stream_get_default_opts(&ns, &opts, sizeof(opts));
+	opts.first_zone_slba = 2 * UT_ZONE_SIZE;
+	opts.max_open_zones = 1;
+	opts.max_qd_per_zone = 2;
+	opts.zone_capacity = UT_ZONE_SIZE / 2;
+
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	SPDK_CU_ASSERT_FATAL(stream != NULL);
+	CU_ASSERT(stream->opts.num_zones == 2);
+
+	/* Fill both zones of the stream, a zone written up to its capacity is not finished. */
+	for (i = 0; i < 2; i++) {
+		rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, UT_ZONE_SIZE / 2, ut_write_done,
+						&ctx[i], 0);
+		CU_ASSERT(rc == 0);
+		CU_ASSERT(g_num_appends == i + 1);
+		CU_ASSERT(g_appends[i].zslba == (2 + i) * UT_ZONE_SIZE);
+
+		ut_complete_append(i, write_pointers);
+		CU_ASSERT(ctx[i].done == true);
+		CU_ASSERT(ctx[i].lba == (2 + i) * UT_ZONE_SIZE);
+	}
+	CU_ASSERT(g_num_finished_zones == 0);
+
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 1, ut_write_done, &ctx[2], 0);
+	CU_ASSERT(rc == -ENOSPC);
+
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == 0);
+}
+
+static void
+test_zns_stream_finish_failure(void)
+{
+	struct spdk_nvme_ns ns;
+	struct spdk_nvme_zns_ns_data nsdata_zns;
+	struct spdk_nvme_qpair qpair;
+	struct nvme_request req = {};
+	struct spdk_nvme_zns_stream_opts opts;
+	struct spdk_nvme_zns_stream *stream;
+	struct ut_write_ctx ctx[2] = {};
+	uint64_t write_pointers[UT_NUM_ZONES];
+	uint32_t i;
+	int rc;
+
+	/* No request is available to submit a zone finish. */
+	ut_init_ns(&ns, &nsdata_zns, &qpair, NULL, 0);
+	for (i = 0; i < UT_NUM_ZONES; i++) {
+		write_pointers[i] = i * UT_ZONE_SIZE;
+	}
+
+	spdk_nvme_zns_stream_get_default_opts(&ns, &opts, sizeof(opts));
+	opts.max_open_zones = 1;
+	opts.max_qd_per_zone = 2;
+
+	stream = spdk_nvme_zns_stream_create(&ns, &qpair, &opts, sizeof(opts));
+	SPDK_CU_ASSERT_FATAL(stream != NULL);
+
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 48, ut_write_done, &ctx[0], 0);
+	CU_ASSERT(rc == 0);
+	ut_complete_append(0, write_pointers);
+	CU_ASSERT(ctx[0].done == true);
+
+	/* The next write does not fit, the zone finish cannot be submitted. The zone is
+	 * not reused and the error is returned. */
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 32, ut_write_done, &ctx[1], 0);
+	CU_ASSERT(rc == -ENOMEM);
+	CU_ASSERT(g_num_finished_zones == 0);
+	CU_ASSERT(g_num_appends == 1);
+	CU_ASSERT(stream->zones[0].state == NVME_ZNS_STREAM_ZONE_RETIRING);
+	CU_ASSERT(stream->zones[0].slba == 0);
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == -ENOMEM);
+
+	/* The finish is retried by the next write, which waits for it to complete. */
+	req.qpair = &qpair;
+	STAILQ_INSERT_TAIL(&qpair.free_req, &req, stailq);
+	rc = spdk_nvme_zns_stream_write(stream, NULL, NULL, 32, ut_write_done, &ctx[1], 0);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_num_finished_zones == 1);
+	CU_ASSERT(g_finished_zones[0] == 0);
+	CU_ASSERT(g_num_appends == 1);
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == -EBUSY);
+
+	ut_complete_finish(0);
+	CU_ASSERT(g_num_appends == 2);
+	CU_ASSERT(g_appends[1].zslba == UT_ZONE_SIZE);
+	ut_complete_append(1, write_pointers);
+	CU_ASSERT(ctx[1].done == true);
+	CU_ASSERT(ctx[1].success == true);
+	CU_ASSERT(ctx[1].lba == UT_ZONE_SIZE);
+
+	CU_ASSERT(spdk_nvme_zns_stream_free(stream) == 0);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("nvme_zns", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_zns_stream_create);
+	CU_ADD_TEST(suite, test_zns_stream_write);
+	CU_ADD_TEST(suite, test_zns_stream_full);
+	CU_ADD_TEST(suite, test_zns_stream_finish_failure);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+	return num_failures;
+}
@@ -115,6 +115,11 @@ DEFINE_STUB(nvmf_bdev_ctrlr_read_cmd,
 	     struct spdk_nvmf_request *req),
 	    0);
 
+DEFINE_STUB(nvmf_poll_group_get_ns_io_stat,
+	    struct spdk_nvmf_ns_io_stat *,
+	    (struct spdk_nvmf_subsystem_poll_group *sgroup, uint32_t nsid, const char *hostnqn),
+	    NULL);
+
 DEFINE_STUB(nvmf_bdev_ctrlr_write_cmd,
 	    int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
@@ -163,10 +168,21 @@ DEFINE_STUB(nvmf_bdev_ctrlr_nvme_passthru_io,
 	     struct spdk_nvmf_request *req),
 	    0);
 
-DEFINE_STUB(nvmf_transport_req_complete,
-	    int,
-	    (struct spdk_nvmf_request *req),
-	    0);
+static bool g_reuse_req_on_complete;
+
+int
+nvmf_transport_req_complete(struct spdk_nvmf_request *req)
+{
+	/* The transport may hand the request to a new command as soon as it completed it */
+	if (g_reuse_req_on_complete) {
+		req->cmd->nvme_cmd.opc = SPDK_NVME_OPC_WRITE_ZEROES;
+		req->length = 0;
+		req->rsp->nvme_cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+		req->rsp->nvme_cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+	}
+
+	return 0;
+}
 
 DEFINE_STUB_V(nvmf_ns_reservation_request, (void *ctx));
 
@@ -1085,6 +1101,45 @@ test_identify_ns(void)
 	CU_ASSERT(spdk_mem_all_zero(&nsdata, sizeof(nsdata)));
 }
 
+static void
+test_identify_ns_cached(void)
+{
+	struct spdk_nvmf_subsystem subsystem = {};
+	struct spdk_nvmf_transport transport = {};
+	struct spdk_nvmf_qpair admin_qpair = { .transport = &transport};
+	struct spdk_nvmf_ctrlr ctrlr = { .subsys = &subsystem, .admin_qpair = &admin_qpair };
+	struct spdk_nvme_cmd cmd = { .nsid = 1 };
+	struct spdk_nvme_cpl rsp = {};
+	struct spdk_nvme_ns_data nsdata = {}, identify_data = {};
+	struct spdk_bdev bdev = { .blockcnt = 1234 };
+	struct spdk_nvmf_ns ns = { .bdev = &bdev, .identify_data = &identify_data };
+	struct spdk_nvmf_ns *ns_arr[1] = {&ns};
+
+	subsystem.ns = ns_arr;
+	subsystem.max_nsid = SPDK_COUNTOF(ns_arr);
+
+	/* Precomputed data is returned instead of querying the bdev */
+	identify_data.nsze = 4321;
+	CU_ASSERT(spdk_nvmf_ctrlr_identify_ns(&ctrlr, &cmd, &rsp,
+					      &nsdata) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.status.sc == SPDK_NVME_SC_SUCCESS);
+	CU_ASSERT(nsdata.nsze == 4321);
+
+	/* Without metadata, DIF insert/strip doesn't change anything */
+	ctrlr.dif_insert_or_strip = true;
+	memset(&nsdata, 0, sizeof(nsdata));
+	CU_ASSERT(spdk_nvmf_ctrlr_identify_ns(&ctrlr, &cmd, &rsp,
+					      &nsdata) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(nsdata.nsze == 4321);
+
+	/* With metadata, it has to be built for this controller */
+	identify_data.lbaf[0].ms = 8;
+	memset(&nsdata, 0, sizeof(nsdata));
+	CU_ASSERT(spdk_nvmf_ctrlr_identify_ns(&ctrlr, &cmd, &rsp,
+					      &nsdata) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(nsdata.nsze == 1234);
+}
+
 static void
 test_identify_ns_iocs_specific(void)
 {
@@ -1940,6 +1995,287 @@ test_fused_compare_and_write(void)
 	CU_ASSERT(qpair.first_fused_req == NULL);
 }
 
+static void
+ut_ns_paused_cb(void *cb_arg, int status)
+{
+	int *rc = cb_arg;
+
+	*rc = status;
+}
+
+static void
+test_ns_pause_completion(void)
+{
+	struct spdk_nvmf_request req = {}, req2 = {}, admin_req = {};
+	struct spdk_nvmf_qpair qpair = {}, admin_qpair = {};
+	struct spdk_nvme_cmd cmd = {}, cmd2 = {}, admin_cmd = {};
+	union nvmf_c2h_msg rsp = {}, rsp2 = {}, admin_rsp = {};
+	struct spdk_nvmf_ctrlr ctrlr = {};
+	struct spdk_nvmf_subsystem subsystem = {};
+	struct spdk_nvmf_ns ns = {};
+	struct spdk_nvmf_ns *subsys_ns[1] = {};
+	enum spdk_nvme_ana_state ana_state[1];
+	struct spdk_nvmf_subsystem_listener listener = { .ana_state = ana_state };
+	struct spdk_bdev bdev = {};
+	struct spdk_nvmf_poll_group group = {};
+	struct spdk_nvmf_subsystem_poll_group sgroups = {};
+	struct spdk_nvmf_subsystem_pg_ns_info ns_info = {};
+	struct spdk_io_channel io_ch = {};
+	int paused_rc = -1;
+
+	ns.bdev = &bdev;
+	ns.anagrpid = 1;
+
+	subsystem.id = 0;
+	subsystem.max_nsid = 1;
+	subsys_ns[0] = &ns;
+	subsystem.ns = (struct spdk_nvmf_ns **)&subsys_ns;
+
+	listener.ana_state[0] = SPDK_NVME_ANA_OPTIMIZED_STATE;
+
+	ctrlr.vcprop.cc.bits.en = 1;
+	ctrlr.subsys = &subsystem;
+	ctrlr.listener = &listener;
+
+	group.thread = spdk_get_thread();
+	group.num_sgroups = 1;
+	sgroups.state = SPDK_NVMF_SUBSYSTEM_ACTIVE;
+	sgroups.num_ns = 1;
+	ns_info.state = SPDK_NVMF_SUBSYSTEM_ACTIVE;
+	ns_info.channel = &io_ch;
+	sgroups.ns_info = &ns_info;
+	TAILQ_INIT(&sgroups.queued);
+	group.sgroups = &sgroups;
+
+	TAILQ_INIT(&qpair.outstanding);
+	qpair.ctrlr = &ctrlr;
+	qpair.group = &group;
+	qpair.qid = 1;
+	qpair.state = SPDK_NVMF_QPAIR_ACTIVE;
+
+	TAILQ_INIT(&admin_qpair.outstanding);
+	admin_qpair.ctrlr = &ctrlr;
+	admin_qpair.group = &group;
+	admin_qpair.qid = 0;
+	admin_qpair.state = SPDK_NVMF_QPAIR_ACTIVE;
+
+	cmd.opc = SPDK_NVME_OPC_READ;
+	cmd.nsid = 1;
+	req.qpair = &qpair;
+	req.cmd = (union nvmf_h2c_msg *)&cmd;
+	req.rsp = &rsp;
+
+	cmd2 = cmd;
+	req2.qpair = &qpair;
+	req2.cmd = (union nvmf_h2c_msg *)&cmd2;
+	req2.rsp = &rsp2;
+
+	admin_cmd.opc = SPDK_NVME_OPC_IDENTIFY;
+	admin_cmd.nsid = 1;
+	admin_cmd.cdw10_bits.identify.cns = SPDK_NVME_IDENTIFY_NS;
+	admin_req.qpair = &admin_qpair;
+	admin_req.cmd = (union nvmf_h2c_msg *)&admin_cmd;
+	admin_req.rsp = &admin_rsp;
+
+	/* Start a read that stays outstanding */
+	MOCK_SET(nvmf_bdev_ctrlr_read_cmd, SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS);
+	spdk_nvmf_request_exec(&req);
+	CU_ASSERT(ns_info.io_outstanding == 1);
+
+	/* Pause only the namespace, as nvmf_poll_group_pause_subsystem() does for a single NSID */
+	ns_info.state = SPDK_NVMF_SUBSYSTEM_PAUSING;
+	sgroups.cb_fn = ut_ns_paused_cb;
+	sgroups.cb_arg = &paused_rc;
+
+	/* New I/O and admin commands to the namespace are queued */
+	spdk_nvmf_request_exec(&req2);
+	spdk_nvmf_request_exec(&admin_req);
+	CU_ASSERT(TAILQ_FIRST(&sgroups.queued) == &req2);
+	CU_ASSERT(TAILQ_NEXT(&req2, link) == &admin_req);
+	CU_ASSERT(ns_info.io_outstanding == 1);
+	CU_ASSERT(sgroups.mgmt_io_outstanding == 0);
+
+	/* The rest of the subsystem stays active */
+	CU_ASSERT(sgroups.state == SPDK_NVMF_SUBSYSTEM_ACTIVE);
+	CU_ASSERT(paused_rc == -1);
+
+	/* Completing the last read finishes the pause */
+	_nvmf_request_complete(&req);
+	CU_ASSERT(ns_info.io_outstanding == 0);
+	CU_ASSERT(ns_info.state == SPDK_NVMF_SUBSYSTEM_PAUSED);
+	CU_ASSERT(sgroups.state == SPDK_NVMF_SUBSYSTEM_ACTIVE);
+	CU_ASSERT(paused_rc == 0);
+	CU_ASSERT(sgroups.cb_fn == NULL);
+	CU_ASSERT(sgroups.cb_arg == NULL);
+
+	MOCK_CLEAR(nvmf_bdev_ctrlr_read_cmd);
+}
+
+static void
+test_ns_io_stats(void)
+{
+	struct spdk_nvmf_request req = {};
+	struct spdk_nvmf_qpair qpair = {};
+	struct spdk_nvme_cmd cmd = {};
+	union nvmf_c2h_msg rsp = {};
+	struct spdk_nvmf_ctrlr ctrlr = {};
+	struct spdk_nvmf_subsystem subsystem = {};
+	struct spdk_nvmf_ns ns = {};
+	struct spdk_nvmf_ns *subsys_ns[1] = {};
+	enum spdk_nvme_ana_state ana_state[1];
+	struct spdk_nvmf_subsystem_listener listener = { .ana_state = ana_state };
+	struct spdk_bdev bdev = {};
+	struct spdk_nvmf_poll_group group = {};
+	struct spdk_nvmf_subsystem_poll_group sgroups = {};
+	struct spdk_nvmf_subsystem_pg_ns_info ns_info = {};
+	struct spdk_io_channel io_ch = {};
+	struct spdk_nvmf_ns_io_stat stat = {};
+
+	stat.nsid = 1;
+	stat.latency = spdk_histogram_data_alloc_sized(NVMF_IO_STAT_HISTOGRAM_BUCKET_SHIFT);
+	SPDK_CU_ASSERT_FATAL(stat.latency != NULL);
+	MOCK_SET(nvmf_poll_group_get_ns_io_stat, &stat);
+
+	ns.bdev = &bdev;
+	ns.anagrpid = 1;
+
+	subsystem.id = 0;
+	subsystem.max_nsid = 1;
+	subsys_ns[0] = &ns;
+	subsystem.ns = (struct spdk_nvmf_ns **)&subsys_ns;
+
+	listener.ana_state[0] = SPDK_NVME_ANA_OPTIMIZED_STATE;
+
+	ctrlr.vcprop.cc.bits.en = 1;
+	ctrlr.subsys = &subsystem;
+	ctrlr.listener = &listener;
+	snprintf(ctrlr.hostnqn, sizeof(ctrlr.hostnqn), "nqn.2016-06.io.spdk:host1");
+
+	group.thread = spdk_get_thread();
+	group.num_sgroups = 1;
+	sgroups.state = SPDK_NVMF_SUBSYSTEM_ACTIVE;
+	sgroups.num_ns = 1;
+	ns_info.state = SPDK_NVMF_SUBSYSTEM_ACTIVE;
+	ns_info.channel = &io_ch;
+	sgroups.ns_info = &ns_info;
+	TAILQ_INIT(&sgroups.queued);
+	group.sgroups = &sgroups;
+
+	TAILQ_INIT(&qpair.outstanding);
+	qpair.ctrlr = &ctrlr;
+	qpair.group = &group;
+	qpair.qid = 1;
+	qpair.state = SPDK_NVMF_QPAIR_ACTIVE;
+
+	cmd.nsid = 1;
+	req.qpair = &qpair;
+	req.cmd = (union nvmf_h2c_msg *)&cmd;
+	req.rsp = &rsp;
+	req.length = 4096;
+
+	/*
+	 * A successful read is counted along with its length, even if the request is reused as
+	 * soon as the transport completed it.
+	 */
+	cmd.opc = SPDK_NVME_OPC_READ;
+	MOCK_SET(nvmf_bdev_ctrlr_read_cmd, SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS);
+	spdk_nvmf_request_exec(&req);
+	g_reuse_req_on_complete = true;
+	_nvmf_request_complete(&req);
+	g_reuse_req_on_complete = false;
+	CU_ASSERT(stat.num_read_ops == 1);
+	CU_ASSERT(stat.num_other_ops == 0);
+	CU_ASSERT(stat.bytes_read == 4096);
+	CU_ASSERT(stat.num_errors == 0);
+	req.length = 4096;
+	memset(&rsp, 0, sizeof(rsp));
+	SPDK_CU_ASSERT_FATAL(qpair.ns_io_stats != NULL);
+	CU_ASSERT(qpair.num_ns_io_stats == 1);
+	CU_ASSERT(qpair.ns_io_stats[0] == &stat);
+	MOCK_CLEAR(nvmf_bdev_ctrlr_read_cmd);
+
+	/* A failed write counts as an error, without bytes */
+	cmd.opc = SPDK_NVME_OPC_WRITE;
+	MOCK_SET(nvmf_bdev_ctrlr_write_cmd, SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS);
+	spdk_nvmf_request_exec(&req);
+	rsp.nvme_cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+	rsp.nvme_cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+	_nvmf_request_complete(&req);
+	CU_ASSERT(stat.num_write_ops == 1);
+	CU_ASSERT(stat.bytes_written == 0);
+	CU_ASSERT(stat.num_errors == 1);
+	MOCK_CLEAR(nvmf_bdev_ctrlr_write_cmd);
+
+	/* The namespace grows, the cached statistics follow */
+	subsystem.max_nsid = 2;
+	sgroups.num_ns = 2;
+	sgroups.ns_info = calloc(2, sizeof(*sgroups.ns_info));
+	SPDK_CU_ASSERT_FATAL(sgroups.ns_info != NULL);
+	sgroups.ns_info[0] = ns_info;
+	sgroups.ns_info[1] = ns_info;
+	subsystem.ns = calloc(2, sizeof(*subsystem.ns));
+	SPDK_CU_ASSERT_FATAL(subsystem.ns != NULL);
+	subsystem.ns[0] = &ns;
+	subsystem.ns[1] = &ns;
+
+	cmd.nsid = 2;
+	cmd.opc = SPDK_NVME_OPC_FLUSH;
+	memset(&rsp, 0, sizeof(rsp));
+	MOCK_SET(nvmf_bdev_ctrlr_flush_cmd, SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS);
+	spdk_nvmf_request_exec(&req);
+	_nvmf_request_complete(&req);
+	CU_ASSERT(stat.num_other_ops == 1);
+	CU_ASSERT(stat.num_errors == 1);
+	CU_ASSERT(qpair.num_ns_io_stats == 2);
+	CU_ASSERT(qpair.ns_io_stats[0] == &stat);
+	CU_ASSERT(qpair.ns_io_stats[1] == &stat);
+	MOCK_CLEAR(nvmf_bdev_ctrlr_flush_cmd);
+
+	free(subsystem.ns);
+	free(sgroups.ns_info);
+	free(qpair.ns_io_stats);
+	spdk_histogram_data_free(stat.latency);
+	MOCK_CLEAR_P(nvmf_poll_group_get_ns_io_stat);
+}
+
+static void
+test_ns_changed(void)
+{
+	struct spdk_nvmf_ctrlr ctrlr = {};
+	struct iovec iov;
+	uint32_t ns_list[4];
+	uint32_t i;
+
+	ctrlr.thread = spdk_get_thread();
+
+	/* The list is only updated on the controller's thread */
+	nvmf_ctrlr_ns_changed(&ctrlr, 5);
+	nvmf_ctrlr_ns_changed(&ctrlr, 3);
+	nvmf_ctrlr_ns_changed(&ctrlr, 5);
+	CU_ASSERT(ctrlr.changed_ns_list_count == 0);
+	poll_threads();
+	CU_ASSERT(ctrlr.changed_ns_list_count == 2);
+	CU_ASSERT(ctrlr.changed_ns_list.ns_list[0] == 5);
+	CU_ASSERT(ctrlr.changed_ns_list.ns_list[1] == 3);
+
+	/* Reading the log page clears it */
+	iov.iov_base = ns_list;
+	iov.iov_len = sizeof(ns_list);
+	nvmf_get_changed_ns_list_log_page(&ctrlr, &iov, 1, 0, sizeof(ns_list), 1);
+	CU_ASSERT(ns_list[0] == 5);
+	CU_ASSERT(ns_list[1] == 3);
+	CU_ASSERT(ns_list[2] == 0);
+	CU_ASSERT(ctrlr.changed_ns_list_count == 0);
+
+	/* Too many changes are reported as FFFFFFFFh */
+	for (i = 0; i <= SPDK_COUNTOF(ctrlr.changed_ns_list.ns_list); i++) {
+		nvmf_ctrlr_ns_changed(&ctrlr, i + 1);
+	}
+	poll_threads();
+	CU_ASSERT(ctrlr.changed_ns_list.ns_list[0] == 0xFFFFFFFFu);
+	CU_ASSERT(ctrlr.changed_ns_list.ns_list[1] == 0);
+}
+
 static void
 test_multi_async_event_reqs(void)
 {
@@ -2196,6 +2532,127 @@ test_get_ana_log_page_multi_ns_per_anagrp(void)
 
 #undef UT_ANA_LOG_PAGE_SIZE
 }
+
+static void
+test_get_ana_log_page_precomputed(void)
+{
+	uint32_t ana_group[1] = {1};
+	struct spdk_nvmf_subsystem subsystem = { .ana_group = ana_group, .max_nsid = 1 };
+	enum spdk_nvme_ana_state ana_state[1] = {SPDK_NVME_ANA_OPTIMIZED_STATE};
+	struct spdk_nvmf_subsystem_listener listener = { .ana_state = ana_state };
+	struct spdk_nvmf_ctrlr ctrlr = { .subsys = &subsystem, .listener = &listener };
+	struct nvmf_ana_log_page *ana_log_page;
+	char *page, actual_page[64];
+	struct iovec iov;
+	uint32_t i;
+
+	ana_log_page = calloc(1, sizeof(*ana_log_page) + 64);
+	SPDK_CU_ASSERT_FATAL(ana_log_page != NULL);
+	ana_log_page->len = 64;
+	page = (char *)ana_log_page->data;
+	for (i = 0; i < 64; i++) {
+		page[i] = i + 1;
+	}
+
+	/* The precomputed page is returned as is */
+	listener.ana_log_page = ana_log_page;
+
+	memset(actual_page, 0, sizeof(actual_page));
+	iov.iov_base = actual_page;
+	iov.iov_len = sizeof(actual_page);
+	nvmf_get_ana_log_page(&ctrlr, &iov, 1, 0, sizeof(actual_page), 0);
+	CU_ASSERT(memcmp(page, actual_page, 64) == 0);
+
+	/* Partial read from an offset */
+	memset(actual_page, 0, sizeof(actual_page));
+	nvmf_get_ana_log_page(&ctrlr, &iov, 1, 40, 16, 0);
+	CU_ASSERT(memcmp(&page[40], actual_page, 16) == 0);
+	CU_ASSERT(spdk_mem_all_zero(&actual_page[16], sizeof(actual_page) - 16));
+
+	/* Read past the end of the page */
+	memset(actual_page, 0, sizeof(actual_page));
+	nvmf_get_ana_log_page(&ctrlr, &iov, 1, 56, 32, 0);
+	CU_ASSERT(memcmp(&page[56], actual_page, 8) == 0);
+	CU_ASSERT(spdk_mem_all_zero(&actual_page[8], sizeof(actual_page) - 8));
+
+	memset(actual_page, 0, sizeof(actual_page));
+	nvmf_get_ana_log_page(&ctrlr, &iov, 1, 64, 16, 0);
+	CU_ASSERT(spdk_mem_all_zero(actual_page, sizeof(actual_page)));
+
+	free(ana_log_page);
+}
+
+static void
+test_nvmf_ctrlr_build_ana_log_page(void)
+{
+	struct spdk_nvmf_ns ns[5] = {};
+	struct spdk_nvmf_ns *ns_arr[5] = {&ns[0], &ns[1], &ns[2], &ns[3], &ns[4]};
+	uint32_t ana_group[5] = {0, 3, 2, 0, 0};
+	struct spdk_nvmf_subsystem subsystem = { .ns = ns_arr, .ana_group = ana_group, .max_nsid = 5 };
+	enum spdk_nvme_ana_state ana_state[5];
+	struct spdk_nvmf_subsystem_listener listener = { .ana_state = ana_state };
+	struct spdk_nvme_ana_page *ana_hdr;
+	struct spdk_nvme_ana_group_descriptor *ana_desc;
+	struct nvmf_ana_log_page *page;
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		ns[i].nsid = i + 1;
+		ns[i].opts.nsid = i + 1;
+		ana_state[i] = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	}
+	ns[0].anagrpid = 2;
+	ns[1].anagrpid = 3;
+	ns[2].anagrpid = 2;
+	ns[3].anagrpid = 3;
+	ns[4].anagrpid = 2;
+	ana_state[2] = SPDK_NVME_ANA_INACCESSIBLE_STATE;
+	listener.ana_state_change_count = 7;
+	subsystem.flags.ana_reporting = true;
+
+	page = nvmf_ctrlr_build_ana_log_page(&subsystem, &listener);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+	CU_ASSERT(page->len == sizeof(*ana_hdr) + 2 * sizeof(*ana_desc) + 5 * sizeof(uint32_t));
+
+	ana_hdr = (void *)page->data;
+	CU_ASSERT(ana_hdr->num_ana_group_desc == 2);
+	CU_ASSERT(ana_hdr->change_count == 7);
+
+	ana_desc = (void *)(page->data + sizeof(*ana_hdr));
+	CU_ASSERT(ana_desc->ana_group_id == 2);
+	CU_ASSERT(ana_desc->num_of_nsid == 3);
+	CU_ASSERT(ana_desc->ana_state == SPDK_NVME_ANA_OPTIMIZED_STATE);
+	CU_ASSERT(ana_desc->nsid[0] == 1);
+	CU_ASSERT(ana_desc->nsid[1] == 3);
+	CU_ASSERT(ana_desc->nsid[2] == 5);
+
+	ana_desc = (void *)&ana_desc->nsid[3];
+	CU_ASSERT(ana_desc->ana_group_id == 3);
+	CU_ASSERT(ana_desc->num_of_nsid == 2);
+	CU_ASSERT(ana_desc->ana_state == SPDK_NVME_ANA_INACCESSIBLE_STATE);
+	CU_ASSERT(ana_desc->nsid[0] == 2);
+	CU_ASSERT(ana_desc->nsid[1] == 4);
+	free(page);
+
+	/* Without a listener, every group is reported inaccessible */
+	page = nvmf_ctrlr_build_ana_log_page(&subsystem, NULL);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+	ana_hdr = (void *)page->data;
+	CU_ASSERT(ana_hdr->change_count == 0);
+	ana_desc = (void *)(page->data + sizeof(*ana_hdr));
+	CU_ASSERT(ana_desc->ana_state == SPDK_NVME_ANA_INACCESSIBLE_STATE);
+	free(page);
+
+	/* Without ANA reporting, every group is reported optimized */
+	subsystem.flags.ana_reporting = false;
+	page = nvmf_ctrlr_build_ana_log_page(&subsystem, &listener);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+	ana_desc = (void *)(page->data + sizeof(*ana_hdr) + sizeof(*ana_desc) + 3 * sizeof(uint32_t));
+	CU_ASSERT(ana_desc->ana_group_id == 3);
+	CU_ASSERT(ana_desc->ana_state == SPDK_NVME_ANA_OPTIMIZED_STATE);
+	free(page);
+}
+
 static void
 test_multi_async_events(void)
 {
@@ -3074,6 +3531,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_connect);
 	CU_ADD_TEST(suite, test_get_ns_id_desc_list);
 	CU_ADD_TEST(suite, test_identify_ns);
+	CU_ADD_TEST(suite, test_identify_ns_cached);
 	CU_ADD_TEST(suite, test_identify_ns_iocs_specific);
 	CU_ADD_TEST(suite, test_reservation_write_exclusive);
 	CU_ADD_TEST(suite, test_reservation_exclusive_access);
@@ -3086,9 +3544,14 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_identify_ctrlr_iocs_specific);
 	CU_ADD_TEST(suite, test_custom_admin_cmd);
 	CU_ADD_TEST(suite, test_fused_compare_and_write);
+	CU_ADD_TEST(suite, test_ns_pause_completion);
+	CU_ADD_TEST(suite, test_ns_io_stats);
+	CU_ADD_TEST(suite, test_ns_changed);
 	CU_ADD_TEST(suite, test_multi_async_event_reqs);
 	CU_ADD_TEST(suite, test_get_ana_log_page_one_ns_per_anagrp);
 	CU_ADD_TEST(suite, test_get_ana_log_page_multi_ns_per_anagrp);
+	CU_ADD_TEST(suite, test_get_ana_log_page_precomputed);
+	CU_ADD_TEST(suite, test_nvmf_ctrlr_build_ana_log_page);
 	CU_ADD_TEST(suite, test_multi_async_events);
 	CU_ADD_TEST(suite, test_rae);
 	CU_ADD_TEST(suite, test_nvmf_ctrlr_create_destruct);
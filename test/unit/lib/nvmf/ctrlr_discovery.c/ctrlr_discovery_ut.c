@@ -19,6 +19,9 @@ SPDK_LOG_REGISTER_COMPONENT(nvmf)
 DEFINE_STUB_V(spdk_bdev_module_release_bdev,
 	      (struct spdk_bdev *bdev));
 
+DEFINE_STUB_V(nvmf_bdev_ctrlr_identify_ns,
+	      (struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *nsdata, bool dif_insert_or_strip));
+
 DEFINE_STUB(spdk_bdev_get_block_size, uint32_t,
 	    (const struct spdk_bdev *bdev), 512);
 
@@ -72,6 +75,9 @@ DEFINE_STUB(spdk_nvmf_request_complete, int,
 
 DEFINE_STUB(nvmf_ctrlr_async_event_ana_change_notice, int,
 	    (struct spdk_nvmf_ctrlr *ctrlr), 0);
+DEFINE_STUB(nvmf_ctrlr_build_ana_log_page, struct nvmf_ana_log_page *,
+	    (struct spdk_nvmf_subsystem *subsystem,
+	     const struct spdk_nvmf_subsystem_listener *listener), NULL);
 
 DEFINE_STUB(spdk_nvme_transport_id_trtype_str, const char *,
 	    (enum spdk_nvme_transport_type trtype), NULL);
@@ -49,12 +49,17 @@ DEFINE_STUB(spdk_bdev_module_claim_bdev, int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 	     struct spdk_bdev_module *module), 0);
 DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB_V(nvmf_bdev_ctrlr_identify_ns, (struct spdk_nvmf_ns *ns,
+		struct spdk_nvme_ns_data *nsdata, bool dif_insert_or_strip));
 DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
 DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 1024);
 
 DEFINE_STUB(nvmf_ctrlr_async_event_ns_notice, int, (struct spdk_nvmf_ctrlr *ctrlr), 0);
 DEFINE_STUB(nvmf_ctrlr_async_event_ana_change_notice, int,
 	    (struct spdk_nvmf_ctrlr *ctrlr), 0);
+DEFINE_STUB(nvmf_ctrlr_build_ana_log_page, struct nvmf_ana_log_page *,
+	    (struct spdk_nvmf_subsystem *subsystem,
+	     const struct spdk_nvmf_subsystem_listener *listener), NULL);
 DEFINE_STUB_V(spdk_nvme_trid_populate_transport, (struct spdk_nvme_transport_id *trid,
 		enum spdk_nvme_transport_type trtype));
 DEFINE_STUB(spdk_nvmf_request_complete, int, (struct spdk_nvmf_request *req),
@@ -213,6 +213,68 @@ test_nvmf_tgt_create_poll_group(void)
 	MOCK_CLEAR(spdk_bdev_get_io_channel);
 }
 
+static void
+test_nvmf_poll_group_ns_io_stats(void)
+{
+	struct spdk_nvmf_subsystem_poll_group sgroup = {};
+	struct spdk_nvmf_ns_io_stat *stat1, *stat2, *stat3;
+	struct spdk_nvmf_ns_io_stat *stats[2 * NVMF_IO_STAT_HASH_BUCKETS];
+	char hostnqn[SPDK_NVMF_NQN_MAX_LEN + 1];
+	int i;
+
+	TAILQ_INIT(&sgroup.io_stats);
+
+	/* First lookup creates the entry, the second one returns it */
+	stat1 = nvmf_poll_group_get_ns_io_stat(&sgroup, 1, "nqn.2016-06.io.spdk:host1");
+	SPDK_CU_ASSERT_FATAL(stat1 != NULL);
+	CU_ASSERT(stat1->nsid == 1);
+	CU_ASSERT(strcmp(stat1->hostnqn, "nqn.2016-06.io.spdk:host1") == 0);
+	CU_ASSERT(stat1->latency != NULL);
+	CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 1, "nqn.2016-06.io.spdk:host1") == stat1);
+
+	/* Another host or another namespace gets its own entry */
+	stat2 = nvmf_poll_group_get_ns_io_stat(&sgroup, 1, "nqn.2016-06.io.spdk:host2");
+	SPDK_CU_ASSERT_FATAL(stat2 != NULL);
+	CU_ASSERT(stat2 != stat1);
+	stat3 = nvmf_poll_group_get_ns_io_stat(&sgroup, 2, "nqn.2016-06.io.spdk:host1");
+	SPDK_CU_ASSERT_FATAL(stat3 != NULL);
+	CU_ASSERT(stat3 != stat1 && stat3 != stat2);
+
+	/* Resetting a namespace only clears its own entries */
+	stat1->num_read_ops = 4;
+	stat1->bytes_read = 16384;
+	stat1->num_errors = 1;
+	spdk_histogram_data_tally(stat1->latency, 100);
+	stat2->num_write_ops = 2;
+	stat3->num_other_ops = 3;
+
+	nvmf_poll_group_reset_ns_io_stats(&sgroup, 1);
+	CU_ASSERT(stat1->num_read_ops == 0);
+	CU_ASSERT(stat1->bytes_read == 0);
+	CU_ASSERT(stat1->num_errors == 0);
+	CU_ASSERT(stat2->num_write_ops == 0);
+	CU_ASSERT(stat3->num_other_ops == 3);
+	CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 1, "nqn.2016-06.io.spdk:host1") == stat1);
+
+	/* Entries of many hosts are all kept and still found, whichever bucket they land in */
+	for (i = 0; i < 2 * NVMF_IO_STAT_HASH_BUCKETS; i++) {
+		snprintf(hostnqn, sizeof(hostnqn), "nqn.2016-06.io.spdk:host-%d", i);
+		stats[i] = nvmf_poll_group_get_ns_io_stat(&sgroup, 1, hostnqn);
+		SPDK_CU_ASSERT_FATAL(stats[i] != NULL);
+	}
+	for (i = 0; i < 2 * NVMF_IO_STAT_HASH_BUCKETS; i++) {
+		snprintf(hostnqn, sizeof(hostnqn), "nqn.2016-06.io.spdk:host-%d", i);
+		CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 1, hostnqn) == stats[i]);
+		CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 2, hostnqn) != stats[i]);
+	}
+	CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 1, "nqn.2016-06.io.spdk:host2") == stat2);
+	CU_ASSERT(nvmf_poll_group_get_ns_io_stat(&sgroup, 2, "nqn.2016-06.io.spdk:host1") == stat3);
+
+	nvmf_poll_group_free_ns_io_stats(&sgroup);
+	CU_ASSERT(TAILQ_EMPTY(&sgroup.io_stats));
+	CU_ASSERT(sgroup.io_stats_hash == NULL);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -224,6 +286,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("nvmf", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_nvmf_tgt_create_poll_group);
+	CU_ADD_TEST(suite, test_nvmf_poll_group_ns_io_stats);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
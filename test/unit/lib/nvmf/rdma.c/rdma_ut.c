@@ -1335,6 +1335,57 @@ test_nvmf_rdma_qpair_compare(void)
 	CU_ASSERT(nvmf_rdma_qpair_compare(&rqpair2, &rqpair1) > 0);
 }
 
+static void
+test_nvmf_rdma_poller_adapt_cq_polling(void)
+{
+	struct spdk_nvmf_rdma_poller rpoller = {};
+	int i;
+
+	rpoller.cq_poll_batch = NVMF_RDMA_CQ_POLL_BATCH_DEFAULT;
+	rpoller.cq_poll_interval = 1;
+
+	/* Full batches grow the batch size up to the maximum */
+	nvmf_rdma_poller_adapt_cq_polling(&rpoller, NVMF_RDMA_CQ_POLL_BATCH_DEFAULT, 1);
+	CU_ASSERT(rpoller.cq_poll_batch == NVMF_RDMA_CQ_POLL_BATCH_DEFAULT * 2);
+	nvmf_rdma_poller_adapt_cq_polling(&rpoller, rpoller.cq_poll_batch, 1);
+	nvmf_rdma_poller_adapt_cq_polling(&rpoller, rpoller.cq_poll_batch, 1);
+	CU_ASSERT(rpoller.cq_poll_batch == NVMF_RDMA_CQ_POLL_BATCH_MAX);
+
+	/* Moderately filled batches keep it */
+	nvmf_rdma_poller_adapt_cq_polling(&rpoller, NVMF_RDMA_CQ_POLL_BATCH_MAX / 2, 1);
+	CU_ASSERT(rpoller.cq_poll_batch == NVMF_RDMA_CQ_POLL_BATCH_MAX);
+
+	/* Nearly empty ones shrink it down to the minimum */
+	for (i = 0; i < 8; i++) {
+		nvmf_rdma_poller_adapt_cq_polling(&rpoller, 1, 1);
+	}
+	CU_ASSERT(rpoller.cq_poll_batch == NVMF_RDMA_CQ_POLL_BATCH_MIN);
+
+	/* With max_cq_poll_interval == 1 an idle CQ is still polled every time */
+	for (i = 0; i < NVMF_RDMA_CQ_IDLE_POLLS_BEFORE_BACKOFF; i++) {
+		nvmf_rdma_poller_adapt_cq_polling(&rpoller, 0, 1);
+	}
+	CU_ASSERT(rpoller.cq_poll_interval == 1);
+
+	/* Otherwise the interval doubles after each streak of idle polls */
+	for (i = 0; i < NVMF_RDMA_CQ_IDLE_POLLS_BEFORE_BACKOFF; i++) {
+		nvmf_rdma_poller_adapt_cq_polling(&rpoller, 0, 4);
+	}
+	CU_ASSERT(rpoller.cq_poll_interval == 2);
+	for (i = 0; i < 2 * NVMF_RDMA_CQ_IDLE_POLLS_BEFORE_BACKOFF; i++) {
+		nvmf_rdma_poller_adapt_cq_polling(&rpoller, 0, 4);
+	}
+	CU_ASSERT(rpoller.cq_poll_interval == 4);
+	CU_ASSERT(rpoller.cq_polls_skipped == 0);
+
+	/* Any completion resets it */
+	rpoller.cq_polls_skipped = 3;
+	nvmf_rdma_poller_adapt_cq_polling(&rpoller, 1, 4);
+	CU_ASSERT(rpoller.cq_poll_interval == 1);
+	CU_ASSERT(rpoller.cq_idle_polls == 0);
+	CU_ASSERT(rpoller.cq_polls_skipped == 0);
+}
+
 static void
 test_nvmf_rdma_resize_cq(void)
 {
@@ -1431,6 +1482,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_rdma_resources_create);
 	CU_ADD_TEST(suite, test_nvmf_rdma_qpair_compare);
 	CU_ADD_TEST(suite, test_nvmf_rdma_resize_cq);
+	CU_ADD_TEST(suite, test_nvmf_rdma_poller_adapt_cq_polling);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
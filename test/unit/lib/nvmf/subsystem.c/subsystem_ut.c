@@ -24,6 +24,9 @@ DEFINE_STUB(spdk_bdev_module_claim_bdev,
 DEFINE_STUB_V(spdk_bdev_module_release_bdev,
 	      (struct spdk_bdev *bdev));
 
+DEFINE_STUB_V(nvmf_bdev_ctrlr_identify_ns,
+	      (struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *nsdata, bool dif_insert_or_strip));
+
 DEFINE_STUB(spdk_bdev_get_block_size, uint32_t,
 	    (const struct spdk_bdev *bdev), 512);
 
@@ -53,6 +56,21 @@ DEFINE_STUB(nvmf_ctrlr_async_event_ana_change_notice,
 	    int,
 	    (struct spdk_nvmf_ctrlr *ctrlr), 0);
 
+static int g_ana_log_page_builds;
+static bool g_ana_log_page_fail;
+
+struct nvmf_ana_log_page *
+nvmf_ctrlr_build_ana_log_page(struct spdk_nvmf_subsystem *subsystem,
+			      const struct spdk_nvmf_subsystem_listener *listener)
+{
+	g_ana_log_page_builds++;
+	if (g_ana_log_page_fail) {
+		return NULL;
+	}
+
+	return calloc(1, sizeof(struct nvmf_ana_log_page));
+}
+
 DEFINE_STUB(spdk_nvme_transport_id_trtype_str,
 	    const char *,
 	    (enum spdk_nvme_transport_type trtype), NULL);
@@ -1308,6 +1326,8 @@ test_spdk_nvmf_ns_event(void)
 	SPDK_CU_ASSERT_FATAL(subsystem.ns != NULL);
 	subsystem.ana_group = calloc(subsystem.max_nsid, sizeof(uint32_t));
 	SPDK_CU_ASSERT_FATAL(subsystem.ana_group != NULL);
+	TAILQ_INIT(&subsystem.removed_ns);
+	TAILQ_INIT(&subsystem.stale_ana_log_pages);
 
 	tgt.max_subsystems = 1024;
 	tgt.subsystem_ids = spdk_bit_array_create(tgt.max_subsystems);
@@ -1358,6 +1378,9 @@ test_spdk_nvmf_ns_event(void)
 	CU_ASSERT(&ctrlr == g_ns_changed_ctrlr);
 	CU_ASSERT(NULL == subsystem.ns[0]);
 	CU_ASSERT(SPDK_NVMF_SUBSYSTEM_ACTIVE == subsystem.state);
+	/* Only the namespace was paused, so it was freed by the resume */
+	CU_ASSERT(1 == subsystem.pause_nsid);
+	CU_ASSERT(TAILQ_EMPTY(&subsystem.removed_ns));
 
 	spdk_io_device_unregister(&tgt, NULL);
 
@@ -1714,12 +1737,18 @@ test_nvmf_ns_reservation_restore(void)
 	CU_ASSERT(rc == -EINVAL);
 }
 
+static void
+ut_subsystem_state_change_done(struct spdk_nvmf_subsystem *subsystem, void *cb_arg, int status)
+{
+	*(int *)cb_arg = status;
+}
+
 static void
 test_nvmf_subsystem_state_change(void)
 {
 	struct spdk_nvmf_tgt tgt = {};
 	struct spdk_nvmf_subsystem *subsystem, *discovery_subsystem;
-	int rc;
+	int rc, status;
 
 	tgt.max_subsystems = 1024;
 	tgt.subsystem_ids = spdk_bit_array_create(tgt.max_subsystems);
@@ -1747,6 +1776,24 @@ test_nvmf_subsystem_state_change(void)
 	poll_threads();
 	CU_ASSERT(subsystem->state == SPDK_NVMF_SUBSYSTEM_ACTIVE);
 
+	/* A pause while a different namespace is paused is reported through the callback */
+	rc = spdk_nvmf_subsystem_pause(subsystem, 1, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED);
+	status = 1;
+	rc = spdk_nvmf_subsystem_pause(subsystem, 0, ut_subsystem_state_change_done, &status);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(status == -EBUSY);
+	status = 1;
+	rc = spdk_nvmf_subsystem_pause(subsystem, 1, ut_subsystem_state_change_done, &status);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(status == 0);
+	rc = spdk_nvmf_subsystem_resume(subsystem, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(subsystem->state == SPDK_NVMF_SUBSYSTEM_ACTIVE);
+
 	rc = spdk_nvmf_subsystem_pause(subsystem, SPDK_NVME_GLOBAL_NS_TAG, NULL, NULL);
 	CU_ASSERT(rc == 0);
 	rc = spdk_nvmf_subsystem_stop(subsystem, NULL, NULL);
@@ -1774,6 +1821,57 @@ test_nvmf_subsystem_state_change(void)
 	spdk_bit_array_free(&tgt.subsystem_ids);
 }
 
+static void
+test_nvmf_subsystem_update_ana_log_pages(void)
+{
+	struct spdk_nvmf_subsystem subsystem = {};
+	struct spdk_nvmf_subsystem_listener listener[2] = {
+		{ .subsystem = &subsystem },
+		{ .subsystem = &subsystem },
+	};
+	struct nvmf_ana_log_page *old_page;
+	int i;
+
+	TAILQ_INIT(&subsystem.listeners);
+	TAILQ_INIT(&subsystem.stale_ana_log_pages);
+	TAILQ_INSERT_TAIL(&subsystem.listeners, &listener[0], link);
+	TAILQ_INSERT_TAIL(&subsystem.listeners, &listener[1], link);
+
+	/* Each listener gets its own page */
+	g_ana_log_page_builds = 0;
+	nvmf_subsystem_update_ana_log_pages(&subsystem);
+	CU_ASSERT(g_ana_log_page_builds == 2);
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT(listener[i].ana_log_page != NULL);
+	}
+	CU_ASSERT(listener[0].ana_log_page != listener[1].ana_log_page);
+
+	/* A replaced page is freed right away while the subsystem is not paused */
+	nvmf_subsystem_update_ana_log_pages(&subsystem);
+	CU_ASSERT(g_ana_log_page_builds == 4);
+	CU_ASSERT(TAILQ_EMPTY(&subsystem.stale_ana_log_pages));
+
+	/* While a single namespace is paused, the replaced pages are kept until the resume */
+	subsystem.state = SPDK_NVMF_SUBSYSTEM_PAUSED;
+	subsystem.pause_nsid = 5;
+	old_page = listener[0].ana_log_page;
+	nvmf_subsystem_update_ana_log_pages(&subsystem);
+	CU_ASSERT(listener[0].ana_log_page != old_page);
+	CU_ASSERT(TAILQ_FIRST(&subsystem.stale_ana_log_pages) == old_page);
+
+	nvmf_subsystem_free_retired(&subsystem);
+	CU_ASSERT(TAILQ_EMPTY(&subsystem.stale_ana_log_pages));
+
+	/* If the page cannot be built, the commands build it themselves */
+	subsystem.state = SPDK_NVMF_SUBSYSTEM_INACTIVE;
+	subsystem.pause_nsid = 0;
+	g_ana_log_page_fail = true;
+	nvmf_subsystem_update_ana_log_pages(&subsystem);
+	g_ana_log_page_fail = false;
+	CU_ASSERT(listener[0].ana_log_page == NULL);
+	CU_ASSERT(listener[1].ana_log_page == NULL);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1805,6 +1903,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_valid_nqn);
 	CU_ADD_TEST(suite, test_nvmf_ns_reservation_restore);
 	CU_ADD_TEST(suite, test_nvmf_subsystem_state_change);
+	CU_ADD_TEST(suite, test_nvmf_subsystem_update_ana_log_pages);
 
 	allocate_threads(1);
 	set_thread(0);
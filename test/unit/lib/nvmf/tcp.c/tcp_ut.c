@@ -107,6 +107,11 @@ DEFINE_STUB(nvmf_bdev_ctrlr_read_cmd,
 	     struct spdk_nvmf_request *req),
 	    0);
 
+DEFINE_STUB(nvmf_poll_group_get_ns_io_stat,
+	    struct spdk_nvmf_ns_io_stat *,
+	    (struct spdk_nvmf_subsystem_poll_group *sgroup, uint32_t nsid, const char *hostnqn),
+	    NULL);
+
 DEFINE_STUB(nvmf_bdev_ctrlr_write_cmd,
 	    int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
@@ -188,10 +193,15 @@ DEFINE_STUB_V(spdk_nvmf_request_free_buffers,
 	      (struct spdk_nvmf_request *req, struct spdk_nvmf_transport_poll_group *group,
 	       struct spdk_nvmf_transport *transport));
 
-DEFINE_STUB(spdk_sock_get_optimal_sock_group,
-	    int,
-	    (struct spdk_sock *sock, struct spdk_sock_group **group, struct spdk_sock_group *hint),
-	    0);
+static struct spdk_sock_group *g_optimal_sock_group;
+
+int
+spdk_sock_get_optimal_sock_group(struct spdk_sock *sock, struct spdk_sock_group **group,
+				 struct spdk_sock_group *hint)
+{
+	*group = g_optimal_sock_group;
+	return 0;
+}
 
 DEFINE_STUB(spdk_sock_group_get_ctx,
 	    void *,
@@ -525,6 +535,72 @@ test_nvmf_tcp_poll_group_create(void)
 	spdk_thread_destroy(thread);
 }
 
+static void
+test_nvmf_tcp_get_optimal_poll_group(void)
+{
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_poll_group tgroups[3] = {};
+	struct spdk_nvmf_poll_group groups[3] = {};
+	struct spdk_sock_group sock_groups[3] = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_transport_poll_group *result;
+	int i;
+
+	TAILQ_INIT(&ttransport.poll_groups);
+	for (i = 0; i < 3; i++) {
+		pthread_mutex_init(&groups[i].mutex, NULL);
+		tgroups[i].group.group = &groups[i];
+		tgroups[i].sock_group = &sock_groups[i];
+		TAILQ_INSERT_TAIL(&ttransport.poll_groups, &tgroups[i], link);
+	}
+	ttransport.next_pg = &tgroups[0];
+	tqpair.qpair.transport = &ttransport.transport;
+
+	/* No load at all, poll groups are picked round robin */
+	for (i = 0; i < 4; i++) {
+		result = nvmf_tcp_get_optimal_poll_group(&tqpair.qpair);
+		CU_ASSERT(result == &tgroups[i % 3].group);
+	}
+	CU_ASSERT(ttransport.next_pg == &tgroups[1]);
+
+	/* The poll group with the fewest I/O qpairs wins */
+	groups[0].stat.current_io_qpairs = 2;
+	groups[1].stat.current_io_qpairs = 3;
+	groups[2].current_unassociated_qpairs = 1;
+	result = nvmf_tcp_get_optimal_poll_group(&tqpair.qpair);
+	CU_ASSERT(result == &tgroups[2].group);
+	CU_ASSERT(ttransport.next_pg == &tgroups[0]);
+
+	/* A busier thread outweighs the qpair count, unless the difference is
+	 * within the same busy bucket */
+	tgroups[2].load.busy_pct = 40;
+	tgroups[0].load.busy_pct = 5;
+	result = nvmf_tcp_get_optimal_poll_group(&tqpair.qpair);
+	CU_ASSERT(result == &tgroups[0].group);
+
+	/* Sock placement is honored while its poll group isn't much busier */
+	MOCK_SET(spdk_sock_group_get_ctx, &tgroups[2].group);
+	g_optimal_sock_group = &sock_groups[2];
+	tgroups[2].load.busy_pct = NVMF_TCP_PLACEMENT_MAX_BUSY_DELTA_PCT;
+	tgroups[0].load.busy_pct = 0;
+	ttransport.next_pg = &tgroups[0];
+	result = nvmf_tcp_get_optimal_poll_group(&tqpair.qpair);
+	CU_ASSERT(result == &tgroups[2].group);
+	CU_ASSERT(ttransport.next_pg == &tgroups[0]);
+
+	/* ... and ignored once it is */
+	tgroups[2].load.busy_pct = NVMF_TCP_PLACEMENT_MAX_BUSY_DELTA_PCT + 1;
+	result = nvmf_tcp_get_optimal_poll_group(&tqpair.qpair);
+	CU_ASSERT(result == &tgroups[0].group);
+	CU_ASSERT(ttransport.next_pg == &tgroups[1]);
+
+	MOCK_CLEAR_P(spdk_sock_group_get_ctx);
+	g_optimal_sock_group = NULL;
+	for (i = 0; i < 3; i++) {
+		pthread_mutex_destroy(&groups[i].mutex);
+	}
+}
+
 static void
 test_nvmf_tcp_send_c2h_data(void)
 {
@@ -551,6 +627,7 @@ test_nvmf_tcp_send_c2h_data(void)
 	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_ERROR;
 
 	tcp_req.req.cmd = (union nvmf_h2c_msg *)&tcp_req.cmd;
+	tcp_req.req.rsp = (union nvmf_c2h_msg *)&tcp_req.rsp;
 
 	tcp_req.req.iov[0].iov_base = (void *)0xDEADBEEF;
 	tcp_req.req.iov[0].iov_len = 101;
@@ -578,6 +655,9 @@ test_nvmf_tcp_send_c2h_data(void)
 	CU_ASSERT((uint64_t)pdu.data_iov[2].iov_base == 0xC0FFEE);
 	CU_ASSERT(pdu.data_iov[2].iov_len == 99);
 
+	CU_ASSERT(!tcp_req.c2h_rsp_pending);
+	CU_ASSERT(pdu.sock_req.iovcnt == 4);
+
 	tcp_req.pdu_in_use = false;
 	tcp_req.rsp.cdw0 = 1;
 	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req);
@@ -585,6 +665,29 @@ test_nvmf_tcp_send_c2h_data(void)
 	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU);
 	CU_ASSERT((c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) == 0);
 
+	/* The capsule response is queued right behind the data, in the same socket request */
+	CU_ASSERT(tcp_req.c2h_rsp_pending);
+	CU_ASSERT(tcp_req.c2h_rsp.hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_CAPSULE_RESP);
+	CU_ASSERT(tcp_req.c2h_rsp.hdr.common.plen == sizeof(struct spdk_nvme_tcp_rsp));
+	CU_ASSERT(tcp_req.c2h_rsp.hdr.rccqe.cdw0 == 1);
+	CU_ASSERT(pdu.sock_req.iovcnt == 5);
+	CU_ASSERT(pdu.iov[4].iov_base == &tcp_req.c2h_rsp);
+	CU_ASSERT(pdu.iov[4].iov_len == sizeof(struct spdk_nvme_tcp_rsp));
+
+	/* With header digests, the digest follows the response header */
+	tcp_req.pdu_in_use = false;
+	tqpair.host_hdgst_enable = true;
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req);
+
+	CU_ASSERT(tcp_req.c2h_rsp_pending);
+	CU_ASSERT(tcp_req.c2h_rsp.hdr.common.flags & SPDK_NVME_TCP_CH_FLAGS_HDGSTF);
+	CU_ASSERT(tcp_req.c2h_rsp.hdr.common.plen == sizeof(struct spdk_nvme_tcp_rsp) +
+		  SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(pdu.iov[pdu.sock_req.iovcnt - 1].iov_base == &tcp_req.c2h_rsp);
+	CU_ASSERT(pdu.iov[pdu.sock_req.iovcnt - 1].iov_len == sizeof(struct spdk_nvme_tcp_rsp) +
+		  SPDK_NVME_TCP_DIGEST_LEN);
+	tqpair.host_hdgst_enable = false;
+
 	ttransport.tcp_opts.c2h_success = false;
 	tcp_req.pdu_in_use = false;
 	tcp_req.rsp.cdw0 = 0;
@@ -744,6 +847,105 @@ test_nvmf_tcp_in_capsule_data_handle(void)
 	CU_ASSERT(tqpair.pdu_in_progress->req == (void *)&tcp_req2);
 }
 
+static void
+test_nvmf_tcp_sock_process_multiple_pdus(void)
+{
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req = {};
+	struct nvme_tcp_pdu pdus[2] = {};
+	struct spdk_nvme_tcp_h2c_data_hdr *h2c_data;
+	uint8_t stream[4 * (sizeof(*h2c_data) + 16)];
+	uint8_t data[64] = {}, expected[64];
+	size_t pdu_len = sizeof(*h2c_data) + 16;
+	uint32_t i;
+	int rc;
+
+	tqpair.state = NVME_TCP_QPAIR_STATE_RUNNING;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY;
+	tqpair.qpair.transport = &ttransport.transport;
+	tqpair.sock = (struct spdk_sock *)0xDEADBEEF;
+	tqpair.resource_count = 1;
+	tqpair.reqs = &tcp_req;
+	SLIST_INIT(&tqpair.tcp_pdu_free_queue);
+	SLIST_INSERT_HEAD(&tqpair.tcp_pdu_free_queue, &pdus[0], slist);
+	SLIST_INSERT_HEAD(&tqpair.tcp_pdu_free_queue, &pdus[1], slist);
+
+	/* The second PDU straddles both buffers, so its payload is read with readv */
+	tcp_req.req.iov[0].iov_base = data;
+	tcp_req.req.iov[0].iov_len = 24;
+	tcp_req.req.iov[1].iov_base = data + 24;
+	tcp_req.req.iov[1].iov_len = sizeof(data) - 24;
+	tcp_req.req.iovcnt = 2;
+	tcp_req.req.length = sizeof(data);
+	tcp_req.req.cmd = (union nvmf_h2c_msg *)&tcp_req.cmd;
+	tcp_req.req.cmd->nvme_cmd.cid = 1;
+	tcp_req.ttag = 1;
+	/* Keep the request from executing once all of its data has arrived */
+	tcp_req.state = TCP_REQUEST_STATE_AWAITING_R2T_ACK;
+
+	/* Four H2C data PDUs carrying 16 bytes each */
+	for (i = 0; i < sizeof(expected); i++) {
+		expected[i] = i + 1;
+	}
+	memset(stream, 0, sizeof(stream));
+	for (i = 0; i < 4; i++) {
+		h2c_data = (struct spdk_nvme_tcp_h2c_data_hdr *)&stream[i * pdu_len];
+		h2c_data->common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_H2C_DATA;
+		h2c_data->common.hlen = sizeof(*h2c_data);
+		h2c_data->common.pdo = sizeof(*h2c_data);
+		h2c_data->common.plen = pdu_len;
+		h2c_data->cccid = 1;
+		h2c_data->ttag = 1;
+		h2c_data->datao = i * 16;
+		h2c_data->datal = 16;
+		memcpy(&stream[i * pdu_len + sizeof(*h2c_data)], &expected[i * 16], 16);
+	}
+
+	/* Three complete PDUs followed by the header and half of the payload of the fourth
+	 * one, all available at once. */
+	g_sock_recv_data = stream;
+	g_sock_recv_len = 3 * pdu_len + sizeof(*h2c_data) + 8;
+	g_sock_recv_offset = 0;
+
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(g_sock_recv_offset == g_sock_recv_len);
+	CU_ASSERT(tcp_req.h2c_offset == 48);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD);
+	SPDK_CU_ASSERT_FATAL(tqpair.pdu_in_progress != NULL);
+	CU_ASSERT(tqpair.pdu_in_progress->hdr.h2c_data.datao == 48);
+	CU_ASSERT(tqpair.pdu_in_progress->rw_offset == 8);
+	CU_ASSERT(tqpair.tcp_pdu_working_count == 1);
+	CU_ASSERT(memcmp(data, expected, 56) == 0);
+	CU_ASSERT(spdk_mem_all_zero(data + 56, sizeof(data) - 56));
+
+	/* Nothing new arrived - nothing gets processed again */
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(tcp_req.h2c_offset == 48);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD);
+	CU_ASSERT(tqpair.pdu_in_progress->rw_offset == 8);
+
+	/* The rest of the last PDU arrives */
+	g_sock_recv_len = sizeof(stream);
+
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(g_sock_recv_offset == sizeof(stream));
+	CU_ASSERT(tcp_req.h2c_offset == sizeof(data));
+	CU_ASSERT(tcp_req.state == TCP_REQUEST_STATE_AWAITING_R2T_ACK);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH);
+	CU_ASSERT(tqpair.pdu_in_progress != NULL);
+	CU_ASSERT(tqpair.pdu_in_progress->ch_valid_bytes == 0);
+	CU_ASSERT(tqpair.tcp_pdu_working_count == 1);
+	CU_ASSERT(memcmp(data, expected, sizeof(data)) == 0);
+
+	g_sock_recv_data = NULL;
+	g_sock_recv_len = 0;
+	g_sock_recv_offset = 0;
+}
+
 static void
 test_nvmf_tcp_qpair_init_mem_resource(void)
 {
@@ -1478,9 +1680,11 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_create);
 	CU_ADD_TEST(suite, test_nvmf_tcp_destroy);
 	CU_ADD_TEST(suite, test_nvmf_tcp_poll_group_create);
+	CU_ADD_TEST(suite, test_nvmf_tcp_get_optimal_poll_group);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_data);
 	CU_ADD_TEST(suite, test_nvmf_tcp_h2c_data_hdr_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_in_capsule_data_handle);
+	CU_ADD_TEST(suite, test_nvmf_tcp_sock_process_multiple_pdus);
 	CU_ADD_TEST(suite, test_nvmf_tcp_qpair_init_mem_resource);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_term_req);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_capsule_resp_pdu);
@@ -248,6 +248,36 @@ test_nvmf_vfio_user_create_destroy(void)
 	CU_ASSERT(done == 1);
 }
 
+static void
+test_vfio_user_cq_to_poll_group(void)
+{
+	struct nvmf_vfio_user_transport vu_transport = {};
+	struct nvmf_vfio_user_poll_group vu_groups[4] = {};
+	uint16_t cqid;
+	int i;
+
+	TAILQ_INIT(&vu_transport.poll_groups);
+	for (i = 0; i < 4; i++) {
+		TAILQ_INSERT_TAIL(&vu_transport.poll_groups, &vu_groups[i], link);
+	}
+
+	/* I/O CQs are spread over all poll groups, starting after the admin queue's one */
+	for (cqid = 1; cqid <= 8; cqid++) {
+		CU_ASSERT(vfio_user_cq_to_poll_group(&vu_transport, &vu_groups[0], cqid) ==
+			  &vu_groups[cqid % 4]);
+	}
+
+	/* The offset wraps around the end of the list */
+	CU_ASSERT(vfio_user_cq_to_poll_group(&vu_transport, &vu_groups[2], 1) == &vu_groups[3]);
+	CU_ASSERT(vfio_user_cq_to_poll_group(&vu_transport, &vu_groups[2], 2) == &vu_groups[0]);
+	CU_ASSERT(vfio_user_cq_to_poll_group(&vu_transport, &vu_groups[3], 3) == &vu_groups[2]);
+
+	/* A single poll group gets everything */
+	TAILQ_INIT(&vu_transport.poll_groups);
+	TAILQ_INSERT_TAIL(&vu_transport.poll_groups, &vu_groups[1], link);
+	CU_ASSERT(vfio_user_cq_to_poll_group(&vu_transport, &vu_groups[1], 5) == &vu_groups[1]);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -261,6 +291,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_cmd_map_prps);
 	CU_ADD_TEST(suite, test_nvme_cmd_map_sgls);
 	CU_ADD_TEST(suite, test_nvmf_vfio_user_create_destroy);
+	CU_ADD_TEST(suite, test_vfio_user_cq_to_poll_group);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
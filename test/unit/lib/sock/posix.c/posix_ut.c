@@ -135,6 +135,230 @@ flush(void)
 	free(req2);
 }
 
+static void
+ktls_opts(void)
+{
+	struct spdk_sock_impl_opts opts, saved;
+	size_t len = sizeof(saved);
+	int rc;
+
+	rc = ssl_sock_impl_get_opts(&saved, &len);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(len == sizeof(saved));
+	CU_ASSERT(saved.enable_ktls == false);
+
+	/* Round-trip enable_ktls */
+	opts = saved;
+	opts.enable_ktls = true;
+	rc = ssl_sock_impl_set_opts(&opts, sizeof(opts));
+	CU_ASSERT(rc == 0);
+	memset(&opts, 0, sizeof(opts));
+	len = sizeof(opts);
+	rc = ssl_sock_impl_get_opts(&opts, &len);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(opts.enable_ktls == true);
+
+	/* A length that stops short of enable_ktls neither reports nor changes it */
+	len = offsetof(struct spdk_sock_impl_opts, enable_ktls);
+	memset(&opts, 0xff, sizeof(opts));
+	rc = ssl_sock_impl_get_opts(&opts, &len);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(*(uint8_t *)&opts.enable_ktls == 0xff);
+	opts.enable_ktls = false;
+	rc = ssl_sock_impl_set_opts(&opts, offsetof(struct spdk_sock_impl_opts, enable_ktls));
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_ssl_impl_opts.enable_ktls == true);
+
+	/* The posix implementation keeps its own copy */
+	CU_ASSERT(g_posix_impl_opts.enable_ktls == false);
+
+	rc = ssl_sock_impl_set_opts(&saved, sizeof(saved));
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_ssl_impl_opts.enable_ktls == false);
+}
+
+static void
+ktls_ssl_context(void)
+{
+	struct spdk_sock_impl_opts impl_opts = g_ssl_impl_opts;
+	struct spdk_sock_opts opts = {};
+	SSL_CTX *ctx;
+
+	impl_opts.enable_ktls = false;
+	ctx = posix_sock_create_ssl_context(TLS_client_method(), &opts, &impl_opts);
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+#ifdef SSL_OP_ENABLE_KTLS
+	CU_ASSERT((SSL_CTX_get_options(ctx) & SSL_OP_ENABLE_KTLS) == 0);
+#endif
+	SSL_CTX_free(ctx);
+
+	/* Without kTLS support in OpenSSL, asking for it must fail the context
+	 * rather than silently fall back to user space encryption. */
+	impl_opts.enable_ktls = true;
+	ctx = posix_sock_create_ssl_context(TLS_client_method(), &opts, &impl_opts);
+#ifdef SSL_OP_ENABLE_KTLS
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	CU_ASSERT((SSL_CTX_get_options(ctx) & SSL_OP_ENABLE_KTLS) != 0);
+	SSL_CTX_free(ctx);
+#else
+	CU_ASSERT(ctx == NULL);
+#endif
+}
+
+/* OpenSSL issues the TCP_ULP and TLS_TX/TLS_RX setsockopt() calls itself at the end of
+ * the handshake and reports the outcome through BIO_get_ktls_send/recv(), which is what
+ * ktls_send/ktls_recv cache. The tests below drive both outcomes through those flags on
+ * an SSL object that never completed a handshake, so any data that reaches OpenSSL
+ * restarts the handshake and shows up on the peer as a TLS handshake record. */
+static SSL *
+ut_ssl_connect_setup(SSL_CTX **ctx, int fds[2])
+{
+	SSL *ssl;
+	int rc;
+
+	rc = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	*ctx = SSL_CTX_new(TLS_client_method());
+	SPDK_CU_ASSERT_FATAL(*ctx != NULL);
+	ssl = SSL_new(*ctx);
+	SPDK_CU_ASSERT_FATAL(ssl != NULL);
+	SSL_set_fd(ssl, fds[0]);
+	SSL_set_connect_state(ssl);
+
+	return ssl;
+}
+
+static void
+ut_ssl_connect_cleanup(SSL_CTX *ctx, SSL *ssl, int fds[2])
+{
+	SSL_free(ssl);
+	SSL_CTX_free(ctx);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static bool
+ut_peer_got_handshake(int fd)
+{
+	uint8_t buf[512];
+	ssize_t rc;
+
+	rc = read(fd, buf, sizeof(buf));
+
+	return rc > 0 && buf[0] == 0x16;
+}
+
+static void
+ktls_send(void)
+{
+	struct spdk_posix_sock_group_impl group = {};
+	struct spdk_posix_sock psock = {};
+	struct spdk_sock *sock = &psock.base;
+	struct spdk_sock_request *req;
+	char data[2][32] = {};
+	SSL_CTX *ctx;
+	bool cb_arg;
+	int fds[2];
+	int rc;
+
+	TAILQ_INIT(&sock->queued_reqs);
+	TAILQ_INIT(&sock->pending_reqs);
+	sock->group_impl = &group.base;
+	psock.ssl = ut_ssl_connect_setup(&ctx, fds);
+	psock.fd = fds[0];
+
+	req = calloc(1, sizeof(struct spdk_sock_request) + 2 * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req != NULL);
+	SPDK_SOCK_REQUEST_IOV(req, 0)->iov_base = data[0];
+	SPDK_SOCK_REQUEST_IOV(req, 0)->iov_len = sizeof(data[0]);
+	SPDK_SOCK_REQUEST_IOV(req, 1)->iov_base = data[1];
+	SPDK_SOCK_REQUEST_IOV(req, 1)->iov_len = sizeof(data[1]);
+	req->iovcnt = 2;
+	req->cb_fn = _req_cb;
+	req->cb_arg = &cb_arg;
+
+	/* TLS_TX installed - the kernel frames all iovecs with a single sendmsg */
+	psock.ktls_send = true;
+	spdk_sock_request_queue(sock, req);
+	MOCK_SET(sendmsg, 64);
+	cb_arg = false;
+	rc = _sock_flush(sock);
+	CU_ASSERT(rc == 64);
+	CU_ASSERT(cb_arg == true);
+	CU_ASSERT(TAILQ_EMPTY(&sock->queued_reqs));
+	CU_ASSERT(!ut_peer_got_handshake(fds[1]));
+
+	/* TLS_TX not installed - the data has to go through OpenSSL, not sendmsg */
+	psock.ktls_send = false;
+	spdk_sock_request_queue(sock, req);
+	cb_arg = false;
+	rc = _sock_flush(sock);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(errno == EAGAIN);
+	CU_ASSERT(cb_arg == false);
+	CU_ASSERT(TAILQ_FIRST(&sock->queued_reqs) == req);
+	CU_ASSERT(ut_peer_got_handshake(fds[1]));
+	CU_ASSERT(psock.ktls_send == false);
+	TAILQ_REMOVE(&sock->queued_reqs, req, internal.link);
+	MOCK_CLEAR(sendmsg);
+
+	free(req);
+	ut_ssl_connect_cleanup(ctx, psock.ssl, fds);
+}
+
+static void
+ktls_recv(void)
+{
+	struct spdk_posix_sock psock = {};
+	const char msg[] = "plaintext";
+	char buf[64];
+	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+	SSL_CTX *ctx;
+	int fds[2];
+	ssize_t rc;
+
+	psock.ssl = ut_ssl_connect_setup(&ctx, fds);
+	psock.fd = fds[0];
+
+	/* TLS_RX installed - the kernel hands out decrypted data with a plain readv */
+	psock.ktls_recv = true;
+	rc = write(fds[1], msg, sizeof(msg));
+	CU_ASSERT(rc == sizeof(msg));
+	memset(buf, 0, sizeof(buf));
+	rc = posix_sock_ssl_readv(&psock, &iov, 1);
+	CU_ASSERT(rc == sizeof(msg));
+	CU_ASSERT(memcmp(buf, msg, sizeof(msg)) == 0);
+	CU_ASSERT(!ut_peer_got_handshake(fds[1]));
+
+	/* Nothing to read is reported as is, without involving OpenSSL */
+	rc = posix_sock_ssl_readv(&psock, &iov, 1);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(errno == EAGAIN);
+	CU_ASSERT(!ut_peer_got_handshake(fds[1]));
+
+	/* A non-data record fails the kernel read with EIO and is left to OpenSSL */
+	MOCK_SET(readv, -1);
+	errno = EIO;
+	rc = posix_sock_ssl_readv(&psock, &iov, 1);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(errno == EAGAIN);
+	CU_ASSERT(ut_peer_got_handshake(fds[1]));
+	MOCK_CLEAR(readv);
+	ut_ssl_connect_cleanup(ctx, psock.ssl, fds);
+
+	/* TLS_RX not installed - everything is read through OpenSSL */
+	psock.ssl = ut_ssl_connect_setup(&ctx, fds);
+	psock.fd = fds[0];
+	psock.ktls_recv = false;
+	rc = posix_sock_ssl_readv(&psock, &iov, 1);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(errno == EAGAIN);
+	CU_ASSERT(ut_peer_got_handshake(fds[1]));
+	CU_ASSERT(psock.ktls_recv == false);
+	ut_ssl_connect_cleanup(ctx, psock.ssl, fds);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -146,6 +370,10 @@ main(int argc, char **argv)
 	suite = CU_add_suite("posix", NULL, NULL);
 
 	CU_ADD_TEST(suite, flush);
+	CU_ADD_TEST(suite, ktls_opts);
+	CU_ADD_TEST(suite, ktls_ssl_context);
+	CU_ADD_TEST(suite, ktls_send);
+	CU_ADD_TEST(suite, ktls_recv);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
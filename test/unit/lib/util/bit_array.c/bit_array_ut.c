@@ -317,6 +317,41 @@ test_mask_clear(void)
 	spdk_bit_array_free(&ba);
 }
 
+static void
+test_pool_allocate_at(void)
+{
+	struct spdk_bit_pool *pool;
+
+	pool = spdk_bit_pool_create(256);
+	SPDK_CU_ASSERT_FATAL(pool != NULL);
+
+	/* Allocate bits in the middle, the lowest free bit is not affected */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 100) == 0);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 100) == -EBUSY);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 256) == -EINVAL);
+	CU_ASSERT(spdk_bit_pool_is_allocated(pool, 100));
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == 255);
+	CU_ASSERT(spdk_bit_pool_allocate_bit(pool) == 0);
+
+	/* Allocating the lowest free bit moves it past the allocated ones */
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 2) == 0);
+	CU_ASSERT(spdk_bit_pool_allocate_bit_at(pool, 1) == 0);
+	CU_ASSERT(spdk_bit_pool_allocate_bit(pool) == 3);
+	CU_ASSERT(spdk_bit_pool_count_free(pool) == 251);
+
+	/* Free ranges: [4, 100) and [101, 256) */
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 0, 1) == 4);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 0, 96) == 4);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 0, 97) == 101);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 50, 64) == 101);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 150, 106) == 150);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 150, 107) == UINT32_MAX);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 0, 156) == UINT32_MAX);
+	CU_ASSERT(spdk_bit_pool_find_free_range(pool, 256, 1) == UINT32_MAX);
+
+	spdk_bit_pool_free(&pool);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -335,6 +370,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_count);
 	CU_ADD_TEST(suite, test_mask_store_load);
 	CU_ADD_TEST(suite, test_mask_clear);
+	CU_ADD_TEST(suite, test_pool_allocate_at);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -95,6 +95,7 @@ function unittest_nvme() {
 	$valgrind $testdir/lib/nvme/nvme_quirks.c/nvme_quirks_ut
 	$valgrind $testdir/lib/nvme/nvme_tcp.c/nvme_tcp_ut
 	$valgrind $testdir/lib/nvme/nvme_transport.c/nvme_transport_ut
+	$valgrind $testdir/lib/nvme/nvme_zns.c/nvme_zns_ut
 	$valgrind $testdir/lib/nvme/nvme_io_msg.c/nvme_io_msg_ut
 	$valgrind $testdir/lib/nvme/nvme_pcie_common.c/nvme_pcie_common_ut
 	$valgrind $testdir/lib/nvme/nvme_fabric.c/nvme_fabric_ut